@@ -0,0 +1,38 @@
+# Find the ZSTD includes and library.
+# 
+# This module defines
+# ZSTD_INCLUDE_DIR, where to locate zstd.h file
+# ZSTD_LIBRARIES, the libraries to link against to use zstd
+# ZSTD_FOUND.  If false, you cannot build anything that requires zstd.
+
+if(ZSTD_CONFIG_EXECUTABLE)
+  set(ZSTD_FIND_QUIETLY 1)
+endif()
+set(ZSTD_FOUND 0)
+
+find_path(ZSTD_INCLUDE_DIR zstd.h
+  $ENV{ZSTD_DIR}/include
+  /usr/local/include
+  /usr/include
+  /opt/zstd/include
+  DOC "Specify the directory containing zstd.h"
+)
+
+find_library(ZSTD_LIBRARY NAMES zstd PATHS
+  $ENV{ZSTD_DIR}/lib
+  /usr/local/lib
+  /usr/lib
+  /opt/zstd/lib
+  DOC "Specify the zstd library here."
+)
+
+if(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+  set(ZSTD_FOUND 1 )
+  if(NOT ZSTD_FIND_QUIETLY)
+     message(STATUS "Found ZSTD includes at ${ZSTD_INCLUDE_DIR}")
+     message(STATUS "Found ZSTD library at ${ZSTD_LIBRARY}")
+  endif()
+endif()
+
+set(ZSTD_LIBRARIES ${ZSTD_LIBRARY})
+mark_as_advanced(ZSTD_FOUND ZSTD_LIBRARY ZSTD_INCLUDE_DIR)
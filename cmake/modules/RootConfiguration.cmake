@@ -192,6 +192,16 @@ set(pythia8libdir ${PYTHIA8_LIBRARY_DIR})
 set(pythia8lib ${PYTHIA8_LIBRARY})
 set(pythia8cppflags)
 
+set(buildlz4 ${value${lz4}})
+set(lz4libdir ${LZ4_LIBRARY_DIR})
+set(lz4lib ${LZ4_LIBRARY})
+set(lz4incdir ${LZ4_INCLUDE_DIR})
+
+set(buildzstd ${value${zstd}})
+set(zstdlibdir ${ZSTD_LIBRARY_DIR})
+set(zstdlib ${ZSTD_LIBRARY})
+set(zstdincdir ${ZSTD_INCLUDE_DIR})
+
 set(buildfftw3 ${value${fftw3}})
 set(fftw3libdir ${FFTW3_LIBRARY_DIR})
 set(fftw3lib ${FFTW3_LIBRARY})
@@ -322,6 +332,8 @@ set(setresuid undef)
 set(hasmathmore ${has${mathmore}})
 set(haspthread ${has${CMAKE_USE_PTHREADS_INIT}})
 set(hasxft ${has${xft}})
+set(haslz4 ${has${lz4}})
+set(haszstd ${has${zstd}})
 set(hascling ${has${cling}})
 set(haslzmacompression ${has${lzma}})
 set(hascocoa ${has${cocoa}})
@@ -16,12 +16,15 @@
 //                                                                      //
 // Initial version: Apr 22, 2000                                        //
 //                                                                      //
-// A set of inline byte swapping routines for arrays.                   //
+// A set of byte swapping routines for arrays.                          //
 //                                                                      //
-// The bswapcpy16() and bswapcpy32() routines are used for packing      //
-// arrays of basic types into a buffer in a byte swapped order. Use     //
-// of asm and the `bswap' opcode (available on i486 and up) reduces     //
-// byte swapping overhead on linux.                                     //
+// The R__bswapcpy16(), R__bswapcpy32() and R__bswapcpy64() routines    //
+// are used for packing arrays of basic types into a buffer in a byte   //
+// swapped order (and for unpacking them again). Source and target do  //
+// not have to be aligned. On x86 the SSSE3 or AVX2 byte shuffle       //
+// instructions are used when the running CPU supports them; the        //
+// choice is made once, at the first call. Elsewhere a portable scalar  //
+// loop is used.                                                        //
 //                                                                      //
 // Use of routines is similar to that of memcpy.                        //
 //                                                                      //
@@ -30,11 +33,15 @@
 //    n - is a number of array elements to be copied and byteswapped.   //
 //        (It is not the number of bytes!)                              //
 //                                                                      //
-// For arrays of short type (2 bytes in size) use bswapcpy16().         //
-// For arrays of of 4-byte types (int, float) use bswapcpy32().         //
+// For arrays of short type (2 bytes in size) use R__bswapcpy16().      //
+// For arrays of 4-byte types (int, float) use R__bswapcpy32().         //
+// For arrays of 8-byte types (long long, double) use R__bswapcpy64().  //
 //                                                                      //
+// R__SetBswapcpyImpl() forces one of the implementations (mainly for   //
+// benchmarking); it returns false if the CPU does not support it.      //
 //                                                                      //
-// Author: Alexandre V. Vaniachine <AVVaniachine@lbl.gov>               //
+// Original i386 asm version:                                           //
+//         Alexandre V. Vaniachine <AVVaniachine@lbl.gov>               //
 //                                                                      //
 //////////////////////////////////////////////////////////////////////////
 
@@ -42,40 +49,23 @@
 #include <sys/types.h>
 #endif
 
-extern inline void * bswapcpy16(void * to, const void * from, size_t n)
-{
-int d0, d1, d2, d3;
-__asm__ __volatile__(
-        "cld\n"
-        "1:\tlodsw\n\t"
-        "rorw $8, %%ax\n\t"
-        "stosw\n\t"
-        "loop 1b\n\t"
-        :"=&c" (d0), "=&D" (d1), "=&S" (d2), "=&a" (d3)
-        :"0" (n), "1" ((long) to),"2" ((long) from)
-        :"memory");
-return (to);
-}
+enum ER__BswapcpyImpl {
+   kBswapcpyScalar = 0,  // portable loop
+   kBswapcpySSSE3  = 1,  // 128 bit pshufb
+   kBswapcpyAVX2   = 2,  // 256 bit vpshufb
+   kBswapcpyBest   = 3   // best one supported by the running CPU
+};
+
+void *R__bswapcpy16(void *to, const void *from, size_t n);
+void *R__bswapcpy32(void *to, const void *from, size_t n);
+void *R__bswapcpy64(void *to, const void *from, size_t n);
+
+int         R__GetBswapcpyImpl();
+const char *R__GetBswapcpyImplName();
+bool        R__SetBswapcpyImpl(int impl);
+
+// Backward compatible names.
+inline void *bswapcpy16(void *to, const void *from, size_t n) { return R__bswapcpy16(to, from, n); }
+inline void *bswapcpy32(void *to, const void *from, size_t n) { return R__bswapcpy32(to, from, n); }
 
-extern inline void * bswapcpy32(void * to, const void * from, size_t n)
-{
-int d0, d1, d2, d3;
-__asm__ __volatile__(
-        "cld\n"
-        "1:\tlodsl\n\t"
-#if !defined __i486__ && !defined __pentium__ && !defined __pentiumpro__ && \
-    !defined __pentium4__ && !defined __x86_64__
-        "rorw $8, %%ax\n\t"
-        "rorl $16, %%eax\n\t"
-        "rorw $8, %%ax\n\t"
-#else
-        "bswap %%eax\n\t"
-#endif
-        "stosl\n\t"
-        "loop 1b\n\t"
-        :"=&c" (d0), "=&D" (d1), "=&S" (d2), "=&a" (d3)
-        :"0" (n), "1" ((long) to),"2" ((long) from)
-        :"memory");
-return (to);
-}
 #endif
@@ -63,6 +63,11 @@ public:
 
    virtual void FileUnzipEvent(TFile *file, Long64_t pos, Double_t start, Int_t complen, Int_t objlen) = 0;
 
+   // Called by TBasket instead of FileUnzipEvent; branch is the TBranch the
+   // basket belongs to. By default forward to FileUnzipEvent.
+   virtual void BasketUnzipEvent(TObject * /* branch */, TFile *file, Long64_t pos, Double_t start, Int_t complen, Int_t objlen)
+                { FileUnzipEvent(file, pos, start, complen, objlen); }
+
    virtual void RateEvent(Double_t proctime, Double_t deltatime,
                           Long64_t eventsprocessed, Long64_t bytesRead) = 0;
 
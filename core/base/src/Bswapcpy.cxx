@@ -0,0 +1,267 @@
+// @(#)root/base:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2000, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// Bswapcpy                                                             //
+//                                                                      //
+// Bulk byte swapping copy routines used by TBufferFile to stream       //
+// arrays of basic types. See Bswapcpy.h.                               //
+//                                                                      //
+// On x86 with gcc >= 4.9 or clang >= 3.8 the SSSE3 and AVX2 kernels    //
+// are compiled with per function target attributes, so that the rest   //
+// of the library keeps the default instruction set; the kernel is      //
+// selected at run time according to the CPU features.                  //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "Rtypes.h"
+#include "Byteswap.h"
+#include "Bswapcpy.h"
+
+#if !defined(__INTEL_COMPILER) && (defined(__x86_64__) || defined(__i386__)) && \
+    ((defined(__clang__) && (__clang_major__ > 3 || (__clang_major__ == 3 && __clang_minor__ >= 8))) || \
+     (!defined(__clang__) && defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define R__BSWAPCPY_SIMD
+#include <immintrin.h>
+#define R__BSWAPCPY_TARGET(x) __attribute__((target(x)))
+#endif
+
+typedef void (*BswapcpyFunc_t)(char *to, const char *from, size_t n);
+
+static int            gBswapcpyImpl = -1;
+static BswapcpyFunc_t gBswapcpy16   = 0;
+static BswapcpyFunc_t gBswapcpy32   = 0;
+static BswapcpyFunc_t gBswapcpy64   = 0;
+
+//______________________________________________________________________________
+static inline UShort_t R__Swap(UShort_t x) { return Rbswap_16(x); }
+static inline UInt_t   R__Swap(UInt_t x)   { return Rbswap_32(x); }
+static inline ULong64_t R__Swap(ULong64_t x)
+{
+#ifdef Rbswap_64
+   return Rbswap_64(x);
+#else
+   UInt_t lo = (UInt_t)x, hi = (UInt_t)(x >> 32);
+   return ((ULong64_t)Rbswap_32(lo) << 32) | Rbswap_32(hi);
+#endif
+}
+
+//______________________________________________________________________________
+template <typename T>
+static inline void BswapcpyScalar(char *to, const char *from, size_t n)
+{
+   // Portable version, also used for the tails of the vectorised kernels.
+   // Source and target may be unaligned, hence the memcpy.
+
+   T x;
+   for (size_t i = 0; i < n; ++i, to += sizeof(T), from += sizeof(T)) {
+      memcpy(&x, from, sizeof(T));
+      x = R__Swap(x);
+      memcpy(to, &x, sizeof(T));
+   }
+}
+
+static void Bswapcpy16Scalar(char *to, const char *from, size_t n) { BswapcpyScalar<UShort_t>(to, from, n); }
+static void Bswapcpy32Scalar(char *to, const char *from, size_t n) { BswapcpyScalar<UInt_t>(to, from, n); }
+static void Bswapcpy64Scalar(char *to, const char *from, size_t n) { BswapcpyScalar<ULong64_t>(to, from, n); }
+
+#ifdef R__BSWAPCPY_SIMD
+
+// pshufb masks reversing the bytes of each 2, 4 and 8 byte element of a
+// 16 byte lane.
+static const unsigned char kShuffle16[16] = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8,11,10,13,12,15,14 };
+static const unsigned char kShuffle32[16] = { 3, 2, 1, 0, 7, 6, 5, 4,11,10, 9, 8,15,14,13,12 };
+static const unsigned char kShuffle64[16] = { 7, 6, 5, 4, 3, 2, 1, 0,15,14,13,12,11,10, 9, 8 };
+
+//______________________________________________________________________________
+R__BSWAPCPY_TARGET("ssse3")
+static size_t ShuffleSSSE3(char *to, const char *from, size_t nbytes, const unsigned char *shuffle)
+{
+   // Byte swap the leading multiple of 16 bytes; return the number of
+   // bytes done.
+
+   const __m128i mask = _mm_loadu_si128((const __m128i*)shuffle);
+   size_t i = 0;
+   for (; i + 64 <= nbytes; i += 64) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(from + i));
+      __m128i b = _mm_loadu_si128((const __m128i*)(from + i + 16));
+      __m128i c = _mm_loadu_si128((const __m128i*)(from + i + 32));
+      __m128i d = _mm_loadu_si128((const __m128i*)(from + i + 48));
+      _mm_storeu_si128((__m128i*)(to + i),      _mm_shuffle_epi8(a, mask));
+      _mm_storeu_si128((__m128i*)(to + i + 16), _mm_shuffle_epi8(b, mask));
+      _mm_storeu_si128((__m128i*)(to + i + 32), _mm_shuffle_epi8(c, mask));
+      _mm_storeu_si128((__m128i*)(to + i + 48), _mm_shuffle_epi8(d, mask));
+   }
+   for (; i + 16 <= nbytes; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(from + i));
+      _mm_storeu_si128((__m128i*)(to + i), _mm_shuffle_epi8(a, mask));
+   }
+   return i;
+}
+
+//______________________________________________________________________________
+R__BSWAPCPY_TARGET("avx2")
+static size_t ShuffleAVX2(char *to, const char *from, size_t nbytes, const unsigned char *shuffle)
+{
+   // Byte swap the leading multiple of 16 bytes; return the number of
+   // bytes done. vpshufb works within 128 bit lanes, so the 16 byte mask
+   // is simply broadcast to both lanes.
+
+   const __m128i mask128 = _mm_loadu_si128((const __m128i*)shuffle);
+   const __m256i mask = _mm256_broadcastsi128_si256(mask128);
+   size_t i = 0;
+   for (; i + 128 <= nbytes; i += 128) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(from + i));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(from + i + 32));
+      __m256i c = _mm256_loadu_si256((const __m256i*)(from + i + 64));
+      __m256i d = _mm256_loadu_si256((const __m256i*)(from + i + 96));
+      _mm256_storeu_si256((__m256i*)(to + i),      _mm256_shuffle_epi8(a, mask));
+      _mm256_storeu_si256((__m256i*)(to + i + 32), _mm256_shuffle_epi8(b, mask));
+      _mm256_storeu_si256((__m256i*)(to + i + 64), _mm256_shuffle_epi8(c, mask));
+      _mm256_storeu_si256((__m256i*)(to + i + 96), _mm256_shuffle_epi8(d, mask));
+   }
+   for (; i + 32 <= nbytes; i += 32) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(from + i));
+      _mm256_storeu_si256((__m256i*)(to + i), _mm256_shuffle_epi8(a, mask));
+   }
+   for (; i + 16 <= nbytes; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(from + i));
+      _mm_storeu_si128((__m128i*)(to + i), _mm_shuffle_epi8(a, mask128));
+   }
+   return i;
+}
+
+#define R__BSWAPCPY_KERNEL(bits, T, impl)                                     \
+static void Bswapcpy##bits##impl(char *to, const char *from, size_t n)        \
+{                                                                             \
+   size_t done = Shuffle##impl(to, from, n * sizeof(T), kShuffle##bits);      \
+   BswapcpyScalar<T>(to + done, from + done, n - done / sizeof(T));           \
+}
+
+R__BSWAPCPY_KERNEL(16, UShort_t,  SSSE3)
+R__BSWAPCPY_KERNEL(32, UInt_t,    SSSE3)
+R__BSWAPCPY_KERNEL(64, ULong64_t, SSSE3)
+R__BSWAPCPY_KERNEL(16, UShort_t,  AVX2)
+R__BSWAPCPY_KERNEL(32, UInt_t,    AVX2)
+R__BSWAPCPY_KERNEL(64, ULong64_t, AVX2)
+
+#undef R__BSWAPCPY_KERNEL
+
+//______________________________________________________________________________
+static bool CpuSupports(int impl)
+{
+   __builtin_cpu_init();
+   switch (impl) {
+      case kBswapcpySSSE3: return __builtin_cpu_supports("ssse3");
+      case kBswapcpyAVX2:  return __builtin_cpu_supports("avx2");
+      default:             return impl == kBswapcpyScalar;
+   }
+}
+
+#else
+
+//______________________________________________________________________________
+static bool CpuSupports(int impl)
+{
+   return impl == kBswapcpyScalar;
+}
+
+#endif
+
+//______________________________________________________________________________
+bool R__SetBswapcpyImpl(int impl)
+{
+   // Select the implementation used by the R__bswapcpy routines. With
+   // kBswapcpyBest the fastest one supported by the CPU is taken. Returns
+   // false, leaving the current selection unchanged, if impl is not
+   // supported. Not thread safe: call it before starting any I/O.
+
+   if (impl == kBswapcpyBest) {
+      impl = CpuSupports(kBswapcpyAVX2)  ? kBswapcpyAVX2 :
+             CpuSupports(kBswapcpySSSE3) ? kBswapcpySSSE3 : kBswapcpyScalar;
+   }
+   if (!CpuSupports(impl)) return false;
+
+   switch (impl) {
+#ifdef R__BSWAPCPY_SIMD
+      case kBswapcpyAVX2:
+         gBswapcpy16 = Bswapcpy16AVX2;
+         gBswapcpy32 = Bswapcpy32AVX2;
+         gBswapcpy64 = Bswapcpy64AVX2;
+         break;
+      case kBswapcpySSSE3:
+         gBswapcpy16 = Bswapcpy16SSSE3;
+         gBswapcpy32 = Bswapcpy32SSSE3;
+         gBswapcpy64 = Bswapcpy64SSSE3;
+         break;
+#endif
+      default:
+         gBswapcpy16 = Bswapcpy16Scalar;
+         gBswapcpy32 = Bswapcpy32Scalar;
+         gBswapcpy64 = Bswapcpy64Scalar;
+         break;
+   }
+   gBswapcpyImpl = impl;
+   return true;
+}
+
+//______________________________________________________________________________
+int R__GetBswapcpyImpl()
+{
+   // Return the implementation currently used by the R__bswapcpy routines.
+
+   if (gBswapcpyImpl < 0) R__SetBswapcpyImpl(kBswapcpyBest);
+   return gBswapcpyImpl;
+}
+
+//______________________________________________________________________________
+const char *R__GetBswapcpyImplName()
+{
+   // Return the name of the implementation currently in use.
+
+   switch (R__GetBswapcpyImpl()) {
+      case kBswapcpyAVX2:  return "avx2";
+      case kBswapcpySSSE3: return "ssse3";
+      default:             return "scalar";
+   }
+}
+
+//______________________________________________________________________________
+void *R__bswapcpy16(void *to, const void *from, size_t n)
+{
+   // Copy n 2 byte elements from from to to, swapping the bytes of each.
+
+   if (!gBswapcpy16) R__SetBswapcpyImpl(kBswapcpyBest);
+   (*gBswapcpy16)((char*)to, (const char*)from, n);
+   return to;
+}
+
+//______________________________________________________________________________
+void *R__bswapcpy32(void *to, const void *from, size_t n)
+{
+   // Copy n 4 byte elements from from to to, swapping the bytes of each.
+
+   if (!gBswapcpy32) R__SetBswapcpyImpl(kBswapcpyBest);
+   (*gBswapcpy32)((char*)to, (const char*)from, n);
+   return to;
+}
+
+//______________________________________________________________________________
+void *R__bswapcpy64(void *to, const void *from, size_t n)
+{
+   // Copy n 8 byte elements from from to to, swapping the bytes of each.
+
+   if (!gBswapcpy64) R__SetBswapcpyImpl(kBswapcpyBest);
+   (*gBswapcpy64)((char*)to, (const char*)from, n);
+   return to;
+}
@@ -0,0 +1,124 @@
+// @(#)root/lz4:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2013, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+/* The LZ4 compression algorithm (http://lz4.org).
+
+   The compressed buffer has the usual 9 bytes ROOT header: 'L', '4', the
+   format version, the compressed size and the uncompressed size (3 bytes
+   each), followed by a raw LZ4 block. Readers which do not know about LZ4
+   reject the buffer because of its signature.
+
+   R__HAS_LZ4 is defined in RConfigure.h when ROOT is built against
+   liblz4. Without it, R__zipLZ4 leaves the buffers uncompressed and
+   R__unzipLZ4 fails with an error message.
+*/
+
+#include "ZipLZ4.h"
+#include "RConfigure.h"
+#include <stdio.h>
+
+#ifdef R__HAS_LZ4
+#include "lz4.h"
+#include "lz4hc.h"
+
+static const int kHeaderSize = 9;
+static const char kVersion = 1;
+#endif
+
+int R__HasLZ4(void)
+{
+#ifdef R__HAS_LZ4
+   return 1;
+#else
+   return 0;
+#endif
+}
+
+void R__zipLZ4(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep)
+{
+#ifdef R__HAS_LZ4
+   int out_size;                  /* compressed size */
+   unsigned in_size = (unsigned) (*srcsize);
+
+   *irep = 0;
+
+   if (*tgtsize <= kHeaderSize) {
+      return;
+   }
+
+   if (*srcsize > 0xffffff || *srcsize < 0) {
+      return;
+   }
+
+   /* Levels 1 to 3 use the fast compressor, higher levels the
+      LZ4HC one; both are decompressed at the same speed. */
+   if (cxlevel > 9) cxlevel = 9;
+   if (cxlevel < 4) {
+      out_size = LZ4_compress_default(src, &tgt[kHeaderSize], *srcsize, *tgtsize - kHeaderSize);
+   } else {
+      out_size = LZ4_compress_HC(src, &tgt[kHeaderSize], *srcsize, *tgtsize - kHeaderSize, cxlevel);
+   }
+   if (out_size <= 0 || out_size > 0xffffff) {
+      /* No need to print an error message. We simply abandon the compression
+         the buffer cannot be compressed or compressed buffer would be larger than original buffer
+      */
+      return;
+   }
+
+   tgt[0] = 'L';  /* Signature of LZ4 */
+   tgt[1] = '4';
+   tgt[2] = kVersion;
+
+   tgt[3] = (char)(out_size & 0xff);
+   tgt[4] = (char)((out_size >> 8) & 0xff);
+   tgt[5] = (char)((out_size >> 16) & 0xff);
+
+   tgt[6] = (char)(in_size & 0xff);         /* decompressed size */
+   tgt[7] = (char)((in_size >> 8) & 0xff);
+   tgt[8] = (char)((in_size >> 16) & 0xff);
+
+   *irep = out_size + kHeaderSize;
+#else
+   (void)cxlevel; (void)srcsize; (void)src; (void)tgtsize; (void)tgt;
+   *irep = 0;
+#endif
+}
+
+void R__unzipLZ4(int *srcsize, unsigned char *src, int *tgtsize, unsigned char *tgt, int *irep)
+{
+#ifdef R__HAS_LZ4
+   int returnStatus;
+
+   *irep = 0;
+
+   if (src[2] != kVersion) {
+      fprintf(stderr,
+              "R__unzipLZ4: unsupported LZ4 format version %d\n",
+              (int)src[2]);
+      return;
+   }
+
+   returnStatus = LZ4_decompress_safe((const char *)(&src[kHeaderSize]), (char *)tgt,
+                                      *srcsize - kHeaderSize, *tgtsize);
+   if (returnStatus < 0) {
+      fprintf(stderr,
+              "R__unzipLZ4: error %d in LZ4_decompress_safe\n",
+              returnStatus);
+      return;
+   }
+
+   *irep = returnStatus;
+#else
+   (void)srcsize; (void)src; (void)tgtsize; (void)tgt;
+   *irep = 0;
+   fprintf(stderr,
+           "R__unzipLZ4: ROOT was built without LZ4 support\n");
+#endif
+}
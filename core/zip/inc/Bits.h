@@ -15,6 +15,8 @@
 #include "zlib.h"
 #include "RConfigure.h"
 #include "ZipLZMA.h"
+#include "ZipLZ4.h"
+#include "ZipZSTD.h"
 
 #include <stdio.h>
 
@@ -152,9 +154,15 @@ ulg R__bits_sent;   /* bit length of the compressed data */
    R__ZipMode = 2 : LZMA compression algorithm is used
    R__ZipMode = 0 or 3 : a very old compression algorithm is used
    (the very old algorithm is supported for backward compatibility)
+   R__ZipMode = 4 : LZ4 compression algorithm is used
+   R__ZipMode = 5 : Zstandard compression algorithm is used
    The LZMA algorithm requires the external XZ package be installed when linking
    is done. LZMA typically has significantly higher compression factors, but takes
    more CPU time and memory resources while compressing.
+   LZ4 and Zstandard are only available if ROOT was built with liblz4 and libzstd;
+   otherwise the buffers are left uncompressed. LZ4 decompresses several times
+   faster than ZLIB; Zstandard compresses about as well as ZLIB at higher speed,
+   and at high levels approaches LZMA while decompressing much faster.
 */
 int R__ZipMode = 1;
 
@@ -392,6 +400,88 @@ local int R__mem_read(char *b, unsigned bsize)
     }
 }
 
+#define HDRSIZE 9
+static  int error_flag;
+
+/* ===========================================================================
+   Compress a buffer with ZLIB, optionally with a preset dictionary.
+   Unlike the very old algorithm, this does not use any global state so that
+   buffers can be compressed concurrently by several threads.
+   Buffers compressed with a dictionary have the signature "ZD" instead of
+   "ZL" and can only be decompressed by R__unzipDict with the same dictionary.
+*/
+local void R__zipZLIB(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, const char *dict, int dictsize)
+{
+  int err;
+  z_stream stream;
+  unsigned zin_size, zout_size;
+  *irep = 0;
+
+  if (*tgtsize <= 0) {
+    R__error("target buffer too small");
+    return;
+  }
+  if (*srcsize > 0xffffff) {
+    R__error("source buffer too big");
+    return;
+  }
+
+
+  stream.next_in   = (Bytef*)src;
+  stream.avail_in  = (uInt)(*srcsize);
+
+  stream.next_out  = (Bytef*)(&tgt[HDRSIZE]);
+  stream.avail_out = (uInt)(*tgtsize);
+
+  stream.zalloc    = (alloc_func)0;
+  stream.zfree     = (free_func)0;
+  stream.opaque    = (voidpf)0;
+
+  if (cxlevel > 9) cxlevel = 9;
+  err = deflateInit(&stream, cxlevel);
+  if (err != Z_OK) {
+     printf("error %d in deflateInit (zlib)\n",err);
+     return;
+  }
+  if (dict && dictsize > 0) {
+     err = deflateSetDictionary(&stream, (const Bytef*)dict, (uInt)dictsize);
+     if (err != Z_OK) {
+        deflateEnd(&stream);
+        printf("error %d in deflateSetDictionary (zlib)\n",err);
+        return;
+     }
+  }
+
+  err = deflate(&stream, Z_FINISH);
+  if (err != Z_STREAM_END) {
+     deflateEnd(&stream);
+     /* No need to print an error message. We simply abandon the compression
+        the buffer cannot be compressed or compressed buffer would be larger than original buffer
+        printf("error %d in deflate (zlib) is not = %d\n",err,Z_STREAM_END);
+     */
+     return;
+  }
+
+  err = deflateEnd(&stream);
+
+  tgt[0] = 'Z';               /* Signature ZLib, 'D' if a dictionary is used */
+  tgt[1] = (dict && dictsize > 0) ? 'D' : 'L';
+  tgt[2] = (char) Z_DEFLATED;
+
+  zin_size  = (unsigned) (*srcsize);
+  zout_size = stream.total_out;             /* compressed size */
+  tgt[3] = (char)(zout_size & 0xff);
+  tgt[4] = (char)((zout_size >> 8) & 0xff);
+  tgt[5] = (char)((zout_size >> 16) & 0xff);
+
+  tgt[6] = (char)(zin_size & 0xff);         /* decompressed size */
+  tgt[7] = (char)((zin_size >> 8) & 0xff);
+  tgt[8] = (char)((zin_size >> 16) & 0xff);
+
+  *irep = stream.total_out + HDRSIZE;
+  return;
+}
+
 /***********************************************************************
  *                                                                     *
  * Name: R__zip                                      Date:    20.01.95 *
@@ -410,9 +500,6 @@ local int R__mem_read(char *b, unsigned bsize)
  *         irep - size of compressed data (0 - if error)               *
  *                                                                     *
  ***********************************************************************/
-#define HDRSIZE 9
-static  int error_flag;
-
 void R__zipMultipleAlgorithm(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, int compressionAlgorithm)
      /* int cxlevel;                      compression level */
      /* int  *srcsize, *tgtsize, *irep;   source and target sizes, replay */
@@ -421,8 +508,9 @@ void R__zipMultipleAlgorithm(int cxlevel, int *srcsize, char *src, int *tgtsize,
      /*                      1 = zlib */
      /*                      2 = lzma */
      /*                      3 = old */
+     /*                      4 = lz4 */
+     /*                      5 = zstd */
 {
-  int err;
   int method   = Z_DEFLATED;
 
   if (cxlevel <= 0) {
@@ -440,6 +528,18 @@ void R__zipMultipleAlgorithm(int cxlevel, int *srcsize, char *src, int *tgtsize,
     return;
   }
 
+  // The LZ4 compression algorithm
+  if (compressionAlgorithm == 4) {
+    R__zipLZ4(cxlevel, srcsize, src, tgtsize, tgt, irep);
+    return;
+  }
+
+  // The Zstandard compression algorithm
+  if (compressionAlgorithm == 5) {
+    R__zipZSTD(cxlevel, srcsize, src, tgtsize, tgt, irep);
+    return;
+  }
+
   // The very old algorithm for backward compatibility
   // 0 for selecting with R__ZipMode in a backward compatible way
   // 3 for selecting in other cases
@@ -493,63 +593,10 @@ void R__zipMultipleAlgorithm(int cxlevel, int *srcsize, char *src, int *tgtsize,
 
   // 1 is for ZLIB (which is the default), ZLIB is also used for any illegal
   // algorithm setting
+  // Unlike the very old algorithm, this branch does not use any global
+  // state so that buffers can be compressed concurrently by several threads.
   } else {
-
-    z_stream stream;
-    *irep = 0;
-
-    error_flag   = 0;
-    if (*tgtsize <= 0) R__error("target buffer too small");
-    if (error_flag != 0) return;
-    if (*srcsize > 0xffffff) R__error("source buffer too big");
-    if (error_flag != 0) return;
-
-
-    stream.next_in   = (Bytef*)src;
-    stream.avail_in  = (uInt)(*srcsize);
-
-    stream.next_out  = (Bytef*)(&tgt[HDRSIZE]);
-    stream.avail_out = (uInt)(*tgtsize);
-
-    stream.zalloc    = (alloc_func)0;
-    stream.zfree     = (free_func)0;
-    stream.opaque    = (voidpf)0;
-
-    if (cxlevel > 9) cxlevel = 9;
-    err = deflateInit(&stream, cxlevel);
-    if (err != Z_OK) {
-       printf("error %d in deflateInit (zlib)\n",err);
-       return;
-    }
-
-    err = deflate(&stream, Z_FINISH);
-    if (err != Z_STREAM_END) {
-       deflateEnd(&stream);
-       /* No need to print an error message. We simply abandon the compression
-          the buffer cannot be compressed or compressed buffer would be larger than original buffer
-          printf("error %d in deflate (zlib) is not = %d\n",err,Z_STREAM_END);
-       */
-       return;
-    }
-
-    err = deflateEnd(&stream);
-
-    tgt[0] = 'Z';               /* Signature ZLib */
-    tgt[1] = 'L';
-    tgt[2] = (char) method;
-
-    in_size   = (unsigned) (*srcsize);
-    out_size  = stream.total_out;             /* compressed size */
-    tgt[3] = (char)(out_size & 0xff);
-    tgt[4] = (char)((out_size >> 8) & 0xff);
-    tgt[5] = (char)((out_size >> 16) & 0xff);
-
-    tgt[6] = (char)(in_size & 0xff);         /* decompressed size */
-    tgt[7] = (char)((in_size >> 8) & 0xff);
-    tgt[8] = (char)((in_size >> 16) & 0xff);
-
-    *irep = stream.total_out + HDRSIZE;
-    return;
+    R__zipZLIB(cxlevel, srcsize, src, tgtsize, tgt, irep, 0, 0);
   }
 }
 
@@ -558,6 +605,27 @@ void R__zip(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *
   R__zipMultipleAlgorithm(cxlevel, srcsize, src, tgtsize, tgt, irep, 0);
 }
 
+/* ===========================================================================
+   Same as R__zipMultipleAlgorithm, but ZLIB compression uses the preset
+   dictionary dict of dictsize bytes (see R__zipZLIB). The other algorithms
+   ignore the dictionary.
+*/
+void R__zipDict(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, int compressionAlgorithm, const char *dict, int dictsize)
+{
+  if (cxlevel <= 0) {
+    *irep = 0;
+    return;
+  }
+  if (compressionAlgorithm == 0) {
+    compressionAlgorithm = R__ZipMode;
+  }
+  if (compressionAlgorithm != 1 || !dict || dictsize <= 0) {
+    R__zipMultipleAlgorithm(cxlevel, srcsize, src, tgtsize, tgt, irep, compressionAlgorithm);
+    return;
+  }
+  R__zipZLIB(cxlevel, srcsize, src, tgtsize, tgt, irep, dict, dictsize);
+}
+
 void R__error(char *msg)
 {
   if (verbose) fprintf(stderr,"R__zip: %s\n",msg);
@@ -25,6 +25,15 @@ namespace ROOT {
    // in greater compression factors, but takes more CPU time
    // and memory when compressing.  LZMA memory usage is particularly
    // high for compression levels 8 and 9.
+   // The LZ4 algorithm decompresses several times faster than
+   // ZLIB at the price of larger files; levels 4 to 9 use the
+   // slower LZ4HC compressor, which does not slow down reading.
+   // The Zstandard (zstd) algorithm gives compression factors
+   // similar to or better than ZLIB at a higher speed, both when
+   // compressing and decompressing. LZ4 and zstd require ROOT to
+   // be built with liblz4 and libzstd (see IsCompressionAvailable),
+   // otherwise the buffers are written uncompressed. Files written
+   // with them cannot be read by older ROOT versions.
    //
    // The current algorithms support level 1 to 9. The higher
    // the level the greater the compression and more CPU time
@@ -34,6 +43,8 @@ namespace ROOT {
                                 kZLIB,
                                 kLZMA,
                                 kOldCompressionAlgo,
+                                kLZ4,
+                                kZSTD,
                                 // if adding new algorithm types,
                                 // keep this enum value last
                                 kUndefinedCompressionAlgorithm
@@ -41,6 +52,15 @@ namespace ROOT {
 
    int CompressionSettings(ECompressionAlgorithm algorithm,
                            int compressionLevel);
+
+   // Returns true if several buffers can be compressed concurrently
+   // with the given algorithm (kUseGlobalSetting is resolved using
+   // R__ZipMode). Only the very old algorithm uses global state.
+   bool IsCompressionThreadSafe(int algorithm);
+
+   // Returns false if ROOT was built without the library implementing
+   // the algorithm, in which case the buffers are left uncompressed.
+   bool IsCompressionAvailable(int algorithm);
 }
 
 #endif
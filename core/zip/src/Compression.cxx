@@ -11,6 +11,10 @@
 
 #include "Compression.h"
 
+extern "C" int R__ZipMode;
+extern "C" int R__HasLZ4();
+extern "C" int R__HasZSTD();
+
 namespace ROOT {
 
 //______________________________________________________________________________
@@ -23,4 +27,20 @@ namespace ROOT {
     if (algorithm >= ROOT::kUndefinedCompressionAlgorithm) algo = 0;
     return algo * 100 + compressionLevel;
   }
+
+//______________________________________________________________________________
+  bool IsCompressionThreadSafe(int algorithm)
+  {
+    if (algorithm == ROOT::kUseGlobalSetting) algorithm = R__ZipMode;
+    return algorithm != ROOT::kUseGlobalSetting && algorithm != ROOT::kOldCompressionAlgo;
+  }
+
+//______________________________________________________________________________
+  bool IsCompressionAvailable(int algorithm)
+  {
+    if (algorithm == ROOT::kUseGlobalSetting) algorithm = R__ZipMode;
+    if (algorithm == ROOT::kLZ4) return R__HasLZ4();
+    if (algorithm == ROOT::kZSTD) return R__HasZSTD();
+    return algorithm >= 0 && algorithm < ROOT::kUndefinedCompressionAlgorithm;
+  }
 }
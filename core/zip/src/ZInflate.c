@@ -20,6 +20,8 @@ static const int qflag = 0;
 #include "zlib.h"
 #include "RConfigure.h"
 #include "ZipLZMA.h"
+#include "ZipLZ4.h"
+#include "ZipZSTD.h"
 
 
 /* inflate.c -- put in the public domain by Mark Adler
@@ -1129,8 +1131,11 @@ int R__unzip_header(int *srcsize, uch *src, int *tgtsize)
 
   /*   C H E C K   H E A D E R   */
   if (!(src[0] == 'Z' && src[1] == 'L' && src[2] == Z_DEFLATED) &&
+      !(src[0] == 'Z' && src[1] == 'D' && src[2] == Z_DEFLATED) &&
       !(src[0] == 'C' && src[1] == 'S' && src[2] == Z_DEFLATED) &&
-      !(src[0] == 'X' && src[1] == 'Z' && src[2] == 0)) {
+      !(src[0] == 'X' && src[1] == 'Z' && src[2] == 0) &&
+      !(src[0] == 'L' && src[1] == '4') &&
+      !(src[0] == 'Z' && src[1] == 'S')) {
     fprintf(stderr, "Error R__unzip_header: error in header\n");
     return 1;
   }
@@ -1158,8 +1163,11 @@ void R__unzip(int *srcsize, uch *src, int *tgtsize, uch *tgt, int *irep)
 
   /*   C H E C K   H E A D E R   */
   if (!(src[0] == 'Z' && src[1] == 'L' && src[2] == Z_DEFLATED) &&
+      !(src[0] == 'Z' && src[1] == 'D' && src[2] == Z_DEFLATED) &&
       !(src[0] == 'C' && src[1] == 'S' && src[2] == Z_DEFLATED) &&
-      !(src[0] == 'X' && src[1] == 'Z' && src[2] == 0)) {
+      !(src[0] == 'X' && src[1] == 'Z' && src[2] == 0) &&
+      !(src[0] == 'L' && src[1] == '4') &&
+      !(src[0] == 'Z' && src[1] == 'S')) {
     fprintf(stderr,"Error R__unzip: error in header\n");
     return;
   }
@@ -1182,6 +1190,12 @@ void R__unzip(int *srcsize, uch *src, int *tgtsize, uch *tgt, int *irep)
 
   /*   D E C O M P R E S S   D A T A  */
 
+  /* zlib format with a preset dictionary, see R__unzipDict */
+  if (src[0] == 'Z' && src[1] == 'D') {
+    fprintf(stderr,"R__unzip: the buffer was compressed with a dictionary\n");
+    return;
+  }
+
   /* New zlib format */
   if (src[0] == 'Z' && src[1] == 'L') {
     z_stream stream; /* decompression stream */
@@ -1217,6 +1231,14 @@ void R__unzip(int *srcsize, uch *src, int *tgtsize, uch *tgt, int *irep)
     R__unzipLZMA(srcsize, src, tgtsize, tgt, irep);
     return;
   }
+  else if (src[0] == 'L' && src[1] == '4') {
+    R__unzipLZ4(srcsize, src, tgtsize, tgt, irep);
+    return;
+  }
+  else if (src[0] == 'Z' && src[1] == 'S') {
+    R__unzipZSTD(srcsize, src, tgtsize, tgt, irep);
+    return;
+  }
 
   /* Old zlib format */
   if (R__Inflate(&ibufptr, &ibufcnt, &obufptr, &obufcnt)) {
@@ -1236,6 +1258,77 @@ void R__unzip(int *srcsize, uch *src, int *tgtsize, uch *tgt, int *irep)
   *irep = isize;
 }
 
+void R__unzipDict(int *srcsize, uch *src, int *tgtsize, uch *tgt, int *irep, const uch *dict, int dictsize)
+{
+  // Same as R__unzip, but buffers compressed with a ZLIB preset dictionary
+  // (signature "ZD", see R__zipDict) are decompressed using dict, which
+  // must be the dictionary used for the compression.
+
+  z_stream stream; /* decompression stream */
+  long isize, ibufcnt;
+  int err = 0;
+
+  if (*srcsize < HDRSIZE || !(src[0] == 'Z' && src[1] == 'D')) {
+    R__unzip(srcsize, src, tgtsize, tgt, irep);
+    return;
+  }
+
+  *irep = 0;
+
+  if (!dict || dictsize <= 0) {
+    fprintf(stderr,"R__unzipDict: the buffer was compressed with a dictionary which is not available\n");
+    return;
+  }
+
+  ibufcnt = (long)src[3] | ((long)src[4] << 8) | ((long)src[5] << 16);
+  isize   = (long)src[6] | ((long)src[7] << 8) | ((long)src[8] << 16);
+
+  if (*tgtsize < isize) {
+    fprintf(stderr,"R__unzipDict: too small target\n");
+    return;
+  }
+
+  if (ibufcnt + HDRSIZE != *srcsize) {
+    fprintf(stderr,"R__unzipDict: discrepancy in source length\n");
+    return;
+  }
+
+  stream.next_in   = (Bytef*)(&src[HDRSIZE]);
+  stream.avail_in  = (uInt)(ibufcnt);
+  stream.next_out  = (Bytef*)tgt;
+  stream.avail_out = (uInt)(*tgtsize);
+  stream.zalloc    = (alloc_func)0;
+  stream.zfree     = (free_func)0;
+  stream.opaque    = (voidpf)0;
+
+  err = inflateInit(&stream);
+  if (err != Z_OK) {
+    fprintf(stderr,"R__unzipDict: error %d in inflateInit (zlib)\n",err);
+    return;
+  }
+
+  err = inflate(&stream, Z_FINISH);
+  if (err == Z_NEED_DICT) {
+    /* zlib checks that the dictionary is the one used for the compression */
+    err = inflateSetDictionary(&stream, (const Bytef*)dict, (uInt)dictsize);
+    if (err != Z_OK) {
+      inflateEnd(&stream);
+      fprintf(stderr,"R__unzipDict: error %d in inflateSetDictionary (zlib)\n",err);
+      return;
+    }
+    err = inflate(&stream, Z_FINISH);
+  }
+  if (err != Z_STREAM_END) {
+    inflateEnd(&stream);
+    fprintf(stderr,"R__unzipDict: error %d in inflate (zlib)\n",err);
+    return;
+  }
+
+  inflateEnd(&stream);
+
+  *irep = stream.total_out;
+}
+
 #ifndef CHECK_EOF
 static int R__ReadByte (uch** ibufptr, long*  ibufcnt)
 {
@@ -0,0 +1,120 @@
+// @(#)root/zstd:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2013, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+/* The Zstandard compression algorithm (http://facebook.github.io/zstd).
+
+   The compressed buffer has the usual 9 bytes ROOT header: 'Z', 'S', the
+   format version, the compressed size and the uncompressed size (3 bytes
+   each), followed by a zstd frame. Readers which do not know about zstd
+   reject the buffer because of its signature.
+
+   R__HAS_ZSTD is defined in RConfigure.h when ROOT is built against
+   libzstd. Without it, R__zipZSTD leaves the buffers uncompressed and
+   R__unzipZSTD fails with an error message.
+*/
+
+#include "ZipZSTD.h"
+#include "RConfigure.h"
+#include <stdio.h>
+
+#ifdef R__HAS_ZSTD
+#include "zstd.h"
+
+static const int kHeaderSize = 9;
+static const char kVersion = 1;
+#endif
+
+int R__HasZSTD(void)
+{
+#ifdef R__HAS_ZSTD
+   return 1;
+#else
+   return 0;
+#endif
+}
+
+void R__zipZSTD(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep)
+{
+#ifdef R__HAS_ZSTD
+   size_t out_size;               /* compressed size */
+   unsigned in_size = (unsigned) (*srcsize);
+
+   *irep = 0;
+
+   if (*tgtsize <= kHeaderSize) {
+      return;
+   }
+
+   if (*srcsize > 0xffffff || *srcsize < 0) {
+      return;
+   }
+
+   /* The ROOT levels map directly to the zstd ones; levels above 9
+      (up to ZSTD_maxCLevel) trade a lot of CPU for a small gain. */
+   if (cxlevel > ZSTD_maxCLevel()) cxlevel = ZSTD_maxCLevel();
+   out_size = ZSTD_compress(&tgt[kHeaderSize], (size_t)(*tgtsize - kHeaderSize),
+                            src, (size_t)(*srcsize), cxlevel);
+   if (ZSTD_isError(out_size) || out_size > 0xffffff) {
+      /* No need to print an error message. We simply abandon the compression
+         the buffer cannot be compressed or compressed buffer would be larger than original buffer
+      */
+      return;
+   }
+
+   tgt[0] = 'Z';  /* Signature of zstd */
+   tgt[1] = 'S';
+   tgt[2] = kVersion;
+
+   tgt[3] = (char)(out_size & 0xff);
+   tgt[4] = (char)((out_size >> 8) & 0xff);
+   tgt[5] = (char)((out_size >> 16) & 0xff);
+
+   tgt[6] = (char)(in_size & 0xff);         /* decompressed size */
+   tgt[7] = (char)((in_size >> 8) & 0xff);
+   tgt[8] = (char)((in_size >> 16) & 0xff);
+
+   *irep = (int)out_size + kHeaderSize;
+#else
+   (void)cxlevel; (void)srcsize; (void)src; (void)tgtsize; (void)tgt;
+   *irep = 0;
+#endif
+}
+
+void R__unzipZSTD(int *srcsize, unsigned char *src, int *tgtsize, unsigned char *tgt, int *irep)
+{
+#ifdef R__HAS_ZSTD
+   size_t returnStatus;
+
+   *irep = 0;
+
+   if (src[2] != kVersion) {
+      fprintf(stderr,
+              "R__unzipZSTD: unsupported zstd format version %d\n",
+              (int)src[2]);
+      return;
+   }
+
+   returnStatus = ZSTD_decompress(tgt, (size_t)(*tgtsize),
+                                  &src[kHeaderSize], (size_t)(*srcsize - kHeaderSize));
+   if (ZSTD_isError(returnStatus)) {
+      fprintf(stderr,
+              "R__unzipZSTD: error %s in ZSTD_decompress\n",
+              ZSTD_getErrorName(returnStatus));
+      return;
+   }
+
+   *irep = (int)returnStatus;
+#else
+   (void)srcsize; (void)src; (void)tgtsize; (void)tgt;
+   *irep = 0;
+   fprintf(stderr,
+           "R__unzipZSTD: ROOT was built without zstd support\n");
+#endif
+}
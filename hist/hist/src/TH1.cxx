@@ -3084,23 +3084,48 @@ void TH1::FillN(Int_t ntimes, const Double_t *x, const Double_t *w, Int_t stride
 
    fEntries += ntimes;
    Double_t ww = 1;
-   Int_t nbins   = fXaxis.GetNbins();
    ntimes *= stride;
-   for (i=0;i<ntimes;i+=stride) {
-      bin =fXaxis.FindBin(x[i]);
-      if (bin <0) continue;
-      if (w) ww = w[i];
-      if (!fSumw2.fN && ww != 1.0)  Sumw2(); 
-      if (fSumw2.fN) fSumw2.fArray[bin] += ww*ww;
-      AddBinContent(bin, ww);
-      if (bin == 0 || bin > nbins) {
-         if (!fgStatOverflows) continue;
+   // Calling Sumw2 first gives the same result as calling it at the first
+   // weight different from 1: the previous entries all have a weight of 1.
+   if (w && !fSumw2.fN) {
+      for (i=0;i<ntimes;i+=stride) {
+         if (w[i] != 1.0) { Sumw2(); break; }
+      }
+   }
+
+   // The bins are computed by blocks with TAxis::FindFixBins. When the axis
+   // can be extended, an underflow or overflow goes through FindBin and the
+   // bins of the rest of the block are computed again with the new limits.
+   const Int_t kBlock = 256;
+   Int_t bins[kBlock];
+   i = 0;
+   while (i < ntimes) {
+      Int_t n = (ntimes - i + stride - 1) / stride;
+      if (n > kBlock) n = kBlock;
+      fXaxis.FindFixBins(n, x + i, stride, bins);
+      const Bool_t extend = fXaxis.CanExtend();
+      for (Int_t k = 0; k < n; ++k, i += stride) {
+         bin = bins[k];
+         Bool_t extended = kFALSE;
+         if (extend && (bin == 0 || bin > fXaxis.GetNbins())) {
+            bin = fXaxis.FindBin(x[i]);
+            extended = kTRUE;
+         }
+         if (w) ww = w[i];
+         if (fSumw2.fN) fSumw2.fArray[bin] += ww*ww;
+         AddBinContent(bin, ww);
+         if (fgStatOverflows || (bin > 0 && bin <= fXaxis.GetNbins())) {
+            Double_t z= ww;
+            fTsumw   += z;
+            fTsumw2  += z*z;
+            fTsumwx  += z*x[i];
+            fTsumwx2 += z*x[i]*x[i];
+         }
+         if (extended) {
+            i += stride;
+            break;
+         }
       }
-      Double_t z= ww;
-      fTsumw   += z;
-      fTsumw2  += z*z;
-      fTsumwx  += z*x[i];
-      fTsumwx2 += z*x[i]*x[i];
    }
 }
 
@@ -502,29 +502,53 @@ void TH2::FillN(Int_t ntimes, const Double_t *x, const Double_t *y, const Double
    fEntries += ntimes;
    Double_t ww = 1;
    ntimes *= stride;
-   for (i=0;i<ntimes;i+=stride) {
-      binx = fXaxis.FindBin(x[i]);
-      biny = fYaxis.FindBin(y[i]);
-      if (binx <0 || biny <0) continue;
-      bin  = biny*(fXaxis.GetNbins()+2) + binx;
-      if (w) ww = w[i];
-      if (!fSumw2.fN && ww != 1.0)  Sumw2(); 
-      if (fSumw2.fN) fSumw2.fArray[bin] += ww*ww;
-      AddBinContent(bin,ww);
-      if (binx == 0 || binx > fXaxis.GetNbins()) {
-         if (!fgStatOverflows) continue;
+   // See TH1::FillN for the Sumw2 call and the computation of the bins by blocks.
+   if (w && !fSumw2.fN) {
+      for (i=0;i<ntimes;i+=stride) {
+         if (w[i] != 1.0) { Sumw2(); break; }
       }
-      if (biny == 0 || biny > fYaxis.GetNbins()) {
-         if (!fgStatOverflows) continue;
+   }
+
+   const Int_t kBlock = 256;
+   Int_t binsx[kBlock];
+   Int_t binsy[kBlock];
+   i = 0;
+   while (i < ntimes) {
+      Int_t n = (ntimes - i + stride - 1) / stride;
+      if (n > kBlock) n = kBlock;
+      fXaxis.FindFixBins(n, x + i, stride, binsx);
+      fYaxis.FindFixBins(n, y + i, stride, binsy);
+      const Bool_t extendx = fXaxis.CanExtend();
+      const Bool_t extendy = fYaxis.CanExtend();
+      for (Int_t k = 0; k < n; ++k, i += stride) {
+         binx = binsx[k];
+         biny = binsy[k];
+         Bool_t extended = kFALSE;
+         if ((extendx && (binx == 0 || binx > fXaxis.GetNbins())) ||
+             (extendy && (biny == 0 || biny > fYaxis.GetNbins()))) {
+            binx = fXaxis.FindBin(x[i]);
+            biny = fYaxis.FindBin(y[i]);
+            extended = kTRUE;
+         }
+         bin  = biny*(fXaxis.GetNbins()+2) + binx;
+         if (w) ww = w[i];
+         if (fSumw2.fN) fSumw2.fArray[bin] += ww*ww;
+         AddBinContent(bin,ww);
+         if (fgStatOverflows || (binx > 0 && binx <= fXaxis.GetNbins() && biny > 0 && biny <= fYaxis.GetNbins())) {
+            Double_t z= ww; //(ww > 0 ? ww : -ww);
+            fTsumw   += z;
+            fTsumw2  += z*z;
+            fTsumwx  += z*x[i];
+            fTsumwx2 += z*x[i]*x[i];
+            fTsumwy  += z*y[i];
+            fTsumwy2 += z*y[i]*y[i];
+            fTsumwxy += z*x[i]*y[i];
+         }
+         if (extended) {
+            i += stride;
+            break;
+         }
       }
-      Double_t z= ww; //(ww > 0 ? ww : -ww);
-      fTsumw   += z;
-      fTsumw2  += z*z;
-      fTsumwx  += z*x[i];
-      fTsumwx2 += z*x[i]*x[i];
-      fTsumwy  += z*y[i];
-      fTsumwy2 += z*y[i]*y[i];
-      fTsumwxy += z*x[i]*y[i];
    }
 }
 
@@ -25,6 +25,10 @@ IOO          := $(call stripsrc,$(IOS:.cxx=.o))
 IODEP        := $(IOO:.o=.d) $(IODO:.o=.d)
 
 IOLIB        := $(LPATH)/libRIO.$(SOEXT)
+ifeq ($(PLATFORM),linux)
+# POSIX asynchronous I/O (TFile::ReadBuffersAIO)
+IOAIOLIB     := -lrt
+endif
 IOMAP        := $(IOLIB:.$(SOEXT)=.rootmap)
 
 # used in the main Makefile
@@ -44,7 +48,7 @@ include/%.h:    $(IODIRI)/%.h
 $(IOLIB):       $(IOO) $(IODO) $(ORDER_) $(MAINLIBS) $(IOLIBDEP)
 		@$(MAKELIB) $(PLATFORM) $(LD) "$(LDFLAGS)" \
 		   "$(SOFLAGS)" libRIO.$(SOEXT) $@ "$(IOO) $(IODO)" \
-		   "$(IOLIBEXTRA)"
+		   "$(IOLIBEXTRA) $(IOAIOLIB)"
 
 $(IODS):        $(IOH) $(IOL) $(ROOTCINTTMPDEP)
 		$(MAKEDIR)
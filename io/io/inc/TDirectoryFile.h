@@ -45,9 +45,17 @@ protected:
    Long64_t    fSeekKeys;        //Location of Keys record on file
    TFile      *fFile;            //pointer to current file in memory
    TList      *fKeys;            //Pointer to keys list in memory
+   Int_t       fKeyIndexSlots;   //!Number of slots of the key index, 0 if all the keys are in fKeys
+   Int_t       fKeyIndexNkeys;   //!Number of keys in the directory according to the key index
+   Int_t       fKeyIndexNpids;   //!Number of TProcessID keys according to the key index
+   Long64_t    fKeyIndexSeek;    //!Location of the key index on file
+
+   static Int_t fgKeyIndexThreshold; //Minimum number of keys to write a key index, -1 if not yet initialized from gEnv
 
    virtual void         CleanTargets();
    void Init(TClass *cl = 0);
+   TList               *GetListOfKeysWith(const char *name) const;
+   Bool_t               ReadKeyIndex();
 
 private:
    TDirectoryFile(const TDirectoryFile &directory);  //Directories cannot be copied
@@ -88,13 +96,14 @@ public:
    const TDatime      &GetCreationDate() const { return fDatimeC; }
    virtual TFile      *GetFile() const { return fFile; }
    virtual TKey       *GetKey(const char *name, Short_t cycle=9999) const;
-   virtual TList      *GetListOfKeys() const { return fKeys; }
+   virtual TList      *GetListOfKeys() const;
    const TDatime      &GetModificationDate() const { return fDatimeM; }
    virtual Int_t       GetNbytesKeys() const { return fNbytesKeys; }
-   virtual Int_t       GetNkeys() const { return fKeys->GetSize(); }
+   virtual Int_t       GetNkeys() const { return fKeyIndexSlots ? fKeyIndexNkeys : fKeys->GetSize(); }
    virtual Long64_t    GetSeekDir() const { return fSeekDir; }
    virtual Long64_t    GetSeekParent() const { return fSeekParent; }
    virtual Long64_t    GetSeekKeys() const { return fSeekKeys; }
+   Bool_t              IsKeyIndexed() const { return fKeyIndexSlots > 0; }
    Bool_t              IsModified() const { return fModified; }
    Bool_t              IsWritable() const { return fWritable; }
    virtual void        ls(Option_t *option="") const;
@@ -125,6 +134,9 @@ public:
    virtual void        WriteDirHeader();
    virtual void        WriteKeys();
 
+   static Int_t        GetKeyIndexThreshold();
+   static void         SetKeyIndexThreshold(Int_t nkeys);
+
    ClassDef(TDirectoryFile,5)  //Describe directory structure in a ROOT file
 };
 
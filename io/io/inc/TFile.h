@@ -44,6 +44,7 @@ class TFilePrefetch;
 class TFile : public TDirectoryFile {
   friend class TDirectoryFile;
   friend class TFilePrefetch;
+  friend class TFileCacheWrite;
 
 public:
    // Asynchronous open request status
@@ -88,6 +89,8 @@ protected:
    Bool_t           fInitDone;       //!True if the file has been initialized
    Bool_t           fMustFlush;      //!True if the file buffers must be flushed
    TFileOpenHandle *fAsyncHandle;    //!For proper automatic cleanup
+   char            *fMapBuffer;      //!Memory mapping of the file (if any)
+   Long64_t         fMapSize;        //!Size of the memory mapping
    EAsyncOpenStatus fAsyncOpenStatus; //!Status of an asynchronous open request
    TUrl             fUrl;            //!URL of file
 
@@ -107,12 +110,17 @@ protected:
    static Int_t     fgReadCalls;             //Number of bytes read from all TFile objects
    static Int_t     fgReadaheadSize;         //Readahead buffer size
    static Bool_t    fgReadInfo;              //if true (default) ReadStreamerInfo is called when opening a file
+   static Bool_t    fgMemoryMapping;         //if true local files opened for reading are memory mapped
+   static Int_t     fgAsyncReadBuffers;      //if 1 ReadBuffers submits all blocks at once with asynchronous I/O, -1 if not yet set
 
    virtual EAsyncOpenStatus GetAsyncOpenStatus() { return fAsyncOpenStatus; }
    virtual void  Init(Bool_t create);
    Bool_t        FlushWriteCache();
    Int_t         ReadBufferViaCache(char *buf, Int_t len);
+   Bool_t        ReadBuffersAIO(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf);
    Int_t         WriteBufferViaCache(const char *buf, Int_t len);
+   void          MapFile();
+   void          UnmapFile();
 
    // Creating projects
    Int_t         MakeProjectParMake(const char *packname, const char *filename);
@@ -202,6 +210,7 @@ public:
                                        Int_t &nbytes, Int_t &objlen, Int_t &keylen);
    virtual Int_t       GetNbytesInfo() const {return fNbytesInfo;}
    virtual Int_t       GetNbytesFree() const {return fNbytesFree;}
+   const char         *GetMappedBuffer(Long64_t pos, Int_t len);
    Long64_t            GetRelOffset() const { return fOffset - fArchiveOffset; }
    virtual Long64_t    GetSeekFree() const {return fSeekFree;}
    virtual Long64_t    GetSeekInfo() const {return fSeekInfo;}
@@ -213,6 +222,7 @@ public:
            Bool_t      IsBinary() const { return TestBit(kBinaryFile); }
            Bool_t      IsRaw() const { return !fIsRootFile; }
    virtual Bool_t      IsOpen() const;
+           Bool_t      IsMapped() const { return fMapBuffer != 0 && !fWritable; }
    virtual void        ls(Option_t *option="") const;
    virtual void        MakeFree(Long64_t first, Long64_t last);
    virtual void        MakeProject(const char *dirname, const char *classes="*",
@@ -272,11 +282,15 @@ public:
    static Long64_t     GetFileBytesWritten();
    static Int_t        GetFileReadCalls();
    static Int_t        GetReadaheadSize();
+   static Bool_t       GetMemoryMapping();
+   static Bool_t       GetAsyncReadBuffers();
 
    static void         SetFileBytesRead(Long64_t bytes = 0);
    static void         SetFileBytesWritten(Long64_t bytes = 0);
    static void         SetFileReadCalls(Int_t readcalls = 0);
    static void         SetReadaheadSize(Int_t bufsize = 256000);
+   static void         SetMemoryMapping(Bool_t map = kTRUE);
+   static void         SetAsyncReadBuffers(Bool_t async = kTRUE);
    static void         SetReadStreamerInfo(Bool_t readinfo=kTRUE);
 
    static Long64_t     GetFileCounter();
@@ -63,6 +63,7 @@ protected:
    Bool_t         fIsSorted;         // True if fSeek array is sorted
    Bool_t         fIsTransferred;    // True when fBuffer contains something valid
    Long64_t       fPrefetchedBlocks; // Number of blocks prefetched.
+   Bool_t         fProfileUsed;      //! True if the branches of the TTreeCache were loaded from or saved to its access profile
 
    //variables for the second block prefetched with the same semantics as for the first one
    Int_t          fBNseek;
@@ -110,6 +111,7 @@ public:
    virtual void        SetEnablePrefetching(Bool_t setPrefetching = kFALSE);
    virtual Bool_t      IsEnablePrefetching() const { return fEnablePrefetching; };
    virtual Bool_t      IsLearning() const {return kFALSE;}
+           Bool_t      IsProfileUsed() const {return fProfileUsed;}  // If true, the cache is a TTreeCache recording the branches read (see TTreeCache::UpdateProfile)
    virtual void        Prefetch(Long64_t pos, Int_t len);
    virtual void        Print(Option_t *option="") const;
    virtual Int_t       ReadBufferExt(char *buf, Long64_t pos, Int_t len, Int_t &loc);
@@ -26,6 +26,9 @@
 #endif
 
 class TFile;
+class TThread;
+class TMutex;
+class TCondition;
 
 class TFileCacheWrite : public TObject {
 
@@ -36,6 +39,24 @@ protected:
    TFile        *fFile;           //Pointer to file
    char         *fBuffer;         //[fBufferSize] buffer of contiguous prefetched blocks
    Bool_t        fRecursive;      //flag to avoid recursive calls
+   Bool_t        fAsync;          //!True if the buffers are written by a background thread
+   char         *fAsyncBuffer;    //!Buffer being written by the background thread
+   Long64_t      fAsyncSeek;      //!Seek value of fAsyncBuffer
+   Int_t         fAsyncNtot;      //!Number of bytes in fAsyncBuffer, 0 once accounted for
+   Bool_t        fAsyncPending;   //!True while fAsyncBuffer is being written (under fAsyncMutex)
+   Bool_t        fAsyncStop;      //!Ask the background thread to exit (under fAsyncMutex)
+   Int_t         fAsyncErrno;     //!errno of the first failed background write, 0 if none
+   TThread      *fAsyncThread;    //!Background writer thread
+   TMutex       *fAsyncMutex;     //!Mutex protecting the state shared with the thread
+   TCondition   *fAsyncCond;      //!Signal a buffer to write or a write completed
+
+   Bool_t        FlushAsync();
+   void          StopAsync();
+   Int_t         WriteAsyncBuffer();
+
+   static Int_t  fgAsyncWrite;    //Write in the background, -1 if not yet initialized from gEnv
+
+   static void  *ThreadProc(void *arg);
 
 private:
    TFileCacheWrite(const TFileCacheWrite &);            //cannot be copied
@@ -46,11 +67,17 @@ public:
    TFileCacheWrite(TFile *file, Int_t buffersize);
    virtual ~TFileCacheWrite();
    virtual Bool_t      Flush();
-   virtual Int_t       GetBytesInCache() const { return fNtot; }
+   virtual Int_t       GetBytesInCache() const { return fNtot + fAsyncNtot; }
+   Bool_t              IsAsync() const { return fAsync; }
    virtual void        Print(Option_t *option="") const;
    virtual Int_t       ReadBuffer(char *buf, Long64_t pos, Int_t len);
    virtual Int_t       WriteBuffer(const char *buf, Long64_t pos, Int_t len);
+   Bool_t              SetAsync(Bool_t async = kTRUE);
    virtual void        SetFile(TFile *file);
+   Bool_t              WaitAsync();
+
+   static Bool_t       GetAsyncWrite();
+   static void         SetAsyncWrite(Bool_t async = kTRUE);
 
    ClassDef(TFileCacheWrite,1)  //TFile cache when writing
 };
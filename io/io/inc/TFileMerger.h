@@ -55,7 +55,7 @@ protected:
    Bool_t         fFastMethod;       // True if using Fast merging algorithm (default)
    Bool_t         fNoTrees;          // True if Trees should not be merged (default is kFALSE)
    Bool_t         fExplicitCompLevel;// True if the user explicitly requested a compressio level change (default kFALSE)
-   Bool_t         fCompressionChange;// True if the output and input have different compression level (default kFALSE)
+   Bool_t         fCompressionChange;// True if the output and input have different compression settings (default kFALSE)
    Int_t          fPrintLevel;       // How much information to print out at run time.
    TString        fMsgPrefix;        // Prefix to be used when printing informational message (default TFileMerger)
 
@@ -65,8 +65,12 @@ protected:
    TString        fObjectNames;     // List of object names to be either merged exclusively or skipped
    TList         *fMergeList;       // list of TObjString containing the name of the files need to be merged
    TList         *fExcessFiles;     //! List of TObjString containing the name of the files not yet added to fFileList due to user or system limitiation on the max number of files opened.
+   Int_t          fNThreads;        // Number of threads used to merge the histograms (default 1, 0 for one per core)
+   Int_t          fFanIn;           // Number of files merged together at each level of a hierarchical merge (0 if disabled)
+   Long64_t       fMaxMemory;       // Maximum size in bytes of the in-memory intermediate files of a hierarchical merge
 
    Bool_t         OpenExcessFiles();
+   Bool_t         MergeHierarchically(Int_t type, TList &temporaries);
    virtual Bool_t AddFile(TFile *source, Bool_t own, Bool_t cpProgress);
    virtual Bool_t MergeRecursive(TDirectory *target, TList *sourcelist, Int_t type = kRegular | kAll);
 
@@ -94,6 +98,11 @@ public:
    TFile      *GetOutputFile() const { return fOutputFile; }
    Int_t       GetMaxOpenedFies() const { return fMaxOpenedFiles; }
    void        SetMaxOpenedFiles(Int_t newmax);
+   Int_t       GetNThreads() const { return fNThreads; }
+   void        SetNThreads(Int_t nthreads);
+   Int_t       GetHierarchicalFanIn() const { return fFanIn; }
+   Long64_t    GetHierarchicalMaxMemory() const { return fMaxMemory; }
+   void        SetHierarchicalMerge(Int_t fanin, Long64_t maxmemory = 0);
    const char *GetMsgPrefix() const { return fMsgPrefix; }
    void        SetMsgPrefix(const char *prefix);
    void        AddObjectNames(const char *name) {fObjectNames += name; fObjectNames += " ";}
@@ -120,7 +129,7 @@ public:
    virtual void   SetNotrees(Bool_t notrees=kFALSE) {fNoTrees = notrees;}
    virtual void        RecursiveRemove(TObject *obj);
 
-   ClassDef(TFileMerger,5)  // File copying and merging services
+   ClassDef(TFileMerger,6)  // File copying and merging services
 };
 
 #endif
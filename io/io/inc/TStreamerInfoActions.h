@@ -15,6 +15,7 @@
 #include <vector>
 
 #include "TStreamerInfo.h"
+#include "TAtomicCount.h"
 #include <assert.h>
 
 namespace TStreamerInfoActions {
@@ -121,10 +122,24 @@ namespace TStreamerInfoActions {
    };
    
    typedef std::vector<TConfiguredAction> ActionContainer_t;
+   typedef Int_t (*TStreamerInfoFusedAction_t)(TBuffer &buf, void *obj, const TConfiguredAction *actions);
+
    class TActionSequence : public TObject {
-      TActionSequence() {};
+      TActionSequence() : fFusedAction(0), fNCalls(0), fFuseStatus(0), fStreamerInfo(0), fLoopConfig(0) {};
+
+      // The sequences are shared by the threads reading the same class: the
+      // counter and the status are atomic and fFusedAction is set, under
+      // gClingMutex, before the status becomes 1.
+      mutable TStreamerInfoFusedAction_t fFusedAction; //! Generated code applying all the actions at once, 0 if none
+      mutable TAtomicCount  fNCalls;                   //! Number of calls to GetFusedAction before fusing
+      mutable TAtomicCount  fFuseStatus;               //! 0: not tried yet, 1: fused, -1: can not be fused
+
+      static Long_t         fgFuseThreshold;           // Number of uses after which a sequence is fused, 0 to never fuse
+
+      TStreamerInfoFusedAction_t Fuse() const;
+
    public:
-      TActionSequence(TVirtualStreamerInfo *info, UInt_t maxdata) : fStreamerInfo(info), fLoopConfig(0) { fActions.reserve(maxdata); };
+      TActionSequence(TVirtualStreamerInfo *info, UInt_t maxdata) : fFusedAction(0), fNCalls(0), fFuseStatus(0), fStreamerInfo(info), fLoopConfig(0) { fActions.reserve(maxdata); };
       ~TActionSequence() { 
          delete fLoopConfig; 
       }
@@ -132,9 +147,11 @@ namespace TStreamerInfoActions {
       template <typename action_t> 
       void AddAction( action_t action, TConfiguration *conf ) {
          fActions.push_back( TConfiguredAction(action, conf) );
+         ResetFusedAction();
       }
       void AddAction(const TConfiguredAction &action ) {
          fActions.push_back( action );
+         ResetFusedAction();
       }
       
       TVirtualStreamerInfo *fStreamerInfo; // StreamerInfo used to derive these actions.
@@ -142,6 +159,23 @@ namespace TStreamerInfoActions {
       ActionContainer_t     fActions;
 
       void AddToOffset(Int_t delta);
+
+      inline TStreamerInfoFusedAction_t GetFusedAction() const {
+         // Return the generated function applying the whole sequence or 0
+         // if there is none (yet), in which case the actions must be applied
+         // one by one. The function is generated the fgFuseThreshold-th time
+         // this is called.
+         Long_t status = fFuseStatus.Get();
+         if (status) return status > 0 ? fFusedAction : 0;
+         if (!fgFuseThreshold) return 0;
+         ++fNCalls;
+         if (fNCalls.Get() < fgFuseThreshold) return 0;
+         return Fuse();
+      }
+      void ResetFusedAction() { fFuseStatus.Set(0); fNCalls.Set(0); fFusedAction = 0; }
+
+      static Long_t GetFuseThreshold() { return fgFuseThreshold; }
+      static void   SetFuseThreshold(Long_t ncalls);
       
       TActionSequence *CreateCopy();      
       static TActionSequence *CreateReadMemberWiseActions(TVirtualStreamerInfo *info, TVirtualCollectionProxy &proxy);
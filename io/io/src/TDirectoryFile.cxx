@@ -46,18 +46,44 @@
 #include "TStreamerElement.h"
 #include "TProcessUUID.h"
 #include "TVirtualMutex.h"
+#include "TEnv.h"
+#include "TMathBase.h"
+
+#include <vector>
+#include <map>
 
 const UInt_t kIsBigFile = BIT(16);
 const Int_t  kMaxLen = 2048;
 
+// Key index appended to the keys record of large directories, see WriteKeys.
+const UInt_t kKeyIndexMagic     = 0x4b494458; // "KIDX"
+const Int_t  kKeyIndexSlotLen   = 12;         // hash, offset and length of a key header
+const Int_t  kKeyIndexTrailer   = 20;         // nkeys, npids, nslots, table offset, magic
+const Int_t  kKeyIndexMinBytes  = 65536;      // smaller keys records are always read in full
+
+Int_t TDirectoryFile::fgKeyIndexThreshold = -1;
+
 ClassImp(TDirectoryFile)
 
+//______________________________________________________________________________
+static UInt_t R__KeyIndexHash(const char *name)
+{
+   // FNV-1a hash of a key name, identical on all platforms.
+
+   UInt_t hash = 2166136261U;
+   for (const unsigned char *c = (const unsigned char*)name; *c; ++c) {
+      hash ^= *c;
+      hash *= 16777619U;
+   }
+   return hash;
+}
+
 
 //______________________________________________________________________________
 TDirectoryFile::TDirectoryFile() : TDirectory()
    , fModified(kFALSE), fWritable(kFALSE), fNbytesKeys(0), fNbytesName(0)
    , fBufferSize(0), fSeekDir(0), fSeekParent(0), fSeekKeys(0)
-   , fFile(0), fKeys(0)
+   , fFile(0), fKeys(0), fKeyIndexSlots(0), fKeyIndexNkeys(0), fKeyIndexNpids(0), fKeyIndexSeek(0)
 {
 //*-*-*-*-*-*-*-*-*-*-*-*Directory default constructor-*-*-*-*-*-*-*-*-*-*-*-*
 //*-*                    =============================
@@ -68,7 +94,7 @@ TDirectoryFile::TDirectoryFile(const char *name, const char *title, Option_t *cl
            : TDirectory()
    , fModified(kFALSE), fWritable(kFALSE), fNbytesKeys(0), fNbytesName(0)
    , fBufferSize(0), fSeekDir(0), fSeekParent(0), fSeekKeys(0)
-   , fFile(0), fKeys(0)
+   , fFile(0), fKeys(0), fKeyIndexSlots(0), fKeyIndexNkeys(0), fKeyIndexNpids(0), fKeyIndexSeek(0)
 {
 //*-*-*-*-*-*-*-*-*-*-*-* Create a new DirectoryFile *-*-*-*-*-*-*-*-*-*-*-*-*-*
 //*-*                     ==========================
@@ -166,7 +192,7 @@ void TDirectoryFile::Init(TClass *cl)
 TDirectoryFile::TDirectoryFile(const TDirectoryFile & directory) : TDirectory(directory)
    , fModified(kFALSE), fWritable(kFALSE), fNbytesKeys(0), fNbytesName(0)
    , fBufferSize(0), fSeekDir(0), fSeekParent(0), fSeekKeys(0)
-   , fFile(0), fKeys(0)
+   , fFile(0), fKeys(0), fKeyIndexSlots(0), fKeyIndexNkeys(0), fKeyIndexNpids(0), fKeyIndexSeek(0)
 {
    // Copy constructor.
    ((TDirectoryFile&)directory).Copy(*this);
@@ -229,6 +255,7 @@ Int_t TDirectoryFile::AppendKey(TKey *key)
    fModified = kTRUE;
 
    key->SetMotherDir(this);
+   if (fKeyIndexSlots) ReadKeys(kFALSE);
 
    // This is a fast hash lookup in case the key does not already exist
    TKey *oldkey = (TKey*)fKeys->FindObject(key->GetName());
@@ -262,7 +289,7 @@ void TDirectoryFile::Browse(TBrowser *b)
       TObject *obj = 0;
       TIter nextin(fList);
       TKey *key = 0, *keyo = 0;
-      TIter next(fKeys);
+      TIter next(GetListOfKeys());
 
       cd();
 
@@ -316,6 +343,7 @@ void TDirectoryFile::Build(TFile* motherFile, TDirectory* motherDir)
    fSeekDir    = 0;
    fSeekParent = 0;
    fSeekKeys   = 0;
+   fKeyIndexSlots = 0;
    fList       = new THashList(100,50);
    fKeys       = new THashList(100,50);
    fMother     = motherDir;
@@ -552,6 +580,7 @@ void TDirectoryFile::Close(Option_t *)
    if (fKeys) {
       fKeys->Delete("slow");
    }
+   fKeyIndexSlots = 0;
 
    CleanTargets();
 }
@@ -884,7 +913,7 @@ TObject *TDirectoryFile::Get(const char *namecycle)
 //*-*---------------------Case of Key---------------------
 //                        ===========
    TKey *key;
-   TIter nextkey(GetListOfKeys());
+   TIter nextkey(GetListOfKeysWith(namobj));
    while ((key = (TKey *) nextkey())) {
       if (strcmp(namobj,key->GetName()) == 0) {
          if ((cycle == 9999) || (cycle == key->GetCycle())) {
@@ -993,7 +1022,7 @@ void *TDirectoryFile::GetObjectChecked(const char *namecycle, const TClass* expe
 //                        ===========
    void *idcur = 0;
    TKey *key;
-   TIter nextkey(GetListOfKeys());
+   TIter nextkey(GetListOfKeysWith(namobj));
    while ((key = (TKey *) nextkey())) {
       if (strcmp(namobj,key->GetName()) == 0) {
          if ((cycle == 9999) || (cycle == key->GetCycle())) {
@@ -1027,7 +1056,7 @@ TKey *TDirectoryFile::GetKey(const char *name, Short_t cycle) const
 //  if cycle = 9999 returns highest cycle
 //
    TKey *key;
-   TIter next(GetListOfKeys());
+   TIter next(GetListOfKeysWith(name));
    while ((key = (TKey *) next()))
       if (!strcmp(name, key->GetName())) {
          if (cycle == 9999)             return key;
@@ -1036,6 +1065,98 @@ TKey *TDirectoryFile::GetKey(const char *name, Short_t cycle) const
    return 0;
 }
 
+//______________________________________________________________________________
+TList *TDirectoryFile::GetListOfKeys() const
+{
+   // Return the list of keys of this directory.
+   // If the directory was opened with its key index (see WriteKeys), the
+   // keys not yet looked up are read now.
+
+   if (fKeyIndexSlots) ((TDirectoryFile*)this)->ReadKeys(kFALSE);
+   return fKeys;
+}
+
+//______________________________________________________________________________
+TList *TDirectoryFile::GetListOfKeysWith(const char *name) const
+{
+   // Return a list of keys containing at least all the keys (i.e. all the
+   // cycles) named name. Without key index, this is the list of all keys.
+   // With a key index only the slots of name in the index and the headers
+   // of the matching keys are read from the file, and added to fKeys,
+   // highest cycle first as in the full list.
+
+   if (!fKeyIndexSlots) return fKeys;
+   if (fKeys->FindObject(name)) return fKeys;  // already looked up
+
+   TDirectoryFile *dir = (TDirectoryFile*)this;
+   TList found;
+   UInt_t hash = R__KeyIndexHash(name);
+   const Int_t kChunk = 8;
+   char slots[kChunk*kKeyIndexSlotLen];
+   Int_t mask = fKeyIndexSlots - 1;
+   Int_t slot = hash & mask;
+   Bool_t done = kFALSE;
+   for (Int_t nprobe = 0; !done && nprobe < fKeyIndexSlots; ) {
+      Int_t nread = TMath::Min(kChunk, fKeyIndexSlots - slot);
+      fFile->Seek(fKeyIndexSeek + Long64_t(slot)*kKeyIndexSlotLen);
+      if (fFile->ReadBuffer(slots, nread*kKeyIndexSlotLen)) break;
+      char *buffer = slots;
+      for (Int_t i = 0; i < nread; ++i, ++nprobe) {
+         UInt_t shash;
+         Int_t offset, keylen;
+         frombuf(buffer, &shash);
+         frombuf(buffer, &offset);
+         frombuf(buffer, &keylen);
+         if (!offset) { done = kTRUE; break; }  // empty slot: end of the probe sequence
+         if (shash != hash || keylen <= 0 || keylen > fNbytesKeys) continue;
+         char *header = new char[keylen];
+         fFile->Seek(fSeekKeys + offset);
+         if (!fFile->ReadBuffer(header, keylen)) {
+            char *hbuffer = header;
+            TKey *key = new TKey(dir);
+            key->ReadKeyBuffer(hbuffer);
+            if (!strcmp(key->GetName(), name)) found.Add(key);
+            else delete key;
+         }
+         delete [] header;
+      }
+      slot = (slot + nread) & mask;
+   }
+   // keep the order of the keys record: highest cycle first
+   while (found.GetSize()) {
+      TKey *best = 0;
+      TIter next(&found);
+      TKey *key;
+      while ((key = (TKey*)next()))
+         if (!best || key->GetCycle() > best->GetCycle()) best = key;
+      found.Remove(best);
+      fKeys->Add(best);
+   }
+   return fKeys;
+}
+
+//______________________________________________________________________________
+Int_t TDirectoryFile::GetKeyIndexThreshold()
+{
+   // Static function returning the minimum number of keys of a directory
+   // for WriteKeys to write a key index, 0 if no index is written. The
+   // default is taken from the TDirectory.KeyIndexThreshold rootrc
+   // variable (10000 by default).
+
+   if (fgKeyIndexThreshold < 0)
+      fgKeyIndexThreshold = gEnv->GetValue("TDirectory.KeyIndexThreshold", 10000);
+   return fgKeyIndexThreshold;
+}
+
+//______________________________________________________________________________
+void TDirectoryFile::SetKeyIndexThreshold(Int_t nkeys)
+{
+   // Static function to set the minimum number of keys of a directory for
+   // WriteKeys to write a key index (0 to never write it), see WriteKeys.
+
+   fgKeyIndexThreshold = nkeys < 0 ? 0 : nkeys;
+}
+
 //______________________________________________________________________________
 void TDirectoryFile::ls(Option_t *option) const
 {
@@ -1236,6 +1357,11 @@ Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
 //  This is an efficient way (without opening/closing files) to view
 //  the latest updates of a file being modified by another process
 //  as it is typically the case in a data acquisition system.
+//
+//  When a directory of a file opened for reading has a key index (see
+//  WriteKeys), only the index trailer is read here: the keys are then read
+//  one name at a time by Get, GetKey and FindKey, or all at once by
+//  GetListOfKeys.
 
    if (fFile==0) return 0;
 
@@ -1244,6 +1370,18 @@ Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
 
    TDirectory::TContext ctxt(this);
 
+   // keys already looked up via the key index, kept when reading the others,
+   // by position on file
+   std::map<Long64_t,TKey*> lazyKeys;
+   Bool_t wasIndexed = fKeyIndexSlots && !forceRead;
+   if (wasIndexed) {
+      TIter nextlazy(fKeys);
+      TKey *lazy;
+      while ((lazy = (TKey*)nextlazy())) lazyKeys[lazy->GetSeekKey()] = lazy;
+      fKeys->Clear("nodelete");
+   }
+   fKeyIndexSlots = 0;
+
    char *buffer;
    if (forceRead) {
       fKeys->Delete();
@@ -1278,6 +1416,8 @@ Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
       delete [] header;
    }
 
+   if (!wasIndexed && ReadKeyIndex()) return fKeyIndexNkeys;
+
    Int_t nkeys = 0;
    Long64_t fsize = fFile->GetSize();
    if ( fSeekKeys >  0) {
@@ -1303,14 +1443,57 @@ Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
             nkeys = i;
             break;
          }
+         if (!lazyKeys.empty()) {
+            std::map<Long64_t,TKey*>::iterator lazy = lazyKeys.find(key->GetSeekKey());
+            if (lazy != lazyKeys.end()) {
+               delete key;
+               key = lazy->second;
+               lazyKeys.erase(lazy);
+            }
+         }
          fKeys->Add(key);
       }
       delete headerkey;
    }
+   // should not happen unless the file changed: keep these keys valid
+   std::map<Long64_t,TKey*>::iterator lazy;
+   for (lazy = lazyKeys.begin(); lazy != lazyKeys.end(); ++lazy) fKeys->Add(lazy->second);
 
    return nkeys;
 }
 
+//______________________________________________________________________________
+Bool_t TDirectoryFile::ReadKeyIndex()
+{
+   // Read the trailer of the key index of this directory, if any, instead
+   // of the full keys record. Only done for large keys records of files
+   // opened for reading. Returns kTRUE if the index can be used.
+
+   if (fSeekKeys <= 0 || fNbytesKeys < kKeyIndexMinBytes) return kFALSE;
+   if (fFile->IsWritable()) return kFALSE;
+
+   char trailer[kKeyIndexTrailer];
+   fFile->Seek(fSeekKeys + fNbytesKeys - kKeyIndexTrailer);
+   if (fFile->ReadBuffer(trailer, kKeyIndexTrailer)) return kFALSE;
+   char *buffer = trailer;
+   Int_t nkeys, npids, nslots, offset;
+   UInt_t magic;
+   frombuf(buffer, &nkeys);
+   frombuf(buffer, &npids);
+   frombuf(buffer, &nslots);
+   frombuf(buffer, &offset);
+   frombuf(buffer, &magic);
+   if (magic != kKeyIndexMagic || nkeys <= 0 || nslots < nkeys || (nslots & (nslots-1))) return kFALSE;
+   if (Long64_t(offset) + Long64_t(nslots)*kKeyIndexSlotLen + kKeyIndexTrailer != fNbytesKeys) return kFALSE;
+
+   fKeyIndexSlots = nslots;
+   fKeyIndexNkeys = nkeys;
+   fKeyIndexNpids = npids;
+   fKeyIndexSeek  = fSeekKeys + offset;
+   if (gDebug > 0) Info("ReadKeyIndex", "using the key index of %s (%d keys)", GetName(), nkeys);
+   return kTRUE;
+}
+
 
 //______________________________________________________________________________
 Int_t TDirectoryFile::ReadTObject(TObject *obj, const char *keyname)
@@ -1520,6 +1703,9 @@ void TDirectoryFile::SetWritable(Bool_t writable)
 
    fWritable = writable;
 
+   // the keys not yet looked up via the key index are needed to write the keys
+   if (writable && fKeyIndexSlots) ReadKeys(kFALSE);
+
    // recursively set all sub-directories
    if (fList) {
       TObject *idcur;
@@ -1992,6 +2178,17 @@ void TDirectoryFile::WriteKeys()
 //*-*-*-*-*-*-*-*-*-*-*-*Write KEYS linked list on the file *-*-*-*-*-*-*-*
 //*-*                    ==================================
 //  The linked list of keys (fKeys) is written as a single data record
+//
+//  For directories with at least GetKeyIndexThreshold() keys, a key index
+//  is appended to the record: an open addressing hash table (linear
+//  probing, load factor at most 1/2) whose slots hold the hash of a key
+//  name and the offset and length of its key header in the record,
+//  followed by a trailer with the number of keys, the number of
+//  TProcessID keys, the number of slots, the offset of the table and a
+//  magic number. Readers not knowing the index ignore these trailing
+//  bytes. When reading, the index lets a directory be opened without
+//  reading its keys, and a key be found by reading a few slots and its
+//  header only.
 //
 
    TFile* f = GetFile();
@@ -2015,6 +2212,13 @@ void TDirectoryFile::WriteKeys()
    while ((key = (TKey*)next())) {
       nbytes += key->Sizeof();
    }
+   Int_t nslots = 0;
+   Int_t threshold = GetKeyIndexThreshold();
+   if (threshold > 0 && nkeys >= threshold) {
+      nslots = 1;
+      while (nslots < 2*nkeys) nslots *= 2;
+      nbytes += nslots*kKeyIndexSlotLen + kKeyIndexTrailer;
+   }
    TKey *headerkey  = new TKey(fName,fTitle,IsA(),nbytes,this);
    if (headerkey->GetSeekKey() == 0) {
       delete headerkey;
@@ -2023,6 +2227,33 @@ void TDirectoryFile::WriteKeys()
    char *buffer = headerkey->GetBuffer();
    next.Reset();
    tobuf(buffer, nkeys);
+   if (nslots) {
+      // the key headers are written as usual, the table and the trailer at the end
+      char *record = headerkey->GetBuffer() - headerkey->GetKeylen();
+      char *table  = headerkey->GetBuffer() + nbytes - nslots*kKeyIndexSlotLen - kKeyIndexTrailer;
+      memset(table, 0, nslots*kKeyIndexSlotLen);
+      std::vector<Bool_t> used(nslots, kFALSE);
+      Int_t npids = 0;
+      while ((key = (TKey*)next())) {
+         Int_t offset = buffer - record;
+         key->FillBuffer(buffer);
+         UInt_t hash = R__KeyIndexHash(key->GetName());
+         Int_t slot = hash & (nslots-1);
+         while (used[slot]) slot = (slot+1) & (nslots-1);
+         used[slot] = kTRUE;
+         char *sbuffer = table + slot*kKeyIndexSlotLen;
+         tobuf(sbuffer, hash);
+         tobuf(sbuffer, offset);
+         tobuf(sbuffer, Int_t(buffer - record - offset));
+         if (!strcmp(key->GetClassName(),"TProcessID")) npids++;
+      }
+      buffer = table + nslots*kKeyIndexSlotLen;
+      tobuf(buffer, nkeys);
+      tobuf(buffer, npids);
+      tobuf(buffer, nslots);
+      tobuf(buffer, Int_t(table - record));
+      tobuf(buffer, kKeyIndexMagic);
+   }
    while ((key = (TKey*)next())) {
       key->FillBuffer(buffer);
    }
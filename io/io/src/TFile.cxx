@@ -70,11 +70,16 @@
 #include <sys/stat.h>
 #ifndef WIN32
 #   include <unistd.h>
+#   include <sys/mman.h>
 #else
 #   define ssize_t int
 #   include <io.h>
 #   include <sys/types.h>
 #endif
+#if defined(R__LINUX)
+#   define R__HAS_POSIX_AIO
+#   include <aio.h>
+#endif
 
 #include "Bytes.h"
 #include "Compression.h"
@@ -114,6 +119,7 @@
 #include "compiledata.h"
 #include <cmath>
 #include <set>
+#include <vector>
 #include "TSchemaRule.h"
 #include "TSchemaRuleSet.h"
 #include "TThreadSlots.h"
@@ -126,6 +132,8 @@ Long64_t TFile::fgFileCounter = 0;
 Int_t    TFile::fgReadaheadSize = 256000;
 Int_t    TFile::fgReadCalls = 0;
 Bool_t   TFile::fgReadInfo = kTRUE;
+Bool_t   TFile::fgMemoryMapping = kFALSE;
+Int_t    TFile::fgAsyncReadBuffers = -1;
 TList   *TFile::fgAsyncOpenRequests = 0;
 TString  TFile::fgCacheFileDir;
 Bool_t   TFile::fgCacheFileForce = kFALSE;
@@ -169,6 +177,8 @@ TFile::TFile() : TDirectoryFile(), fInfoCache(0)
    fMustFlush       = kTRUE;
    fAsyncHandle     = 0;
    fAsyncOpenStatus = kAOSNotAsync;
+   fMapBuffer       = 0;
+   fMapSize         = 0;
    SetBit(kBinaryFile, kTRUE);
 
    fBEGIN          = 0;
@@ -346,6 +356,8 @@ TFile::TFile(const char *fname1, Option_t *option, const char *ftitle, Int_t com
    fCacheReadMap = new TMap();
    fCacheWrite   = 0;
    fReadCalls    = 0;
+   fMapBuffer    = 0;
+   fMapSize      = 0;
    SetBit(kBinaryFile, kTRUE);
 
    fOption.ToUpper();
@@ -475,6 +487,7 @@ TFile::TFile(const char *fname1, Option_t *option, const char *ftitle, Int_t com
          goto zombie;
       }
       fWritable = kFALSE;
+      if (fgMemoryMapping) MapFile();
    }
 
    Init(create);
@@ -820,7 +833,10 @@ void TFile::Init(Bool_t create)
    }
 
    // Count number of TProcessIDs in this file
-   {
+   if (fKeyIndexSlots) {
+      fNProcessIDs = fKeyIndexNpids;
+      fProcessIDs = new TObjArray(fNProcessIDs+1);
+   } else {
       TIter next(fKeys);
       TKey *key;
       while ((key = (TKey*)next())) {
@@ -828,6 +844,10 @@ void TFile::Init(Bool_t create)
       }
       fProcessIDs = new TObjArray(fNProcessIDs+1);
    }
+
+   // Local files being written get a write cache flushed in the background
+   if (fWritable && !fCacheWrite && IsA() == TFile::Class() && TFileCacheWrite::GetAsyncWrite())
+      new TFileCacheWrite(this, 1);
    return;
 
 zombie:
@@ -861,6 +881,10 @@ void TFile::Close(Option_t *option)
 
    if (fIsArchive || !fIsRootFile) {
       FlushWriteCache();
+      // A background write may still use the descriptor, even if the file
+      // is no longer writable.
+      if (fCacheWrite) fCacheWrite->WaitAsync();
+      UnmapFile();
       SysClose(fD);
       fD = -1;
 
@@ -912,6 +936,10 @@ void TFile::Close(Option_t *option)
    }
 
    if (IsOpen()) {
+      // A background write may still use the descriptor, even if the file
+      // is no longer writable.
+      if (fCacheWrite) fCacheWrite->WaitAsync();
+      UnmapFile();
       SysClose(fD);
       fD = -1;
    }
@@ -1487,6 +1515,11 @@ Bool_t TFile::ReadBuffer(char *buf, Long64_t pos, Int_t len)
          return kFALSE;
       }
 
+      if (const char *mapped = GetMappedBuffer(pos, len)) {
+         memcpy(buf, mapped, len);
+         return kFALSE;
+      }
+
       Seek(pos);
       ssize_t siz;
 
@@ -1573,6 +1606,10 @@ Bool_t TFile::ReadBuffers(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf)
    // This function is overloaded by TNetFile, TWebFile, etc.
    // Returns kTRUE in case of failure.
 
+   // the blocks are read from the file: write first the data still in the
+   // write cache or being written in the background
+   if (fWritable && fCacheWrite && fCacheWrite->GetBytesInCache()) fCacheWrite->Flush();
+
    // called with buf=0, from TFileCacheRead to pass list of readahead buffers
    if (!buf) {
       for (Int_t j = 0; j < nbuf; j++) {
@@ -1583,6 +1620,30 @@ Bool_t TFile::ReadBuffers(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf)
       return kFALSE;
    }
 
+   if (IsMapped()) {
+      // Memory mapped file: simply copy the blocks out of the mapping.
+      Int_t j;
+      for (j = 0; j < nbuf; j++) {
+         if (pos[j] < 0 || len[j] < 0 || pos[j] + fArchiveOffset + len[j] > fMapSize) break;
+      }
+      if (j == nbuf) {
+         Int_t k = 0;
+         for (j = 0; j < nbuf; j++) {
+            memcpy(&buf[k], GetMappedBuffer(pos[j], len[j]), len[j]);
+            k += len[j];
+         }
+         return kFALSE;
+      }
+   }
+
+   if (nbuf > 1 && IsA() == TFile::Class() && GetAsyncReadBuffers()) {
+      TFileCacheRead *old = fCacheRead;
+      fCacheRead = 0;
+      Bool_t result = ReadBuffersAIO(buf, pos, len, nbuf);
+      fCacheRead = old;
+      return result;
+   }
+
    Int_t k = 0;
    Bool_t result = kTRUE;
    TFileCacheRead *old = fCacheRead;
@@ -1633,6 +1694,189 @@ Bool_t TFile::ReadBuffers(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf)
    return result;
 }
 
+//______________________________________________________________________________
+Bool_t TFile::ReadBuffersAIO(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf)
+{
+   // Read the nbuf blocks described in arrays pos and len with POSIX
+   // asynchronous I/O. All the blocks (typically those of a TTreeCache
+   // fill) are submitted at once, so that the device can serve them in
+   // parallel rather than one read after the other; adjacent blocks are
+   // merged into a single request. Requests that fail or come back short
+   // are read again synchronously. Where asynchronous I/O is not
+   // available the blocks are simply read one by one.
+   // Returns kTRUE in case of failure.
+
+   std::vector<Long64_t> rpos;
+   std::vector<Int_t>    rlen;
+   std::vector<char*>    rbuf;
+   rpos.reserve(nbuf);
+   rlen.reserve(nbuf);
+   rbuf.reserve(nbuf);
+   Long64_t k = 0;
+   for (Int_t i = 0; i < nbuf; ) {
+      rpos.push_back(pos[i]);
+      rbuf.push_back(buf + k);
+      Int_t size = len[i];
+      k += len[i++];
+      while (i < nbuf && pos[i] == rpos.back() + size && len[i] <= kMaxInt - size) {
+         size += len[i];
+         k += len[i++];
+      }
+      rlen.push_back(size);
+   }
+   Int_t nreq = (Int_t)rpos.size();
+   std::vector<Bool_t> done(nreq, kFALSE);
+
+#ifdef R__HAS_POSIX_AIO
+#if defined(R__SEEK64)
+   typedef struct aiocb64 AIOCB_t;
+#   define R__lio_listio lio_listio64
+#   define R__aio_error  aio_error64
+#   define R__aio_return aio_return64
+#   define R__aio_suspend aio_suspend64
+#else
+   typedef struct aiocb AIOCB_t;
+#   define R__lio_listio lio_listio
+#   define R__aio_error  aio_error
+#   define R__aio_return aio_return
+#   define R__aio_suspend aio_suspend
+#endif
+   // lio_listio() limits the length of the list.
+   const Int_t kMaxBatch = 1024;
+
+   Double_t start = 0;
+   if (gPerfStats != 0) start = TTimeStamp();
+
+   std::vector<AIOCB_t>  cbs(nreq);
+   std::vector<AIOCB_t*> list(nreq);
+   for (Int_t j = 0; j < nreq; j++) {
+      memset(&cbs[j], 0, sizeof(AIOCB_t));
+      cbs[j].aio_fildes     = fD;
+      cbs[j].aio_offset     = rpos[j] + fArchiveOffset;
+      cbs[j].aio_buf        = rbuf[j];
+      cbs[j].aio_nbytes     = rlen[j];
+      cbs[j].aio_lio_opcode = LIO_READ;
+      cbs[j].aio_sigevent.sigev_notify = SIGEV_NONE;
+      list[j] = &cbs[j];
+   }
+
+   Long64_t nread = 0;
+   Int_t    ncalls = 0;
+   for (Int_t first = 0; first < nreq; first += kMaxBatch) {
+      Int_t n = TMath::Min(kMaxBatch, nreq - first);
+      // Even if lio_listio() fails (or is interrupted) some requests may
+      // have been queued: wait for each of them and check its status.
+      R__lio_listio(LIO_WAIT, &list[first], n, 0);
+      for (Int_t j = first; j < first + n; j++) {
+         Int_t err;
+         while ((err = R__aio_error(&cbs[j])) == EINPROGRESS)
+            R__aio_suspend((const AIOCB_t * const *)&list[j], 1, 0);
+         if (err == 0 && R__aio_return(&cbs[j]) == (ssize_t)rlen[j]) {
+            done[j] = kTRUE;
+            nread += rlen[j];
+            ncalls++;
+         }
+      }
+   }
+#undef R__lio_listio
+#undef R__aio_error
+#undef R__aio_return
+#undef R__aio_suspend
+
+   if (ncalls) {
+      fBytesRead  += nread;
+      fgBytesRead += nread;
+      fReadCalls  += ncalls;
+      fgReadCalls += ncalls;
+
+      if (gMonitoringWriter)
+         gMonitoringWriter->SendFileReadProgress(this);
+      if (gPerfStats != 0) {
+         gPerfStats->FileReadEvent(this, (Int_t)nread, start);
+      }
+   }
+#endif
+
+   for (Int_t j = 0; j < nreq; j++) {
+      if (done[j]) continue;
+      Seek(rpos[j]);
+      if (ReadBuffer(rbuf[j], rlen[j]))
+         return kTRUE;
+   }
+   return kFALSE;
+}
+
+//______________________________________________________________________________
+const char *TFile::GetMappedBuffer(Long64_t pos, Int_t len)
+{
+   // Return a pointer to the len bytes at the offset 'pos' in the file
+   // if the file is memory mapped (see SetMemoryMapping()) and the block
+   // is in the mapping, 0 otherwise. The read is accounted for as if done
+   // by ReadBuffer(). The memory stays valid until the file is closed.
+
+   if (!IsMapped() || pos < 0 || len < 0) return 0;
+   Long64_t off = pos + fArchiveOffset;
+   if (off + len > fMapSize) return 0;
+
+   Double_t start = 0;
+   if (gPerfStats != 0) start = TTimeStamp();
+
+   SetOffset(pos);
+   fBytesRead  += len;
+   fgBytesRead += len;
+   fReadCalls++;
+   fgReadCalls++;
+
+   if (gMonitoringWriter)
+      gMonitoringWriter->SendFileReadProgress(this);
+   if (gPerfStats != 0) {
+      gPerfStats->FileReadEvent(this, len, start);
+   }
+   return fMapBuffer + off;
+}
+
+//______________________________________________________________________________
+void TFile::MapFile()
+{
+   // Map the file in memory. On failure the file is silently read
+   // with SysRead() as usual.
+   // The mapping is private and writable, so that a basket used in place
+   // by TBasket can be scribbled on by the streamers without affecting
+   // the file: pages are only copied if they are actually written to.
+
+#ifndef WIN32
+   if (fMapBuffer || fD < 0) return;
+   Long64_t size = SysSeek(fD, 0, SEEK_END);
+   SysSeek(fD, 0, SEEK_SET);
+   if (size <= 0 || (Long64_t)(size_t)size != size) return;
+
+   Int_t flags = MAP_PRIVATE;
+#ifdef MAP_NORESERVE
+   flags |= MAP_NORESERVE;
+#endif
+   void *addr = ::mmap(0, (size_t)size, PROT_READ | PROT_WRITE, flags, fD, 0);
+   if (addr == MAP_FAILED) {
+      if (gDebug > 0)
+         Info("MapFile", "cannot map file %s, errno=%d", GetName(), GetErrno());
+      return;
+   }
+   fMapBuffer = (char *)addr;
+   fMapSize   = size;
+#endif
+}
+
+//______________________________________________________________________________
+void TFile::UnmapFile()
+{
+   // Remove the memory mapping of the file (if any).
+
+#ifndef WIN32
+   if (fMapBuffer) ::munmap(fMapBuffer, (size_t)fMapSize);
+#endif
+   fMapBuffer = 0;
+   fMapSize   = 0;
+}
+
 //______________________________________________________________________________
 Int_t TFile::ReadBufferViaCache(char *buf, Int_t len)
 {
@@ -1642,6 +1886,10 @@ Int_t TFile::ReadBufferViaCache(char *buf, Int_t len)
 
    Long64_t off = GetRelOffset();
    if (fCacheRead) {
+      // The read cache and the reads it misses go to the file: the data
+      // still in the write cache, or being written in the background, must
+      // be there first.
+      if (fWritable && fCacheWrite && fCacheWrite->GetBytesInCache()) fCacheWrite->Flush();
       Int_t st = fCacheRead->ReadBuffer(buf, off, len);
       if (st < 0)
          return 2;  // failure reading
@@ -1936,11 +2184,14 @@ Int_t TFile::ReOpen(Option_t *mode)
          return -1;
       }
       SetWritable(kFALSE);
+      if (fgMemoryMapping && !fMapBuffer && IsA() == TFile::Class()) MapFile();
 
    } else {
       // switch to UPDATE mode
 
-      // close readonly file
+      // close readonly file; an existing memory mapping is kept until Close()
+      // since baskets may still be read in place from it, but it is not used
+      // any more while the file is writable
       if (IsOpen()) {
          SysClose(fD);
          fD = -1;
@@ -2025,6 +2276,9 @@ void TFile::SetCompressionAlgorithm(Int_t algorithm)
 {
    // See comments for function SetCompressionSettings
    if (algorithm < 0 || algorithm >= ROOT::kUndefinedCompressionAlgorithm) algorithm = 0;
+   if (!ROOT::IsCompressionAvailable(algorithm)) {
+      Warning("SetCompressionAlgorithm", "ROOT was built without support for the compression algorithm %d, the objects will be written uncompressed", algorithm);
+   }
    if (fCompress < 0) {
       // if the level is not defined yet use 1 as a default
       fCompress = 100 * algorithm + 1;
@@ -4223,6 +4477,54 @@ Int_t TFile::GetReadaheadSize()
 //______________________________________________________________________________
 void TFile::SetReadaheadSize(Int_t bytes) { fgReadaheadSize = bytes; }
 
+//______________________________________________________________________________
+Bool_t TFile::GetMemoryMapping()
+{
+   // Static function returning true if local files opened for reading
+   // are memory mapped.
+
+   return fgMemoryMapping;
+}
+
+//______________________________________________________________________________
+Bool_t TFile::GetAsyncReadBuffers()
+{
+   // Static function returning true if ReadBuffers() submits all the
+   // blocks at once with asynchronous I/O. The default is taken from the
+   // TFile.AsyncReadBuffers rootrc variable.
+
+   if (fgAsyncReadBuffers < 0)
+      fgAsyncReadBuffers = gEnv->GetValue("TFile.AsyncReadBuffers", 0) ? 1 : 0;
+   return fgAsyncReadBuffers == 1;
+}
+
+//______________________________________________________________________________
+void TFile::SetAsyncReadBuffers(Bool_t async)
+{
+   // Static function to make ReadBuffers() of local files submit all the
+   // blocks of a request (e.g. a TTreeCache fill) at once with POSIX
+   // asynchronous I/O (Linux only) instead of reading them one after the
+   // other. This mostly helps devices which can serve many requests in
+   // parallel, like NVMe disks and disk arrays.
+
+   fgAsyncReadBuffers = async ? 1 : 0;
+}
+
+//______________________________________________________________________________
+void TFile::SetMemoryMapping(Bool_t map)
+{
+   // Static function to memory map (mmap) the local files opened for
+   // reading from now on. Reads are then served from the mapping without
+   // any system call, TTree does not create a TTreeCache for these files
+   // and TBasket decompresses the baskets straight from the mapping and
+   // uses the uncompressed ones in place, saving a memcpy of every
+   // basket. This is mostly interesting for files that are already in
+   // the page cache. The baskets read in place must not outlive the file.
+   // Files that cannot be mapped are read as usual.
+
+   fgMemoryMapping = map;
+}
+
 //______________________________________________________________________________
 void TFile::SetFileBytesRead(Long64_t bytes) { fgBytesRead = bytes; }
 
@@ -84,6 +84,7 @@ TFileCacheRead::TFileCacheRead() : TObject()
    fEnablePrefetching = kFALSE;
    fPrefetch        = 0;
    fPrefetchedBlocks= 0;
+   fProfileUsed     = kFALSE;
 }
 
 //_____________________________________________________________________________
@@ -133,6 +134,7 @@ TFileCacheRead::TFileCacheRead(TFile *file, Int_t buffersize, TObject *tree)
    fBuffer = 0;
    fPrefetch = 0;
    fPrefetchedBlocks = 0;
+   fProfileUsed = kFALSE;
 
    //initialise the prefetch object and set the cache directory
    // start the thread only if the file is not local  
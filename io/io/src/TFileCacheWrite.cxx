@@ -23,11 +23,32 @@
 // The write cache is automatically created when writing a remote file  //
 // (created in TFile::Open()).                                          //
 //                                                                      //
+// With SetAsync (or TFileCacheWrite::SetAsyncWrite for all the local  //
+// files opened for writing) the cache is double buffered: a full       //
+// buffer is handed over to a background thread which writes it while  //
+// the caller fills the other one. At most one buffer is in flight.     //
+// Errors of the background writes are reported by the next Flush()     //
+// (hence TFile::Close) and flag the file with TFile::kWriteError.      //
+// This is only available for local files on Unix.                     //
+//                                                                      //
 //////////////////////////////////////////////////////////////////////////
 
 
+#include <errno.h>
+#include <string.h>
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
 #include "TFile.h"
 #include "TFileCacheWrite.h"
+#include "TEnv.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TCondition.h"
+#include "TVirtualMonitoring.h"
+
+Int_t TFileCacheWrite::fgAsyncWrite = -1;
 
 ClassImp(TFileCacheWrite)
 
@@ -42,6 +63,16 @@ TFileCacheWrite::TFileCacheWrite() : TObject()
    fFile        = 0;
    fBuffer      = 0;
    fRecursive   = kFALSE;
+   fAsync       = kFALSE;
+   fAsyncBuffer = 0;
+   fAsyncSeek   = 0;
+   fAsyncNtot   = 0;
+   fAsyncPending= kFALSE;
+   fAsyncStop   = kFALSE;
+   fAsyncErrno  = 0;
+   fAsyncThread = 0;
+   fAsyncMutex  = 0;
+   fAsyncCond   = 0;
 }
 
 //_____________________________________________________________________________
@@ -60,8 +91,19 @@ TFileCacheWrite::TFileCacheWrite(TFile *file, Int_t buffersize)
    fFile        = file;
    fRecursive   = kFALSE;
    fBuffer      = new char[fBufferSize];
+   fAsync       = kFALSE;
+   fAsyncBuffer = 0;
+   fAsyncSeek   = 0;
+   fAsyncNtot   = 0;
+   fAsyncPending= kFALSE;
+   fAsyncStop   = kFALSE;
+   fAsyncErrno  = 0;
+   fAsyncThread = 0;
+   fAsyncMutex  = 0;
+   fAsyncCond   = 0;
    if (file) file->SetCacheWrite(this);
-   if (gDebug > 0) Info("TFileCacheWrite","Creating a write cache with buffersize=%d bytes",buffersize);
+   if (GetAsyncWrite()) SetAsync(kTRUE);
+   if (gDebug > 0) Info("TFileCacheWrite","Creating a%s write cache with buffersize=%d bytes",fAsync ? "n asynchronous" : "",buffersize);
 }
 
 //_____________________________________________________________________________
@@ -69,6 +111,7 @@ TFileCacheWrite::~TFileCacheWrite()
 {
    // Destructor.
 
+   StopAsync();
    delete [] fBuffer;
 }
 
@@ -76,8 +119,14 @@ TFileCacheWrite::~TFileCacheWrite()
 Bool_t TFileCacheWrite::Flush()
 {
    // Flush the current write buffer to the file.
-   // Returns kTRUE in case of error.
+   // In asynchronous mode, wait for the background writes to complete.
+   // Returns kTRUE in case of error, including a failure of a previous
+   // background write.
 
+   if (fAsync) {
+      if (FlushAsync()) return kTRUE;
+      return WaitAsync();
+   }
    if (!fNtot) return kFALSE;
    fFile->Seek(fSeekStart);
    //printf("Flushing buffer at fSeekStart=%lld, fNtot=%d\n",fSeekStart,fNtot);
@@ -107,6 +156,8 @@ Int_t TFileCacheWrite::ReadBuffer(char *buf, Long64_t pos, Int_t len)
    //        Returns -1 if data not in write cache,
    //        0 otherwise.
 
+   // the file content is not up to date while a buffer is being written
+   if (fAsync) WaitAsync();
    if (pos < fSeekStart || pos+len > fSeekStart+fNtot) return -1;
    memcpy(buf,fBuffer+pos-fSeekStart,len);
    return 0;
@@ -126,15 +177,18 @@ Int_t TFileCacheWrite::WriteBuffer(const char *buf, Long64_t pos, Int_t len)
 
    if (fSeekStart + fNtot != pos) {
       //we must flush the current cache
-      if (Flush()) return -1; //failure
+      if (fAsync ? FlushAsync() : Flush()) return -1; //failure
    }
    if (fNtot + len >= fBufferSize) {
-      if (Flush()) return -1; //failure
+      if (fAsync ? FlushAsync() : Flush()) return -1; //failure
       if (len >= fBufferSize) {
          //buffer larger than the cache itself: direct write to file
+         if (WaitAsync()) return -1; //failure
+         fFile->Seek(pos);
          fRecursive = kTRUE;
-         if (fFile->WriteBuffer(buf,len)) return -1;  // failure
+         Bool_t status = fFile->WriteBuffer(buf,len);
          fRecursive = kFALSE;
+         if (status) return -1;  // failure
          return 1;
       }
    }
@@ -151,5 +205,205 @@ void TFileCacheWrite::SetFile(TFile *file)
    // Set the file using this cache.
    // Any write not yet flushed will be lost.
 
+   if (fAsync) {
+      WaitAsync();
+      if (!file || file->IsA() != TFile::Class()) StopAsync();
+   }
    fFile = file;
 }
+
+//_____________________________________________________________________________
+Bool_t TFileCacheWrite::SetAsync(Bool_t async)
+{
+   // Write the cache buffers in a background thread (async = kTRUE): when
+   // the buffer is full it is handed over to the thread and the following
+   // writes go to a second buffer. Only supported for local files (TFile
+   // itself, not its network subclasses) on Unix. The pending data are
+   // flushed when switching back to synchronous writes.
+   // Returns kTRUE if the cache is asynchronous.
+
+   if (async == fAsync) return fAsync;
+   if (!async) {
+      Flush();
+      StopAsync();
+      return kFALSE;
+   }
+#ifdef WIN32
+   return kFALSE;
+#else
+   if (!fFile || fFile->IsA() != TFile::Class() || fFile->GetFd() < 0) return kFALSE;
+
+   fAsyncBuffer  = new char[fBufferSize];
+   fAsyncNtot    = 0;
+   fAsyncPending = kFALSE;
+   fAsyncStop    = kFALSE;
+   fAsyncErrno   = 0;
+   fAsyncMutex   = new TMutex();
+   fAsyncCond    = new TCondition(fAsyncMutex);
+   fAsyncThread  = new TThread(ThreadProc, this);
+   fAsync        = kTRUE;
+   if (fAsyncThread->Run()) {
+      Error("SetAsync", "cannot start the writer thread, writing synchronously");
+      SafeDelete(fAsyncThread);
+      StopAsync();
+   }
+   return fAsync;
+#endif
+}
+
+//_____________________________________________________________________________
+Bool_t TFileCacheWrite::FlushAsync()
+{
+   // Hand the current buffer over to the background thread, after waiting
+   // for the previous one to be written.
+   // Returns kTRUE in case of error.
+
+   if (!fNtot) return kFALSE;
+   if (WaitAsync()) return kTRUE;
+
+   char *buffer = fAsyncBuffer;
+   fAsyncBuffer = fBuffer;
+   fBuffer      = buffer;
+   fAsyncSeek   = fSeekStart;
+   fAsyncNtot   = fNtot;
+   fNtot        = 0;
+
+   fAsyncMutex->Lock();
+   fAsyncPending = kTRUE;
+   fAsyncCond->Signal();
+   fAsyncMutex->UnLock();
+   return kFALSE;
+}
+
+//_____________________________________________________________________________
+void TFileCacheWrite::StopAsync()
+{
+   // Wait for the buffer in flight, stop the background thread and go back
+   // to synchronous writes. Data still in the cache are kept.
+
+   if (!fAsync) return;
+   WaitAsync();
+   if (fAsyncThread) {
+      fAsyncMutex->Lock();
+      fAsyncStop = kTRUE;
+      fAsyncCond->Signal();
+      fAsyncMutex->UnLock();
+      fAsyncThread->Join();
+   }
+   SafeDelete(fAsyncThread);
+   SafeDelete(fAsyncCond);
+   SafeDelete(fAsyncMutex);
+   delete [] fAsyncBuffer;
+   fAsyncBuffer = 0;
+   fAsync = kFALSE;
+}
+
+//_____________________________________________________________________________
+Bool_t TFileCacheWrite::WaitAsync()
+{
+   // Wait for the buffer being written by the background thread, then
+   // account for the bytes written in the file statistics. TFile calls it
+   // before closing its descriptor.
+   // Returns kTRUE if a background write failed; the file is then
+   // flagged with kWriteError and all the following writes fail.
+
+   if (!fAsync || !fAsyncMutex) return kFALSE;
+
+   fAsyncMutex->Lock();
+   while (fAsyncPending) fAsyncCond->Wait();
+   Int_t err = fAsyncErrno;
+   fAsyncMutex->UnLock();
+
+   if (err) {
+      if (fFile && !fFile->TestBit(TFile::kWriteError)) {
+         fFile->SetBit(TFile::kWriteError);
+         fFile->SetWritable(kFALSE);
+         Error("WaitAsync", "error writing to file %s (%s)", fFile->GetName(), strerror(err));
+      }
+      fAsyncNtot = 0;
+      return kTRUE;
+   }
+   if (fAsyncNtot && fFile) {
+      fFile->fBytesWrite   += fAsyncNtot;
+      TFile::fgBytesWrite  += fAsyncNtot;
+      if (gMonitoringWriter)
+         gMonitoringWriter->SendFileWriteProgress(fFile);
+   }
+   fAsyncNtot = 0;
+   return kFALSE;
+}
+
+//_____________________________________________________________________________
+Int_t TFileCacheWrite::WriteAsyncBuffer()
+{
+   // Write fAsyncBuffer to the file, called by the background thread.
+   // pwrite does not use the file offset, which the main thread keeps
+   // using meanwhile (e.g. to read back objects).
+   // Returns 0 or the errno of the failure.
+
+#ifdef WIN32
+   return ENOSYS;
+#else
+   const char *buf = fAsyncBuffer;
+   Long64_t pos = fAsyncSeek + fFile->GetArchiveOffset();
+   Long64_t len = fAsyncNtot;
+   while (len > 0) {
+      ssize_t siz = pwrite(fFile->GetFd(), buf, len, pos);
+      if (siz < 0) {
+         if (errno == EINTR) continue;
+         return errno;
+      }
+      if (siz == 0) return EIO;
+      buf += siz;
+      pos += siz;
+      len -= siz;
+   }
+   return 0;
+#endif
+}
+
+//_____________________________________________________________________________
+void *TFileCacheWrite::ThreadProc(void *arg)
+{
+   // Execution loop of the background writer thread.
+
+   TFileCacheWrite *cache = (TFileCacheWrite*)arg;
+
+   cache->fAsyncMutex->Lock();
+   while (1) {
+      while (!cache->fAsyncPending && !cache->fAsyncStop)
+         cache->fAsyncCond->Wait();
+      if (!cache->fAsyncPending) break;  // asked to stop
+      cache->fAsyncMutex->UnLock();
+      Int_t err = cache->WriteAsyncBuffer();
+      cache->fAsyncMutex->Lock();
+      if (err && !cache->fAsyncErrno) cache->fAsyncErrno = err;
+      cache->fAsyncPending = kFALSE;
+      cache->fAsyncCond->Broadcast();
+   }
+   cache->fAsyncMutex->UnLock();
+   return 0;
+}
+
+//_____________________________________________________________________________
+Bool_t TFileCacheWrite::GetAsyncWrite()
+{
+   // Static function returning kTRUE if the write caches are asynchronous,
+   // see SetAsyncWrite. The default is taken from the
+   // TFileCacheWrite.AsyncWrite rootrc variable.
+
+   if (fgAsyncWrite < 0)
+      fgAsyncWrite = gEnv->GetValue("TFileCacheWrite.AsyncWrite", 0) ? 1 : 0;
+   return fgAsyncWrite == 1;
+}
+
+//_____________________________________________________________________________
+void TFileCacheWrite::SetAsyncWrite(Bool_t async)
+{
+   // Static function to make the write caches created from now on
+   // asynchronous (see SetAsync). The local files opened for writing from
+   // now on then get an asynchronous write cache of the default size, so
+   // that e.g. TTree::Fill does not wait for the baskets to be written.
+
+   fgAsyncWrite = async ? 1 : 0;
+}
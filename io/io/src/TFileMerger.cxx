@@ -40,6 +40,11 @@
 #include "TClassRef.h"
 #include "TROOT.h"
 #include "TMemFile.h"
+#include "TThread.h"
+#include "TVirtualMutex.h"
+#include "TError.h"
+
+#include <vector>
 
 #ifdef WIN32
 // For _getmaxstdio
@@ -56,6 +61,7 @@ TClassRef R__TH1_Class("TH1");
 TClassRef R__TTree_Class("TTree");
 
 static const Int_t kCpProgress = BIT(14);
+static const Int_t kTemporary  = BIT(15);
 static const Int_t kCintFileNumber = 100;
 //______________________________________________________________________________
 static Int_t R__GetSystemMaxOpenedFiles()
@@ -83,11 +89,146 @@ static Int_t R__GetSystemMaxOpenedFiles()
    }
 }
 
+//______________________________________________________________________________
+//
+// Helper for the multi-threaded merging of the histograms and of the other
+// objects that are not reset after merging (see TFileMerger::SetNThreads).
+// Each thread reads the object from a contiguous slice of the input files
+// and merges them into a partial result. The partial results are then
+// merged, in the order of the slices, into the object of the first file,
+// so that the output only depends on the number of threads.
+//
+class TFileMergerSlice {
+public:
+   const std::vector<TFile*> *fFiles;     // Input files
+   Int_t                      fFirst;     // First input file of the slice
+   Int_t                      fLast;      // One past the last input file of the slice
+   const char                *fPath;      // Directory of the object in the files
+   const char                *fName;      // Name of the object
+   Bool_t                     fOneGo;     // Merge all the objects of the slice in one go
+   TDirectory                *fTarget;    // Output directory
+   const char                *fOptions;   // Options of the TFileMergeInfo
+   TObject                   *fResult;    // Partial result, 0 if the slice has no such object
+
+   TFileMergerSlice() : fFiles(0), fFirst(0), fLast(0), fPath(0), fName(0), fOneGo(kFALSE),
+                        fTarget(0), fOptions(0), fResult(0) {}
+
+   static void *Run(void *arg);
+};
+
+//______________________________________________________________________________
+void *TFileMergerSlice::Run(void *arg)
+{
+   // Read and merge the objects of one slice of the input files.
+
+   // Only the calls to Merge() are done in parallel: reading and deleting
+   // the input objects goes through global lists (for example the list of
+   // functions of gROOT for a TFormula), so they are done under gROOTMutex.
+
+   TFileMergerSlice *slice = (TFileMergerSlice*)arg;
+   TDirectory::TContext ctxt(0);
+
+   TFileMergeInfo info(slice->fTarget);
+   info.fOptions = slice->fOptions;
+   TList inputs;
+   for (Int_t i = slice->fFirst; i < slice->fLast; ++i) {
+      TFile *source = (*slice->fFiles)[i];
+      TObject *hobj = 0;
+      {
+         R__LOCKGUARD2(gROOTMutex);
+         TDirectory *ndir = source->GetDirectory(slice->fPath);
+         if (!ndir) continue;
+         TKey *key = (TKey*)ndir->GetListOfKeys()->FindObject(slice->fName);
+         if (!key) continue;
+         hobj = key->ReadObj();
+         if (!hobj) {
+            ::Info("TFileMerger::MergeRecursive", "could not read object for key {%s, %s}; skipping file %s",
+                   key->GetName(), key->GetTitle(), source->GetName());
+            continue;
+         }
+         // Set ownership for collections
+         if (hobj->InheritsFrom(TCollection::Class())) {
+            ((TCollection*)hobj)->SetOwner();
+         }
+         hobj->ResetBit(kMustCleanup);
+      }
+      if (!slice->fResult) {
+         slice->fResult = hobj;
+         continue;
+      }
+      inputs.Add(hobj);
+      if (!slice->fOneGo) {
+         ROOT::MergeFunc_t func = slice->fResult->IsA()->GetMerge();
+         if (func(slice->fResult, &inputs, &info) < 0) {
+            ::Error("TFileMerger::MergeRecursive", "calling Merge() on '%s' with the corresponding object in '%s'",
+                    slice->fName, source->GetName());
+         }
+         info.fIsFirst = kFALSE;
+         R__LOCKGUARD2(gROOTMutex);
+         inputs.Delete();
+      }
+   }
+   if (inputs.GetSize()) {
+      // Merge the list, if still to be done
+      ROOT::MergeFunc_t func = slice->fResult->IsA()->GetMerge();
+      if (func(slice->fResult, &inputs, &info) < 0) {
+         ::Error("TFileMerger::MergeRecursive", "calling Merge() on '%s' with the corresponding objects in files %d to %d",
+                 slice->fName, slice->fFirst, slice->fLast-1);
+      }
+      R__LOCKGUARD2(gROOTMutex);
+      inputs.Delete();
+   }
+   return 0;
+}
+
+//______________________________________________________________________________
+static void R__MergeInThreads(TObject *obj, TList *sourcelist, TFile *firstsource, const char *path,
+                              Bool_t oneGo, TFileMergeInfo &info, Int_t nthreads)
+{
+   // Merge into obj the same-name objects of firstsource and of the files
+   // following it in sourcelist, using nthreads threads.
+
+   std::vector<TFile*> files;
+   for (TFile *f = firstsource; f; f = (TFile*)sourcelist->After(f)) files.push_back(f);
+   Int_t nfiles = files.size();
+   Int_t nslices = TMath::Min(nthreads, nfiles);
+
+   std::vector<TFileMergerSlice> slices(nslices);
+   std::vector<TThread*> threads(nslices);
+   for (Int_t s = 0; s < nslices; ++s) {
+      slices[s].fFiles   = &files;
+      slices[s].fFirst   = (Int_t)((Long64_t)s * nfiles / nslices);
+      slices[s].fLast    = (Int_t)((Long64_t)(s+1) * nfiles / nslices);
+      slices[s].fPath    = path;
+      slices[s].fName    = obj->GetName();
+      slices[s].fOneGo   = oneGo;
+      slices[s].fTarget  = info.fOutputDirectory;
+      slices[s].fOptions = info.fOptions.Data();
+      threads[s] = new TThread(TFileMergerSlice::Run, &slices[s]);
+      threads[s]->Run();
+   }
+   TList inputs;
+   for (Int_t s = 0; s < nslices; ++s) {
+      threads[s]->Join();
+      delete threads[s];
+      if (slices[s].fResult) inputs.Add(slices[s].fResult);
+   }
+
+   ROOT::MergeFunc_t func = obj->IsA()->GetMerge();
+   if (func(obj, &inputs, &info) < 0) {
+      ::Error("TFileMerger::MergeRecursive", "calling Merge() on '%s' with the partial results of %d threads",
+              obj->GetName(), nslices);
+   }
+   info.fIsFirst = kFALSE;
+   inputs.Delete();
+}
+
 //______________________________________________________________________________
 TFileMerger::TFileMerger(Bool_t isLocal, Bool_t histoOneGo)
             : fOutputFile(0), fFastMethod(kTRUE), fNoTrees(kFALSE), fExplicitCompLevel(kFALSE), fCompressionChange(kFALSE),
               fPrintLevel(0), fMsgPrefix("TFileMerger"), fMaxOpenedFiles( R__GetSystemMaxOpenedFiles() ),
-              fLocal(isLocal), fHistoOneGo(histoOneGo), fObjectNames()
+              fLocal(isLocal), fHistoOneGo(histoOneGo), fObjectNames(), fNThreads(1),
+              fFanIn(0), fMaxMemory(0)
 {
    // Create file merger object.
 
@@ -171,7 +312,7 @@ Bool_t TFileMerger::AddFile(const char *url, Bool_t cpProgress)
          Error("AddFile", "cannot open file %s", url);
       return kFALSE;
    } else {
-      if (fOutputFile && fOutputFile->GetCompressionLevel() != newfile->GetCompressionLevel()) fCompressionChange = kTRUE;
+      if (fOutputFile && fOutputFile->GetCompressionSettings() != newfile->GetCompressionSettings()) fCompressionChange = kTRUE;
       
       newfile->SetBit(kCanDelete);
       fFileList->Add(newfile);
@@ -246,7 +387,7 @@ Bool_t TFileMerger::AddFile(TFile *source, Bool_t own, Bool_t cpProgress)
          Error("AddFile", "cannot open file %s", source->GetName());
       return kFALSE;
    } else {
-      if (fOutputFile && fOutputFile->GetCompressionLevel() != newfile->GetCompressionLevel()) fCompressionChange = kTRUE;
+      if (fOutputFile && fOutputFile->GetCompressionSettings() != newfile->GetCompressionSettings()) fCompressionChange = kTRUE;
       
       if (own || newfile != source) {
          newfile->SetBit(kCanDelete);
@@ -380,8 +521,10 @@ Bool_t TFileMerger::MergeRecursive(TDirectory *target, TList *sourcelist, Int_t
    
    TFileMergeInfo info(target);
 
-   if ((fFastMethod && !fCompressionChange)) {
-      info.fOptions.Append(" fast");
+   if (fFastMethod) {
+      // With a compression change, the baskets are decompressed and compressed
+      // again without being unstreamed (see TTreeCloner::WriteRecompressedBaskets).
+      info.fOptions.Append(fCompressionChange ? " fast recompress" : " fast");
    }
 
    TFile      *current_file;
@@ -520,11 +663,20 @@ Bool_t TFileMerger::MergeRecursive(TDirectory *target, TList *sourcelist, Int_t
                
                // Loop over all source files and merge same-name object
                TFile *nextsource = current_file ? (TFile*)sourcelist->After( current_file ) : (TFile*)sourcelist->First();
+               Int_t nthreads = fNThreads;
+               if (nthreads == 0) {
+                  SysInfo_t sysinfo;
+                  gSystem->GetSysInfo(&sysinfo);
+                  nthreads = sysinfo.fCpus;
+               }
                if (nextsource == 0) {
                   // There is only one file in the list
                   ROOT::MergeFunc_t func = obj->IsA()->GetMerge();
                   func(obj, &inputs, &info);
                   info.fIsFirst = kFALSE;
+               } else if (nthreads > 1 && sourcelist->After(nextsource) && !cl->GetResetAfterMerge()) {
+                  // Read and merge the objects of the other files in parallel
+                  R__MergeInThreads(obj, sourcelist, nextsource, path, oneGo, info, nthreads);
                } else {
                   do {
                      // make sure we are at the correct directory level by cd'ing to path
@@ -813,6 +965,14 @@ Bool_t TFileMerger::PartialMerge(Int_t in_type)
    
    Bool_t result = kTRUE;
    Int_t type = in_type;
+
+   // Reduce the number of inputs first, in case of a hierarchical merge.
+   TList temporaries;
+   temporaries.SetOwner(kTRUE);
+   if (fFanIn > 1 && !(in_type & kIncremental) &&
+       fFileList->GetEntries() + fExcessFiles->GetEntries() > fFanIn) {
+      result = MergeHierarchically(in_type, temporaries);
+   }
    while (result && fFileList->GetEntries()>0) {
       result = MergeRecursive(fOutputFile, fFileList, type);
       
@@ -840,6 +1000,11 @@ Bool_t TFileMerger::PartialMerge(Int_t in_type)
          OpenExcessFiles();         
       }
    }
+   TIter nexttemp(&temporaries);
+   TObjString *temp;
+   while ((temp = (TObjString*) nexttemp())) {
+      gSystem->Unlink(temp->GetName());
+   }
    if (!result) {
       Error("Merge", "error during merge of your ROOT files");
    } else {
@@ -861,6 +1026,158 @@ Bool_t TFileMerger::PartialMerge(Int_t in_type)
    return result;
 }
 
+//______________________________________________________________________________
+Bool_t TFileMerger::MergeHierarchically(Int_t type, TList &temporaries)
+{
+   // Reduce the inputs (fFileList and fExcessFiles) to at most fFanIn files,
+   // by merging groups of fFanIn inputs into intermediate files, then
+   // groups of those, and so on. The intermediate files are TMemFile as long
+   // as their total size stays below fMaxMemory and temporary files on disk
+   // otherwise; the names of the latter are added to temporaries so that
+   // the caller can remove them. On return fFileList holds the remaining
+   // inputs, to be merged into the output file as usual.
+
+   // The inputs are either opened files or TObjString holding a file name.
+   TList inputs;
+   TIter nextfile(fFileList);
+   TObject *input;
+   while ((input = nextfile())) inputs.Add(input);
+   fFileList->Clear("nodelete");
+   TIter nextexcess(fExcessFiles);
+   while ((input = nextexcess())) {
+      TObjString *url = new TObjString(input->GetName());
+      url->SetBit(kCpProgress, input->TestBit(kCpProgress));
+      inputs.Add(url);
+   }
+   fExcessFiles->Clear();
+
+   Int_t settings = fOutputFile->GetCompressionSettings();
+   Long64_t inmemory = 0;  // Total size of the TMemFile intermediates
+   Int_t level = 0;
+   Bool_t status = kTRUE;
+   while (status && inputs.GetEntries() > fFanIn) {
+      Int_t ninputs = inputs.GetEntries();
+      Int_t ngroups = (ninputs + fFanIn - 1) / fFanIn;
+      if (fPrintLevel > 0) {
+         Printf("%s Merging level %d: %d inputs in %d groups",fMsgPrefix.Data(),level,ninputs,ngroups);
+      }
+      TList outputs;
+      for (Int_t g = 0; status && g < ngroups; ++g) {
+         // Balance the groups so that none of them is much smaller than the others.
+         Int_t size = (Int_t)((Long64_t)(g+1) * ninputs / ngroups - (Long64_t)g * ninputs / ngroups);
+         if (size == 1) {
+            input = inputs.First();
+            inputs.Remove(input);
+            outputs.Add(input);
+            continue;
+         }
+
+         TFileMerger sub(kFALSE, fHistoOneGo);
+         sub.SetMsgPrefix(fMsgPrefix);
+         sub.SetPrintLevel(fPrintLevel - 1);
+         sub.fFastMethod = fFastMethod;
+         sub.fNoTrees = fNoTrees;
+         sub.fObjectNames = fObjectNames;
+         sub.fNThreads = fNThreads;
+         sub.fMaxOpenedFiles = fMaxOpenedFiles;
+         Long64_t insize = 0;
+         for (Int_t i = 0; i < size; ++i) {
+            input = inputs.First();
+            inputs.Remove(input);
+            if (input->InheritsFrom(TFile::Class())) {
+               TFile *file = (TFile*)input;
+               if (file->InheritsFrom(TMemFile::Class())) {
+                  inmemory -= file->GetSize();
+               } else if (fLocal) {
+                  // The sub merger does not know that this is a local copy.
+                  temporaries.Add(new TObjString(TUrl(file->GetPath(), kTRUE).GetFile()));
+               }
+               if (file->TestBit(kCanDelete)) {
+                  sub.AddAdoptFile(file, kFALSE);
+               } else {
+                  sub.AddFile(file, kFALSE);
+               }
+            } else {
+               // Local copies are only made of the original inputs.
+               sub.fLocal = fLocal && !input->TestBit(kTemporary);
+               if (!sub.AddFile(input->GetName(), input->TestBit(kCpProgress))) {
+                  status = kFALSE;
+               } else if (sub.fLocal) {
+                  TFile *copy = (TFile*)sub.fFileList->Last();
+                  temporaries.Add(new TObjString(TUrl(copy->GetPath(), kTRUE).GetFile()));
+               }
+               sub.fLocal = kFALSE;
+               delete input;
+            }
+         }
+         if (!status) break;
+         TIter nextin(sub.fFileList);
+         TFile *file;
+         while ((file = (TFile*)nextin())) {
+            insize += file->GetSize();
+            if (file->GetCompressionSettings() != fOutputFile->GetCompressionSettings()) sub.fCompressionChange = kTRUE;
+         }
+
+         TFile *out = 0;
+         TUUID uuid;
+         TString name;
+         if (fMaxMemory > 0 && inmemory + insize <= fMaxMemory) {
+            name.Form("ROOTMERGE-%s.root", uuid.AsString());
+            out = new TMemFile(name, "RECREATE", "", settings);
+         } else {
+            name.Form("%s/ROOTMERGE-%s.root", gSystem->TempDirectory(), uuid.AsString());
+            out = TFile::Open(name, "RECREATE", "", settings);
+         }
+         if (!out || out->IsZombie()) {
+            Error("MergeHierarchically", "cannot create the intermediate file %s", name.Data());
+            delete out;
+            status = kFALSE;
+            break;
+         }
+         sub.fOutputFile = out;
+         sub.fOutputFilename = name;
+         // Incremental, so that the output file is written but kept.
+         status = sub.PartialMerge(type | kIncremental);
+         sub.fOutputFile = 0;
+         if (out->InheritsFrom(TMemFile::Class())) {
+            inmemory += out->GetSize();
+            out->SetBit(kCanDelete);
+            outputs.Add(out);
+         } else {
+            out->Close();
+            delete out;
+            TObjString *temp = new TObjString(name);
+            temp->SetBit(kTemporary);
+            outputs.Add(temp);
+            temporaries.Add(new TObjString(name));
+         }
+      }
+      // Unmerged inputs (in case of failure) are released with the outputs.
+      TIter nextout(&outputs);
+      while ((input = nextout())) inputs.Add(input);
+      outputs.Clear("nodelete");
+      ++level;
+   }
+
+   // The remaining inputs are merged into the output file by the caller.
+   TIter nextinput(&inputs);
+   while ((input = nextinput())) {
+      if (!status) {
+         if (!input->InheritsFrom(TFile::Class()) || input->TestBit(kCanDelete)) delete input;
+      } else if (input->InheritsFrom(TFile::Class())) {
+         fFileList->Add(input);
+      } else {
+         Bool_t local = fLocal;
+         fLocal = fLocal && !input->TestBit(kTemporary);
+         if (!AddFile(input->GetName(), input->TestBit(kCpProgress))) status = kFALSE;
+         fLocal = local;
+         delete input;
+      }
+   }
+   inputs.Clear("nodelete");
+   return status;
+}
+
 //______________________________________________________________________________
 Bool_t TFileMerger::OpenExcessFiles()
 {
@@ -897,7 +1214,7 @@ Bool_t TFileMerger::OpenExcessFiles()
             Error("OpenExcessFiles", "cannot open file %s", url->GetName());
          return kFALSE;
       } else {
-         if (fOutputFile && fOutputFile->GetCompressionLevel() != newfile->GetCompressionLevel()) fCompressionChange = kTRUE;
+         if (fOutputFile && fOutputFile->GetCompressionSettings() != newfile->GetCompressionSettings()) fCompressionChange = kTRUE;
          
          newfile->SetBit(kCanDelete);
          fFileList->Add(newfile);
@@ -937,6 +1254,50 @@ void TFileMerger::SetMaxOpenedFiles(Int_t newmax)
    }
 }
 
+//______________________________________________________________________________
+void TFileMerger::SetNThreads(Int_t nthreads)
+{
+   // Set the number of threads used to merge the histograms.
+   //
+   // With nthreads > 1 (or nthreads = 0 for one thread per core) the
+   // objects which have a merge function and are not reset after merging
+   // (histograms, profiles, graphs, ...) are read and merged in parallel:
+   // the input files are split in nthreads contiguous slices, each thread
+   // merges the objects of its slice, and the partial results are then
+   // merged in order, so that the output does not depend on the thread
+   // scheduling. The TTrees and the other incrementally mergeable objects
+   // are still merged sequentially since they are written to the output
+   // file while being merged.
+   // The classes of the merged objects must support being read and merged
+   // concurrently from different files.
+   //
+   // The default, nthreads = 1, merges everything in the calling thread.
+
+   fNThreads = nthreads < 0 ? 1 : nthreads;
+}
+
+//______________________________________________________________________________
+void TFileMerger::SetHierarchicalMerge(Int_t fanin, Long64_t maxmemory)
+{
+   // Merge the files hierarchically, fanin at a time (0 or 1 to disable).
+   //
+   // Instead of merging all the inputs into the output file, which is done
+   // in several incremental passes over the output when there are more
+   // inputs than the maximum number of opened files, the inputs are merged
+   // by groups of fanin into intermediate files, which are in turn merged by
+   // groups of fanin, until at most fanin files are left and merged into the
+   // output. Each object is thus merged about log(n)/log(fanin) times
+   // instead of once per pass. The intermediate files are kept in memory
+   // (TMemFile) as long as their total size does not exceed maxmemory bytes,
+   // and written to temporary files in TSystem::TempDirectory() otherwise
+   // (always if maxmemory is 0). fanin is limited to the maximum number of
+   // opened files. This only applies to non incremental merges.
+
+   if (fanin > fMaxOpenedFiles - 1) fanin = fMaxOpenedFiles - 1;
+   fFanIn = fanin > 1 ? fanin : 0;
+   fMaxMemory = maxmemory > 0 ? maxmemory : 0;
+}
+
 //______________________________________________________________________________
 void TFileMerger::SetMsgPrefix(const char *prefix)
 {
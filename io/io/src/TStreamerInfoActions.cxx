@@ -1226,6 +1226,27 @@ namespace TStreamerInfoActions
          return 0;
       }
 
+      template <typename T>
+      static INLINE_TEMPLATE_ARGS Int_t WriteCollectionBasicType(TBuffer &buf, void *addr, const TConfiguration *conf)
+      {
+         // Collection of numbers, written in one go straight from the vector's
+         // storage, bypassing the TClass and the collection proxy.  The output
+         // is the same as the one of the generic kSTL case of WriteBufferAux.
+
+         TConfigSTL *config = (TConfigSTL*)conf;
+         UInt_t pos = buf.WriteVersion(config->fInfo->IsA(), kTRUE);
+
+         std::vector<T> *const vec = (std::vector<T>*)(((char*)addr)+config->fOffset);
+         Int_t nvalues = vec->size();
+         buf.WriteInt(nvalues);
+         if (nvalues) {
+            buf.WriteFastArray(&(*vec)[0], nvalues);
+         }
+
+         buf.SetByteCount(pos, kTRUE);
+         return 0;
+      }
+
       template <typename From, typename To>
       struct ConvertCollectionBasicType {
          static INLINE_TEMPLATE_ARGS Int_t Action(TBuffer &buf, void *addr, const TConfiguration *conf)
@@ -1968,6 +1989,62 @@ static TConfiguredAction GetNumericCollectionReadAction(Int_t type, TConfigSTL *
    return TConfiguredAction();
 }
 
+static Bool_t CanWriteNumericCollection(TStreamerElement *element)
+{
+   // Return true if the kSTL element is a std::vector of a basic type that
+   // VectorLooper::WriteCollectionBasicType can write directly.
+
+   TClass *cl = element->GetClassPointer();
+   TVirtualCollectionProxy *proxy = cl ? cl->GetCollectionProxy() : 0;
+   if (!proxy || element->GetArrayLength() > 1 || element->GetStreamer()
+       || (element->IsBase() && element->IsA()!=TStreamerBase::Class())
+       || proxy->GetCollectionType() != TClassEdit::kVector
+       || proxy->GetValueClass() || proxy->HasPointers()) {
+      return kFALSE;
+   }
+   switch (proxy->GetType()) {
+      case TStreamerInfo::kChar:
+      case TStreamerInfo::kShort:
+      case TStreamerInfo::kInt:
+      case TStreamerInfo::kLong:
+      case TStreamerInfo::kLong64:
+      case TStreamerInfo::kFloat:
+      case TStreamerInfo::kDouble:
+      case TStreamerInfo::kUChar:
+      case TStreamerInfo::kUShort:
+      case TStreamerInfo::kUInt:
+      case TStreamerInfo::kULong:
+      case TStreamerInfo::kULong64:
+         return kTRUE;
+      default:
+         // vector<bool> has no contiguous storage, Float16_t and Double32_t
+         // are packed.
+         return kFALSE;
+   }
+}
+
+static TConfiguredAction GetNumericCollectionWriteAction(Int_t type, TConfigSTL *conf)
+{
+   // Return the action writing a std::vector of 'type' (see CanWriteNumericCollection).
+
+   switch (type) {
+      case TStreamerInfo::kChar:    return TConfiguredAction( VectorLooper::WriteCollectionBasicType<Char_t>, conf );    break;
+      case TStreamerInfo::kShort:   return TConfiguredAction( VectorLooper::WriteCollectionBasicType<Short_t>,conf );   break;
+      case TStreamerInfo::kInt:     return TConfiguredAction( VectorLooper::WriteCollectionBasicType<Int_t>,  conf );     break;
+      case TStreamerInfo::kLong:    return TConfiguredAction( VectorLooper::WriteCollectionBasicType<Long_t>, conf );    break;
+      case TStreamerInfo::kLong64:  return TConfiguredAction( VectorLooper::WriteCollectionBasicType<Long64_t>, conf );  break;
+      case TStreamerInfo::kFloat:   return TConfiguredAction( VectorLooper::WriteCollectionBasicType<Float_t>,  conf );   break;
+      case TStreamerInfo::kDouble:  return TConfiguredAction( VectorLooper::WriteCollectionBasicType<Double_t>, conf );  break;
+      case TStreamerInfo::kUChar:   return TConfiguredAction( VectorLooper::WriteCollectionBasicType<UChar_t>,  conf );   break;
+      case TStreamerInfo::kUShort:  return TConfiguredAction( VectorLooper::WriteCollectionBasicType<UShort_t>, conf );  break;
+      case TStreamerInfo::kUInt:    return TConfiguredAction( VectorLooper::WriteCollectionBasicType<UInt_t>,   conf );    break;
+      case TStreamerInfo::kULong:   return TConfiguredAction( VectorLooper::WriteCollectionBasicType<ULong_t>,  conf );   break;
+      case TStreamerInfo::kULong64: return TConfiguredAction( VectorLooper::WriteCollectionBasicType<ULong64_t>, conf ); break;
+   }
+   R__ASSERT(0); // We should never be here
+   return TConfiguredAction();
+}
+
 template <typename Looper, typename From> 
 static TConfiguredAction GetConvertCollectionReadActionFrom(Int_t newtype, TConfiguration *conf)
 {
@@ -2250,9 +2327,11 @@ void TStreamerInfo::Compile()
 
    if (fReadObjectWise) {
       fReadObjectWise->fActions.clear();
+      fReadObjectWise->ResetFusedAction();
    }
    if (fWriteObjectWise) {
       fWriteObjectWise->fActions.clear();
+      fWriteObjectWise->ResetFusedAction();
    }
    Int_t ndata = fElements->GetEntries();
 
@@ -2694,7 +2773,7 @@ void TStreamerInfo::AddReadAction(Int_t i, TStreamerElement* element)
 }
 
 //______________________________________________________________________________
-void TStreamerInfo::AddWriteAction(Int_t i, TStreamerElement* /*element*/ )
+void TStreamerInfo::AddWriteAction(Int_t i, TStreamerElement* element )
 {
    switch (fType[i]) {
       // write basic types
@@ -2776,6 +2855,14 @@ void TStreamerInfo::AddWriteAction(Int_t i, TStreamerElement* /*element*/ )
         }
         break;
      } */
+      case TStreamerInfo::kSTL:
+         if (CanWriteNumericCollection(element)) {
+            TClass *cl = element->GetClassPointer();
+            fWriteObjectWise->AddAction( GetNumericCollectionWriteAction(cl->GetCollectionProxy()->GetType(), new TConfigSTL(this,i,fOffset[i],1,cl,element->GetTypeName(),kFALSE)) );
+         } else {
+            fWriteObjectWise->AddAction( GenericWriteAction, new TGenericConfiguration(this,i) );
+         }
+         break;
       default:
          fWriteObjectWise->AddAction( GenericWriteAction, new TGenericConfiguration(this,i) );
          break;
@@ -3073,6 +3160,132 @@ void TStreamerInfoActions::TActionSequence::AddToOffset(Int_t delta)
    {
       iter->fConfiguration->AddToOffset(delta);
    }
+   // The offsets are hard coded in the fused function.
+   ResetFusedAction();
+}
+
+Long_t TStreamerInfoActions::TActionSequence::fgFuseThreshold = 0;
+
+namespace {
+   struct TFusableRead {
+      TStreamerInfoAction_t fAction; // Action reading a single basic type
+      const char           *fType;   // Type read
+      const char           *fMethod; // Equivalent TBufferFile method
+   };
+
+   const TFusableRead gFusableReads[] = {
+      { ReadBasicType<Bool_t>,    "Bool_t",    "ReadBool"    },
+      { ReadBasicType<Char_t>,    "Char_t",    "ReadChar"    },
+      { ReadBasicType<Short_t>,   "Short_t",   "ReadShort"   },
+      { ReadBasicType<Int_t>,     "Int_t",     "ReadInt"     },
+      { ReadBasicType<Long_t>,    "Long_t",    "ReadLong"    },
+      { ReadBasicType<Long64_t>,  "Long64_t",  "ReadLong64"  },
+      { ReadBasicType<Float_t>,   "Float_t",   "ReadFloat"   },
+      { ReadBasicType<Double_t>,  "Double_t",  "ReadDouble"  },
+      { ReadBasicType<UChar_t>,   "UChar_t",   "ReadUChar"   },
+      { ReadBasicType<UShort_t>,  "UShort_t",  "ReadUShort"  },
+      { ReadBasicType<UInt_t>,    "UInt_t",    "ReadUInt"    },
+      { ReadBasicType<ULong_t>,   "ULong_t",   "ReadULong"   },
+      { ReadBasicType<ULong64_t>, "ULong64_t", "ReadULong64" }
+   };
+
+   const TFusableRead *R__FindFusableRead(TStreamerInfoAction_t action)
+   {
+      // Return the description of 'action' if it reads a single basic type
+      // that the fused function can read inline, 0 otherwise.
+
+      for (size_t i = 0; i < sizeof(gFusableReads)/sizeof(gFusableReads[0]); ++i) {
+         if (gFusableReads[i].fAction == action) return &gFusableReads[i];
+      }
+      return 0;
+   }
+
+   TStreamerInfoFusedAction_t R__GenerateFusedAction(const TActionSequence &sequence)
+   {
+      // Generate and compile the function applying all the actions of
+      // sequence, see TActionSequence::Fuse. Return 0 if there is none.
+      // Must be called with gClingMutex held.
+
+      const ActionContainer_t &actions = sequence.fActions;
+      if (!gInterpreter || actions.size() < 2) return 0;
+
+      static Int_t nfused = 0;
+      TString name = TString::Format("R__StreamerInfoFusedAction%d", nfused);
+      TString code;
+      code.Form("Int_t %s(TBuffer &buf, void *obj, const TStreamerInfoActions::TConfiguredAction *actions)\n{\n", name.Data());
+      if (sequence.fStreamerInfo) {
+         code += TString::Format("   // %s version %d\n", sequence.fStreamerInfo->GetName(), sequence.fStreamerInfo->GetClassVersion());
+      }
+      code += "   TBufferFile &b = (TBufferFile&)buf;\n";
+      code += "   char *o = (char*)obj;\n";
+      Int_t ninline = 0;
+      for (UInt_t i = 0; i < actions.size(); ++i) {
+         const TFusableRead *read = R__FindFusableRead(actions[i].fAction);
+         if (read) {
+            code += TString::Format("   b.TBufferFile::%s(*(%s*)(o+%d));\n", read->fMethod, read->fType, actions[i].fConfiguration->fOffset);
+            ++ninline;
+         } else {
+            code += TString::Format("   actions[%u](buf,obj);\n", i);
+         }
+      }
+      code += "   return 0;\n}\n";
+      if (!ninline) return 0;
+
+      static Bool_t included = kFALSE;
+      TInterpreter::EErrorCode err = TInterpreter::kNoError;
+      if (!included) {
+         gInterpreter->ProcessLine("#include \"TBufferFile.h\"", &err);
+         if (err == TInterpreter::kNoError) gInterpreter->ProcessLine("#include \"TStreamerInfoActions.h\"", &err);
+         if (err != TInterpreter::kNoError) return 0;
+         included = kTRUE;
+      }
+      ++nfused;
+      gInterpreter->ProcessLine(code, &err);
+      if (err != TInterpreter::kNoError) return 0;
+      Long_t addr = gInterpreter->Calc(TString::Format("(Long_t)&%s", name.Data()), &err);
+      if (err != TInterpreter::kNoError || !addr) return 0;
+
+      if (gDebug > 0) {
+         ::Info("TActionSequence::Fuse", "%s: fused %d actions (%d inline)",
+                sequence.fStreamerInfo ? sequence.fStreamerInfo->GetName() : "", (Int_t)actions.size(), ninline);
+      }
+      return (TStreamerInfoFusedAction_t)addr;
+   }
+}
+
+TStreamerInfoActions::TStreamerInfoFusedAction_t TStreamerInfoActions::TActionSequence::Fuse() const
+{
+   // Generate a function applying all the actions of this sequence in a row,
+   // compile it with the interpreter and return it. The reading of the basic
+   // types is done inline with the non virtual TBufferFile methods, so the
+   // function must only be used with a buffer of class TBufferFile (see
+   // TBufferFile::ApplySequence), and the other actions are called directly,
+   // which avoids the loop and one indirect call per data member.
+   // Return 0, and do not try again, if the sequence does not contain any
+   // basic type read or if the compilation fails: the actions are then
+   // applied one by one as usual.
+   // The status is only changed, atomically, once fFusedAction is set, so
+   // that the other threads either see 0 or the complete function.
+
+   R__LOCKGUARD2(gClingMutex);
+
+   Long_t status = fFuseStatus.Get();
+   if (status) return status > 0 ? fFusedAction : 0;
+   fFusedAction = R__GenerateFusedAction(*this);
+   if (fFusedAction) ++fFuseStatus;
+   else --fFuseStatus;
+   return fFusedAction;
+}
+
+void TStreamerInfoActions::TActionSequence::SetFuseThreshold(Long_t ncalls)
+{
+   // Enable the generation of fused code for the action sequences applied
+   // object wise by TBufferFile (see Fuse). A sequence is fused when it has
+   // been applied ncalls times, so that the cost of the compilation is only
+   // paid for the classes that are read often. 0 (the default) disables it.
+   // Sequences already fused are not affected.
+
+   fgFuseThreshold = ncalls > 0 ? ncalls : 0;
 }
 
 TStreamerInfoActions::TActionSequence *TStreamerInfoActions::TActionSequence::CreateCopy()
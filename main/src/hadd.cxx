@@ -32,6 +32,16 @@
   the Trees with
        hadd -T targetfile source1 source2 ...
 
+  The histograms can be read and merged by several threads with
+       hadd -j nthreads targetfile source1 source2 ...
+  (-j 0 uses one thread per core, see TFileMerger::SetNThreads and
+  TTree::SetFlushThreads).
+
+  A large number of files can be merged hierarchically, 'fanin' at a time,
+  keeping at most 'maxmemory' MB of intermediate results in memory, with
+       hadd -r fanin -M maxmemory targetfile source1 source2 ...
+  (see TFileMerger::SetHierarchicalMerge).
+
   Wildcarding and indirect files are also supported
     hadd result.root  myfil*.root
    will merge all files in myfil*.root
@@ -47,6 +57,9 @@
   the merge will be done without  unzipping or unstreaming the baskets
   (i.e. direct copy of the raw byte on disk). The "fast" mode is typically
   5 times faster than the mode unzipping and unstreaming the baskets.
+  If the compression settings differ (e.g. with -f207 to convert the files to
+  LZMA), the baskets are unzipped and zipped again with the target settings,
+  by several threads with -j, but they are still not unstreamed. Use -O to rebuild the baskets instead.
 
   NOTE1: By default histograms are added. However hadd does not support the case where
          histograms have their bit TH1::kIsAverage set.
@@ -71,13 +84,14 @@
 #include <stdlib.h>
 
 #include "TFileMerger.h"
+#include "TTree.h"
 
 //___________________________________________________________________________
 int main( int argc, char **argv )
 {
 
    if ( argc < 3 || "-h" == std::string(argv[1]) || "--help" == std::string(argv[1]) ) {
-      std::cout << "Usage: " << argv[0] << " [-f[0-9]] [-k] [-T] [-O] [-n maxopenedfiles] [-v verbosity] targetfile source1 [source2 source3 ...]" << std::endl;
+      std::cout << "Usage: " << argv[0] << " [-f[0-9]] [-k] [-T] [-O] [-n maxopenedfiles] [-j nthreads] [-r fanin [-M maxmemory]] [-v verbosity] targetfile source1 [source2 source3 ...]" << std::endl;
       std::cout << "This program will add histograms from a list of root files and write them" << std::endl;
       std::cout << "to a target root file. The target file is newly created and must not " << std::endl;
       std::cout << "exist, or if -f (\"force\") is given, must not be one of the source files." << std::endl;
@@ -87,12 +101,15 @@ int main( int argc, char **argv )
       std::cout << "If the option -O is used, when merging TTree, the basket size is re-optimized" <<std::endl;
       std::cout << "If the option -v is used, explicitly set the verbosity level; 0 request no output, 99 is the default" <<std::endl;
       std::cout << "If the option -n is used, hadd will open at most 'maxopenedfiles' at once, use 0 to request to use the system maximum." << std::endl;
+      std::cout << "If the option -j is used, the histograms are merged (and the baskets recompressed) by 'nthreads' threads, use 0 to request one thread per core." << std::endl;
+      std::cout << "If the option -r is used, the files are merged hierarchically, 'fanin' at a time, into intermediate files." << std::endl;
+      std::cout << "If the option -M is used, at most 'maxmemory' MB of intermediate files are kept in memory, the others are written in the temporary directory (the default)." << std::endl;
       std::cout << "When -the -f option is specified, one can also specify the compression" <<std::endl;
       std::cout << "level of the target file. By default the compression level is 1, but" <<std::endl;
       std::cout << "if \"-f0\" is specified, the target file will not be compressed." <<std::endl;
       std::cout << "if \"-f6\" is specified, the compression level 6 will be used." <<std::endl;
-      std::cout << "if Target and source files have different compression levels"<<std::endl;
-      std::cout << " a slower method is used"<<std::endl;
+      std::cout << "if Target and source files have different compression settings"<<std::endl;
+      std::cout << " the baskets are recompressed, which is slower"<<std::endl;
       return 1;
    }
 
@@ -101,6 +118,9 @@ int main( int argc, char **argv )
    Bool_t reoptimize = kFALSE;
    Bool_t noTrees = kFALSE;
    Int_t maxopenedfiles = 0;
+   Int_t nthreads = 1;
+   Int_t fanin = 0;
+   Long64_t maxmemory = 0;
    Int_t verbosity = 99;
 
    int outputPlace = 0;
@@ -133,6 +153,48 @@ int main( int argc, char **argv )
             }
          }
          ++ffirst;
+      } else if ( strcmp(argv[a],"-j") == 0 ) {
+         if (a+1 >= argc) {
+            std::cerr << "Error: no number of threads was provided after -j.\n";
+         } else {
+            Long_t request = strtol(argv[a+1], 0, 10);
+            if (request < kMaxInt && request >= 0) {
+               nthreads = (Int_t)request;
+               ++a;
+               ++ffirst;
+            } else {
+               std::cerr << "Error: could not parse the number of threads passed after -j: " << argv[a+1] << ". We will use one thread.\n";
+            }
+         }
+         ++ffirst;
+      } else if ( strcmp(argv[a],"-r") == 0 ) {
+         if (a+1 >= argc) {
+            std::cerr << "Error: no fan-in was provided after -r.\n";
+         } else {
+            Long_t request = strtol(argv[a+1], 0, 10);
+            if (request < kMaxInt && request >= 0) {
+               fanin = (Int_t)request;
+               ++a;
+               ++ffirst;
+            } else {
+               std::cerr << "Error: could not parse the fan-in passed after -r: " << argv[a+1] << ". We will not merge hierarchically.\n";
+            }
+         }
+         ++ffirst;
+      } else if ( strcmp(argv[a],"-M") == 0 ) {
+         if (a+1 >= argc) {
+            std::cerr << "Error: no memory size was provided after -M.\n";
+         } else {
+            Long_t request = strtol(argv[a+1], 0, 10);
+            if (request < kMaxInt && request >= 0) {
+               maxmemory = 1024 * 1024 * (Long64_t)request;
+               ++a;
+               ++ffirst;
+            } else {
+               std::cerr << "Error: could not parse the memory size passed after -M: " << argv[a+1] << ". We will keep the intermediate files on disk.\n";
+            }
+         }
+         ++ffirst;
       } else if ( strcmp(argv[a],"-v") == 0 ) {
          if (a+1 >= argc) {
             std::cerr << "Error: no verbosity level was provided after -v.\n";
@@ -187,6 +249,9 @@ int main( int argc, char **argv )
    if (maxopenedfiles > 0) {
       merger.SetMaxOpenedFiles(maxopenedfiles);
    }
+   merger.SetNThreads(nthreads);
+   TTree::SetFlushThreads(nthreads);
+   merger.SetHierarchicalMerge(fanin, maxmemory);
    if (!merger.OutputFile(targetname,force,newcomp) ) {
       std::cerr << "hadd error opening target file (does " << argv[ffirst-1] << " exist?)." << std::endl;
       std::cerr << "Pass \"-f\" argument to force re-creation of output file." << std::endl;
@@ -221,8 +286,8 @@ int main( int argc, char **argv )
    } else {
       if (merger.HasCompressionChange()) {
          // Don't warn if the user any request re-optimization.
-         std::cout <<"hadd Sources and Target have different compression levels"<<std::endl;
-         std::cout <<"hadd merging will be slower"<<std::endl;
+         std::cout <<"hadd Sources and Target have different compression settings"<<std::endl;
+         std::cout <<"hadd the baskets of the trees will be recompressed, merging will be slower"<<std::endl;
       }
    }
    merger.SetNotrees(noTrees);
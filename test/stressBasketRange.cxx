@@ -0,0 +1,411 @@
+/////////////////////////////////////////////////////////////////
+//
+//___A stress test for the selections skipping baskets by their range___
+//
+//   Branches calling TBranch::SetBasketMinMax() record the range of the
+//   values of each basket, and TTree::Draw and TTree::CopyTree skip the
+//   baskets where the selection can not pass (TTreeFormula::SkipEntries).
+//   The same entries are written to a tree "ranged", with ranges, and to a
+//   tree "plain", without ranges, and the results of the two trees are
+//   compared:
+//   - Test1() - the ranges are recorded, and used by TTreeFormula::SkipEntries
+//   - Test2() - Draw with selections using &&, || and ! on scalar branches
+//   - Test3() - Draw with selections on arrays and on values with NaNs
+//   - Test4() - Draw with selections on the branches of a friend tree
+//   - Test5() - CopyTree with the selections of the tests above
+//   - Test6() - Draw and CopyTree of a tree with fast-cloned baskets
+//
+//   To run in batch mode, do
+//     stressBasketRange
+//     stressBasketRange 20000
+//   Here the parameter is the number of entries of the trees.
+//   Default value is 20000
+//
+//   An example of output when all tests pass:
+// **********************************************************************
+// ***************Starting basket range stress test**********************
+// **********************************************************************
+// Test1: Ranges recorded and used by SkipEntries--------------------- OK
+// Test2: Selections with &&, || and ! on scalars--------------------- OK
+// Test3: Selections on arrays and NaN values------------------------- OK
+// Test4: Selections on a friend tree--------------------------------- OK
+// Test5: CopyTree with and without ranges---------------------------- OK
+// Test6: Fast-cloned baskets----------------------------------------- OK
+// **********************************************************************
+// *******************Deleting the data files****************************
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "TApplication.h"
+#include "TBranch.h"
+#include "TChain.h"
+#include "TEntryList.h"
+#include "TFile.h"
+#include "TMath.h"
+#include "TRandom.h"
+#include "TSystem.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+
+Int_t stressBasketRange(Int_t nentries = 20000);
+
+const char *kDataFile  = "stressBasketRange.root";
+const char *kCopyFile  = "stressBasketRangeCopy.root";
+const char *kCloneFile = "stressBasketRangeClone.root";
+const Int_t kBufSize   = 2000; // Small baskets, to have many of them
+
+// Selections on the scalar branches
+const char *kScalarSelections[] = {
+   "t>5000", "t>=2000 && t<3000", "t<1000 || t>19000", "!(t>=500)",
+   "!(t>100 && x>0)", "k==42", "k!=42 && t<5000", "t>4000 && x>1",
+   "abs(t-5000)<100", "2*t-1<300", "-t>-100", "t>5000 && 0", "1 || t>5",
+   "!(t<3000 || t>3500) && x<0", 0
+};
+
+// Selections on the arrays and on the branch with NaNs
+const char *kArraySelections[] = {
+   "a>19990", "a[2]<10000", "a[0]<500 || a[2]>19500", "v>1500", "!(v<1000)",
+   "n==2 && v>1000", "Sum$(a)>30000", "w>3000 && w<3500", "w!=w", "!(w<5000)",
+   "w==w && t<1000", "!(w>=0)", 0
+};
+
+// Selections on the friend tree, whose branch t is decreasing
+const char *kFriendSelections[] = {
+   "fr.t>15000", "fr.t<100", "t>3000 && fr.u<100", "!(fr.t<10000) && t<12000",
+   "fr.u>4900 || t<200", 0
+};
+
+void MakeFile(Int_t nentries)
+{
+   // Write the trees "ranged" and "plain" with the same entries, and the
+   // friend tree "fr".
+
+   TFile *f = new TFile(kDataFile, "RECREATE");
+   Double_t t, x, w, a[3];
+   Int_t k, n;
+   Float_t v[4];
+   TTree *ranged = new TTree("ranged", "branches with ranges");
+   TTree *plain = new TTree("plain", "branches without ranges");
+   TTree *trees[2] = { ranged, plain };
+   for (Int_t i = 0; i < 2; i++) {
+      trees[i]->Branch("t", &t, "t/D", kBufSize);
+      trees[i]->Branch("x", &x, "x/D", kBufSize);
+      trees[i]->Branch("k", &k, "k/I", kBufSize);
+      trees[i]->Branch("n", &n, "n/I", kBufSize);
+      trees[i]->Branch("v", v, "v[n]/F", kBufSize);
+      trees[i]->Branch("a", a, "a[3]/D", kBufSize);
+      trees[i]->Branch("w", &w, "w/D", kBufSize);
+   }
+   TIter next(ranged->GetListOfBranches());
+   TBranch *branch;
+   while ((branch = (TBranch*)next())) branch->SetBasketMinMax();
+
+   Double_t tfr, u;
+   TTree *fr = new TTree("fr", "friend tree");
+   fr->Branch("t", &tfr, "t/D", kBufSize)->SetBasketMinMax();
+   fr->Branch("u", &u, "u/D", kBufSize)->SetBasketMinMax();
+
+   for (Int_t i = 0; i < nentries; i++) {
+      t = i;
+      x = gRandom->Gaus();
+      k = i / 100;
+      n = i % 4;
+      for (Int_t j = 0; j < n; j++) v[j] = i / 10. + j;
+      for (Int_t j = 0; j < 3; j++) a[j] = i + 100 * j;
+      w = (i % 1000 == 500) ? TMath::QuietNaN() : i;
+      ranged->Fill();
+      plain->Fill();
+      tfr = nentries - 1 - i;
+      u = i % 5000;
+      fr->Fill();
+   }
+   f->Write();
+   delete f;
+}
+
+Bool_t SameValue(Double_t x1, Double_t x2)
+{
+   return x1 == x2 || (TMath::IsNaN(x1) && TMath::IsNaN(x2));
+}
+
+Int_t CompareDraw(TTree *t1, TTree *t2, const char *varexp, const char *selection)
+{
+   // Return the number of differences between the values drawn from t1 and
+   // t2 with the selection.
+
+   Long64_t n1 = t1->Draw(varexp, selection, "goff");
+   std::vector<Double_t> values;
+   if (n1 > 0) values.assign(t1->GetV1(), t1->GetV1() + n1);
+   Long64_t n2 = t2->Draw(varexp, selection, "goff");
+   if (n1 != n2) {
+      printf("\n%s: %lld rows with ranges, %lld without\n", selection, n1, n2);
+      return 1;
+   }
+   Int_t wrong = 0;
+   for (Long64_t i = 0; i < n2; i++) {
+      if (!SameValue(values[i], t2->GetV1()[i])) wrong++;
+   }
+   if (wrong) printf("\n%s: %d wrong values\n", selection, wrong);
+   return wrong;
+}
+
+Int_t CompareEntryLists(TTree *t1, TTree *t2, const char *selection)
+{
+   // Return the number of differences between the entry lists made by Draw
+   // from t1 and t2 with the selection.
+
+   t1->Draw(">>elranged", selection, "entrylist");
+   t2->Draw(">>elplain", selection, "entrylist");
+   TEntryList *el1 = (TEntryList*)gDirectory->Get("elranged");
+   TEntryList *el2 = (TEntryList*)gDirectory->Get("elplain");
+   Int_t wrong = 0;
+   if (!el1 || !el2 || el1->GetN() != el2->GetN()) {
+      wrong = 1;
+   } else {
+      for (Long64_t i = 0; i < el2->GetN(); i++) {
+         if (el1->GetEntry(i) != el2->GetEntry(i)) wrong++;
+      }
+   }
+   if (wrong) printf("\n%s: %d wrong entries in the entry list\n", selection, wrong);
+   delete el1;
+   delete el2;
+   return wrong;
+}
+
+Int_t CompareCopies(TTree *t1, TTree *t2, const char *selection)
+{
+   // Return the number of differences between the trees copied by CopyTree
+   // from t1 and t2 with the selection.
+
+   TDirectory *dir = gDirectory;
+   TFile *f = new TFile(kCopyFile, "RECREATE");
+   TTree *c1 = t1->CopyTree(selection);
+   TTree *c2 = t2->CopyTree(selection);
+   Int_t wrong = 0;
+   if (!c1 || !c2 || c1->GetEntries() != c2->GetEntries()) {
+      printf("\n%s: %lld entries copied with ranges, %lld without\n", selection,
+             c1 ? c1->GetEntries() : -1, c2 ? c2->GetEntries() : -1);
+      wrong = 1;
+   } else {
+      wrong += CompareDraw(c1, c2, "t", "");
+      wrong += CompareDraw(c1, c2, "a", "");
+   }
+   delete c1;
+   delete c2;
+   delete f;
+   dir->cd();
+   return wrong;
+}
+
+Int_t CompareSelections(TTree *t1, TTree *t2, const char **selections, const char *varexp)
+{
+   // Return the number of differences between the Draw results of t1 and t2
+   // for all the selections.
+
+   Int_t wrong = 0;
+   for (Int_t i = 0; selections[i]; i++) {
+      wrong += CompareDraw(t1, t2, varexp, selections[i]);
+      wrong += CompareEntryLists(t1, t2, selections[i]);
+   }
+   return wrong;
+}
+
+Bool_t Test1(TTree *ranged, TTree *plain, Int_t nentries)
+{
+   // The ranges of the baskets are recorded for the ranged tree only, and
+   // SkipEntries skips the baskets where the selection can not pass, but
+   // not on the ranges of a friend tree.
+
+   Int_t wrong = 0;
+   TBranch *branch = ranged->GetBranch("t");
+   if (!branch->HasBasketMinMax()) wrong++;
+   if (plain->GetBranch("t")->HasBasketMinMax()) wrong++;
+
+   Double_t min, max;
+   Long64_t next = 0;
+   if (!branch->GetBasketMinMax(0, min, max, next)) wrong++;
+   else if (min != 0 || max != next - 1 || next >= nentries) wrong++;
+   if (plain->GetBranch("t")->GetBasketMinMax(0, min, max, next)) wrong++;
+   // The basket of the entry 500 of w holds a NaN.
+   if (ranged->GetBranch("w")->GetBasketMinMax(500, min, max, next)) wrong++;
+   if (!ranged->GetBranch("w")->GetBasketMinMax(0, min, max, next)) wrong++;
+
+   TTreeFormula *select = new TTreeFormula("select", "t>5000", ranged);
+   Long64_t first = select->SkipEntries(0);
+   if (first <= 0 || first > 5001) wrong++;
+   delete select;
+   select = new TTreeFormula("select", "t>5000", plain);
+   if (select->SkipEntries(0) != 0) wrong++;
+   delete select;
+   select = new TTreeFormula("select", "fr.t<100", ranged);
+   if (select->SkipEntries(0) != 0) wrong++;
+   delete select;
+   return wrong == 0;
+}
+
+Bool_t Test2(TTree *ranged, TTree *plain)
+{
+   // Selections with &&, || and ! on scalar branches.
+
+   return CompareSelections(ranged, plain, kScalarSelections, "t") == 0;
+}
+
+Bool_t Test3(TTree *ranged, TTree *plain)
+{
+   // Selections on fixed and variable size arrays, and on a branch with NaNs.
+
+   Int_t wrong = CompareSelections(ranged, plain, kArraySelections, "t");
+   wrong += CompareDraw(ranged, plain, "v", "v>1500 || t<100");
+   wrong += CompareDraw(ranged, plain, "w", "!(w<5000)");
+   return wrong == 0;
+}
+
+Bool_t Test4(TTree *ranged, TTree *plain)
+{
+   // Selections on the branches of a friend tree, which has a branch t too.
+
+   Int_t wrong = CompareSelections(ranged, plain, kFriendSelections, "t");
+   wrong += CompareDraw(ranged, plain, "fr.t", "t>5000 && fr.t>10000");
+   return wrong == 0;
+}
+
+Bool_t Test5(TTree *ranged, TTree *plain)
+{
+   // CopyTree with the selections of the tests above.
+
+   Int_t wrong = 0;
+   const char **selections[] = { kScalarSelections, kArraySelections, kFriendSelections, 0 };
+   for (Int_t i = 0; selections[i]; i++) {
+      for (Int_t j = 0; selections[i][j]; j++) {
+         wrong += CompareCopies(ranged, plain, selections[i][j]);
+      }
+   }
+   return wrong == 0;
+}
+
+Bool_t Test6(TTree *ranged, Int_t nentries)
+{
+   // Copy the ranged tree twice, first with fast cloning, then entry by
+   // entry: the baskets copied as is have unknown ranges, the others are
+   // recorded again. Compare with a chain of the plain tree twice.
+
+   // The friend tree is not copied.
+   TTree *fr = ranged->GetFriend("fr");
+   if (fr) ranged->RemoveFriend(fr);
+
+   TDirectory *dir = gDirectory;
+   TFile *f = new TFile(kCloneFile, "RECREATE");
+   TTree *clone = ranged->CloneTree(-1, "fast");
+   clone->CopyEntries(ranged, -1, "");
+   f->Write();
+   delete f;
+   dir->cd();
+
+   f = new TFile(kCloneFile);
+   clone = (TTree*)f->Get("ranged");
+   if (!clone) {
+      delete f;
+      return kFALSE;
+   }
+   Int_t wrong = 0;
+   Double_t min, max;
+   Long64_t next;
+   TBranch *branch = clone->GetBranch("t");
+   if (clone->GetEntries() != 2 * nentries) wrong++;
+   if (!branch->HasBasketMinMax()) wrong++;
+   if (branch->GetBasketMinMax(0, min, max, next)) wrong++;
+   if (!branch->GetBasketMinMax(nentries, min, max, next)) wrong++;
+   else if (min != 0 || max != next - nentries - 1) wrong++;
+
+   TChain *chain = new TChain("plain");
+   chain->Add(kDataFile);
+   chain->Add(kDataFile);
+   wrong += CompareSelections(clone, chain, kScalarSelections, "t");
+   wrong += CompareSelections(clone, chain, kArraySelections, "t");
+   for (Int_t i = 0; kScalarSelections[i]; i++) {
+      wrong += CompareCopies(clone, chain, kScalarSelections[i]);
+   }
+   delete chain;
+   delete f;
+   return wrong == 0;
+}
+
+void CleanUp()
+{
+   gSystem->Unlink(kDataFile);
+   gSystem->Unlink(kCopyFile);
+   gSystem->Unlink(kCloneFile);
+}
+
+Int_t stressBasketRange(Int_t nentries)
+{
+   MakeFile(nentries);
+   printf("**********************************************************************\n");
+   printf("***************Starting basket range stress test**********************\n");
+   printf("**********************************************************************\n");
+
+   TFile *f = new TFile(kDataFile);
+   TTree *ranged = (TTree*)f->Get("ranged");
+   TTree *plain = (TTree*)f->Get("plain");
+   TTree *fr = (TTree*)f->Get("fr");
+   if (!ranged || !plain || !fr) {
+      printf("Reading the trees of %s FAILED\n", kDataFile);
+      delete f;
+      CleanUp();
+      return 1;
+   }
+   ranged->AddFriend(fr);
+   plain->AddFriend(fr);
+
+   if (Test1(ranged, plain, nentries))
+      printf("Test1: Ranges recorded and used by SkipEntries--------------------- OK\n");
+   else
+      printf("Test1: Ranges recorded and used by SkipEntries--------------------- FAILED\n");
+
+   if (Test2(ranged, plain))
+      printf("Test2: Selections with &&, || and ! on scalars--------------------- OK\n");
+   else
+      printf("Test2: Selections with &&, || and ! on scalars--------------------- FAILED\n");
+
+   if (Test3(ranged, plain))
+      printf("Test3: Selections on arrays and NaN values------------------------- OK\n");
+   else
+      printf("Test3: Selections on arrays and NaN values------------------------- FAILED\n");
+
+   if (Test4(ranged, plain))
+      printf("Test4: Selections on a friend tree--------------------------------- OK\n");
+   else
+      printf("Test4: Selections on a friend tree--------------------------------- FAILED\n");
+
+   if (Test5(ranged, plain))
+      printf("Test5: CopyTree with and without ranges---------------------------- OK\n");
+   else
+      printf("Test5: CopyTree with and without ranges---------------------------- FAILED\n");
+
+   if (Test6(ranged, nentries))
+      printf("Test6: Fast-cloned baskets----------------------------------------- OK\n");
+   else
+      printf("Test6: Fast-cloned baskets----------------------------------------- FAILED\n");
+
+   delete f;
+   printf("**********************************************************************\n");
+   printf("*******************Deleting the data files****************************\n");
+   printf("**********************************************************************\n");
+   CleanUp();
+   return 0;
+}
+//_____________________________batch only_____________________
+#ifndef __CINT__
+
+int main(int argc, char *argv[])
+{
+   TApplication theApp("App", &argc, argv);
+   Int_t nentries = 20000;
+   if (argc > 1) nentries = atoi(argv[1]);
+   stressBasketRange(nentries);
+   return 0;
+}
+
+#endif
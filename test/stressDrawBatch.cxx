@@ -0,0 +1,274 @@
+/////////////////////////////////////////////////////////////////
+//
+//___A stress test for the draws done in a single loop by TSelectorDrawBatch___
+//
+//   The same draws are done with one TTree::Draw each and with a single
+//   TSelectorDrawBatch, and the objects they fill are compared:
+//   - Test1() - histograms with selections shared by several draws, with
+//               weights, on arrays and without a target histogram
+//   - Test2() - 2D histograms, profiles and entry lists
+//   - Test3() - the draws of Test1 and Test2 on a chain of two files
+//
+//   To run in batch mode, do
+//     stressDrawBatch
+//     stressDrawBatch 5000
+//   Here the parameter is the number of entries of the trees.
+//   Default value is 5000
+//
+//   An example of output when all tests pass:
+// **********************************************************************
+// ***************Starting draw batch stress test************************
+// **********************************************************************
+// Test1: Histograms with shared selections--------------------------- OK
+// Test2: 2D histograms, profiles and entry lists--------------------- OK
+// Test3: Draws of a chain-------------------------------------------- OK
+// **********************************************************************
+// *******************Deleting the data files****************************
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "TApplication.h"
+#include "TChain.h"
+#include "TEntryList.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TROOT.h"
+#include "TObjArray.h"
+#include "TRandom.h"
+#include "TSelectorDraw.h"
+#include "TSelectorDrawBatch.h"
+#include "TSystem.h"
+#include "TTree.h"
+#include "TTreePlayer.h"
+
+Int_t stressDrawBatch(Int_t nentries = 5000);
+
+const char *kDataFile  = "stressDrawBatch.root";
+const char *kDataFile2 = "stressDrawBatch2.root";
+
+struct DrawSpec {
+   const char *fVarexp;    // Expression drawn
+   const char *fTarget;    // Binning of the histogram, "" for none, 0 for an unnamed draw
+   const char *fSelection;
+   const char *fOption;
+};
+
+// Histograms, with the selections "x>0", "(x>0)*2.5" and
+// "n>2 && v[2]>i/10." shared by several draws
+const DrawSpec kDraws1[] = {
+   { "x",    "(100,-4,4)",    "",                  "" },
+   { "x",    "(100,-4,4)",    "x>0",               "" },
+   { "y",    "(100,-4,4)",    "x>0",               "" },
+   { "v",    "(100,0,1000)",  "x>0",               "" },
+   { "x+y",  "(50,-6,6)",     "(x>0)*2.5",         "" },
+   { "i",    "(100,0,10000)", "(x>0)*2.5",         "" },
+   { "v[1]", "(100,0,1000)",  "n>2 && v[2]>i/10.", "" },
+   { "y",    "(100,-4,4)",    "n>2 && v[2]>i/10.", "" },
+   { "v",    "(100,0,1000)",  "v>i/10.+1",         "" },
+   { "x",    "(100,-4,4)",    "v>i/10.+1",         "" },
+   { "y",    "",              "y<0",               "" },
+   { "x",    0,               "y<0",               "" },
+   { 0, 0, 0, 0 }
+};
+
+// 2D histograms, profiles and entry lists
+const DrawSpec kDraws2[] = {
+   { "y:x",  "(20,-3,3,20,-3,3)", "x>0",               "" },
+   { "y:x",  "(20,-3,3)",         "x>0",               "prof" },
+   { "v:i",  "(20,0,10000)",      "x>0",               "prof" },
+   { "y:x",  "(20,-3,3,20,-3,3)", "(x>0)*2.5",         "" },
+   { "",     "",                  "x>0",               "entrylist" },
+   { "",     "",                  "n>2 && v[2]>i/10.", "entrylist" },
+   { "",     "",                  "y<0",               "entrylist" },
+   { 0, 0, 0, 0 }
+};
+
+void MakeFile(const char *filename, Int_t nentries, Int_t first)
+{
+   // Write the tree "T", with entries numbered from first.
+
+   TFile *f = new TFile(filename, "RECREATE");
+   Int_t i, n;
+   Double_t x, y;
+   Float_t v[4];
+   TTree *tree = new TTree("T", "stressDrawBatch");
+   tree->Branch("i", &i, "i/I");
+   tree->Branch("x", &x, "x/D");
+   tree->Branch("y", &y, "y/D");
+   tree->Branch("n", &n, "n/I");
+   tree->Branch("v", v, "v[n]/F");
+   gRandom->SetSeed(65539 + first);
+   for (Int_t k = 0; k < nentries; k++) {
+      i = first + k;
+      x = gRandom->Gaus();
+      y = gRandom->Gaus() + x / 2;
+      n = i % 5;
+      for (Int_t j = 0; j < n; j++) v[j] = i / 10. + j;
+      tree->Fill();
+   }
+   f->Write();
+   delete f;
+}
+
+TString Varexp(const DrawSpec &spec, const char *name)
+{
+   // Return the varexp of spec filling the object called name.
+
+   TString varexp = spec.fVarexp;
+   if (spec.fTarget) varexp += TString::Format(">>%s%s", name, spec.fTarget);
+   return varexp;
+}
+
+Int_t CompareObjects(TObject *obj1, TObject *obj2)
+{
+   // Return the number of differences between two histograms or two entry
+   // lists, for all the bins, with their under and overflows.
+
+   if (!obj1 || !obj2 || obj1->IsA() != obj2->IsA()) return 1;
+   Int_t wrong = 0;
+   if (obj1->InheritsFrom(TEntryList::Class())) {
+      TEntryList *list1 = (TEntryList*)obj1;
+      TEntryList *list2 = (TEntryList*)obj2;
+      if (list1->GetN() != list2->GetN()) return 1;
+      for (Long64_t k = 0; k < list1->GetN(); k++) {
+         if (list1->GetEntry(k) != list2->GetEntry(k)) wrong++;
+      }
+      return wrong;
+   }
+   TH1 *h1 = (TH1*)obj1;
+   TH1 *h2 = (TH1*)obj2;
+   if (h1->GetNcells() != h2->GetNcells() || h1->GetEntries() != h2->GetEntries()) return 1;
+   if (h1->GetXaxis()->GetXmin() != h2->GetXaxis()->GetXmin() ||
+       h1->GetXaxis()->GetXmax() != h2->GetXaxis()->GetXmax()) return 1;
+   for (Int_t bin = 0; bin < h1->GetNcells(); bin++) {
+      if (h1->GetBinContent(bin) != h2->GetBinContent(bin)) wrong++;
+      if (h1->GetBinError(bin) != h2->GetBinError(bin)) wrong++;
+   }
+   return wrong;
+}
+
+Int_t CompareDraws(TTree *tree, const DrawSpec *draws, const char *prefix)
+{
+   // Do each draw with TTree::Draw, then all of them with a batch, and return
+   // the number of differences between their objects and selected rows.
+
+   TObjArray single;
+   std::vector<Long64_t> rows;
+   for (Int_t d = 0; draws[d].fVarexp; d++) {
+      TString name = TString::Format("%ss%d", prefix, d);
+      const DrawSpec &spec = draws[d];
+      // The unnamed draw of the batch is compared with a histogram without binning
+      TString varexp = Varexp(spec, name);
+      if (!spec.fTarget) varexp.Form("%s>>%s", spec.fVarexp, name.Data());
+      tree->Draw(varexp, spec.fSelection, TString::Format("goff %s", spec.fOption));
+      TSelectorDraw *draw = (TSelectorDraw*)((TTreePlayer*)tree->GetPlayer())->GetSelector();
+      single.Add(draw->GetObject());
+      rows.push_back(tree->GetSelectedRows());
+   }
+
+   TSelectorDrawBatch batch;
+   Int_t wrong = 0;
+   for (Int_t d = 0; draws[d].fVarexp; d++) {
+      TString name = TString::Format("%sb%d", prefix, d);
+      const DrawSpec &spec = draws[d];
+      if (batch.Add(Varexp(spec, name), spec.fSelection, TString::Format("goff %s", spec.fOption)) != d) wrong++;
+   }
+   tree->Process(&batch);
+   if (batch.GetStatus() != tree->GetEntries()) wrong++;
+
+   for (Int_t d = 0; draws[d].fVarexp; d++) {
+      Int_t nwrong = CompareObjects(single.At(d), batch.GetDrawObject(d));
+      if (batch.GetDraw(d)->GetSelectedRows() != rows[d]) nwrong++;
+      if (nwrong) {
+         printf("\n%s, %s: %d differences\n", Varexp(draws[d], "h").Data(), draws[d].fSelection, nwrong);
+      }
+      wrong += nwrong;
+   }
+   return wrong;
+}
+
+Bool_t Test1(TTree *tree)
+{
+   return CompareDraws(tree, kDraws1, "t1") == 0;
+}
+
+Bool_t Test2(TTree *tree)
+{
+   return CompareDraws(tree, kDraws2, "t2") == 0;
+}
+
+Bool_t Test3(Int_t nentries)
+{
+   // Compare the draws on a chain, the shared selections being switched to
+   // the second tree.
+
+   MakeFile(kDataFile2, nentries / 2, nentries);
+   TChain *chain = new TChain("T");
+   chain->Add(kDataFile);
+   chain->Add(kDataFile2);
+   Int_t wrong = CompareDraws(chain, kDraws1, "t3") + CompareDraws(chain, kDraws2, "t4");
+   delete chain;
+   return wrong == 0;
+}
+
+void CleanUp()
+{
+   gSystem->Unlink(kDataFile);
+   gSystem->Unlink(kDataFile2);
+}
+
+Int_t stressDrawBatch(Int_t nentries)
+{
+   MakeFile(kDataFile, nentries, 0);
+   printf("**********************************************************************\n");
+   printf("***************Starting draw batch stress test************************\n");
+   printf("**********************************************************************\n");
+
+   TFile *f = new TFile(kDataFile);
+   TTree *tree = (TTree*)f->Get("T");
+   if (!tree) {
+      printf("Reading the tree of %s FAILED\n", kDataFile);
+      delete f;
+      CleanUp();
+      return 1;
+   }
+   gROOT->cd();
+
+   if (Test1(tree))
+      printf("Test1: Histograms with shared selections--------------------------- OK\n");
+   else
+      printf("Test1: Histograms with shared selections--------------------------- FAILED\n");
+
+   if (Test2(tree))
+      printf("Test2: 2D histograms, profiles and entry lists--------------------- OK\n");
+   else
+      printf("Test2: 2D histograms, profiles and entry lists--------------------- FAILED\n");
+
+   delete f;
+
+   if (Test3(nentries))
+      printf("Test3: Draws of a chain-------------------------------------------- OK\n");
+   else
+      printf("Test3: Draws of a chain-------------------------------------------- FAILED\n");
+
+   printf("**********************************************************************\n");
+   printf("*******************Deleting the data files****************************\n");
+   printf("**********************************************************************\n");
+   CleanUp();
+   return 0;
+}
+//_____________________________batch only_____________________
+#ifndef __CINT__
+
+int main(int argc, char *argv[])
+{
+   TApplication theApp("App", &argc, argv);
+   Int_t nentries = 5000;
+   if (argc > 1) nentries = atoi(argv[1]);
+   stressDrawBatch(nentries);
+   return 0;
+}
+
+#endif
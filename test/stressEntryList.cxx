@@ -12,6 +12,12 @@
 //               and using ">>+elist" in TTree::Draw
 //   - Test3() - transforming TEventList objects into TEntryList objects for a TChain
 //   - Test4() - same as Test3() but for a TTree 
+//   - Test5() - entry lists with all or no entries
+//   - Test6() - union, intersection and difference of entry lists with blocks
+//               stored as bits, lists (fPassing=1 and 0) and runs
+//   - Test7() - Next(), GetEntry() and Contains() over blocks stored as runs
+//   - Test8() - writing and reading an entry list with blocks stored as runs,
+//               written as bits by default and as runs on request
 //
 //   To run in batch mode, do
 //     stressEntryList
@@ -31,13 +37,19 @@
 // Test2: Adding and subtracting entry lists-------------------------- OK
 // Test3: TEntryList and TEventList for TChain------------------------ OK
 // Test4: TEntryList and TEventList for TTree------------------------- OK
+// Test5: Full and Empty TEntryList----------------------------------- OK
+// Test6: Union, intersection and difference of block types----------- OK
+// Test7: Next and GetEntry over blocks stored as runs---------------- OK
+// Test8: Writing and reading blocks stored as runs------------------- OK
 // **********************************************************************
 // *******************Deleting the data files****************************
 // **********************************************************************
 
 #include <stdlib.h>
+#include <vector>
 #include "TApplication.h"
 #include "TEntryList.h"
+#include "TEntryListBlock.h"
 #include "TEventList.h"
 #include "TTree.h"
 #include "TChain.h"
@@ -45,6 +57,8 @@
 #include "TH1F.h"
 #include "TCut.h"
 #include "TFile.h"
+#include "TMath.h"
+#include "TObjArray.h"
 #include "TSystem.h"
 
 Int_t stressEntryList(Int_t nentries = 10000, Int_t nfiles = 10);
@@ -512,6 +526,299 @@ Bool_t Test5()
 }
 
 
+//Entry lists of kNBlocks blocks, with the entries of each block following
+//one of the patterns below, chosen so that OptimizeStorage() stores the block
+//as bits, as a list of passing entries (fPassing=1), as a list of the entries
+//not passing (fPassing=0) and as runs
+enum { kPatternBits, kPatternList, kPatternInverted, kPatternRuns, kNPatterns };
+const Int_t kNBlocks = kNPatterns;
+
+class EntryListBlocks : public TEntryList
+{
+   //Gives access to the blocks of an entry list
+public:
+   EntryListBlocks(const char *name) : TEntryList(name, name) {}
+   EntryListBlocks(const TEntryList &elist) : TEntryList(elist) {}
+   TEntryListBlock *GetBlock(Int_t i) const
+   {
+      if (!fBlocks || i>=fNBlocks) return 0;
+      return (TEntryListBlock*)fBlocks->UncheckedAt(i);
+   }
+};
+
+void FillPattern(std::vector<char> &passing, Int_t iblock, Int_t pattern)
+{
+   //Set the entries of block iblock passing according to the pattern
+
+   Int_t first = iblock*TEntryList::kBlockSize;
+   Int_t last = first + TEntryList::kBlockSize;
+   Int_t i = first;
+   Bool_t inrun = gRandom->Rndm()<0.5;
+   switch (pattern){
+      case kPatternBits:
+         for (i=first; i<last; i++) passing[i] = gRandom->Rndm()<0.5;
+         break;
+      case kPatternList:
+         for (i=first; i<last; i++) passing[i] = gRandom->Rndm()<0.01;
+         break;
+      case kPatternInverted:
+         for (i=first; i<last; i++) passing[i] = gRandom->Rndm()>0.005;
+         break;
+      case kPatternRuns:
+         //runs of 1 to 2000 entries, the last one up to the end of the block
+         while (i<last){
+            Int_t end = TMath::Min(last, i+1+(Int_t)gRandom->Integer(2000));
+            for (; i<end; i++) passing[i] = inrun;
+            inrun = !inrun;
+         }
+         break;
+   }
+}
+
+EntryListBlocks *MakeList(const char *name, std::vector<char> &passing, Int_t shift)
+{
+   //Make an entry list, block i following the pattern (i+shift)%kNPatterns
+
+   passing.assign(kNBlocks*TEntryList::kBlockSize, 0);
+   for (Int_t iblock=0; iblock<kNBlocks; iblock++)
+      FillPattern(passing, iblock, (iblock+shift)%kNPatterns);
+   EntryListBlocks *elist = new EntryListBlocks(name);
+   Int_t n = passing.size();
+   for (Int_t i=0; i<n; i++)
+      if (passing[i]) elist->Enter(i);
+   elist->OptimizeStorage();
+   return elist;
+}
+
+Int_t CheckPatterns(EntryListBlocks *elist, Int_t shift)
+{
+   //Return the number of blocks not stored in the representation of their pattern
+
+   Int_t wrongblocks = 0;
+   for (Int_t iblock=0; iblock<kNBlocks; iblock++){
+      TEntryListBlock *block = elist->GetBlock(iblock);
+      if (!block) {
+         wrongblocks++;
+         continue;
+      }
+      Int_t pattern = (iblock+shift)%kNPatterns;
+      Int_t type = block->GetType();
+      Int_t npassed = block->GetNPassed();
+      if (pattern==kPatternBits && type!=0) wrongblocks++;
+      if (pattern==kPatternList && (type!=1 || npassed>=TEntryListBlock::kBlockSize)) wrongblocks++;
+      if (pattern==kPatternInverted && (type!=1 || npassed<=TEntryListBlock::kBlockSize*15)) wrongblocks++;
+      if (pattern==kPatternRuns && type!=2) wrongblocks++;
+   }
+   return wrongblocks;
+}
+
+Int_t CheckEntries(TEntryList *elist, const std::vector<char> &passing)
+{
+   //Return the number of differences between the entry list and the passing
+   //entries, checking GetN(), Next(), GetEntry() in random order and Contains()
+
+   std::vector<Long64_t> entries;
+   Int_t n = passing.size();
+   for (Int_t i=0; i<n; i++)
+      if (passing[i]) entries.push_back(i);
+   Long64_t nentries = entries.size();
+   if (elist->GetN()!=nentries) {
+      //printf("n=%lld, expected=%lld\n", elist->GetN(), nentries);
+      return 1;
+   }
+
+   Int_t wrongentries = 0;
+   Long64_t entry = elist->GetEntry(0);
+   for (Long64_t i=0; i<nentries; i++){
+      if (entry!=entries[i]) wrongentries++;
+      entry = elist->Next();
+   }
+   if (entry!=-1) wrongentries++;
+
+   for (Int_t i=0; i<1000 && nentries>0; i++){
+      Int_t index = gRandom->Integer(nentries);
+      if (elist->GetEntry(index)!=entries[index]) wrongentries++;
+      //and the following ones in a loop
+      for (Int_t j=index+1; j<index+5 && j<nentries; j++)
+         if (elist->GetEntry(j)!=entries[j]) wrongentries++;
+   }
+   if (elist->GetEntry(nentries)!=-1) wrongentries++;
+
+   for (Int_t i=0; i<n; i++){
+      if ((elist->Contains(i)!=0) != (passing[i]!=0)) wrongentries++;
+   }
+   return wrongentries;
+}
+
+Bool_t Test6()
+{
+   //Test union, intersection and difference of entry lists with blocks stored
+   //as bits, lists (both fPassing values) and runs, for each combination of
+   //representations of the two blocks
+
+   Int_t wrongblocks = 0;
+   Int_t wrongentries1=0, wrongentries2=0, wrongentries3=0, wrongentries4=0;
+   std::vector<char> passing1, passing2;
+   EntryListBlocks *elist1 = MakeList("elist1", passing1, 0);
+   wrongblocks += CheckPatterns(elist1, 0);
+   Int_t n = passing1.size();
+   std::vector<char> expected(n);
+   for (Int_t shift=0; shift<kNPatterns; shift++){
+      EntryListBlocks *elist2 = MakeList("elist2", passing2, shift);
+      wrongblocks += CheckPatterns(elist2, shift);
+
+      EntryListBlocks *elistsum = new EntryListBlocks(*elist1);
+      elistsum->Add(elist2);
+      for (Int_t i=0; i<n; i++) expected[i] = passing1[i] || passing2[i];
+      wrongentries1 += CheckEntries(elistsum, expected);
+
+      EntryListBlocks *elistand = new EntryListBlocks(*elist1);
+      elistand->Intersect(elist2);
+      for (Int_t i=0; i<n; i++) expected[i] = passing1[i] && passing2[i];
+      wrongentries2 += CheckEntries(elistand, expected);
+
+      EntryListBlocks *elistdiff = new EntryListBlocks(*elist1);
+      elistdiff->Subtract(elist2);
+      for (Int_t i=0; i<n; i++) expected[i] = passing1[i] && !passing2[i];
+      wrongentries3 += CheckEntries(elistdiff, expected);
+
+      //the other way around
+      EntryListBlocks *elistdiff2 = new EntryListBlocks(*elist2);
+      elistdiff2->Subtract(elist1);
+      for (Int_t i=0; i<n; i++) expected[i] = passing2[i] && !passing1[i];
+      wrongentries4 += CheckEntries(elistdiff2, expected);
+
+      delete elistsum;
+      delete elistand;
+      delete elistdiff;
+      delete elistdiff2;
+      delete elist2;
+   }
+   //the operands must not have been modified
+   wrongentries1 += CheckEntries(elist1, passing1);
+   delete elist1;
+
+   if (wrongblocks>0)
+      printf("\nblocks not in the expected representation = %d\n", wrongblocks);
+   if (wrongentries1>0 || wrongentries2>0 || wrongentries3>0 || wrongentries4>0)
+      printf("\nwrong entries: union=%d, intersection=%d, differences=%d, %d\n",
+             wrongentries1, wrongentries2, wrongentries3, wrongentries4);
+   if (wrongblocks>0 || wrongentries1>0 || wrongentries2>0 || wrongentries3>0 || wrongentries4>0)
+      return kFALSE;
+   return kTRUE;
+}
+
+Bool_t Test7()
+{
+   //Test Next(), GetEntry() and Contains() on entry lists with all blocks
+   //stored as runs, and Enter() and Remove() changing them back to bits
+
+   Int_t wrongblocks = 0;
+   Int_t wrongentries1 = 0, wrongentries2 = 0;
+   std::vector<char> passing(kNBlocks*TEntryList::kBlockSize, 0);
+   for (Int_t iblock=0; iblock<kNBlocks; iblock++)
+      FillPattern(passing, iblock, kPatternRuns);
+   //a run going across the block boundary, and a block with a single long run
+   //(an almost full block is stored as a list of the entries not passing)
+   for (Int_t i=TEntryList::kBlockSize-10; i<TEntryList::kBlockSize+10; i++)
+      passing[i] = 1;
+   for (Int_t i=2*TEntryList::kBlockSize; i<3*TEntryList::kBlockSize; i++)
+      passing[i] = (i-2*TEntryList::kBlockSize>=100 && i-2*TEntryList::kBlockSize<50000);
+   EntryListBlocks *elist = new EntryListBlocks("elistruns");
+   Int_t n = passing.size();
+   for (Int_t i=0; i<n; i++)
+      if (passing[i]) elist->Enter(i);
+   elist->OptimizeStorage();
+   for (Int_t iblock=0; iblock<kNBlocks; iblock++){
+      TEntryListBlock *block = elist->GetBlock(iblock);
+      if (!block || block->GetType()!=2) wrongblocks++;
+   }
+   wrongentries1 = CheckEntries(elist, passing);
+
+   //entering or removing entries changes the block to bits
+   Int_t entry = 3*TEntryList::kBlockSize + 1234;
+   Bool_t entered = elist->Enter(entry);
+   if (entered != !passing[entry]) wrongentries2++;
+   passing[entry] = 1;
+   entry = 2*TEntryList::kBlockSize + 1017;
+   if (!elist->Remove(entry)) wrongentries2++;
+   passing[entry] = 0;
+   if (elist->GetBlock(2)->GetType()!=0) wrongblocks++;
+   wrongentries2 += CheckEntries(elist, passing);
+   elist->OptimizeStorage();
+   if (elist->GetBlock(2)->GetType()!=2) wrongblocks++;
+   wrongentries2 += CheckEntries(elist, passing);
+   delete elist;
+
+   if (wrongblocks>0)
+      printf("\nblocks not stored as expected = %d\n", wrongblocks);
+   if (wrongentries1>0 || wrongentries2>0)
+      printf("\nwrong entries=%d, after Enter and Remove=%d\n", wrongentries1, wrongentries2);
+   if (wrongblocks>0 || wrongentries1>0 || wrongentries2>0)
+      return kFALSE;
+   return kTRUE;
+}
+
+Int_t WriteReadList(EntryListBlocks *elist, const std::vector<char> &passing, Bool_t runs)
+{
+   //Write and read elist, with the blocks stored as runs written as runs or
+   //not. Return the number of blocks and entries not read as expected
+
+   TEntryList::SetWriteRuns(runs);
+   TFile *f = new TFile("stressEntryListRuns.root", "RECREATE");
+   f->WriteTObject(elist, "elistruns");
+   delete f;
+   TEntryList::SetWriteRuns(kFALSE);
+
+   //the blocks written as bits are stored as runs again in memory
+   Int_t wrong = CheckPatterns(elist, kPatternRuns);
+
+   f = new TFile("stressEntryListRuns.root");
+   TEntryList *elistread = (TEntryList*)f->Get("elistruns");
+   if (!elistread){
+      delete f;
+      return 1;
+   }
+   EntryListBlocks *elistcopy = new EntryListBlocks(*elistread);
+   if (runs) {
+      wrong += CheckPatterns(elistcopy, kPatternRuns);
+   } else {
+      for (Int_t iblock=0; iblock<kNBlocks; iblock++){
+         TEntryListBlock *block = elistcopy->GetBlock(iblock);
+         if (!block || block->GetType()==2) wrong++;
+      }
+   }
+   wrong += CheckEntries(elistread, passing);
+   wrong += CheckEntries(elistcopy, passing);
+   delete elistcopy;
+   delete elistread;
+   delete f;
+   return wrong;
+}
+
+Bool_t Test8()
+{
+   //Test writing and reading an entry list with blocks stored as runs
+   //together with blocks in the other representations: by default the runs
+   //are written as bits, readable by the older versions, and as runs after
+   //TEntryList::SetWriteRuns(kTRUE)
+
+   std::vector<char> passing;
+   EntryListBlocks *elist = MakeList("elistwritten", passing, kPatternRuns);
+   Int_t wrongruns = CheckPatterns(elist, kPatternRuns);
+   Int_t wrongdefault = WriteReadList(elist, passing, kFALSE);
+   wrongruns += WriteReadList(elist, passing, kTRUE);
+   delete elist;
+
+   if (wrongdefault>0)
+      printf("\nwrong blocks and entries with runs not written = %d\n", wrongdefault);
+   if (wrongruns>0)
+      printf("\nwrong blocks and entries with runs written = %d\n", wrongruns);
+   if (wrongdefault>0 || wrongruns>0)
+      return kFALSE;
+   return kTRUE;
+}
+
 void MakeTrees(Int_t nentries, Int_t nfiles)
 {
    //Creates nfiles files with 2 trees of nentries each
@@ -560,6 +867,7 @@ void CleanUp(Int_t nfiles)
       snprintf(buffer,50, "stressEntryListTrees_%d.root", i);
       gSystem->Unlink(buffer);
    }
+   gSystem->Unlink("stressEntryListRuns.root");
 }
 
 Int_t stressEntryList(Int_t nentries, Int_t nfiles)
@@ -578,6 +886,9 @@ Int_t stressEntryList(Int_t nentries, Int_t nfiles)
    Bool_t ok3=kTRUE;
    Bool_t ok4=kTRUE;
    Bool_t ok5=kTRUE;
+   Bool_t ok6=kTRUE;
+   Bool_t ok7=kTRUE;
+   Bool_t ok8=kTRUE;
 
    ok1 = Test1();
    if (ok1)
@@ -613,6 +924,24 @@ Int_t stressEntryList(Int_t nentries, Int_t nfiles)
    else
       printf("Test5: Full and Empty TEntryList----------------------------------- FAILED\n");
 
+   ok6 = Test6();
+   if (ok6)
+      printf("Test6: Union, intersection and difference of block types----------- OK\n");
+   else
+      printf("Test6: Union, intersection and difference of block types----------- FAILED\n");
+
+   ok7 = Test7();
+   if (ok7)
+      printf("Test7: Next and GetEntry over blocks stored as runs---------------- OK\n");
+   else
+      printf("Test7: Next and GetEntry over blocks stored as runs---------------- FAILED\n");
+
+   ok8 = Test8();
+   if (ok8)
+      printf("Test8: Writing and reading blocks stored as runs------------------- OK\n");
+   else
+      printf("Test8: Writing and reading blocks stored as runs------------------- FAILED\n");
+
    printf("**********************************************************************\n");
    printf("*******************Deleting the data files****************************\n");
    printf("**********************************************************************\n");
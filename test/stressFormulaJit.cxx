@@ -0,0 +1,321 @@
+/////////////////////////////////////////////////////////////////
+//
+//___A stress test for the TTreeFormula expressions compiled by the interpreter___
+//
+//   TTreeFormula::SetJitThreshold(n) compiles the formulas evaluated n
+//   times. The results of the compiled formulas are compared with the ones
+//   of the interpreted formulas (threshold 0) on the same tree:
+//   - Test1() - EvalInstance of scalar and array expressions, for each
+//               instance of each entry, and the formulas actually compiled
+//   - Test2() - Draw of expressions and selections, with the && and ||
+//               deciding the selection from their first operand
+//   - Test3() - Scan of arrays with selections
+//   - Test4() - Draw of a chain, the compiled formulas switching trees
+//
+//   To run in batch mode, do
+//     stressFormulaJit
+//     stressFormulaJit 5000
+//   Here the parameter is the number of entries of the trees.
+//   Default value is 5000
+//
+//   An example of output when all tests pass:
+// **********************************************************************
+// ***************Starting compiled formula stress test******************
+// **********************************************************************
+// Test1: EvalInstance of compiled formulas--------------------------- OK
+// Test2: Draw with compiled expressions and selections--------------- OK
+// Test3: Scan with compiled expressions and selections--------------- OK
+// Test4: Draw of a chain with compiled formulas---------------------- OK
+// **********************************************************************
+// *******************Deleting the data files****************************
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "TApplication.h"
+#include "TChain.h"
+#include "TFile.h"
+#include "TMath.h"
+#include "TRandom.h"
+#include "TSystem.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+
+Int_t stressFormulaJit(Int_t nentries = 5000);
+
+const char *kDataFile   = "stressFormulaJit.root";
+const char *kDataFile2  = "stressFormulaJit2.root";
+const char *kScanFile[] = { "stressFormulaJitScan0.txt", "stressFormulaJitScan1.txt" };
+
+// Expressions on the scalars i, x, n and on the arrays v[n] and a[3]
+const char *kExpressions[] = {
+   "x", "2*x+i", "sqrt(abs(x))+sin(x)*cos(i)", "x*x-3*x+1", "i%7", "v", "v*x+a[1]",
+   "a", "a[2]-a[0]", "v[2]", "Entry$", "Iteration$", "Length$", "x>0", "!(x>0)",
+   "n>2 && v[2]>i/10.", "x>0 || v[0]>5", "!(x>0) && v>i/10.", "(x>0)*v-(x<=0)*a[0]",
+   "n>1 && a>i+50", "x<-1 || x>1 || v>i/10.+2", 0
+};
+
+// Expressions which must be compiled
+const char *kCompiled[] = { "2*x+i", "v*x+a[1]", "n>2 && v[2]>i/10.", "x>0 || v[0]>5", 0 };
+
+// Selections, with && and || decided by their first operand
+const char *kSelections[] = {
+   "", "x>0", "n>2 && v[2]>i/10.", "x>1 || v[0]>i/10.", "!(x>0) && v>i/10.+1",
+   "n==0 || a[1]>i+99.5", "x>0 && v>i/10.+1 && a[2]>i", 0
+};
+
+void MakeFile(const char *filename, Int_t nentries, Int_t first)
+{
+   // Write the tree "T", with entries numbered from first.
+
+   TFile *f = new TFile(filename, "RECREATE");
+   Int_t i, n;
+   Double_t x, a[3];
+   Float_t v[4];
+   TTree *tree = new TTree("T", "stressFormulaJit");
+   tree->Branch("i", &i, "i/I");
+   tree->Branch("x", &x, "x/D");
+   tree->Branch("n", &n, "n/I");
+   tree->Branch("v", v, "v[n]/F");
+   tree->Branch("a", a, "a[3]/D");
+   gRandom->SetSeed(65539 + first);
+   for (Int_t k = 0; k < nentries; k++) {
+      i = first + k;
+      x = gRandom->Gaus();
+      n = i % 5;
+      for (Int_t j = 0; j < n; j++) v[j] = i / 10. + j;
+      for (Int_t j = 0; j < 3; j++) a[j] = i + 100 * j;
+      tree->Fill();
+   }
+   f->Write();
+   delete f;
+}
+
+Bool_t EvalFormula(TTree *tree, const char *expression, std::vector<Double_t> &values, Bool_t &compiled)
+{
+   // Store in values, for each entry, the number of instances of expression
+   // and their values. compiled is set if the formula was compiled.
+
+   TTreeFormula *formula = new TTreeFormula("formula", expression, tree);
+   if (!formula->GetNdim()) {
+      delete formula;
+      return kFALSE;
+   }
+   values.clear();
+   for (Long64_t entry = 0; entry < tree->GetEntries(); entry++) {
+      tree->LoadTree(entry);
+      Int_t ndata = formula->GetNdata();
+      values.push_back(ndata);
+      for (Int_t k = 0; k < ndata; k++) values.push_back(formula->EvalInstance(k));
+   }
+   compiled = formula->IsCompiled();
+   delete formula;
+   return kTRUE;
+}
+
+Int_t CompareValues(const std::vector<Double_t> &values1, const std::vector<Double_t> &values2)
+{
+   // Return the number of different values.
+
+   if (values1.size() != values2.size()) return 1;
+   Int_t wrong = 0;
+   for (UInt_t i = 0; i < values1.size(); i++) {
+      if (values1[i] != values2[i] && !(TMath::IsNaN(values1[i]) && TMath::IsNaN(values2[i]))) wrong++;
+   }
+   return wrong;
+}
+
+Bool_t Test1(TTree *tree)
+{
+   // Evaluate each expression interpreted, then compiled after its first
+   // evaluation, and compare the values.
+
+   Int_t wrong = 0;
+   for (Int_t e = 0; kExpressions[e]; e++) {
+      std::vector<Double_t> interpreted, compiled;
+      Bool_t iscompiled;
+      TTreeFormula::SetJitThreshold(0);
+      if (!EvalFormula(tree, kExpressions[e], interpreted, iscompiled) || iscompiled) {
+         wrong++;
+         continue;
+      }
+      TTreeFormula::SetJitThreshold(1);
+      if (!EvalFormula(tree, kExpressions[e], compiled, iscompiled)) {
+         wrong++;
+         continue;
+      }
+      Int_t mustcompile = 0;
+      for (Int_t c = 0; kCompiled[c]; c++) {
+         if (!strcmp(kCompiled[c], kExpressions[e])) mustcompile = 1;
+      }
+      Int_t nwrong = CompareValues(interpreted, compiled);
+      if (mustcompile && !iscompiled) nwrong++;
+      if (nwrong) printf("\n%s: %d differences (compiled %d)\n", kExpressions[e], nwrong, iscompiled);
+      wrong += nwrong;
+   }
+   TTreeFormula::SetJitThreshold(0);
+   return wrong == 0;
+}
+
+Int_t CompareDraw(TTree *tree, const char *varexp, const char *selection)
+{
+   // Return the number of differences between the values drawn with the
+   // interpreted and the compiled formulas.
+
+   TTreeFormula::SetJitThreshold(0);
+   Long64_t n1 = tree->Draw(varexp, selection, "goff");
+   std::vector<Double_t> values;
+   if (n1 > 0) values.assign(tree->GetV1(), tree->GetV1() + n1);
+   TTreeFormula::SetJitThreshold(1);
+   Long64_t n2 = tree->Draw(varexp, selection, "goff");
+   TTreeFormula::SetJitThreshold(0);
+   if (n1 != n2) {
+      printf("\n%s, %s: %lld rows interpreted, %lld compiled\n", varexp, selection, n1, n2);
+      return 1;
+   }
+   Int_t wrong = 0;
+   for (Long64_t i = 0; i < n2; i++) {
+      if (values[i] != tree->GetV1()[i]) wrong++;
+   }
+   if (wrong) printf("\n%s, %s: %d wrong values\n", varexp, selection, wrong);
+   return wrong;
+}
+
+Bool_t Test2(TTree *tree)
+{
+   // Draw each expression with each selection.
+
+   Int_t wrong = 0;
+   for (Int_t e = 0; kExpressions[e]; e++) {
+      for (Int_t s = 0; kSelections[s]; s++) wrong += CompareDraw(tree, kExpressions[e], kSelections[s]);
+   }
+   return wrong == 0;
+}
+
+Bool_t ReadText(const char *filename, std::string &text)
+{
+   FILE *fp = fopen(filename, "r");
+   if (!fp) return kFALSE;
+   char buffer[4096];
+   size_t n;
+   text.clear();
+   while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) text.append(buffer, n);
+   fclose(fp);
+   return kTRUE;
+}
+
+Bool_t Test3(TTree *tree)
+{
+   // Scan arrays and scalars with selections, interpreted and compiled, and
+   // compare the outputs.
+
+   const char *varexps[] = { "i:x:v", "v*x+a[1]:Iteration$:a", "n>2 && v[2]>i/10.:x>0 || v[0]>5", 0 };
+   Int_t wrong = 0;
+   tree->SetScanField(0);
+   for (Int_t e = 0; varexps[e]; e++) {
+      for (Int_t s = 0; kSelections[s]; s++) {
+         std::string text[2];
+         for (Int_t jit = 0; jit < 2; jit++) {
+            TTreeFormula::SetJitThreshold(jit);
+            gSystem->RedirectOutput(kScanFile[jit], "w");
+            tree->Scan(varexps[e], kSelections[s], "precision=15");
+            gSystem->RedirectOutput(0);
+            if (!ReadText(kScanFile[jit], text[jit])) wrong++;
+         }
+         TTreeFormula::SetJitThreshold(0);
+         if (text[0] != text[1] || text[0].empty()) {
+            printf("\n%s, %s: different Scan outputs\n", varexps[e], kSelections[s]);
+            wrong++;
+         }
+      }
+   }
+   return wrong == 0;
+}
+
+Bool_t Test4(Int_t nentries)
+{
+   // Draw the expressions from a chain of two files: the compiled formulas
+   // keep being used when they are switched to the second tree.
+
+   MakeFile(kDataFile2, nentries / 2, nentries);
+   TChain *chain = new TChain("T");
+   chain->Add(kDataFile);
+   chain->Add(kDataFile2);
+   Int_t wrong = 0;
+   for (Int_t e = 0; kExpressions[e]; e++) {
+      wrong += CompareDraw(chain, kExpressions[e], "");
+      wrong += CompareDraw(chain, kExpressions[e], "x>1 || v[0]>i/10.");
+   }
+   delete chain;
+   return wrong == 0;
+}
+
+void CleanUp()
+{
+   gSystem->Unlink(kDataFile);
+   gSystem->Unlink(kDataFile2);
+   gSystem->Unlink(kScanFile[0]);
+   gSystem->Unlink(kScanFile[1]);
+}
+
+Int_t stressFormulaJit(Int_t nentries)
+{
+   MakeFile(kDataFile, nentries, 0);
+   printf("**********************************************************************\n");
+   printf("***************Starting compiled formula stress test******************\n");
+   printf("**********************************************************************\n");
+
+   TFile *f = new TFile(kDataFile);
+   TTree *tree = (TTree*)f->Get("T");
+   if (!tree) {
+      printf("Reading the tree of %s FAILED\n", kDataFile);
+      delete f;
+      CleanUp();
+      return 1;
+   }
+   tree->SetEstimate(5 * nentries + 1);
+
+   if (Test1(tree))
+      printf("Test1: EvalInstance of compiled formulas--------------------------- OK\n");
+   else
+      printf("Test1: EvalInstance of compiled formulas--------------------------- FAILED\n");
+
+   if (Test2(tree))
+      printf("Test2: Draw with compiled expressions and selections--------------- OK\n");
+   else
+      printf("Test2: Draw with compiled expressions and selections--------------- FAILED\n");
+
+   if (Test3(tree))
+      printf("Test3: Scan with compiled expressions and selections--------------- OK\n");
+   else
+      printf("Test3: Scan with compiled expressions and selections--------------- FAILED\n");
+
+   delete f;
+
+   if (Test4(nentries))
+      printf("Test4: Draw of a chain with compiled formulas---------------------- OK\n");
+   else
+      printf("Test4: Draw of a chain with compiled formulas---------------------- FAILED\n");
+
+   printf("**********************************************************************\n");
+   printf("*******************Deleting the data files****************************\n");
+   printf("**********************************************************************\n");
+   CleanUp();
+   return 0;
+}
+//_____________________________batch only_____________________
+#ifndef __CINT__
+
+int main(int argc, char *argv[])
+{
+   TApplication theApp("App", &argc, argv);
+   Int_t nentries = 5000;
+   if (argc > 1) nentries = atoi(argv[1]);
+   stressFormulaJit(nentries);
+   return 0;
+}
+
+#endif
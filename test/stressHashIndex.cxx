@@ -0,0 +1,389 @@
+/////////////////////////////////////////////////////////////////
+//
+//___A stress test for the TTreeHashIndex class___
+//
+//   The functions below test different properties of TTreeHashIndex
+//   - Test1() - lookups compared to a TTreeIndex of the same tree,
+//               for the pairs present in the tree and for missing pairs
+//   - Test2() - values computed by several threads
+//   - Test3() - table written with WriteTable and mapped with OpenTable
+//   - Test4() - OpenTable of truncated or corrupted tables, lookups in a
+//               table without free slot
+//   - Test5() - index saved with the tree and used to join a friend tree
+//
+//   To run in batch mode, do
+//     stressHashIndex
+//     stressHashIndex 100000
+//   Here the parameter is the number of entries in the TTree.
+//   Default value is 100000
+//
+//   An example of output when all tests pass:
+// **********************************************************************
+// ***************Starting TTreeHashIndex stress test********************
+// **********************************************************************
+// Test1: Lookups compared to TTreeIndex------------------------------ OK
+// Test2: Index computed by several threads--------------------------- OK
+// Test3: WriteTable and OpenTable------------------------------------ OK
+// Test4: OpenTable of invalid tables--------------------------------- OK
+// Test5: Index saved with the tree, friend tree---------------------- OK
+// **********************************************************************
+// *******************Deleting the data files****************************
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "TApplication.h"
+#include "TTree.h"
+#include "TLeaf.h"
+#include "TTreeIndex.h"
+#include "TTreeHashIndex.h"
+#include "TRandom.h"
+#include "TFile.h"
+#include "TSystem.h"
+#include "TError.h"
+
+Int_t stressHashIndex(Int_t nentries = 100000);
+
+const char *kTreeFile   = "stressHashIndexTree.root";
+const char *kFriendFile = "stressHashIndexFriend.root";
+const char *kTableFile  = "stressHashIndex.table";
+const char *kBadFile    = "stressHashIndexBad.table";
+
+Int_t gDupRun, gDupEvent;   // Pair of the first and the last entries
+
+void MakeTrees(Int_t nentries)
+{
+   // Create a tree with the pairs (run,event) in random order, each pair
+   // once except the pair of entry 0 which is repeated in the last entry,
+   // and a friend tree with the same pairs in another order.
+
+   Int_t n = nentries - 1;
+   std::vector<Int_t> order(n);
+   for (Int_t i = 0; i < n; i++) order[i] = i;
+   for (Int_t i = n - 1; i > 0; i--) {
+      Int_t j = (Int_t)gRandom->Integer(i + 1);
+      Int_t tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+   }
+
+   Int_t run, event;
+   Double_t x;
+   TFile *f = new TFile(kTreeFile, "RECREATE");
+   TTree *tree = new TTree("tree", "tree");
+   tree->Branch("run", &run, "run/I");
+   tree->Branch("event", &event, "event/I");
+   tree->Branch("x", &x, "x/D");
+   for (Int_t i = 0; i <= n; i++) {
+      Int_t k = order[i < n ? i : 0];
+      run = 1000 + k / 1000;
+      event = k % 1000;
+      x = k;
+      tree->Fill();
+   }
+   gDupRun = run;
+   gDupEvent = event;
+   tree->Write();
+   delete f;
+
+   Double_t y;
+   f = new TFile(kFriendFile, "RECREATE");
+   TTree *friendtree = new TTree("friendtree", "friendtree");
+   friendtree->Branch("run", &run, "run/I");
+   friendtree->Branch("event", &event, "event/I");
+   friendtree->Branch("y", &y, "y/D");
+   for (Int_t k = n - 1; k >= 0; k--) {
+      run = 1000 + k / 1000;
+      event = k % 1000;
+      y = 2 * k;
+      friendtree->Fill();
+   }
+   friendtree->Write();
+   delete f;
+}
+
+Long64_t CompareIndices(const TVirtualIndex *index, const TVirtualIndex *ref, Int_t nentries,
+                        Bool_t skipdup = kFALSE)
+{
+   // Return the number of lookups on which index and ref differ, for the
+   // pairs in the tree and around them. If skipdup, the repeated pair is
+   // not compared: TTreeIndex may give any of its entries.
+
+   Long64_t wrong = 0;
+   Int_t nruns = nentries / 1000 + 2;
+   for (Int_t run = 998; run < 1000 + nruns; run++) {
+      for (Int_t event = -1; event <= 1000; event++) {
+         if (skipdup && run == gDupRun && event == gDupEvent) continue;
+         if (index->GetEntryNumberWithIndex(run, event) != ref->GetEntryNumberWithIndex(run, event)) wrong++;
+      }
+   }
+   return wrong;
+}
+
+Bool_t Test1(Int_t nentries)
+{
+   // Compare the lookups to the ones of a TTreeIndex, and check that a
+   // repeated pair gives its first entry.
+
+   TFile *f = TFile::Open(kTreeFile);
+   TTree *tree = (TTree*)f->Get("tree");
+   TTreeHashIndex *index = new TTreeHashIndex(tree, "run", "event");
+   TTreeIndex *ref = new TTreeIndex(tree, "run", "event");
+
+   Long64_t wrong = 0;
+   if (index->IsZombie() || index->GetN() != nentries) wrong++;
+   wrong += CompareIndices(index, ref, nentries, kTRUE);
+   tree->GetEntry(0);
+   Int_t run = (Int_t)tree->GetLeaf("run")->GetValue();
+   Int_t event = (Int_t)tree->GetLeaf("event")->GetValue();
+   if (index->GetEntryNumberWithIndex(run, event) != 0) wrong++;
+
+   // Through the tree.
+   tree->SetTreeIndex(index);
+   if (tree->GetEntryNumberWithIndex(run, event) != 0) wrong++;
+   if (tree->GetEntryNumberWithIndex(run, 1000) != -1) wrong++;
+   tree->SetTreeIndex(0);
+
+   delete index;
+   delete ref;
+   delete f;
+   return wrong == 0;
+}
+
+Bool_t Test2(Int_t nentries)
+{
+   // Compute the values with several threads, each reading a slice of the
+   // entries, and compare to one thread.
+
+   TFile *f = TFile::Open(kTreeFile);
+   TTree *tree = (TTree*)f->Get("tree");
+   TTreeHashIndex *index1 = new TTreeHashIndex(tree, "run", "event", 1);
+   TTreeHashIndex *index4 = new TTreeHashIndex(tree, "run", "event", 4);
+   TTreeHashIndex *indexall = new TTreeHashIndex(tree, "run", "event", 0);
+
+   Long64_t wrong = 0;
+   if (index4->IsZombie() || indexall->IsZombie()) wrong++;
+   wrong += CompareIndices(index4, index1, nentries);
+   wrong += CompareIndices(indexall, index1, nentries);
+
+   delete index1;
+   delete index4;
+   delete indexall;
+   delete f;
+   return wrong == 0;
+}
+
+Bool_t Test3(Int_t nentries)
+{
+   // Write the table and map it back.
+
+   TFile *f = TFile::Open(kTreeFile);
+   TTree *tree = (TTree*)f->Get("tree");
+   TTreeHashIndex *index = new TTreeHashIndex(tree, "run", "event");
+
+   Long64_t wrong = 0;
+   if (!index->WriteTable(kTableFile)) wrong++;
+   TTreeHashIndex *mapped = TTreeHashIndex::OpenTable(tree, kTableFile);
+   if (!mapped) {
+      wrong++;
+   } else {
+      if (mapped->GetN() != index->GetN()) wrong++;
+      if (strcmp(mapped->GetMajorName(), "run") || strcmp(mapped->GetMinorName(), "event")) wrong++;
+      wrong += CompareIndices(mapped, index, nentries);
+
+      // Appending works on a copy of the mapped table.
+      TTreeHashIndex *twice = TTreeHashIndex::OpenTable(tree, kTableFile);
+      twice->Append(index);
+      if (twice->GetN() != 2 * index->GetN()) wrong++;
+      wrong += CompareIndices(twice, index, nentries);
+      delete twice;
+      wrong += CompareIndices(mapped, index, nentries);
+      delete mapped;
+   }
+
+   delete index;
+   delete f;
+   return wrong == 0;
+}
+
+Bool_t WriteBadTable(const std::vector<char> &table, Long64_t size, Int_t offset, Long64_t value)
+{
+   // Write the first size bytes of table to kBadFile, with the 8 bytes at
+   // offset replaced by value if offset is not negative.
+
+   std::vector<char> bad(table.begin(), table.begin() + size);
+   if (offset >= 0) memcpy(&bad[offset], &value, sizeof(value));
+   FILE *fp = fopen(kBadFile, "wb");
+   if (!fp) return kFALSE;
+   Bool_t ok = fwrite(&bad[0], 1, bad.size(), fp) == bad.size();
+   return fclose(fp) == 0 && ok;
+}
+
+Bool_t Test4()
+{
+   // OpenTable must return 0, not crash, for truncated tables, tables with
+   // invalid headers and files which are not tables. The table written by
+   // Test3 starts with 8 bytes of magic number, 4 ints, the number of
+   // entries (offset 24) and the number of slots (offset 32).
+
+   std::vector<char> table;
+   FILE *fp = fopen(kTableFile, "rb");
+   if (!fp) return kFALSE;
+   char buffer[4096];
+   size_t n;
+   while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) table.insert(table.end(), buffer, buffer + n);
+   fclose(fp);
+   if (table.size() < 64) return kFALSE;
+
+   Int_t level = gErrorIgnoreLevel;
+   gErrorIgnoreLevel = kFatal;
+   Long64_t wrong = 0;
+   Long64_t size = table.size();
+   Long64_t nslots;
+   memcpy(&nslots, &table[32], sizeof(nslots));
+
+   // Truncated in the middle of the slots, of the names, of the header.
+   Long64_t sizes[3] = { size / 2, 44, 16 };
+   for (Int_t i = 0; i < 3; i++) {
+      if (!WriteBadTable(table, sizes[i], -1, 0)) wrong++;
+      TTreeHashIndex *index = TTreeHashIndex::OpenTable(0, kBadFile);
+      if (index) { wrong++; delete index; }
+   }
+   // Number of slots not a power of two, larger than the file, negative;
+   // too many entries for the slots; negative number of entries.
+   Int_t offsets[5] = { 32, 32, 32, 24, 24 };
+   Long64_t values[5] = { nslots - 1, 2 * nslots, -nslots, nslots, -1 };
+   for (Int_t i = 0; i < 5; i++) {
+      if (!WriteBadTable(table, size, offsets[i], values[i])) wrong++;
+      TTreeHashIndex *index = TTreeHashIndex::OpenTable(0, kBadFile);
+      if (index) { wrong++; delete index; }
+   }
+   // No free slot: the lookups of missing pairs must stop. The slots start
+   // after the header of 40 bytes and the names padded to 8 bytes, with the
+   // keys followed by the entries.
+   Int_t majorlen, minorlen;
+   memcpy(&majorlen, &table[12], sizeof(majorlen));
+   memcpy(&minorlen, &table[16], sizeof(minorlen));
+   Long64_t keys = 40 + (majorlen + minorlen + 7) / 8 * 8;
+   if (keys + 2 * nslots * (Long64_t)sizeof(Long64_t) > size) {
+      wrong++;
+   } else {
+      std::vector<char> full(table);
+      for (Long64_t s = 0; s < nslots; s++) {
+         Long64_t key = -1 - s, entry = s;
+         memcpy(&full[keys + s * sizeof(Long64_t)], &key, sizeof(key));
+         memcpy(&full[keys + (nslots + s) * sizeof(Long64_t)], &entry, sizeof(entry));
+      }
+      if (!WriteBadTable(full, size, -1, 0)) wrong++;
+      TTreeHashIndex *index = TTreeHashIndex::OpenTable(0, kBadFile);
+      if (!index) {
+         wrong++;
+      } else {
+         if (index->GetEntryNumberWithIndex(1, 1) != -1) wrong++;
+         if (index->GetEntryNumberWithBestIndex(1, 1) != 0) wrong++;
+         delete index;
+      }
+   }
+   // Not a table.
+   if (TTreeHashIndex::OpenTable(0, kTreeFile)) wrong++;
+   if (TTreeHashIndex::OpenTable(0, "stressHashIndexMissing.table")) wrong++;
+   // The table itself is fine.
+   TTreeHashIndex *index = TTreeHashIndex::OpenTable(0, kTableFile);
+   if (!index) wrong++;
+   delete index;
+
+   gErrorIgnoreLevel = level;
+   gSystem->Unlink(kBadFile);
+   return wrong == 0;
+}
+
+Bool_t Test5(Int_t nentries)
+{
+   // Save the index of the friend tree with it, read it back and use it to
+   // join the friend tree on (run,event).
+
+   TFile *ff = new TFile(kFriendFile, "UPDATE");
+   TTree *friendtree = (TTree*)ff->Get("friendtree");
+   friendtree->SetTreeIndex(new TTreeHashIndex(friendtree, "run", "event"));
+   friendtree->Write("", TObject::kOverwrite);
+   delete ff;
+
+   Long64_t wrong = 0;
+   TFile *f = TFile::Open(kTreeFile);
+   TTree *tree = (TTree*)f->Get("tree");
+   ff = TFile::Open(kFriendFile);
+   friendtree = (TTree*)ff->Get("friendtree");
+   if (!dynamic_cast<TTreeHashIndex*>(friendtree->GetTreeIndex())) {
+      wrong++;
+   } else {
+      tree->AddFriend(friendtree);
+      // y is 2*x for every entry of the tree, the repeated one included.
+      Long64_t nsel = tree->Draw("x", "friendtree.y == 2*x", "goff");
+      if (nsel != nentries) wrong++;
+      nsel = tree->Draw("x", "friendtree.run != run || friendtree.event != event", "goff");
+      if (nsel != 0) wrong++;
+   }
+   delete f;
+   delete ff;
+   return wrong == 0;
+}
+
+void CleanUp()
+{
+   gSystem->Unlink(kTreeFile);
+   gSystem->Unlink(kFriendFile);
+   gSystem->Unlink(kTableFile);
+}
+
+Int_t stressHashIndex(Int_t nentries)
+{
+   if (nentries < 2) nentries = 2;
+   MakeTrees(nentries);
+   printf("**********************************************************************\n");
+   printf("***************Starting TTreeHashIndex stress test********************\n");
+   printf("**********************************************************************\n");
+
+   if (Test1(nentries))
+      printf("Test1: Lookups compared to TTreeIndex------------------------------ OK\n");
+   else
+      printf("Test1: Lookups compared to TTreeIndex------------------------------ FAILED\n");
+
+   if (Test2(nentries))
+      printf("Test2: Index computed by several threads--------------------------- OK\n");
+   else
+      printf("Test2: Index computed by several threads--------------------------- FAILED\n");
+
+   if (Test3(nentries))
+      printf("Test3: WriteTable and OpenTable------------------------------------ OK\n");
+   else
+      printf("Test3: WriteTable and OpenTable------------------------------------ FAILED\n");
+
+   if (Test4())
+      printf("Test4: OpenTable of invalid tables--------------------------------- OK\n");
+   else
+      printf("Test4: OpenTable of invalid tables--------------------------------- FAILED\n");
+
+   if (Test5(nentries))
+      printf("Test5: Index saved with the tree, friend tree---------------------- OK\n");
+   else
+      printf("Test5: Index saved with the tree, friend tree---------------------- FAILED\n");
+
+   printf("**********************************************************************\n");
+   printf("*******************Deleting the data files****************************\n");
+   printf("**********************************************************************\n");
+   CleanUp();
+   return 0;
+}
+//_____________________________batch only_____________________
+#ifndef __CINT__
+
+int main(int argc, char *argv[])
+{
+   TApplication theApp("App", &argc, argv);
+   Int_t nentries = 100000;
+   if (argc > 1) nentries = atoi(argv[1]);
+   stressHashIndex(nentries);
+   return 0;
+}
+
+#endif
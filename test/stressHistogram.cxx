@@ -14,6 +14,7 @@
 // 5. I/O functionality (including reference with older versions).               //
 // 6. Labeling.                                                                  //
 // 7. Interpolation                                                              //
+// 8. Filling with FillN and with Fill                                           //
 //                                                                               //
 // To see the tests individually, at the bottom of the file the tests            //
 // are exectued using the structure TTestSuite, that defines the                 //
@@ -47,7 +48,8 @@
 // Test 14: Integral tests for Histograms....................................OK  //
 // Test 15: TH1-THn[Sparse] Conversion tests.................................OK  //
 // Test 16: Filldata tests for Histograms and THn[Sparse]....................OK  //
-// Test 17: Reference File Read for Histograms and Profiles..................OK  //
+// Test 17: FillN tests for 1D and 2D Histograms.............................OK  //
+// Test 18: Reference File Read for Histograms and Profiles..................OK  //
 // ****************************************************************************  //
 // stressHistogram: Real Time =  64.01 seconds Cpu Time =  63.89 seconds         //
 //  ROOTMARKS = 430.74 ROOT version: 5.25/01 branches/dev/mathDev@29787       //
@@ -7126,6 +7128,240 @@ bool testBinDataData3DInt()
    return status;
 }
 
+void FillNValues(Int_t n, Double_t* x, Int_t stride)
+{
+   // Sets x[e*stride] to values in the range, in the underflow and in the
+   // overflow, one in 50 of them being on a bin edge
+
+   for ( Int_t e = 0; e < n; ++e ) {
+      if ( e % 50 == 0 )
+         x[e*stride] = minRange + (maxRange - minRange) * ((e / 50) % (numberOfBins + 1)) / numberOfBins;
+      else
+         x[e*stride] = r.Uniform(0.5 * minRange, 1.2 * maxRange);
+   }
+}
+
+void FillNWeights(Int_t n, Double_t* w, Int_t stride)
+{
+   // Sets the weights w[e*stride]: 1 for the first half of them, then random,
+   // so that Sumw2 is called in the middle of the fills done one by one
+
+   for ( Int_t e = 0; e < n; ++e )
+      w[e*stride] = ( e < n / 2 ) ? 1.0 : r.Uniform(0.1, 2.0);
+}
+
+bool testFillN1D()
+{
+   // Tests FillN against Fill for 1D Histograms
+
+   Double_t x[nEvents];
+   FillNValues(nEvents, x, 1);
+
+   TH1D* h1 = new TH1D("fn1D-h1", "h1-Title", numberOfBins, minRange, maxRange);
+   TH1D* h2 = new TH1D("fn1D-h2", "h2-Title", numberOfBins, minRange, maxRange);
+
+   for ( Int_t e = 0; e < nEvents; ++e )
+      h1->Fill(x[e]);
+   h2->FillN(nEvents, x, 0);
+
+   bool ret = equals("FillN1D", h1, h2, cmpOptStats);
+   delete h1;
+   delete h2;
+   return ret;
+}
+
+bool testFillN1DWeights()
+{
+   // Tests FillN against Fill for 1D Histograms with weights, a stride and
+   // the under/overflows in the statistics
+
+   const Int_t stride = 2;
+   Double_t x[nEvents*stride];
+   Double_t w[nEvents*stride];
+   FillNValues(nEvents, x, stride);
+   FillNWeights(nEvents, w, stride);
+
+   TH1::StatOverflows(kTRUE);
+   TH1D* h1 = new TH1D("fn1Dw-h1", "h1-Title", numberOfBins, minRange, maxRange);
+   TH1D* h2 = new TH1D("fn1Dw-h2", "h2-Title", numberOfBins, minRange, maxRange);
+
+   for ( Int_t e = 0; e < nEvents; ++e )
+      h1->Fill(x[e*stride], w[e*stride]);
+   h2->FillN(nEvents, x, w, stride);
+   TH1::StatOverflows(kFALSE);
+
+   bool ret = equals("FillN1DWeights", h1, h2, cmpOptStats);
+   delete h1;
+   delete h2;
+   return ret;
+}
+
+bool testFillNVar1D()
+{
+   // Tests FillN against Fill for 1D Histograms with variable bin size
+
+   Double_t v[numberOfBins+1];
+   FillVariableRange(v);
+
+   Double_t x[nEvents];
+   Double_t w[nEvents];
+   FillNValues(nEvents, x, 1);
+   FillNWeights(nEvents, w, 1);
+
+   TH1D* h1 = new TH1D("fnv1D-h1", "h1-Title", numberOfBins, v);
+   TH1D* h2 = new TH1D("fnv1D-h2", "h2-Title", numberOfBins, v);
+
+   for ( Int_t e = 0; e < nEvents; ++e )
+      h1->Fill(x[e], w[e]);
+   h2->FillN(nEvents, x, w);
+
+   bool ret = equals("FillNVar1D", h1, h2, cmpOptStats);
+   delete h1;
+   delete h2;
+   return ret;
+}
+
+bool testFillN1DExtend()
+{
+   // Tests FillN against Fill for 1D Histograms extending their axis
+
+   Double_t x[nEvents];
+   Double_t w[nEvents];
+   FillNValues(nEvents, x, 1);
+   FillNWeights(nEvents, w, 1);
+
+   TH1D* h1 = new TH1D("fn1De-h1", "h1-Title", numberOfBins, minRange, maxRange);
+   TH1D* h2 = new TH1D("fn1De-h2", "h2-Title", numberOfBins, minRange, maxRange);
+   h1->SetCanExtend(TH1::kAllAxes);
+   h2->SetCanExtend(TH1::kAllAxes);
+
+   for ( Int_t e = 0; e < nEvents; ++e )
+      h1->Fill(x[e], w[e]);
+   h2->FillN(nEvents, x, w);
+
+   bool ret = equals("FillN1DExtend", h1, h2, cmpOptStats);
+   delete h1;
+   delete h2;
+   return ret;
+}
+
+bool testFillN2D()
+{
+   // Tests FillN against Fill for 2D Histograms
+
+   Double_t x[nEvents];
+   Double_t y[nEvents];
+   FillNValues(nEvents, x, 1);
+   FillNValues(nEvents, y, 1);
+
+   TH2D* h1 = new TH2D("fn2D-h1", "h1-Title",
+                       numberOfBins, minRange, maxRange,
+                       numberOfBins + 2, minRange, maxRange);
+   TH2D* h2 = new TH2D("fn2D-h2", "h2-Title",
+                       numberOfBins, minRange, maxRange,
+                       numberOfBins + 2, minRange, maxRange);
+
+   for ( Int_t e = 0; e < nEvents; ++e )
+      h1->Fill(x[e], y[e]);
+   h2->FillN(nEvents, x, y, (Double_t*)0);
+
+   bool ret = equals("FillN2D", h1, h2, cmpOptStats);
+   delete h1;
+   delete h2;
+   return ret;
+}
+
+bool testFillN2DWeights()
+{
+   // Tests FillN against Fill for 2D Histograms with weights, a stride and
+   // the under/overflows in the statistics
+
+   const Int_t stride = 3;
+   Double_t x[nEvents*stride];
+   Double_t y[nEvents*stride];
+   Double_t w[nEvents*stride];
+   FillNValues(nEvents, x, stride);
+   FillNValues(nEvents, y, stride);
+   FillNWeights(nEvents, w, stride);
+
+   TH1::StatOverflows(kTRUE);
+   TH2D* h1 = new TH2D("fn2Dw-h1", "h1-Title",
+                       numberOfBins, minRange, maxRange,
+                       numberOfBins + 2, minRange, maxRange);
+   TH2D* h2 = new TH2D("fn2Dw-h2", "h2-Title",
+                       numberOfBins, minRange, maxRange,
+                       numberOfBins + 2, minRange, maxRange);
+
+   for ( Int_t e = 0; e < nEvents; ++e )
+      h1->Fill(x[e*stride], y[e*stride], w[e*stride]);
+   h2->FillN(nEvents, x, y, w, stride);
+   TH1::StatOverflows(kFALSE);
+
+   bool ret = equals("FillN2DWeights", h1, h2, cmpOptStats);
+   delete h1;
+   delete h2;
+   return ret;
+}
+
+bool testFillNVar2D()
+{
+   // Tests FillN against Fill for 2D Histograms with variable bin size
+
+   Double_t vx[numberOfBins+1];
+   Double_t vy[numberOfBins+1];
+   FillVariableRange(vx);
+   FillVariableRange(vy);
+
+   Double_t x[nEvents];
+   Double_t y[nEvents];
+   Double_t w[nEvents];
+   FillNValues(nEvents, x, 1);
+   FillNValues(nEvents, y, 1);
+   FillNWeights(nEvents, w, 1);
+
+   TH2D* h1 = new TH2D("fnv2D-h1", "h1-Title", numberOfBins, vx, numberOfBins, vy);
+   TH2D* h2 = new TH2D("fnv2D-h2", "h2-Title", numberOfBins, vx, numberOfBins, vy);
+
+   for ( Int_t e = 0; e < nEvents; ++e )
+      h1->Fill(x[e], y[e], w[e]);
+   h2->FillN(nEvents, x, y, w);
+
+   bool ret = equals("FillNVar2D", h1, h2, cmpOptStats);
+   delete h1;
+   delete h2;
+   return ret;
+}
+
+bool testFillN2DExtend()
+{
+   // Tests FillN against Fill for 2D Histograms extending their axes
+
+   Double_t x[nEvents];
+   Double_t y[nEvents];
+   Double_t w[nEvents];
+   FillNValues(nEvents, x, 1);
+   FillNValues(nEvents, y, 1);
+   FillNWeights(nEvents, w, 1);
+
+   TH2D* h1 = new TH2D("fn2De-h1", "h1-Title",
+                       numberOfBins, minRange, maxRange,
+                       numberOfBins + 2, minRange, maxRange);
+   TH2D* h2 = new TH2D("fn2De-h2", "h2-Title",
+                       numberOfBins, minRange, maxRange,
+                       numberOfBins + 2, minRange, maxRange);
+   h1->SetCanExtend(TH1::kAllAxes);
+   h2->SetCanExtend(TH1::kAllAxes);
+
+   for ( Int_t e = 0; e < nEvents; ++e )
+      h1->Fill(x[e], y[e], w[e]);
+   h2->FillN(nEvents, x, y, w);
+
+   bool ret = equals("FillN2DExtend", h1, h2, cmpOptStats);
+   delete h1;
+   delete h2;
+   return ret;
+}
+
 bool testRefRead1D()
 {
    // Tests consistency with a reference file for 1D Histogram
@@ -9431,9 +9667,21 @@ int stressHistogram()
                                            "FillData tests for Histograms and Sparses........................",
                                            fillDataTestPointer };
 
+   // Test 17
+   // FillN Tests
+   const unsigned int numberOfFillN = 8;
+   pointer2Test fillNTestPointer[numberOfFillN] = { testFillN1D,       testFillN1DWeights,
+                                                    testFillNVar1D,    testFillN1DExtend,
+                                                    testFillN2D,       testFillN2DWeights,
+                                                    testFillNVar2D,    testFillN2DExtend
+   };
+   struct TTestSuite fillNTestSuite = { numberOfFillN, 
+                                        "FillN tests for 1D and 2D Histograms.............................",
+                                        fillNTestPointer };
+
 
    // Combination of tests
-   const unsigned int numberOfSuits = 14;
+   const unsigned int numberOfSuits = 15;
    struct TTestSuite* testSuite[numberOfSuits];
    testSuite[ 0] = &rangeTestSuite;
    testSuite[ 1] = &rebinTestSuite;
@@ -9449,6 +9697,7 @@ int stressHistogram()
    testSuite[11] = &integralTestSuite;
    testSuite[12] = &conversionsTestSuite;
    testSuite[13] = &fillDataTestSuite;
+   testSuite[14] = &fillNTestSuite;
 
    status = 0;
    for ( unsigned int i = 0; i < numberOfSuits; ++i ) {
@@ -9463,7 +9712,7 @@ int stressHistogram()
    }
    GlobalStatus += status;
 
-   // Test 17
+   // Test 18
    // Reference Tests
    const unsigned int numberOfRefRead = 7;
    pointer2Test refReadTestPointer[numberOfRefRead] = { testRefRead1D,  testRefReadProf1D,
@@ -0,0 +1,309 @@
+/////////////////////////////////////////////////////////////////
+//
+//___A stress test for the key index of the directories___
+//
+//   The keys record of a directory with at least
+//   TDirectoryFile::GetKeyIndexThreshold() keys ends with a key index,
+//   used to read the keys one name at a time from files opened for reading.
+//   The functions below test it:
+//   - Test1() - the index is written for large directories only
+//   - Test2() - Get, GetKey and FindKey through the index, several cycles
+//   - Test3() - GetListOfKeys and GetNkeys after some keys were looked up
+//   - Test4() - ReOpen("UPDATE") of an indexed file, adding and deleting keys
+//   - Test5() - same lookups without index (threshold above the number of keys)
+//
+//   To run in batch mode, do
+//     stressKeyIndex
+//     stressKeyIndex 20000
+//   Here the parameter is the number of keys in the top directory.
+//   Default value is 20000
+//
+//   An example of output when all tests pass:
+// **********************************************************************
+// ***************Starting key index stress test*************************
+// **********************************************************************
+// Test1: Key index written for large directories only---------------- OK
+// Test2: Get, GetKey and FindKey through the key index--------------- OK
+// Test3: GetListOfKeys after lookups--------------------------------- OK
+// Test4: ReOpen in UPDATE mode, adding and deleting keys------------- OK
+// Test5: Same lookups without key index------------------------------ OK
+// **********************************************************************
+// *******************Deleting the data files****************************
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "TApplication.h"
+#include "TFile.h"
+#include "TDirectoryFile.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TNamed.h"
+#include "TString.h"
+#include "TSystem.h"
+
+Int_t stressKeyIndex(Int_t nkeys = 20000);
+
+const char *kIndexedFile   = "stressKeyIndex.root";
+const char *kUnindexedFile = "stressKeyIndexNoIndex.root";
+const Int_t kCycles        = 3;    // Number of cycles of the key "cycles"
+const Int_t kSmallKeys     = 10;   // Number of keys of the directory "small"
+
+void MakeFile(const char *filename, Int_t nkeys)
+{
+   // Create a file with nkeys objects "obj_<i>" in the top directory, plus
+   // kCycles cycles of "cycles", and a subdirectory "small" with a few keys.
+
+   TFile *f = new TFile(filename, "RECREATE");
+   for (Int_t i = 0; i < nkeys; i++) {
+      TNamed obj(TString::Format("obj_%d", i), TString::Format("title_%d", i));
+      obj.Write();
+   }
+   for (Int_t c = 1; c <= kCycles; c++) {
+      TNamed obj("cycles", TString::Format("cycle_%d", c).Data());
+      obj.Write();
+   }
+   TDirectory *small = f->mkdir("small");
+   small->cd();
+   for (Int_t i = 0; i < kSmallKeys; i++) {
+      TNamed obj(TString::Format("small_%d", i).Data(), "small");
+      obj.Write();
+   }
+   delete f;
+}
+
+Bool_t CheckObject(TDirectory *dir, Int_t i)
+{
+   // Return true if dir holds obj_<i> with the right title.
+
+   TNamed *obj = (TNamed*)dir->Get(TString::Format("obj_%d", i));
+   Bool_t ok = obj && TString(obj->GetTitle()) == TString::Format("title_%d", i);
+   delete obj;
+   return ok;
+}
+
+Long64_t CheckLookups(TDirectoryFile *dir, Int_t nkeys)
+{
+   // Return the number of wrong lookups of a few objects, keys and cycles.
+
+   Long64_t wrong = 0;
+   Int_t step = nkeys / 37 + 1;
+   for (Int_t i = 0; i < nkeys; i += step) {
+      if (!CheckObject(dir, i)) wrong++;
+   }
+   if (!CheckObject(dir, nkeys - 1)) wrong++;
+   TKey *key = dir->GetKey("obj_0");
+   if (!key || strcmp(key->GetTitle(), "title_0")) wrong++;
+   if (dir->FindKey("obj_1") == 0) wrong++;
+   if (dir->Get("obj_missing") != 0) wrong++;
+   if (dir->GetKey("obj_missing") != 0) wrong++;
+   if (dir->GetKey(TString::Format("obj_%d", nkeys)) != 0) wrong++;
+
+   // Cycles: the highest by default, a given one with ";<cycle>".
+   key = dir->GetKey("cycles");
+   if (!key || key->GetCycle() != kCycles) wrong++;
+   for (Int_t c = 1; c <= kCycles; c++) {
+      key = dir->GetKey("cycles", c);
+      if (!key || key->GetCycle() != c) wrong++;
+      TNamed *obj = (TNamed*)dir->Get(TString::Format("cycles;%d", c));
+      if (!obj || TString(obj->GetTitle()) != TString::Format("cycle_%d", c)) wrong++;
+      delete obj;
+   }
+
+   // The subdirectory, without index.
+   TDirectoryFile *small = (TDirectoryFile*)dir->Get("small");
+   if (!small || small->IsKeyIndexed() || small->GetNkeys() != kSmallKeys) wrong++;
+   else if (!small->Get("small_3")) wrong++;
+   return wrong;
+}
+
+Long64_t CheckListOfKeys(TDirectoryFile *dir, Int_t nkeys)
+{
+   // Return the number of differences between the list of keys and the
+   // expected keys: each obj_<i> once, kCycles cycles and "small".
+
+   Long64_t wrong = 0;
+   TList *keys = dir->GetListOfKeys();
+   Int_t nexpected = nkeys + kCycles + 1;
+   if (!keys || keys->GetSize() != nexpected) return 1;
+   if (dir->GetNkeys() != nexpected) wrong++;
+   std::vector<Int_t> seen(nkeys, 0);
+   Int_t ncycles = 0;
+   TIter next(keys);
+   TKey *key;
+   while ((key = (TKey*)next())) {
+      TString name = key->GetName();
+      if (name.BeginsWith("obj_")) {
+         Int_t i = TString(name(4, name.Length())).Atoi();
+         if (i < 0 || i >= nkeys || seen[i]++) wrong++;
+      } else if (name == "cycles") {
+         ncycles++;
+      } else if (name != "small") {
+         wrong++;
+      }
+   }
+   if (ncycles != kCycles) wrong++;
+   return wrong;
+}
+
+Bool_t Test1(Int_t nkeys)
+{
+   // The top directory, with more keys than the threshold, has an index;
+   // the subdirectory does not.
+
+   TFile *f = TFile::Open(kIndexedFile);
+   Long64_t wrong = 0;
+   if (!f || !f->IsKeyIndexed()) wrong++;
+   if (f && f->GetNkeys() != nkeys + kCycles + 1) wrong++;
+   TDirectoryFile *small = f ? (TDirectoryFile*)f->Get("small") : 0;
+   if (!small || small->IsKeyIndexed()) wrong++;
+   delete f;
+   return wrong == 0;
+}
+
+Bool_t Test2(Int_t nkeys)
+{
+   // Lookups through the index; the file must still be indexed afterwards,
+   // i.e. the keys were not all read.
+
+   TFile *f = TFile::Open(kIndexedFile);
+   if (!f) return kFALSE;
+   Long64_t wrong = CheckLookups(f, nkeys);
+   if (!f->IsKeyIndexed()) wrong++;
+   delete f;
+   return wrong == 0;
+}
+
+Bool_t Test3(Int_t nkeys)
+{
+   // Read all the keys after some were looked up through the index: the
+   // keys already read must be kept, each key must be there once.
+
+   TFile *f = TFile::Open(kIndexedFile);
+   if (!f) return kFALSE;
+   Long64_t wrong = 0;
+   TKey *before = f->GetKey(TString::Format("obj_%d", nkeys / 2));
+   TKey *cycle2 = f->GetKey("cycles", 2);
+   if (!before || !cycle2) wrong++;
+   wrong += CheckListOfKeys(f, nkeys);
+   if (f->IsKeyIndexed()) wrong++;
+   if (before && f->GetListOfKeys()->FindObject(before->GetName()) != before) wrong++;
+   if (cycle2 && !f->GetListOfKeys()->FindObject(cycle2)) wrong++;
+   wrong += CheckLookups(f, nkeys);
+   delete f;
+   return wrong == 0;
+}
+
+Bool_t Test4(Int_t nkeys)
+{
+   // Reopen an indexed file in UPDATE mode, add and delete keys, and check
+   // the rewritten index.
+
+   TFile *f = TFile::Open(kIndexedFile);
+   if (!f) return kFALSE;
+   Long64_t wrong = 0;
+   if (!CheckObject(f, 7)) wrong++;
+   if (f->ReOpen("UPDATE") != 0) wrong++;
+   if (f->IsKeyIndexed()) wrong++;
+   f->cd();
+   TNamed added(TString::Format("obj_%d", nkeys), TString::Format("title_%d", nkeys));
+   added.Write();
+   f->Delete("obj_0;*");
+   delete f;
+
+   f = TFile::Open(kIndexedFile);
+   if (!f) return kFALSE;
+   if (!f->IsKeyIndexed()) wrong++;
+   if (f->GetNkeys() != nkeys + kCycles + 1) wrong++;
+   if (!CheckObject(f, nkeys)) wrong++;
+   if (!CheckObject(f, 7)) wrong++;
+   if (f->Get("obj_0")) wrong++;
+   if (f->GetListOfKeys()->GetSize() != nkeys + kCycles + 1) wrong++;
+   delete f;
+   return wrong == 0;
+}
+
+Bool_t Test5(Int_t nkeys)
+{
+   // Without index (threshold above the number of keys) the same lookups
+   // give the same results.
+
+   Int_t threshold = TDirectoryFile::GetKeyIndexThreshold();
+   TDirectoryFile::SetKeyIndexThreshold(10 * nkeys);
+   MakeFile(kUnindexedFile, nkeys);
+   TDirectoryFile::SetKeyIndexThreshold(threshold);
+
+   TFile *f = TFile::Open(kUnindexedFile);
+   if (!f) return kFALSE;
+   Long64_t wrong = 0;
+   if (f->IsKeyIndexed()) wrong++;
+   wrong += CheckLookups(f, nkeys);
+   wrong += CheckListOfKeys(f, nkeys);
+   delete f;
+   return wrong == 0;
+}
+
+void CleanUp()
+{
+   gSystem->Unlink(kIndexedFile);
+   gSystem->Unlink(kUnindexedFile);
+}
+
+Int_t stressKeyIndex(Int_t nkeys)
+{
+   // The index is only read for keys records of at least 64 kB.
+   if (nkeys < 2000) nkeys = 2000;
+   Int_t threshold = TDirectoryFile::GetKeyIndexThreshold();
+   TDirectoryFile::SetKeyIndexThreshold(nkeys / 2);
+   MakeFile(kIndexedFile, nkeys);
+   printf("**********************************************************************\n");
+   printf("***************Starting key index stress test*************************\n");
+   printf("**********************************************************************\n");
+
+   if (Test1(nkeys))
+      printf("Test1: Key index written for large directories only---------------- OK\n");
+   else
+      printf("Test1: Key index written for large directories only---------------- FAILED\n");
+
+   if (Test2(nkeys))
+      printf("Test2: Get, GetKey and FindKey through the key index--------------- OK\n");
+   else
+      printf("Test2: Get, GetKey and FindKey through the key index--------------- FAILED\n");
+
+   if (Test3(nkeys))
+      printf("Test3: GetListOfKeys after lookups--------------------------------- OK\n");
+   else
+      printf("Test3: GetListOfKeys after lookups--------------------------------- FAILED\n");
+
+   if (Test4(nkeys))
+      printf("Test4: ReOpen in UPDATE mode, adding and deleting keys------------- OK\n");
+   else
+      printf("Test4: ReOpen in UPDATE mode, adding and deleting keys------------- FAILED\n");
+
+   if (Test5(nkeys))
+      printf("Test5: Same lookups without key index------------------------------ OK\n");
+   else
+      printf("Test5: Same lookups without key index------------------------------ FAILED\n");
+
+   TDirectoryFile::SetKeyIndexThreshold(threshold);
+   printf("**********************************************************************\n");
+   printf("*******************Deleting the data files****************************\n");
+   printf("**********************************************************************\n");
+   CleanUp();
+   return 0;
+}
+//_____________________________batch only_____________________
+#ifndef __CINT__
+
+int main(int argc, char *argv[])
+{
+   TApplication theApp("App", &argc, argv);
+   Int_t nkeys = 20000;
+   if (argc > 1) nkeys = atoi(argv[1]);
+   stressKeyIndex(nkeys);
+   return 0;
+}
+
+#endif
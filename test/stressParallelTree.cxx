@@ -0,0 +1,794 @@
+/////////////////////////////////////////////////////////////////
+//
+//___A stress test for the multi-threaded reading and writing of trees___
+//
+//   The results of the multi-threaded paths are compared with the ones of
+//   the sequential paths on the same data:
+//   - Test1() - reading with the baskets unzipped by a TTreeCacheUnzip
+//               thread pool, with several numbers of threads and buffer
+//               sizes, reading the entries in order and with jumps
+//   - Test2() - TTree::Process with the clusters processed by several
+//               threads, with the selector of stressParallelSelector.C
+//   - Test3() - writing with the baskets compressed by several threads in
+//               TTree::FlushBaskets, with several compression algorithms
+//   - Test4() - reading a chain with the file of the next tree opened in
+//               the background (TChain::SetPrefetchNextFile)
+//   - Test5() - JSON output of the TTreePerfStats counters, parsed and
+//               compared with the tree, during and after a read with the
+//               baskets unzipped sequentially or by threads
+//   - Test6() - writing with the write cache flushed by a background thread:
+//               entries read back before and after closing the file, and
+//               write errors reported by Flush and by Close
+//
+//   To run in batch mode, do
+//     stressParallelTree
+//     stressParallelTree 20000
+//   Here the parameter is the number of entries of the tree.
+//   Default value is 20000
+//
+//   An example of output when all tests pass:
+// **********************************************************************
+// ***************Starting parallel tree stress test*********************
+// **********************************************************************
+// Test1: Parallel unzipping of the baskets--------------------------- OK
+// Test2: Parallel processing of the clusters------------------------- OK
+// Test3: Parallel compression of the flushed baskets----------------- OK
+// Test4: Chain with the next file opened in the background----------- OK
+// Test5: JSON counters of TTreePerfStats----------------------------- OK
+// Test6: Write cache flushed in the background----------------------- OK
+// **********************************************************************
+// *******************Deleting the data files****************************
+// **********************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "Compression.h"
+#include "TApplication.h"
+#include "TBranch.h"
+#include "TChain.h"
+#include "TError.h"
+#include "TFile.h"
+#include "TFileCacheWrite.h"
+#include "TH1.h"
+#include "TList.h"
+#include "TRandom.h"
+#include "TSelector.h"
+#include "TSystem.h"
+#include "TTree.h"
+#include "TTreeCacheUnzip.h"
+#include "TTreePerfStats.h"
+
+Int_t stressParallelTree(Int_t nentries = 20000);
+
+const char    *kDataFile  = "stressParallelTree.root";
+const char    *kFlushRef  = "stressParallelTreeFlush0.root"; // Same length as kFlushFile,
+const char    *kFlushFile = "stressParallelTreeFlush1.root"; // for the same file layout
+const Int_t    kMaxN      = 10;        // Maximum size of the array v
+const Long64_t kAutoFlush = 500;       // Entries per cluster
+const Int_t    kCacheSize = 1000000;   // Size of the TTreeCache
+const char    *kSelector  = "stressParallelSelector.C+";
+const Int_t    kNFiles    = 4;         // Number of files of the chain
+const char    *kAsyncFile = "stressParallelTreeAsync.root";
+
+struct TreeData {
+   Int_t    fI;
+   Double_t fX;
+   Int_t    fN;
+   Float_t  fV[kMaxN];
+};
+
+void CreateBranches(TTree *tree, TreeData &data)
+{
+   tree->Branch("i", &data.fI, "i/I");
+   tree->Branch("x", &data.fX, "x/D");
+   tree->Branch("n", &data.fN, "n/I");
+   tree->Branch("v", data.fV, "v[n]/F");
+}
+
+void SetEntry(TreeData &data, Int_t i)
+{
+   data.fI = i;
+   data.fX = gRandom->Gaus();
+   data.fN = i % kMaxN;
+   for (Int_t j = 0; j < data.fN; j++) data.fV[j] = data.fX * j + i;
+}
+
+Double_t Checksum(const TreeData &data)
+{
+   // Sum of the values of an entry, weighted to detect swapped values.
+
+   Double_t sum = data.fI + 3 * data.fX + 1000. * data.fN;
+   for (Int_t j = 0; j < data.fN && j < kMaxN; j++) sum += (j + 1) * data.fV[j];
+   return sum;
+}
+
+void MakeFile(const char *filename, Int_t nentries, Int_t compress = 1, std::vector<Double_t> *sums = 0,
+              Int_t first = 0)
+{
+   // Write the tree "T" with clusters of kAutoFlush entries, numbered from
+   // first. The entries are the same for each call. If sums is given, the
+   // checksum of each entry is stored in it.
+
+   TFile *f = new TFile(filename, "RECREATE", "", compress);
+   TreeData data;
+   TTree *tree = new TTree("T", "stressParallelTree");
+   CreateBranches(tree, data);
+   tree->SetAutoFlush(kAutoFlush);
+   gRandom->SetSeed(65539);
+   if (sums) sums->assign(nentries, 0);
+   for (Int_t i = 0; i < nentries; i++) {
+      SetEntry(data, first + i);
+      tree->Fill();
+      if (sums) (*sums)[i] = Checksum(data);
+   }
+   f->Write();
+   delete f;
+}
+
+Bool_t ReadFile(const char *filename, std::vector<Double_t> &sums, Bool_t jump, Bool_t &unzipped)
+{
+   // Read the tree "T" of filename through a TTreeCache and store the checksum
+   // of each entry in sums. With jump, the second half of the entries is read
+   // before the first one. unzipped is set if the baskets were unzipped by
+   // the threads of a TTreeCacheUnzip.
+
+   TFile *f = TFile::Open(filename);
+   TTree *tree = f ? (TTree*)f->Get("T") : 0;
+   if (!tree) {
+      delete f;
+      return kFALSE;
+   }
+   TreeData data;
+   tree->SetBranchAddress("i", &data.fI);
+   tree->SetBranchAddress("x", &data.fX);
+   tree->SetBranchAddress("n", &data.fN);
+   tree->SetBranchAddress("v", data.fV);
+   tree->SetCacheSize(kCacheSize);
+   Long64_t nentries = tree->GetEntries();
+   sums.assign(nentries, 0);
+   Long64_t start = jump ? nentries / 2 : 0;
+   for (Long64_t k = 0; k < nentries; k++) {
+      Long64_t entry = (start + k) % nentries;
+      if (tree->GetEntry(entry) <= 0) {
+         delete f;
+         return kFALSE;
+      }
+      sums[entry] = Checksum(data);
+   }
+   TTreeCacheUnzip *cache = dynamic_cast<TTreeCacheUnzip*>(f->GetCacheRead(tree));
+   unzipped = cache && cache->GetNUnzip() > 0;
+   delete f;
+   return kTRUE;
+}
+
+Int_t CompareSums(const std::vector<Double_t> &sums1, const std::vector<Double_t> &sums2)
+{
+   // Return the number of entries with different checksums.
+
+   if (sums1.size() != sums2.size()) return 1;
+   Int_t wrong = 0;
+   for (UInt_t i = 0; i < sums1.size(); i++) {
+      if (sums1[i] != sums2[i]) wrong++;
+   }
+   return wrong;
+}
+
+Bool_t Test1()
+{
+   // Read the file sequentially, then with the baskets unzipped by the
+   // threads of a TTreeCacheUnzip, and compare the entries.
+
+   std::vector<Double_t> reference, sums;
+   Bool_t unzipped = kFALSE;
+   Int_t wrong = 0;
+   TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kDisable);
+   if (!ReadFile(kDataFile, reference, kFALSE, unzipped)) return kFALSE;
+   if (unzipped) wrong++;
+
+   const Int_t nthreads[] = { 1, 2, 4, 0 };
+   const Float_t relsizes[] = { 0.5, 0.05 };
+   TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kForce);
+   for (Int_t it = 0; it < 4; it++) {
+      TTreeCacheUnzip::SetUnzipThreads(nthreads[it]);
+      for (Int_t is = 0; is < 2; is++) {
+         TTreeCacheUnzip::SetUnzipRelBufferSize(relsizes[is]);
+         for (Int_t jump = 0; jump < 2; jump++) {
+            if (!ReadFile(kDataFile, sums, jump, unzipped)) {
+               wrong++;
+               continue;
+            }
+            Int_t nwrong = CompareSums(reference, sums);
+            if (nwrong)
+               printf("\n%d wrong entries with %d threads, buffer %g, jump %d\n",
+                      nwrong, nthreads[it], relsizes[is], jump);
+            wrong += nwrong;
+         }
+      }
+   }
+   TTreeCacheUnzip::SetUnzipRelBufferSize(0.5);
+   TTreeCacheUnzip::SetUnzipThreads(0);
+   TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kDisable);
+   return wrong == 0;
+}
+
+Int_t CompareHistograms(TList *output1, TList *output2, const char *name)
+{
+   // Return the number of bins of the histogram name that differ between the
+   // two output lists, including the underflow and overflow bins.
+
+   TH1 *h1 = output1 ? (TH1*)output1->FindObject(name) : 0;
+   TH1 *h2 = output2 ? (TH1*)output2->FindObject(name) : 0;
+   if (!h1 || !h2 || h1->GetNbinsX() != h2->GetNbinsX()) return 1;
+   Int_t wrong = 0;
+   if (h1->GetEntries() != h2->GetEntries()) wrong++;
+   for (Int_t bin = 0; bin <= h1->GetNbinsX() + 1; bin++) {
+      if (h1->GetBinContent(bin) != h2->GetBinContent(bin)) wrong++;
+   }
+   return wrong;
+}
+
+Double_t GetSlaves(TList *output)
+{
+   // Number of selectors whose output was merged into output.
+
+   TH1 *h = output ? (TH1*)output->FindObject("hslaves") : 0;
+   return h ? h->GetEntries() : 0;
+}
+
+TSelector *ProcessFile(const char *filename, Int_t nthreads, Long64_t nentries, Long64_t first)
+{
+   // Process the tree "T" of filename with a new stressParallelSelector in
+   // nthreads threads and return the selector.
+
+   TFile *f = TFile::Open(filename);
+   TTree *tree = f ? (TTree*)f->Get("T") : 0;
+   TSelector *selector = TSelector::GetSelector(kSelector);
+   if (!tree || !selector) {
+      delete f;
+      delete selector;
+      return 0;
+   }
+   tree->SetCacheSize(kCacheSize);
+   TTree::SetProcessThreads(nthreads);
+   tree->Process(selector, "", nentries, first);
+   TTree::SetProcessThreads(1);
+   delete f;
+   return selector;
+}
+
+Bool_t Test2()
+{
+   // Process the tree sequentially, then with the clusters processed by
+   // several threads, and compare the merged histograms. The histogram of
+   // the entry numbers checks that each entry was processed once.
+
+   const char *names[] = { "hi", "hx", "hv", 0 };
+   const Int_t nthreads[] = { 2, 4, 0 };
+   // All the entries, then a range starting and ending within clusters.
+   const Long64_t nentries[] = { 1000000000, 5 * kAutoFlush + 123 };
+   const Long64_t first[] = { 0, kAutoFlush / 2 };
+   Int_t wrong = 0;
+   for (Int_t ir = 0; ir < 2; ir++) {
+      TSelector *reference = ProcessFile(kDataFile, 1, nentries[ir], first[ir]);
+      if (!reference) return kFALSE;
+      if (GetSlaves(reference->GetOutputList()) != 1) wrong++;
+      for (Int_t it = 0; it < 3; it++) {
+         TSelector *selector = ProcessFile(kDataFile, nthreads[it], nentries[ir], first[ir]);
+         if (!selector) {
+            wrong++;
+            continue;
+         }
+         Int_t nwrong = 0;
+         // More than one selector must have been used.
+         if (nthreads[it] != 0 && GetSlaves(selector->GetOutputList()) <= 1) nwrong++;
+         for (Int_t ih = 0; names[ih]; ih++) {
+            nwrong += CompareHistograms(reference->GetOutputList(), selector->GetOutputList(), names[ih]);
+         }
+         if (nwrong)
+            printf("\n%d differences with %d threads from entry %lld\n", nwrong, nthreads[it], first[ir]);
+         wrong += nwrong;
+         delete selector;
+      }
+      delete reference;
+   }
+   return wrong == 0;
+}
+
+Int_t CompareLayout(const char *filename1, const char *filename2)
+{
+   // Return the number of differences between the baskets of the trees "T"
+   // of the two files: same number of baskets, at the same place, with the
+   // same sizes.
+
+   TFile *f1 = TFile::Open(filename1);
+   TFile *f2 = TFile::Open(filename2);
+   TTree *t1 = f1 ? (TTree*)f1->Get("T") : 0;
+   TTree *t2 = f2 ? (TTree*)f2->Get("T") : 0;
+   Int_t wrong = 0;
+   if (!t1 || !t2 || f1->GetEND() != f2->GetEND()) {
+      wrong = 1;
+   } else {
+      const char *names[] = { "i", "x", "n", "v", 0 };
+      for (Int_t ib = 0; names[ib]; ib++) {
+         TBranch *b1 = t1->GetBranch(names[ib]);
+         TBranch *b2 = t2->GetBranch(names[ib]);
+         if (b1->GetWriteBasket() != b2->GetWriteBasket() || b1->GetZipBytes() != b2->GetZipBytes()) {
+            wrong++;
+            continue;
+         }
+         for (Int_t i = 0; i < b1->GetWriteBasket(); i++) {
+            if (b1->GetBasketSeek(i) != b2->GetBasketSeek(i)) wrong++;
+            if (b1->GetBasketBytes()[i] != b2->GetBasketBytes()[i]) wrong++;
+         }
+      }
+   }
+   delete f1;
+   delete f2;
+   return wrong;
+}
+
+Bool_t Test3(Int_t nentries)
+{
+   // Write the tree with the baskets compressed sequentially, then by several
+   // threads, read it back and compare the entries with the ones written, and
+   // the baskets of the two files. With the old compression algorithm, which
+   // is not reentrant, the baskets are compressed in the calling thread.
+
+   const Int_t algorithms[] = { ROOT::kZLIB, ROOT::kLZMA, ROOT::kOldCompressionAlgo };
+   const Int_t nthreads[] = { 2, 4, 0 };
+   std::vector<Double_t> written, sums;
+   Bool_t unzipped;
+   Int_t wrong = 0;
+   for (Int_t ia = 0; ia < 3; ia++) {
+      Int_t compress = ROOT::CompressionSettings((ROOT::ECompressionAlgorithm)algorithms[ia], 1);
+      TTree::SetFlushThreads(1);
+      MakeFile(kFlushRef, nentries, compress, &written);
+      for (Int_t it = 0; it < 3; it++) {
+         TTree::SetFlushThreads(nthreads[it]);
+         MakeFile(kFlushFile, nentries, compress, &written);
+         TTree::SetFlushThreads(1);
+         Int_t nwrong = 0;
+         if (!ReadFile(kFlushFile, sums, kFALSE, unzipped)) nwrong++;
+         else nwrong += CompareSums(written, sums);
+         nwrong += CompareLayout(kFlushRef, kFlushFile);
+         if (nwrong)
+            printf("\n%d differences with %d threads and compression %d\n", nwrong, nthreads[it], compress);
+         wrong += nwrong;
+      }
+   }
+   TTree::SetFlushThreads(1);
+   return wrong == 0;
+}
+
+TString ChainFileName(Int_t i)
+{
+   return TString::Format("stressParallelTreeChain_%d.root", i);
+}
+
+Bool_t ReadChain(Int_t nentries, Bool_t prefetch, Bool_t jump, Bool_t subset, std::vector<Double_t> &sums)
+{
+   // Read the chain of the kNFiles files through a TTreeCache, opening the
+   // next file in the background if prefetch is set, and store the checksum
+   // of each entry in sums. With jump, the entries are read starting from
+   // the middle of the chain. With subset, only the branches i and x are read.
+
+   TChain *chain = new TChain("T");
+   for (Int_t i = 0; i < kNFiles; i++) chain->Add(ChainFileName(i));
+   TreeData data;
+   data.fN = 0;
+   chain->SetBranchAddress("i", &data.fI);
+   chain->SetBranchAddress("x", &data.fX);
+   chain->SetBranchAddress("n", &data.fN);
+   chain->SetBranchAddress("v", data.fV);
+   if (subset) {
+      chain->SetBranchStatus("*", 0);
+      chain->SetBranchStatus("i", 1);
+      chain->SetBranchStatus("x", 1);
+   }
+   chain->SetCacheSize(kCacheSize);
+   chain->SetPrefetchNextFile(prefetch);
+   sums.assign(nentries, 0);
+   Long64_t start = jump ? nentries / 2 + 17 : 0;
+   Bool_t ok = kTRUE;
+   for (Long64_t k = 0; k < nentries && ok; k++) {
+      Long64_t entry = (start + k) % nentries;
+      if (chain->GetEntry(entry) <= 0) ok = kFALSE;
+      else sums[entry] = Checksum(data);
+   }
+   if (chain->GetEntries() != nentries) ok = kFALSE;
+   delete chain;
+   return ok;
+}
+
+Bool_t Test4(Int_t nentries)
+{
+   // Read a chain with the file of the next tree opened in the background,
+   // in order, with a jump and with a subset of the branches, and compare the
+   // entries with the ones of a plain read.
+
+   Int_t nperfile = nentries / kNFiles;
+   if (nperfile < 2 * kAutoFlush) nperfile = 2 * kAutoFlush;
+   for (Int_t i = 0; i < kNFiles; i++) MakeFile(ChainFileName(i), nperfile, 1, 0, i * nperfile);
+   Int_t ntotal = kNFiles * nperfile;
+
+   std::vector<Double_t> reference, sums;
+   Int_t wrong = 0;
+   for (Int_t subset = 0; subset < 2; subset++) {
+      if (!ReadChain(ntotal, kFALSE, kFALSE, subset, reference)) return kFALSE;
+      for (Int_t jump = 0; jump < 2; jump++) {
+         Int_t nwrong = 0;
+         if (!ReadChain(ntotal, kTRUE, jump, subset, sums)) nwrong++;
+         else nwrong += CompareSums(reference, sums);
+         if (nwrong)
+            printf("\n%d wrong entries with jump %d and subset %d\n", nwrong, jump, subset);
+         wrong += nwrong;
+      }
+   }
+   return wrong == 0;
+}
+
+struct JSONValue {
+   enum EType { kNull, kBool, kNumber, kString, kArray, kObject };
+   EType                    fType;
+   Double_t                 fNumber;
+   std::string              fString;
+   std::vector<JSONValue>   fItems;   // Elements of an array or values of an object
+   std::vector<std::string> fKeys;    // Keys of an object
+
+   JSONValue() : fType(kNull), fNumber(0) { }
+
+   const JSONValue *Find(const char *key) const
+   {
+      for (UInt_t i = 0; i < fKeys.size(); i++) {
+         if (fKeys[i] == key) return &fItems[i];
+      }
+      return 0;
+   }
+
+   Double_t Number(const char *key) const
+   {
+      const JSONValue *v = Find(key);
+      return v && v->fType == kNumber ? v->fNumber : -1;
+   }
+};
+
+void SkipSpaces(const char *&p)
+{
+   while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+}
+
+Bool_t ParseJSONString(const char *&p, std::string &str)
+{
+   if (*p != '"') return kFALSE;
+   p++;
+   str.clear();
+   while (*p != '"') {
+      if (!*p || (unsigned char)*p < 0x20) return kFALSE;
+      if (*p != '\\') {
+         str += *p++;
+         continue;
+      }
+      p++;
+      switch (*p) {
+         case '"': case '\\': case '/': str += *p; break;
+         case 'b': str += '\b'; break;
+         case 'f': str += '\f'; break;
+         case 'n': str += '\n'; break;
+         case 'r': str += '\r'; break;
+         case 't': str += '\t'; break;
+         case 'u': {
+            for (Int_t i = 1; i <= 4; i++) {
+               if (!strchr("0123456789abcdefABCDEF", p[i]) || !p[i]) return kFALSE;
+            }
+            str += (char)strtol(std::string(p + 1, 4).c_str(), 0, 16);
+            p += 4;
+            break;
+         }
+         default: return kFALSE;
+      }
+      p++;
+   }
+   p++;
+   return kTRUE;
+}
+
+Bool_t ParseJSONValue(const char *&p, JSONValue &value)
+{
+   // Parse the JSON value at p, and move p after it. Return false if the
+   // text is not valid JSON, for example if a number is printed as nan.
+
+   SkipSpaces(p);
+   if (*p == '{' || *p == '[') {
+      Bool_t object = *p == '{';
+      char end = object ? '}' : ']';
+      value.fType = object ? JSONValue::kObject : JSONValue::kArray;
+      p++;
+      SkipSpaces(p);
+      if (*p == end) {
+         p++;
+         return kTRUE;
+      }
+      while (1) {
+         if (object) {
+            SkipSpaces(p);
+            value.fKeys.push_back(std::string());
+            if (!ParseJSONString(p, value.fKeys.back())) return kFALSE;
+            SkipSpaces(p);
+            if (*p++ != ':') return kFALSE;
+         }
+         value.fItems.push_back(JSONValue());
+         if (!ParseJSONValue(p, value.fItems.back())) return kFALSE;
+         SkipSpaces(p);
+         if (*p == end) {
+            p++;
+            return kTRUE;
+         }
+         if (*p++ != ',') return kFALSE;
+      }
+   }
+   if (*p == '"') {
+      value.fType = JSONValue::kString;
+      return ParseJSONString(p, value.fString);
+   }
+   if (*p == '-' || (*p >= '0' && *p <= '9')) {
+      char *end;
+      value.fType = JSONValue::kNumber;
+      value.fNumber = strtod(p, &end);
+      if (end == p) return kFALSE;
+      p = end;
+      return kTRUE;
+   }
+   const char *words[3] = { "true", "false", "null" };
+   for (Int_t i = 0; i < 3; i++) {
+      if (!strncmp(p, words[i], strlen(words[i]))) {
+         value.fType = i < 2 ? JSONValue::kBool : JSONValue::kNull;
+         value.fNumber = i == 0;
+         p += strlen(words[i]);
+         return kTRUE;
+      }
+   }
+   return kFALSE;
+}
+
+Int_t CheckPerfStats(const TTreePerfStats *ps, TTree *tree, Bool_t finished)
+{
+   // Parse the output of ps->PrintJSON and compare its counters with the
+   // baskets of tree. Once all the entries are read (finished), all the
+   // baskets must have been read. Return the number of differences.
+
+   std::ostringstream out;
+   ps->PrintJSON(out);
+   std::string text = out.str();
+   const char *p = text.c_str();
+   JSONValue root;
+   if (!ParseJSONValue(p, root)) return 1;
+   SkipSpaces(p);
+   if (*p || root.fType != JSONValue::kObject) return 1;
+
+   Int_t wrong = 0;
+   const JSONValue *name = root.Find("name");
+   if (!name || name->fString != ps->GetName()) wrong++;
+   const JSONValue *tname = root.Find("tree");
+   if (!tname || tname->fString != tree->GetName()) wrong++;
+   const JSONValue *cache = root.Find("cache");
+   if (!cache || cache->fType != JSONValue::kObject || cache->Number("size") <= 0) wrong++;
+
+   const JSONValue *files = root.Find("files");
+   if (!files || files->fType != JSONValue::kArray || files->fItems.size() != 1) return wrong + 1;
+   const JSONValue &file = files->fItems[0];
+   const JSONValue *fname = file.Find("name");
+   if (!fname || fname->fString != tree->GetCurrentFile()->GetName()) wrong++;
+   if (file.Number("readcalls") <= 0 || file.Number("readtime") < 0) wrong++;
+   if (finished && file.Number("bytesread") < tree->GetZipBytes()) wrong++;
+
+   const JSONValue *branches = root.Find("branches");
+   if (!branches || branches->fType != JSONValue::kArray) return wrong + 1;
+   for (UInt_t i = 0; i < branches->fItems.size(); i++) {
+      const JSONValue &counters = branches->fItems[i];
+      const JSONValue *bname = counters.Find("name");
+      TBranch *branch = bname ? tree->GetBranch(bname->fString.c_str()) : 0;
+      if (!branch) {
+         wrong++;
+         continue;
+      }
+      Double_t baskets = counters.Number("baskets");
+      if (baskets <= 0 || baskets > branch->GetWriteBasket()) wrong++;
+      if (counters.Number("zipbytes") > branch->GetZipBytes()) wrong++;
+      if (counters.Number("unzipbytes") <= 0 || counters.Number("unziptime") < 0) wrong++;
+      if (counters.Number("minbasket") > counters.Number("maxbasket")) wrong++;
+   }
+   if (branches->fItems.size() > 4) wrong++;
+   // The baskets of i are compressed: each one is unzipped once when the
+   // file is read in order without the unzipping threads.
+   if (finished && ps->GetBranchCounters().count("i") &&
+       ps->GetBranchCounters().find("i")->second.fBaskets != tree->GetBranch("i")->GetWriteBasket()) wrong++;
+   return wrong;
+}
+
+Bool_t Test5()
+{
+   // Read the file with a TTreePerfStats, without and with the unzipping
+   // threads, and check its JSON output in the middle and at the end.
+
+   Int_t wrong = 0;
+   for (Int_t parallel = 0; parallel < 2; parallel++) {
+      TTreeCacheUnzip::SetParallelUnzip(parallel ? TTreeCacheUnzip::kForce : TTreeCacheUnzip::kDisable);
+      TTreeCacheUnzip::SetUnzipThreads(parallel ? 2 : 0);
+      TFile *f = TFile::Open(kDataFile);
+      TTree *tree = f ? (TTree*)f->Get("T") : 0;
+      if (!tree) {
+         delete f;
+         wrong++;
+         continue;
+      }
+      TreeData data;
+      tree->SetBranchAddress("i", &data.fI);
+      tree->SetBranchAddress("x", &data.fX);
+      tree->SetBranchAddress("n", &data.fN);
+      tree->SetBranchAddress("v", data.fV);
+      tree->SetCacheSize(kCacheSize);
+      TTreePerfStats *ps = new TTreePerfStats("ioperf", tree);
+      Long64_t nentries = tree->GetEntries();
+      Int_t nwrong = 0;
+      for (Long64_t entry = 0; entry < nentries; entry++) {
+         if (tree->GetEntry(entry) <= 0) {
+            nwrong++;
+            break;
+         }
+         if (entry == nentries / 2) nwrong += CheckPerfStats(ps, tree, kFALSE);
+      }
+      // With the unzipping threads, the baskets unzipped by the cache are
+      // not counted in the branch counters.
+      nwrong += CheckPerfStats(ps, tree, !parallel);
+      if (nwrong) printf("\n%d wrong JSON counters with parallel unzip %d\n", nwrong, parallel);
+      wrong += nwrong;
+      delete ps;
+      delete f;
+   }
+   TTreeCacheUnzip::SetUnzipThreads(0);
+   TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kDisable);
+   return wrong == 0;
+}
+
+Bool_t Test6(Int_t nentries)
+{
+   // Write the tree with an asynchronous write cache, read it back with a
+   // TTreeCache before closing the file, then after, and compare it with the
+   // entries written. Then check that a failure of the background writes,
+   // to /dev/full, is reported by Flush and by Close.
+
+   Int_t wrong = 0;
+   TFileCacheWrite::SetAsyncWrite(kTRUE);
+   TFile *f = new TFile(kAsyncFile, "RECREATE");
+   TFileCacheWrite *cache = f->GetCacheWrite();
+   if (!cache || !cache->IsAsync()) wrong++;
+   TreeData data;
+   TTree *tree = new TTree("T", "stressParallelTree");
+   CreateBranches(tree, data);
+   tree->SetAutoFlush(kAutoFlush);
+   gRandom->SetSeed(65539);
+   std::vector<Double_t> reference(nentries), sums(nentries);
+   for (Int_t i = 0; i < nentries; i++) {
+      SetEntry(data, i);
+      tree->Fill();
+      reference[i] = Checksum(data);
+   }
+   // The last baskets are still in the write cache or being written.
+   tree->FlushBaskets();
+   tree->SetCacheSize(kCacheSize);
+   for (Int_t i = 0; i < nentries; i++) {
+      if (tree->GetEntry(i) <= 0) {
+         wrong++;
+         break;
+      }
+      sums[i] = Checksum(data);
+   }
+   wrong += CompareSums(reference, sums);
+   f->Write();
+   delete f;
+   Bool_t unzipped;
+   if (!ReadFile(kAsyncFile, sums, kFALSE, unzipped)) wrong++;
+   else wrong += CompareSums(reference, sums);
+
+#ifndef WIN32
+   if (!gSystem->AccessPathName("/dev/full")) {
+      Int_t level = gErrorIgnoreLevel;
+      gErrorIgnoreLevel = kFatal;
+      for (Int_t atclose = 0; atclose < 2; atclose++) {
+         f = new TFile(kAsyncFile, "RECREATE");
+         cache = f->GetCacheWrite();
+         Int_t fd = open("/dev/full", O_WRONLY);
+         if (!cache || !cache->IsAsync() || fd < 0 || dup2(fd, f->GetFd()) < 0) {
+            wrong++;
+         } else {
+            // The sixth block hands the first five over to the thread.
+            std::vector<char> buf(100000, 'x');
+            Long64_t pos = f->GetEND();
+            for (Int_t i = 0; i < 6; i++) cache->WriteBuffer(&buf[0], pos + i * (Long64_t)buf.size(), buf.size());
+            if (!atclose && !cache->Flush()) wrong++;
+            f->Close();
+            if (!f->TestBit(TFile::kWriteError)) wrong++;
+         }
+         if (fd >= 0) close(fd);
+         delete f;
+      }
+      gErrorIgnoreLevel = level;
+   }
+#endif
+   TFileCacheWrite::SetAsyncWrite(kFALSE);
+   return wrong == 0;
+}
+
+void CleanUp()
+{
+   gSystem->Unlink(kDataFile);
+   for (Int_t i = 0; i < kNFiles; i++) gSystem->Unlink(ChainFileName(i));
+   gSystem->Unlink(kFlushFile);
+   gSystem->Unlink(kFlushRef);
+   gSystem->Unlink(kAsyncFile);
+}
+
+Int_t stressParallelTree(Int_t nentries)
+{
+   MakeFile(kDataFile, nentries);
+   printf("**********************************************************************\n");
+   printf("***************Starting parallel tree stress test*********************\n");
+   printf("**********************************************************************\n");
+
+   if (Test1())
+      printf("Test1: Parallel unzipping of the baskets--------------------------- OK\n");
+   else
+      printf("Test1: Parallel unzipping of the baskets--------------------------- FAILED\n");
+
+   if (Test2())
+      printf("Test2: Parallel processing of the clusters------------------------- OK\n");
+   else
+      printf("Test2: Parallel processing of the clusters------------------------- FAILED\n");
+
+   if (Test3(nentries))
+      printf("Test3: Parallel compression of the flushed baskets----------------- OK\n");
+   else
+      printf("Test3: Parallel compression of the flushed baskets----------------- FAILED\n");
+
+   if (Test4(nentries))
+      printf("Test4: Chain with the next file opened in the background----------- OK\n");
+   else
+      printf("Test4: Chain with the next file opened in the background----------- FAILED\n");
+
+   if (Test5())
+      printf("Test5: JSON counters of TTreePerfStats----------------------------- OK\n");
+   else
+      printf("Test5: JSON counters of TTreePerfStats----------------------------- FAILED\n");
+
+   if (Test6(nentries))
+      printf("Test6: Write cache flushed in the background----------------------- OK\n");
+   else
+      printf("Test6: Write cache flushed in the background----------------------- FAILED\n");
+
+   printf("**********************************************************************\n");
+   printf("*******************Deleting the data files****************************\n");
+   printf("**********************************************************************\n");
+   CleanUp();
+   return 0;
+}
+//_____________________________batch only_____________________
+#ifndef __CINT__
+
+int main(int argc, char *argv[])
+{
+   TApplication theApp("App", &argc, argv);
+   Int_t nentries = 20000;
+   if (argc > 1) nentries = atoi(argv[1]);
+   stressParallelTree(nentries);
+   return 0;
+}
+
+#endif
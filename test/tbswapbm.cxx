@@ -0,0 +1,136 @@
+// @(#)root/test:$Id$
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "TBufferFile.h"
+#include "TStopwatch.h"
+#include "TRandom.h"
+#include "Bswapcpy.h"
+//
+// This program benchmarks TBufferFile::WriteFastArray/ReadFastArray for
+// the 2, 4 and 8 byte basic types with each of the byte swapping
+// implementations available on this CPU (scalar, SSSE3, AVX2), and checks
+// that all of them produce the same buffer.
+//
+// Usage: tbswapbm [nelements] [ntimes]
+//
+// parameters:
+//       nelements     - number of elements in each array (default 100000)
+//       ntimes        - number of write+read round trips  (default 200)
+//
+// On big endian machines no byte swapping is done and all implementations
+// reduce to memcpy.
+
+int nelements = 100000;   // Array size.
+int ntimes    = 200;      // Number of round trips.
+
+//_____________________________________________________________
+
+template <typename T>
+Double_t RoundTrip(const T *in, T *out, TBufferFile &b, char *ref, Bool_t store, Bool_t &ok)
+{
+   // Write and read back in ntimes; return the time spent in seconds. The
+   // first written buffer is stored in ref (store) or compared with it.
+
+   TStopwatch timer;
+   for (int j = 0; j < ntimes; j++) {
+      b.SetWriteMode();
+      b.SetBufferOffset(0);
+      b.WriteFastArray(in, nelements);
+      if (j == 0 && ref) {
+         if (store)
+            memcpy(ref, b.Buffer(), sizeof(T)*nelements);
+         else if (memcmp(ref, b.Buffer(), sizeof(T)*nelements))
+            ok = kFALSE;
+      }
+      b.SetReadMode();
+      b.SetBufferOffset(0);
+      b.ReadFastArray(out, nelements);
+   }
+   timer.Stop();
+   if (memcmp(in, out, sizeof(T)*nelements)) ok = kFALSE;
+   return timer.RealTime();
+}
+
+//_____________________________________________________________
+
+template <typename T>
+Bool_t Bench(const char *type, const T *in)
+{
+   // Run the round trip for all implementations and print the throughput.
+
+   T *out = new T[nelements];
+   char *ref = new char[sizeof(T)*nelements];
+   TBufferFile b(TBuffer::kWrite, sizeof(T)*nelements + 16);
+   Bool_t allok = kTRUE;
+   Double_t mbytes = 2.*ntimes*sizeof(T)*nelements/1048576.;
+   Double_t scalar = 0;
+   Bool_t first = kTRUE;
+
+   for (int impl = kBswapcpyScalar; impl < kBswapcpyBest; impl++) {
+      if (!R__SetBswapcpyImpl(impl)) continue;
+      Bool_t ok = kTRUE;
+      RoundTrip(in, out, b, 0, kFALSE, ok);  // warm up
+      Double_t t = RoundTrip(in, out, b, ref, first, ok);
+      first = kFALSE;
+      if (impl == kBswapcpyScalar) scalar = t;
+      printf("%-9s %-7s %10.1f MB/s  x%5.2f  %s\n", type, R__GetBswapcpyImplName(),
+             t > 0 ? mbytes/t : 0., t > 0 ? scalar/t : 0., ok ? "OK" : "FAILED");
+      allok = allok && ok;
+   }
+   R__SetBswapcpyImpl(kBswapcpyBest);
+
+   delete [] ref;
+   delete [] out;
+   return allok;
+}
+
+//_____________________________________________________________
+
+int main(int argc, char **argv)
+{
+   if (argc > 1 && !strcmp(argv[1], "-h")) {
+      printf("Usage: tbswapbm [nelements] [ntimes]\n");
+      return 0;
+   }
+   if (argc > 1) nelements = atoi(argv[1]);
+   if (argc > 2) ntimes    = atoi(argv[2]);
+   if (nelements <= 0 || ntimes <= 0) {
+      printf("tbswapbm: nelements and ntimes must be positive\n");
+      return 1;
+   }
+
+   Short_t  *h = new Short_t[nelements];
+   Int_t    *i = new Int_t[nelements];
+   Float_t  *f = new Float_t[nelements];
+   Long64_t *l = new Long64_t[nelements];
+   Double_t *d = new Double_t[nelements];
+   TRandom r;
+   for (int k = 0; k < nelements; k++) {
+      d[k] = r.Gaus(0, 100);
+      f[k] = (Float_t)d[k];
+      l[k] = (Long64_t)(d[k] * 1e12);
+      i[k] = (Int_t)(d[k] * 1e6);
+      h[k] = (Short_t)(d[k] * 100);
+   }
+
+   printf("tbswapbm: %d elements, %d round trips, best implementation: %s\n",
+          nelements, ntimes, R__GetBswapcpyImplName());
+
+   Bool_t ok = kTRUE;
+   ok = Bench("Short_t",  h) && ok;
+   ok = Bench("Int_t",    i) && ok;
+   ok = Bench("Float_t",  f) && ok;
+   ok = Bench("Long64_t", l) && ok;
+   ok = Bench("Double_t", d) && ok;
+
+   delete [] h;
+   delete [] i;
+   delete [] f;
+   delete [] l;
+   delete [] d;
+
+   return ok ? 0 : 1;
+}
@@ -60,6 +60,7 @@ protected:
    TBuffer    *fCompressedBufferRef; //! Compressed buffer.
    Bool_t      fOwnsCompressedBuffer; //! Whether or not we own the compressed buffer.
    Int_t       fLastWriteBufferSize; //! Size of the buffer last time we wrote it to disk
+   Int_t       fCompressedNbytes;    //! Size of the object prepared by CompressBuffer for the next WriteBuffer, -1 if none
 
 public:
    
@@ -69,6 +70,7 @@ public:
    virtual ~TBasket();
    
    virtual void    AdjustSize(Int_t newsize);
+           Int_t   CompressBuffer(TFile *file, Bool_t ownBuffer);
    virtual void    DeleteEntryOffset();
    virtual Int_t   DropBuffers();
    TBranch        *GetBranch() const {return fBranch;}
@@ -83,6 +85,7 @@ public:
    virtual void    PrepareBasket(Long64_t /* entry */) {};
            Int_t   ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file);
            Int_t   ReadBasketBytes(Long64_t pos, TFile *file);
+           Int_t   Recompress(const TBranch *from, const TBranch *to);
    virtual void    Reset();
 
            Int_t   LoadBasketBuffers(Long64_t pos, Int_t len, TFile *file, TTree *tree = 0);
@@ -40,6 +40,10 @@
 #include "TDataType.h"
 #endif
 
+#ifndef ROOT_TArrayC
+#include "TArrayC.h"
+#endif
+
 class TTree;
 class TBasket;
 class TLeaf;
@@ -91,6 +95,8 @@ protected:
    Int_t      *fBasketBytes;     //[fMaxBaskets] Length of baskets on file
    Long64_t   *fBasketEntry;     //[fMaxBaskets] Table of first entry in each basket
    Long64_t   *fBasketSeek;      //[fMaxBaskets] Addresses of baskets on file
+   Double_t   *fBasketMin;       //[fMaxBaskets] Minimum value in each basket (see SetBasketMinMax)
+   Double_t   *fBasketMax;       //[fMaxBaskets] Maximum value in each basket (see SetBasketMinMax)
    TTree      *fTree;            //! Pointer to Tree header
    TBranch    *fMother;          //! Pointer to top-level parent branch in the tree.
    TBranch    *fParent;          //! Pointer to parent branch.
@@ -99,8 +105,12 @@ protected:
    TString     fFileName;        //  Name of file where buffers are stored ("" if in same file as Tree header)
    TBuffer    *fEntryBuffer;     //! Buffer used to directly pass the content without streaming
    TList      *fBrowsables;      //! List of TVirtualBranchBrowsables used for Browse()
+   TArrayC     fCompressionDictionary; // Preset dictionary of the ZLIB compression of the baskets, empty if none
 
    Bool_t      fSkipZip;         //! After being read, the buffer will not be unziped.
+   Int_t       fDictionarySize;  //! Size of the compression dictionary to build from the first baskets, 0 if none
+   Int_t       fDictionaryBaskets; //! Number of baskets sampled so far to build the compression dictionary
+   TArrayC     fDictionarySample;  //! Data sampled so far to build the compression dictionary
 
    typedef void (TBranch::*ReadLeaves_t)(TBuffer &b); 
    ReadLeaves_t fReadLeaves;     //! Pointer to the ReadLeaves implementation to use. 
@@ -111,6 +121,7 @@ protected:
    void     ReadLeaves1Impl(TBuffer &b);
    void     ReadLeaves2Impl(TBuffer &b);
    void     FillLeavesImpl(TBuffer &b);
+   void     FillBasketMinMax();
    
    void     SetSkipZip(Bool_t skip = kTRUE) { fSkipZip = skip; }
    void     Init(const char *name, const char *leaflist, Int_t compress);
@@ -147,13 +158,17 @@ public:
            TBasket  *GetBasket(Int_t basket);
            Int_t    *GetBasketBytes() const {return fBasketBytes;}
            Long64_t *GetBasketEntry() const {return fBasketEntry;}
+           Bool_t    GetBasketMinMax(Long64_t entry, Double_t &min, Double_t &max, Long64_t &next) const;
    virtual Long64_t  GetBasketSeek(Int_t basket) const;
    virtual Int_t     GetBasketSize() const {return fBasketSize;}
    virtual TList    *GetBrowsables();
+           Long64_t  GetBulkEntries(Long64_t entry, Long64_t nentries, void *values);
    virtual const char* GetClassName() const;
            Int_t     GetCompressionAlgorithm() const;
            Int_t     GetCompressionLevel() const;
            Int_t     GetCompressionSettings() const;
+   const TArrayC    &GetCompressionDictionary() const {return fCompressionDictionary;}
+           Int_t     GetCompressionDictionarySize() const {return fDictionarySize;}
    TDirectory       *GetDirectory() const {return fDirectory;}
    virtual Int_t     GetEntry(Long64_t entry=0, Int_t getall = 0);
    virtual Int_t     GetEntryExport(Long64_t entry, Int_t getall, TClonesArray *list, Int_t n);
@@ -185,6 +200,7 @@ public:
    virtual Bool_t    GetMakeClass() const;
    TBranch          *GetMother() const;
    TBranch          *GetSubBranch(const TBranch *br) const;
+   Bool_t            HasBasketMinMax() const {return fBasketMin != 0;}
    Bool_t            IsAutoDelete() const;
    Bool_t            IsFolder() const;
    virtual void      KeepCircular(Long64_t maxEntries);
@@ -196,12 +212,15 @@ public:
    virtual void      ResetAfterMerge(TFileMergeInfo *);
    virtual void      ResetAddress();
    virtual void      ResetReadEntry() {fReadEntry = -1;}
+           void      SampleCompressionDictionary(const char *data, Int_t len);
    virtual void      SetAddress(void *add);
    virtual void      SetObject(void *objadd);
    virtual void      SetAutoDelete(Bool_t autodel=kTRUE);
+   virtual void      SetBasketMinMax(Bool_t record=kTRUE);
    virtual void      SetBasketSize(Int_t buffsize);
    virtual void      SetBufferAddress(TBuffer *entryBuffer);
    void              SetCompressionAlgorithm(Int_t algorithm=0);
+   void              SetCompressionDictionarySize(Int_t size=16384);
    void              SetCompressionLevel(Int_t level=1);
    void              SetCompressionSettings(Int_t settings=1);
    virtual void      SetEntries(Long64_t entries);
@@ -219,7 +238,7 @@ public:
 
    static  void      ResetCount();
 
-   ClassDef(TBranch,12);  //Branch descriptor
+   ClassDef(TBranch,14);  //Branch descriptor
 };
 
 //______________________________________________________________________________
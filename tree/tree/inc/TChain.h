@@ -27,6 +27,7 @@
 
 class TFile;
 class TBrowser;
+class TChainNextFile;
 class TCut;
 class TEntryList;
 class TEventList;
@@ -45,6 +46,8 @@ protected:
    TObjArray   *fFiles;            //-> List of file names containing the trees (TChainElement, owned)
    TList       *fStatus;           //-> List of active/inactive branches (TChainElement, owned)
    TChain      *fProofChain;       //! chain proxy when going to be processed by PROOF
+   Bool_t       fPrefetchNextFile; //! If true, open the next file in the background (see SetPrefetchNextFile)
+   TChainNextFile *fNextFile;      //! Background opening of the next file
 
 private:
    TChain(const TChain&);            // not implemented
@@ -53,6 +56,8 @@ private:
 protected:
    void InvalidateCurrentTree();
    void ReleaseChainProof();
+   void StartNextFile();
+   void StopNextFile();
 
 public:
    // TChain constants
@@ -91,6 +96,7 @@ public:
    virtual Long64_t  GetChainEntryNumber(Long64_t entry) const;
    virtual TClusterIterator GetClusterIterator(Long64_t firstentry);
            Int_t     GetNtrees() const { return fNtrees; }
+           Bool_t    GetPrefetchNextFile() const { return fPrefetchNextFile; }
    virtual Long64_t  GetEntries() const;
    virtual Long64_t  GetEntries(const char *sel) { return TTree::GetEntries(sel); }
    virtual Int_t     GetEntry(Long64_t entry=0, Int_t getall=0);
@@ -165,6 +171,7 @@ public:
    virtual void      SetEventList(TEventList *evlist);
    virtual void      SetMakeClass(Int_t make) { TTree::SetMakeClass(make); if (fTree) fTree->SetMakeClass(make);}
    virtual void      SetPacketSize(Int_t size = 100);
+   virtual void      SetPrefetchNextFile(Bool_t prefetch = kTRUE);
    virtual void      SetProof(Bool_t on = kTRUE, Bool_t refresh = kFALSE, Bool_t gettreeheader = kFALSE);
    virtual void      SetWeight(Double_t w=1, Option_t *option="");
    virtual void      UseCache(Int_t maxCacheSize = 10, Int_t pageSize = 0);
@@ -50,6 +50,8 @@ class TEntryList: public TNamed
    TDirectory      *fDirectory;   //! Pointer to directory holding this tree
    Bool_t           fReapply;     //  If true, TTree::Draw will 'reapply' the original cut
 
+   static Bool_t    fgWriteRuns;  //! If true, the blocks stored as runs are written as runs
+
    void             GetFileName(const char *filename, TString &fn, Bool_t * = 0);
 
  public:
@@ -79,6 +81,8 @@ class TEntryList: public TNamed
    virtual const char *GetFileName() const { return fFileName.Data(); }
    virtual Int_t       GetTreeNumber() const { return fTreeNumber; }
    virtual Bool_t      GetReapplyCut() const { return fReapply; };
+   static  Bool_t      GetWriteRuns() { return fgWriteRuns; }
+   virtual void        Intersect(const TEntryList *elist);
    virtual Int_t       Merge(TCollection *list);
    
    virtual Long64_t    Next();
@@ -103,6 +107,7 @@ class TEntryList: public TNamed
    static  Int_t       Relocate(const char *fn,
                                 const char *newroot, const char *oldroot = 0, const char *enlnm = 0);
    static  Int_t       Scan(const char *fn, TList *roots);
+   static  void        SetWriteRuns(Bool_t write = kTRUE);
 
 // Preventing warnings with -Weffc++ in GCC since the overloading of the || operator was a design choice.
 #if (__GNUC__ * 10000 + __GNUC_MINOR__ * 100 + __GNUC_PATCHLEVEL__) >= 40600
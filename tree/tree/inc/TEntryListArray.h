@@ -79,6 +79,7 @@ public:
    virtual void        SetTree(const TTree *tree) {
       TEntryList::SetTree(tree);   // will take treename and filename from the tree and call the method above
    }
+   virtual void        Intersect(const TEntryList *elist);
    virtual void        Subtract(const TEntryList *elist);
    virtual TList* GetSubLists() const {
       return fSubLists;
@@ -168,6 +169,7 @@ public:
    virtual void        SetTree(const TTree *tree) {
       TEntryList::SetTree(tree);   // will take treename and filename from the tree and call the method above
    }
+   virtual void        Intersect(const TEntryList *elist);
    virtual void        Subtract(const TEntryList *elist);
    virtual TList* GetSubLists() const {
       return fSubLists;
@@ -14,11 +14,13 @@
 //
 // Used internally in TEntryList to store the entry numbers. 
 //
-// There are 2 ways to represent entry numbers in a TEntryListBlock:
+// There are 3 ways to represent entry numbers in a TEntryListBlock:
 // 1) as bits, where passing entry numbers are assigned 1, not passing - 0
 // 2) as a simple array of entry numbers
-// In both cases, a UShort_t* is used. The second option is better in case
-// less than 1/16 of entries passes the selection, and the representation can be
+// 3) as runs, a sorted array of (first, last) pairs of consecutive passing entries
+// In all cases, a UShort_t* is used. The second option is better in case
+// less than 1/16 of entries passes the selection, the third one when the passing
+// entries come in long runs, and the representation can be
 // changed by calling OptimizeStorage() function. 
 // When the block is being filled, it's always stored as bits, and the OptimizeStorage()
 // function is called by TEntryList when it starts filling the next block. If
@@ -29,6 +31,9 @@
 // - Merge() - adds all entries from one block to the other. If the first block 
 //             uses array representation, it's changed to bits representation only
 //             if the total number of passing entries is still less than kBlockSize
+// - Intersect() - keeps only the entries also contained in the other block
+// - Subtract()  - removes the entries contained in the other block
+//             Merge(), Intersect() and Subtract() work on 16 entries at a time.
 // - GetEntry(n) - returns n-th non-zero entry.
 // - Next()      - return next non-zero entry. In case of representation 1), Next()
 //                 is faster than GetEntry()
@@ -49,14 +54,18 @@ class TEntryListBlock:public TObject
                          //not in the entry list
    Int_t    fN;          //size of fIndices for I/O  =fNPassed for list, fBlockSize for bits
    UShort_t *fIndices;   //[fN]
-   Int_t    fType;       //0 - bits, 1 - list
+   Int_t    fType;       //0 - bits, 1 - list, 2 - runs
    Bool_t   fPassing;    //1 - stores entries that belong to the list
                          //0 - stores entries that don't belong to the list
    UShort_t fCurrent;    //! to fasten  Contains() in list mode
    Int_t    fLastIndexQueried; //! to optimize GetEntry() in a loop
    Int_t    fLastIndexReturned; //! to optimize GetEntry() in a loop
 
-   void Transform(Bool_t dir, UShort_t *indexnew);
+   void  Transform(Bool_t dir, UShort_t *indexnew);
+   void  TransformToRuns(Int_t nruns);
+   Int_t FindRun(Int_t entry) const;
+   void  GetBits(UShort_t *bits) const;
+   Int_t Combine(TEntryListBlock *block, Int_t op);
 
  public:
 
@@ -69,8 +78,10 @@ class TEntryListBlock:public TObject
    Bool_t  Enter(Int_t entry);
    Bool_t  Remove(Int_t entry);
    Int_t   Contains(Int_t entry);
-   void    OptimizeStorage();
+   void    OptimizeStorage(Bool_t runs = kTRUE);
    Int_t   Merge(TEntryListBlock *block);
+   Int_t   Intersect(TEntryListBlock *block);
+   Int_t   Subtract(TEntryListBlock *block);
    Int_t   Next();
    Int_t   GetEntry(Int_t entry);
    void    ResetIndices() {fLastIndexQueried = -1, fLastIndexReturned = -1;}
@@ -79,7 +90,7 @@ class TEntryListBlock:public TObject
    virtual void Print(const Option_t *option = "") const;
    void    PrintWithShift(Int_t shift) const;
 
-   ClassDef(TEntryListBlock, 1) //Used internally in TEntryList to store the entry numbers
+   ClassDef(TEntryListBlock, 2) //Used internally in TEntryList to store the entry numbers
 
 };
 
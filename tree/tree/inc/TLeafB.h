@@ -48,6 +48,7 @@ public:
    virtual void    Import(TClonesArray* list, Int_t n);
    virtual void    PrintValue(Int_t i = 0) const;
    virtual void    ReadBasket(TBuffer&);
+   virtual Bool_t  ReadBasketBulk(TBuffer &b, void *values, Int_t n);
    virtual void    ReadBasketExport(TBuffer&, TClonesArray* list, Int_t n);
    virtual void    ReadValue(std::istream &s, Char_t delim = ' ');
    virtual void    SetAddress(void* addr = 0);
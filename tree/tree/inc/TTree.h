@@ -143,6 +143,8 @@ protected:
 
    static Int_t     fgBranchStyle;      //  Old/New branch style
    static Long64_t  fgMaxTreeSize;      //  Maximum size of a file containg a Tree
+   static Int_t     fgProcessThreads;   //  Number of threads used by Process, 0 for one per core
+   static Int_t     fgFlushThreads;     //  Number of threads compressing the baskets in FlushBaskets, 0 for one per core
 
 private:
    TTree(const TTree& tt);              // not implemented
@@ -182,6 +184,7 @@ protected:
    friend class TFriendLock;
    // So that the index class can use TFriendLock:
    friend class TTreeIndex;
+   friend class TTreeHashIndex;
    friend class TChainIndex;
    // So that the TTreeCloner can access the protected interfaces
    friend class TTreeCloner;
@@ -351,6 +354,7 @@ public:
    virtual TLeaf          *FindLeaf(const char* name);
    virtual Int_t           Fit(const char* funcname, const char* varexp, const char* selection = "", Option_t* option = "", Option_t* goption = "", Long64_t nentries = 1000000000, Long64_t firstentry = 0); // *MENU*
    virtual Int_t           FlushBaskets() const;
+   static  Int_t           GetFlushThreads();
    virtual const char     *GetAlias(const char* aliasName) const;
    virtual Long64_t        GetAutoFlush() const {return fAutoFlush;}
    virtual Long64_t        GetAutoSave()  const {return fAutoSave;}
@@ -403,6 +407,7 @@ public:
    virtual Double_t        GetMaximum(const char* columname);
    static  Long64_t        GetMaxTreeSize();
    virtual Long64_t        GetMaxVirtualSize() const { return fMaxVirtualSize; }
+   static  Int_t           GetProcessThreads();
    virtual Double_t        GetMinimum(const char* columname);
    virtual Int_t           GetNbranches() { return fBranches.GetEntriesFast(); }
    TObject                *GetNotify() const { return fNotify; }
@@ -514,6 +519,7 @@ public:
    virtual void            SetCacheLearnEntries(Int_t n=10);
    virtual void            SetChainOffset(Long64_t offset = 0) { fChainOffset=offset; }
    virtual void            SetCircular(Long64_t maxEntries);
+   virtual void            SetCompressionDictionarySize(const char* bname, Int_t size = 16384);
    virtual void            SetDebug(Int_t level = 1, Long64_t min = 0, Long64_t max = 9999999); // *MENU*
    virtual void            SetDefaultEntryOffsetLen(Int_t newdefault, Bool_t updateExisting = kFALSE);
    virtual void            SetDirectory(TDirectory* dir);
@@ -530,6 +536,8 @@ public:
    virtual void            SetNotify(TObject* obj) { fNotify = obj; }
    virtual void            SetObject(const char* name, const char* title);
    virtual void            SetParallelUnzip(Bool_t opt=kTRUE, Float_t RelSize=-1);
+   static  void            SetFlushThreads(Int_t nthreads = 0);
+   static  void            SetProcessThreads(Int_t nthreads = 0);
    virtual void            SetScanField(Int_t n = 50) { fScanField = n; } // *MENU*
    virtual void            SetTimerInterval(Int_t msec = 333) { fTimerInterval=msec; }
    virtual void            SetTreeIndex(TVirtualIndex*index);
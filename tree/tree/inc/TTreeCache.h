@@ -30,6 +30,7 @@
 
 class TTree;
 class TBranch;
+class THashList;
 
 class TTreeCache : public TFileCacheRead {
 
@@ -59,7 +60,20 @@ protected:
    Bool_t          fReadDirectionSet; //! read direction established
    Bool_t          fEnabled;     //! cache enabled for cached reading
    EPrefillType    fPrefillType; // Whether a prefilling is enabled (and if applicable which type)
+   TString         fProfileName; //! file of the access profile, "" if not used
+   THashList      *fProfileRead; //! names of the branches read since the profile was loaded or saved
+   Long64_t        fClusterBytes;//! largest size of a cluster of the cached branches seen so far
    static  Int_t   fgLearnEntries; // number of entries used for learning mode
+   static  TString fgProfileDir;   // directory of the access profiles, "" if not used
+   static  Bool_t  fgProfileDirSet;// true once fgProfileDir has been initialised
+   static  Int_t   fgAutoResize;   // 1 to adapt the cache size to the clusters, 0 otherwise, -1 to take it from rootrc
+   static  Int_t   fgMaxAutoSize;  // maximum size of an adapted cache
+
+   void            AdaptBufferSize(Long64_t first, Long64_t next);
+   TString         GetProfileName() const;
+   Bool_t          LoadProfile();
+   void            SaveProfile(const TList *branches) const;
+   void            SetBufferSizeMin(Long64_t size);
 
 private:
    TTreeCache(const TTreeCache &);            //this class cannot be copied
@@ -81,7 +95,13 @@ public:
    Double_t             GetEfficiencyRel() const;
    virtual Int_t        GetEntryMin() const {return fEntryMin;}
    virtual Int_t        GetEntryMax() const {return fEntryMax;}
+   Long64_t             GetClusterBytes() const {return fClusterBytes;}
+   Int_t                GetNReadOk() const {return fNReadOk;}
+   Int_t                GetNReadMiss() const {return fNReadMiss;}
+   Int_t                GetNReadPref() const {return fNReadPref;}
    static Int_t         GetLearnEntries();
+   static Bool_t        GetAutoResize();
+   static const char   *GetProfileDir();
    virtual EPrefillType GetLearnPrefill() const {return fPrefillType;}
    TTree               *GetTree() const;
    virtual Bool_t       IsEnabled() const {return fEnabled;}
@@ -99,9 +119,12 @@ public:
    virtual void         SetFile(TFile *file);
    virtual void         SetLearnPrefill(EPrefillType type = kNoPrefill);
    static void          SetLearnEntries(Int_t n = 10);
+   static void          SetAutoResize(Bool_t resize = kTRUE, Int_t maxsize = 0);
+   static void          SetProfileDir(const char *dir);
    void                 StartLearningPhase();
    virtual void         StopLearningPhase();
    virtual void         UpdateBranches(TTree *tree);
+   void                 UpdateProfile(TBranch *b);
 
    ClassDef(TTreeCache,2)  //Specialization of TFileCacheRead for a TTree
 };
@@ -33,10 +33,12 @@
 
 class TTree;
 class TBranch;
-class TThread;
 class TCondition;
 class TBasket;
 class TMutex;
+class TTreeCacheUnzipTask;
+struct TTreeCacheUnzipBlock;
+template <class aTask, class aParam> class TThreadPool;
 
 class TTreeCacheUnzip : public TTreeCache {
 public:
@@ -47,9 +49,11 @@ public:
 protected:
 
    // Members for paral. managing
-   TThread    *fUnzipThread[10];
+   TThreadPool<TTreeCacheUnzipTask, TTreeCacheUnzipBlock> *fUnzipPool; //! Pool of threads unzipping the baskets
+   TTreeCacheUnzipTask *fUnzipTask;    //! Task executed by the pool for each block
+   Int_t       fNUnzipThreads;         // Number of threads in the pool
+   Int_t       fNPending;              // Number of blocks queued or being unzipped by the pool
    Bool_t      fActiveThread;          // Used to terminate gracefully the unzippers
-   TCondition *fUnzipStartCondition;   // Used to signal the threads to start.
    TCondition *fUnzipDoneCondition;    // Used to wait for an unzip tour to finish. Gives the Async feel.
    Bool_t      fParallel;              // Indicate if we want to activate the parallelism (for this instance)
    Bool_t      fAsyncReading;
@@ -72,6 +76,7 @@ protected:
    Long64_t    fUnzipBufferSize;  //!  Max Size for the ready unzipped blocks (default is 2*fBufferSize)
 
    static Double_t fgRelBuffSize; // This is the percentage of the TTreeCacheUnzip that will be used
+   static Int_t    fgNThreads;    // Number of unzipping threads, 0 means one per core
 
    // Members use to keep statistics
    Int_t       fNUnzip;           //! number of blocks that were unzipped
@@ -92,6 +97,7 @@ private:
    void  Init();
    Int_t StartThreadUnzip(Int_t nthreads);
    Int_t StopThreadUnzip();
+   void  ScheduleBlocks();
 
 public:
    TTreeCacheUnzip();
@@ -109,13 +115,12 @@ public:
    static EParUnzipMode GetParallelUnzip();
    static Bool_t        IsParallelUnzip();
    static Int_t         SetParallelUnzip(TTreeCacheUnzip::EParUnzipMode option = TTreeCacheUnzip::kEnable);
+   static Int_t         GetUnzipThreads();
+   static void          SetUnzipThreads(Int_t nthreads);
 
    Bool_t               IsActiveThread();
    Bool_t               IsQueueEmpty();
 
-   void                 WaitUnzipStartSignal();
-   void                 SendUnzipStartSignal(Bool_t broadcast);
-
    // Unzipping related methods
    Int_t          GetRecordHeader(char *buf, Int_t maxbytes, Int_t &nbytes, Int_t &objlen, Int_t &keylen);
    virtual void   ResetCache();
@@ -123,7 +128,7 @@ public:
    void           SetUnzipBufferSize(Long64_t bufferSize);
    static void    SetUnzipRelBufferSize(Float_t relbufferSize);
    Int_t          UnzipBuffer(char **dest, char *src);
-   Int_t          UnzipCache(Int_t &startindex, Int_t &locbuffsz, char *&locbuff);
+   Int_t          UnzipCache(Int_t index, Int_t cycle);
 
    // Methods to get stats
    Int_t  GetNUnzip() { return fNUnzip; }
@@ -132,8 +137,6 @@ public:
 
    void Print(Option_t* option = "") const;
 
-   // static members
-   static void* UnzipLoop(void *arg);
    ClassDef(TTreeCacheUnzip,0)  //Specialization of TTreeCache for parallel unzipping
 };
 
@@ -45,6 +45,7 @@ class TTreeCloner {
    TTree     *fFromTree;
    TTree     *fToTree;
    Option_t  *fMethod;
+   Bool_t     fRecompress;       //True if the baskets are compressed again with the settings of the output branches.
    TObjArray  fFromBranches;
    TObjArray  fToBranches;
 
@@ -113,8 +114,10 @@ public:
    Bool_t Exec();
    Bool_t IsValid() { return fIsValid; }
    Bool_t NeedConversion() { return fNeedConversion; }
+   Bool_t IsRecompressing() const { return fRecompress; }
    void   SortBaskets();
    void   WriteBaskets();
+   Bool_t WriteRecompressedBaskets();
 
    ClassDef(TTreeCloner,0); // helper used for the fast cloning of TTrees.
 };
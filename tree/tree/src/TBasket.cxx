@@ -32,8 +32,8 @@
   #define R__likely(expr) expr
 #endif
 
-extern "C" void R__zipMultipleAlgorithm(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, int compressionAlgorithm);
-extern "C" void R__unzip(Int_t *nin, UChar_t *bufin, Int_t *lout, char *bufout, Int_t *nout);
+extern "C" void R__zipDict(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, int compressionAlgorithm, const char *dict, int dictsize);
+extern "C" void R__unzipDict(Int_t *nin, UChar_t *bufin, Int_t *lout, char *bufout, Int_t *nout, const char *dict, Int_t dictsize);
 extern "C" int R__unzip_header(Int_t *nin, UChar_t *bufin, Int_t *lout);
 
 const Int_t  kMAXBUF = 0xFFFFFF;
@@ -49,7 +49,7 @@ ClassImp(TBasket)
 //
 
 //_______________________________________________________________________
-TBasket::TBasket() : fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0)
+TBasket::TBasket() : fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0), fCompressedNbytes(-1)
 {
    // Default contructor.
 
@@ -66,7 +66,7 @@ TBasket::TBasket() : fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLa
 }
 
 //_______________________________________________________________________
-TBasket::TBasket(TDirectory *motherDir) : TKey(motherDir),fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0)
+TBasket::TBasket(TDirectory *motherDir) : TKey(motherDir),fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0), fCompressedNbytes(-1)
 {
    // Constructor used during reading.
    fDisplacement  = 0;
@@ -83,7 +83,7 @@ TBasket::TBasket(TDirectory *motherDir) : TKey(motherDir),fCompressedBufferRef(0
 
 //_______________________________________________________________________
 TBasket::TBasket(const char *name, const char *title, TBranch *branch) : 
-   TKey(branch->GetDirectory()),fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0)
+   TKey(branch->GetDirectory()),fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0), fCompressedNbytes(-1)
 {
    // Basket normal constructor, used during writing.
 
@@ -386,7 +386,12 @@ static inline TBuffer* R__InitializeReadBasketBuffer(TBuffer* bufferRef, Int_t l
    if (R__likely(bufferRef)) {
       bufferRef->SetReadMode();
       Int_t curBufferSize = bufferRef->BufferSize();
-      if (curBufferSize < len) {
+      if (R__unlikely(!bufferRef->TestBit(TBuffer::kIsOwner))) {
+         // The memory was lent by the unzip cache or is the file memory
+         // mapping; it must be neither expanded nor overwritten.
+         Int_t newsize = Int_t(len*1.05);
+         bufferRef->SetBuffer(new char[newsize], newsize, kTRUE);
+      } else if (curBufferSize < len) {
          // Experience shows that giving 5% "wiggle-room" decreases churn.
          bufferRef->Expand(Int_t(len*1.05));
       }
@@ -452,6 +457,37 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
       }
    }
 
+   // If the file is memory mapped, decompress straight from the mapping and
+   // use a basket that is not compressed in place.
+   if (!pf && file->IsMapped() && !TestBit(TBufferFile::kNotDecompressed)) {
+      rawCompressedBuffer = (char*)file->GetMappedBuffer(pos, len);
+      if (rawCompressedBuffer) {
+         fBranch->GetTree()->IncrementTotalBuffers(-fBufferSize);
+         {
+            TBufferFile header(TBuffer::kRead, len, rawCompressedBuffer, kFALSE);
+            header.SetParent(file);
+            Streamer(header);
+         }
+         if (IsZombie()) {
+            return 1;
+         }
+         oldCase = OLD_CASE_EXPRESSION;
+         if (fObjlen > fNbytes-fKeylen || oldCase) {
+            goto Unzip;
+         }
+         if (fBufferRef) {
+            fBufferRef->SetBuffer(rawCompressedBuffer, len, kFALSE);
+            fBufferRef->SetReadMode();
+            fBufferRef->Reset();
+         } else {
+            fBufferRef = new TBufferFile(TBuffer::kRead, len, rawCompressedBuffer, kFALSE);
+         }
+         fBufferRef->SetParent(file);
+         fBuffer = fBufferRef->Buffer();
+         goto AfterBuffer;
+      }
+   }
+
    // Determine which buffer to use, so that we can avoid a memcpy in case of 
    // the basket was not compressed.
    TBuffer* readBufferRef;
@@ -523,6 +559,7 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
       }
    }
 
+Unzip:
    // Initialize buffer to hold the uncompressed data
    // Note that in previous versions we didn't allocate buffers until we verified
    // the zip headers; this is no longer beforehand as the buffer lifetime is scoped
@@ -564,7 +601,8 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
             goto AfterBuffer;
          }
 
-         R__unzip(&nin, rawCompressedObjectBuffer, &nbuf, rawUncompressedObjectBuffer, &nout);
+         R__unzipDict(&nin, rawCompressedObjectBuffer, &nbuf, rawUncompressedObjectBuffer, &nout,
+                      fBranch->GetCompressionDictionary().GetArray(), fBranch->GetCompressionDictionary().GetSize());
          if (!nout) break;
          noutot += nout;
          nintot += nin;
@@ -581,7 +619,7 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
       }
       len = fObjlen+fKeylen;
       if (R__unlikely(gPerfStats)) {
-         gPerfStats->FileUnzipEvent(file,pos,start,nintot,fObjlen);
+         gPerfStats->BasketUnzipEvent(fBranch,file,pos,start,nintot,fObjlen);
       }
    } else {
       // Nothing is compressed - copy over wholesale.
@@ -636,6 +674,94 @@ Int_t TBasket::ReadBasketBytes(Long64_t pos, TFile *file)
    return fNbytes;
 }
 
+//_______________________________________________________________________
+Int_t TBasket::Recompress(const TBranch *from, const TBranch *to)
+{
+   // Compress again the raw basket loaded by LoadBasketBuffers, which was
+   // written by the branch from, with the compression settings and dictionary
+   // of the branch to. The content of the basket (the data of the entries
+   // followed by the table of their offsets) is neither unstreamed nor
+   // modified, only the compressed payload and fNbytes change.
+   // This function is called by TTreeCloner, possibly for several baskets
+   // concurrently: it only uses the buffer of this basket.
+   // The function returns 0 in case of success, 1 in case of error (the
+   // basket is then left as it was read).
+
+   if (TestBit(TBufferFile::kNotDecompressed)) {
+      // Stored as is, whatever the compression settings.
+      return 0;
+   }
+
+   Int_t nin = fNbytes - fKeylen;
+   char *objbuf = fBufferRef->Buffer() + fKeylen;
+   char *raw = objbuf;
+   if (fObjlen > nin) {
+      const TArrayC &dict = from->GetCompressionDictionary();
+      raw = new char[fObjlen];
+      UChar_t *bufcur = (UChar_t*)objbuf;
+      Int_t nzip, nbuf, nout = 0, noutot = 0;
+      while (noutot < fObjlen) {
+         if (R__unzip_header(&nzip, bufcur, &nbuf) != 0 || nbuf > fObjlen - noutot) break;
+         R__unzipDict(&nzip, bufcur, &nbuf, raw + noutot, &nout, dict.GetArray(), dict.GetSize());
+         if (!nout) break;
+         noutot += nout;
+         bufcur += nzip;
+      }
+      if (noutot != fObjlen) {
+         Error("Recompress", "Cannot decompress the basket of %s (fObjlen = %d, noutot = %d)",
+               from->GetName(), fObjlen, noutot);
+         delete [] raw;
+         return 1;
+      }
+   }
+
+   // Same as in CompressBuffer.
+   char *zip = 0;
+   Int_t nout = fObjlen;
+   Int_t cxlevel = to->GetCompressionLevel();
+   if (cxlevel > 0) {
+      const TArrayC &dict = to->GetCompressionDictionary();
+      Int_t nbuffers = 1 + (fObjlen - 1) / kMAXBUF;
+      zip = new char[fObjlen + 9 * nbuffers + 28];
+      char *src = raw;
+      char *bufcur = zip;
+      Int_t noutot = 0;
+      for (Int_t i = 0; i < nbuffers; ++i) {
+         Int_t bufmax = (i == nbuffers - 1) ? fObjlen - i * kMAXBUF : kMAXBUF;
+         Int_t nzip = 0;
+         R__zipDict(cxlevel, &bufmax, src, &bufmax, bufcur, &nzip, to->GetCompressionAlgorithm(),
+                    dict.GetArray(), dict.GetSize());
+         if (nzip == 0 || noutot + nzip >= fObjlen) {
+            // Not worth it, store the basket uncompressed.
+            noutot = fObjlen;
+            delete [] zip;
+            zip = 0;
+            break;
+         }
+         bufcur += nzip;
+         noutot += nzip;
+         src    += kMAXBUF;
+      }
+      nout = noutot;
+   }
+
+   const char *payload = zip ? zip : raw;
+   if (payload != objbuf) {
+      if (fBufferRef->BufferSize() < fKeylen + nout) {
+         Bool_t reading = fBufferRef->IsReading();
+         fBufferRef->SetWriteMode();
+         fBufferRef->Expand(fKeylen + nout);
+         if (reading) fBufferRef->SetReadMode();
+      }
+      memcpy(fBufferRef->Buffer() + fKeylen, payload, nout);
+   }
+   fNbytes = fKeylen + nout;
+
+   if (raw != objbuf) delete [] raw;
+   delete [] zip;
+   return 0;
+}
+
 //_______________________________________________________________________
 void TBasket::Reset()
 {
@@ -646,6 +772,14 @@ void TBasket::Reset()
    // Name, Title, fClassName, fBranch 
    // stay the same.
 
+   // A buffer lent by the unzip cache or the file memory mapping can not
+   // be written to: give the basket a buffer of its own.
+   if (!fBufferRef->TestBit(TBuffer::kIsOwner)) {
+      Int_t size = fBranch->GetBasketSize();
+      fBufferRef->SetWriteMode();
+      fBufferRef->SetBuffer(new char[size], size, kTRUE);
+   }
+
    // Downsize the buffer if needed.
    Int_t curSize = fBufferRef->BufferSize();
    // fBufferLen at this point is already reset, so use indirect measurements
@@ -683,6 +817,7 @@ void TBasket::Reset()
    }
    
    TKey::Reset();
+   fCompressedNbytes = -1;
 
    Int_t newNevBufSize = fBranch->GetEntryOffsetLen();
    if (newNevBufSize==0) {
@@ -894,45 +1029,20 @@ void TBasket::Update(Int_t offset, Int_t skipped)
 }
 
 //_______________________________________________________________________
-Int_t TBasket::WriteBuffer()
+Int_t TBasket::CompressBuffer(TFile *file, Bool_t ownBuffer)
 {
-   // Write buffer of this basket on the current file.
+   // Transfer the fEntryOffset table at the end of the buffer of this basket
+   // and compress the buffer into fCompressedBufferRef.
    //
-   // The function returns the number of bytes committed to the memory.
-   // If a write error occurs, the number of bytes returned is -1.
-   // If no data are written, the number of bytes returned is 0.
+   // The function returns the number of bytes of the object to be written,
+   // i.e. the compressed size or fObjlen if the buffer could not be compressed
+   // (in which case fBuffer points to the uncompressed buffer), and -1 in case
+   // of error.
    //
-
-   const Int_t kWrite = 1;
-
-   TFile *file = fBranch->GetFile(kWrite);
-   if (!file) return 0;
-   if (!file->IsWritable()) { 
-      return -1;
-   }
-   fMotherDir = file; // fBranch->GetDirectory();
-
-   if (R__unlikely(fBufferRef->TestBit(TBufferFile::kNotDecompressed))) {
-      // Read the basket information that was saved inside the buffer.
-      Bool_t writing = fBufferRef->IsWriting();
-      fBufferRef->SetReadMode();
-      fBufferRef->SetBufferOffset(0);
-
-      Streamer(*fBufferRef);
-      if (writing) fBufferRef->SetWriteMode();
-      Int_t nout = fNbytes - fKeylen;
-
-      fBuffer = fBufferRef->Buffer();
-
-      Create(nout,file);
-      fBufferRef->SetBufferOffset(0);
-      fHeaderOnly = kTRUE;
-
-      Streamer(*fBufferRef);         //write key itself again
-      int nBytes = WriteFileKeepBuffer();
-      fHeaderOnly = kFALSE;
-      return nBytes>0 ? fKeylen+nout : -1;
-   }
+   // The file is not modified, hence baskets can be compressed concurrently
+   // provided they do not share the compressed buffer: with ownBuffer the
+   // basket stops using the buffer shared by the baskets of the tree and the
+   // result is kept until the next call to WriteBuffer (see TTree::FlushBaskets).
 
    // Transfer fEntryOffset table at the end of fBuffer.
    fLast = fBufferRef->Length();
@@ -955,13 +1065,17 @@ Int_t TBasket::WriteBuffer()
    lbuf       = fBufferRef->Length();
    fObjlen    = lbuf - fKeylen;
 
-   fHeaderOnly = kTRUE;
-   fCycle = fBranch->GetWriteBasket();
    Int_t cxlevel = fBranch->GetCompressionLevel();
    Int_t cxAlgorithm = fBranch->GetCompressionAlgorithm();
-   if (cxlevel > 0) {
+   if (cxlevel <= 0) {
+      fBuffer = fBufferRef->Buffer();
+      nout = fObjlen;
+   } else {
       Int_t nbuffers = 1 + (fObjlen - 1) / kMAXBUF;
       Int_t buflen = fKeylen + fObjlen + 9 * nbuffers + 28; //add 28 bytes in case object is placed in a deleted gap
+      if (ownBuffer && !fOwnsCompressedBuffer) {
+         fCompressedBufferRef = 0;
+      }
       InitializeCompressedBuffer(buflen, file);
       if (!fCompressedBufferRef) {
          Warning("WriteBuffer", "Unable to allocate the compressed buffer");
@@ -971,13 +1085,14 @@ Int_t TBasket::WriteBuffer()
       fBuffer = fCompressedBufferRef->Buffer();
       char *objbuf = fBufferRef->Buffer() + fKeylen;
       char *bufcur = &fBuffer[fKeylen];
+      const TArrayC &dict = fBranch->GetCompressionDictionary();
       noutot = 0;
       nzip   = 0;
       for (Int_t i = 0; i < nbuffers; ++i) {
          if (i == nbuffers - 1) bufmax = fObjlen - nzip;
          else bufmax = kMAXBUF;
          //compress the buffer
-         R__zipMultipleAlgorithm(cxlevel, &bufmax, objbuf, &bufmax, bufcur, &nout, cxAlgorithm);
+         R__zipDict(cxlevel, &bufmax, objbuf, &bufmax, bufcur, &nout, cxAlgorithm, dict.GetArray(), dict.GetSize());
 
          // test if buffer has really been compressed. In case of small buffers 
          // when the buffer contains random data, it may happen that the compressed
@@ -987,39 +1102,93 @@ Int_t TBasket::WriteBuffer()
             // We used to delete fBuffer here, we no longer want to since
             // the buffer (held by fCompressedBufferRef) might be re-used later.
             fBuffer = fBufferRef->Buffer();
-            Create(fObjlen,file);
-            fBufferRef->SetBufferOffset(0);
-
-            Streamer(*fBufferRef);         //write key itself again
             if ((nout+fKeylen)>buflen) {
                Warning("WriteBuffer","Possible memory corruption due to compression algorithm, wrote %d bytes past the end of a block of %d bytes. fNbytes=%d, fObjLen=%d, fKeylen=%d",
                   (nout+fKeylen-buflen),buflen,fNbytes,fObjlen,fKeylen);
             }
-            goto WriteFile;
+            break;
          }
          bufcur += nout;
          noutot += nout;
          objbuf += kMAXBUF;
          nzip   += kMAXBUF;
       }
-      nout = noutot;
-      Create(noutot,file);
+      if (fBuffer != fBufferRef->Buffer()) nout = noutot;
+   }
+   if (ownBuffer) fCompressedNbytes = nout;
+   return nout;
+}
+
+//_______________________________________________________________________
+Int_t TBasket::WriteBuffer()
+{
+   // Write buffer of this basket on the current file.
+   //
+   // The function returns the number of bytes committed to the memory.
+   // If a write error occurs, the number of bytes returned is -1.
+   // If no data are written, the number of bytes returned is 0.
+   //
+
+   const Int_t kWrite = 1;
+
+   TFile *file = fBranch->GetFile(kWrite);
+   if (!file) return 0;
+   if (!file->IsWritable()) { 
+      return -1;
+   }
+   fMotherDir = file; // fBranch->GetDirectory();
+
+   if (R__unlikely(fBufferRef->TestBit(TBufferFile::kNotDecompressed))) {
+      // Read the basket information that was saved inside the buffer.
+      Bool_t writing = fBufferRef->IsWriting();
+      fBufferRef->SetReadMode();
       fBufferRef->SetBufferOffset(0);
 
-      Streamer(*fBufferRef);         //write key itself again
-      memcpy(fBuffer,fBufferRef->Buffer(),fKeylen);
-   } else {
+      Streamer(*fBufferRef);
+      if (writing) fBufferRef->SetWriteMode();
+      Int_t nout = fNbytes - fKeylen;
+
       fBuffer = fBufferRef->Buffer();
-      Create(fObjlen,file);
+
+      Create(nout,file);
       fBufferRef->SetBufferOffset(0);
+      fHeaderOnly = kTRUE;
 
       Streamer(*fBufferRef);         //write key itself again
-      nout = fObjlen;
+      int nBytes = WriteFileKeepBuffer();
+      fHeaderOnly = kFALSE;
+      return nBytes>0 ? fKeylen+nout : -1;
+   }
+
+   // Use the result of CompressBuffer if it was called ahead of time.
+   Bool_t precompressed = fCompressedNbytes >= 0;
+   Int_t nout = precompressed ? fCompressedNbytes : CompressBuffer(file, kFALSE);
+   fCompressedNbytes = -1;
+   if (nout < 0) return -1;
+
+   fHeaderOnly = kTRUE;
+   fCycle = fBranch->GetWriteBasket();
+   Create(nout,file);
+   fBufferRef->SetBufferOffset(0);
+
+   Streamer(*fBufferRef);         //write key itself again
+   if (fBuffer != fBufferRef->Buffer()) {
+      memcpy(fBuffer,fBufferRef->Buffer(),fKeylen);
    }
 
-WriteFile:
    Int_t nBytes = WriteFileKeepBuffer();
    fHeaderOnly = kFALSE;
+
+   if (nBytes > 0 && fBranch->GetCompressionDictionarySize()) {
+      fBranch->SampleCompressionDictionary(fBufferRef->Buffer() + fKeylen, fLast - fKeylen);
+   }
+
+   if (precompressed && fOwnsCompressedBuffer && fBranch->GetTree()) {
+      // Go back to the compressed buffer shared by the baskets of the tree.
+      delete fCompressedBufferRef;
+      fCompressedBufferRef = fBranch->GetTree()->GetTransientBuffer(fBufferSize);
+      fOwnsCompressedBuffer = kFALSE;
+   }
    return nBytes>0 ? fKeylen+nout : -1;
 }
 
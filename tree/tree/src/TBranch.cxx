@@ -46,6 +46,27 @@ R__EXTERN TTree* gTree;
 
 Int_t TBranch::fgCount = 0;
 
+const Int_t kMaxDictionarySize    = 32768; // Size of the ZLIB window
+const Int_t kMaxDictionaryBaskets = 16;    // Baskets sampled at most to build a compression dictionary
+
+//______________________________________________________________________________
+static inline void R__SetEmptyRange(Double_t &min, Double_t &max)
+{
+   // Range of a basket not filled yet (see TBranch::SetBasketMinMax).
+
+   min = TMath::Infinity();
+   max = -TMath::Infinity();
+}
+
+//______________________________________________________________________________
+static inline void R__SetUnknownRange(Double_t &min, Double_t &max)
+{
+   // Range of a basket whose values were not recorded.
+
+   min = -TMath::Infinity();
+   max = TMath::Infinity();
+}
+
 
 #if (__GNUC__ >= 3) || defined(__INTEL_COMPILER)
 #if !defined(R__unlikely)
@@ -105,6 +126,8 @@ TBranch::TBranch()
 , fBasketBytes(0)
 , fBasketEntry(0)
 , fBasketSeek(0)
+, fBasketMin(0)
+, fBasketMax(0)
 , fTree(0)
 , fMother(0)
 , fParent(0)
@@ -114,6 +137,8 @@ TBranch::TBranch()
 , fEntryBuffer(0)
 , fBrowsables(0)
 , fSkipZip(kFALSE)
+, fDictionarySize(0)
+, fDictionaryBaskets(0)
 , fReadLeaves(&TBranch::ReadLeavesImpl)
 , fFillLeaves(&TBranch::FillLeavesImpl)
 {
@@ -151,6 +176,8 @@ TBranch::TBranch(TTree *tree, const char* name, void* address, const char* leafl
 , fBasketBytes(0)
 , fBasketEntry(0)
 , fBasketSeek(0)
+, fBasketMin(0)
+, fBasketMax(0)
 , fTree(tree)
 , fMother(0)
 , fParent(0)
@@ -160,6 +187,8 @@ TBranch::TBranch(TTree *tree, const char* name, void* address, const char* leafl
 , fEntryBuffer(0)
 , fBrowsables(0)
 , fSkipZip(kFALSE)
+, fDictionarySize(0)
+, fDictionaryBaskets(0)
 , fReadLeaves(&TBranch::ReadLeavesImpl)
 , fFillLeaves(&TBranch::FillLeavesImpl)
 {
@@ -253,6 +282,8 @@ TBranch::TBranch(TBranch *parent, const char* name, void* address, const char* l
 , fBasketBytes(0)
 , fBasketEntry(0)
 , fBasketSeek(0)
+, fBasketMin(0)
+, fBasketMax(0)
 , fTree(parent ? parent->GetTree() : 0)
 , fMother(parent ? parent->GetMother() : 0)
 , fParent(parent)
@@ -262,6 +293,8 @@ TBranch::TBranch(TBranch *parent, const char* name, void* address, const char* l
 , fEntryBuffer(0)
 , fBrowsables(0)
 , fSkipZip(kFALSE)
+, fDictionarySize(0)
+, fDictionaryBaskets(0)
 , fReadLeaves(&TBranch::ReadLeavesImpl)
 , fFillLeaves(&TBranch::FillLeavesImpl)
 {
@@ -420,6 +453,12 @@ TBranch::~TBranch()
    delete [] fBasketSeek;
    fBasketSeek  = 0;
 
+   delete [] fBasketMin;
+   fBasketMin = 0;
+
+   delete [] fBasketMax;
+   fBasketMax = 0;
+
    delete [] fBasketEntry;
    fBasketEntry = 0;
 
@@ -518,10 +557,16 @@ void TBranch::AddBasket(TBasket& b, Bool_t ondisk, Long64_t startEntry)
             fBasketEntry[j] = fBasketEntry[j-1];
             fBasketBytes[j] = fBasketBytes[j-1];
             fBasketSeek[j]  = fBasketSeek[j-1];
+            if (fBasketMin) {
+               fBasketMin[j] = fBasketMin[j-1];
+               fBasketMax[j] = fBasketMax[j-1];
+            }
          }
       }
    }
    fBasketEntry[where] = startEntry;
+   // The values of a basket copied as is are not known.
+   if (fBasketMin) R__SetUnknownRange(fBasketMin[where], fBasketMax[where]);
 
    if (ondisk) {
       fBasketBytes[where] = basket->GetNbytes();  // not for in mem
@@ -561,6 +606,7 @@ void TBranch::AddLastBasket(Long64_t startEntry)
 
    }
    fBasketEntry[where] = startEntry;
+   if (fBasketMin) R__SetEmptyRange(fBasketMin[where], fBasketMax[where]);
    fBaskets.AddAtAndExpand(0,fWriteBasket);
 }
 
@@ -698,6 +744,15 @@ void TBranch::ExpandBasketArrays()
                                                 newsize*sizeof(Long64_t),fMaxBaskets*sizeof(Long64_t));
    fBasketSeek   = (Long64_t*)TStorage::ReAlloc(fBasketSeek,
                                                 newsize*sizeof(Long64_t),fMaxBaskets*sizeof(Long64_t));
+   if (fBasketMin) {
+      fBasketMin = (Double_t*)TStorage::ReAlloc(fBasketMin,
+                                                newsize*sizeof(Double_t),fMaxBaskets*sizeof(Double_t));
+      fBasketMax = (Double_t*)TStorage::ReAlloc(fBasketMax,
+                                                newsize*sizeof(Double_t),fMaxBaskets*sizeof(Double_t));
+      for (Int_t i=fMaxBaskets;i<newsize;i++) {
+         R__SetEmptyRange(fBasketMin[i], fBasketMax[i]);
+      }
+   }
 
    fMaxBaskets   = newsize;
 
@@ -749,12 +804,14 @@ Int_t TBranch::Fill()
 
    if (fEntryBuffer) {
       nbytes = FillEntryBuffer(basket,buf,lnew);
+      if (fBasketMin) R__SetUnknownRange(fBasketMin[fWriteBasket], fBasketMax[fWriteBasket]);
    } else {
       Int_t lold = buf->Length();
       basket->Update(lold);
       ++fEntries;
       ++fEntryNumber;
       (this->*fFillLeaves)(*buf);
+      if (fBasketMin) FillBasketMinMax();
       if (buf->GetMapCount()) {
          // The map is used.
          ResetBit(TBranch::kDoNotUseBufferMap);
@@ -1104,6 +1161,7 @@ TBasket* TBranch::GetBasket(Int_t basketnumber)
    TFileCacheRead *pf = file->GetCacheRead(fTree);
    if (pf){
       if (pf->IsLearning()) pf->AddBranch(this);
+      else if (pf->IsProfileUsed()) ((TTreeCache*)pf)->UpdateProfile(this);
       if (fSkipZip) pf->SetSkipZip();
    }
 
@@ -1142,6 +1200,23 @@ Long64_t TBranch::GetBasketSeek(Int_t basketnumber) const
    return fBasketSeek[basketnumber];
 }
 
+//______________________________________________________________________________
+Bool_t TBranch::GetBasketMinMax(Long64_t entry, Double_t &min, Double_t &max, Long64_t &next) const
+{
+   // If the range of the values of the basket containing entry is known (see
+   // SetBasketMinMax), set min and max to it, next to the first entry of the
+   // following basket and return true.
+
+   if (!fBasketMin || entry < 0 || entry >= fEntries) return kFALSE;
+   Int_t basketnumber = TMath::BinarySearch(fWriteBasket+1, fBasketEntry, entry);
+   if (basketnumber < 0) return kFALSE;
+   min = fBasketMin[basketnumber];
+   max = fBasketMax[basketnumber];
+   if (min > max || (min == -TMath::Infinity() && max == TMath::Infinity())) return kFALSE;
+   next = basketnumber < fWriteBasket ? fBasketEntry[basketnumber+1] : fEntries;
+   return kTRUE;
+}
+
 //______________________________________________________________________________
 TList* TBranch::GetBrowsables() {
    // Returns (and, if 0, creates) browsable objects for this branch
@@ -1152,6 +1227,87 @@ TList* TBranch::GetBrowsables() {
    return fBrowsables;
 }
 
+//______________________________________________________________________________
+Long64_t TBranch::GetBulkEntries(Long64_t entry, Long64_t nentries, void *values)
+{
+   // Read the entries [entry, entry+nentries) of this branch into the
+   // contiguous array values. Each basket is deserialised with a single
+   // TBuffer::ReadFastArray call instead of going through GetEntry and
+   // TLeaf::ReadBasket for every entry.
+   //
+   // The branch must have a single leaf of basic type (TLeafB, TLeafS,
+   // TLeafI, TLeafL, TLeafF, TLeafD or TLeafO) and of fixed size, i.e.
+   // without a leaf count. values must point to an array of the type of
+   // the leaf with room for nentries*leaf->GetLenStatic() elements; the
+   // values of entry+i start at index i*leaf->GetLenStatic(). The branch
+   // address, the leaf values and GetReadEntry() are not modified.
+   //
+   // Returns the number of entries read, which is less than nentries if
+   // the branch has fewer entries, or -1 if the branch does not qualify
+   // or if an I/O error occurs.
+   //
+   // Example:
+   //    TBranch *bpx = tree->GetBranch("px");   // a "px/F" branch
+   //    std::vector<Float_t> px(tree->GetEntries());
+   //    bpx->GetBulkEntries(0, px.size(), &px[0]);
+
+   if (fNleaves != 1 || !values || entry < 0 || nentries <= 0) {
+      return -1;
+   }
+   TLeaf *leaf = (TLeaf*) fLeaves.UncheckedAt(0);
+   if (leaf->GetLeafCount()) {
+      return -1;
+   }
+   Int_t entrysize = leaf->GetLenType() * leaf->GetLenStatic();
+   Long64_t last = TMath::Min(entry + nentries, fEntryNumber);
+   char *out = (char*) values;
+   Long64_t nread = 0;
+
+   while (entry < last) {
+      Int_t ibasket = TMath::BinarySearch(fWriteBasket + 1, fBasketEntry, entry);
+      if (ibasket < 0) {
+         Error("GetBulkEntries", "In the branch %s, no basket contains the entry %lld\n", GetName(), entry);
+         return -1;
+      }
+      TBasket *basket = GetBasket(ibasket);
+      if (!basket) {
+         return -1;
+      }
+      Long64_t first = fBasketEntry[ibasket];
+      Long64_t next = (ibasket == fWriteBasket) ? fEntryNumber : fBasketEntry[ibasket+1];
+      // Keep the basket cache used by GetEntry consistent.
+      fReadBasket       = ibasket;
+      fCurrentBasket    = basket;
+      fFirstBasketEntry = first;
+      fNextBasketEntry  = next;
+
+      if (basket->GetEntryOffset()) {
+         // Entries of varying size, the values are not contiguous.
+         return -1;
+      }
+      TBuffer *buf = basket->GetBufferRef();
+      if (R__unlikely(!buf)) {
+         TFile *file = GetFile(0);
+         if (!file) return -1;
+         basket->ReadBasketBuffers(fBasketSeek[ibasket], fBasketBytes[ibasket], file);
+         buf = basket->GetBufferRef();
+         if (!buf) return -1;
+      }
+      if (R__unlikely(!buf->IsReading())) {
+         basket->SetReadMode();
+      }
+      Long64_t n = TMath::Min(last, next) - entry;
+      buf->SetBufferOffset(basket->GetKeylen() + (entry - first) * basket->GetNevBufSize());
+      if (!leaf->ReadBasketBulk(*buf, out, (Int_t) n)) {
+         return -1;
+      }
+      out   += n * entrysize;
+      nread += n;
+      entry += n;
+   }
+   return nread;
+}
+
 //______________________________________________________________________________
 const char * TBranch::GetClassName() const 
 {
@@ -1853,6 +2009,28 @@ void TBranch::FillLeavesImpl(TBuffer& b)
    }
 }
 
+//______________________________________________________________________________
+void TBranch::FillBasketMinMax()
+{
+   // Extend the range of the basket being filled to the values of the leaf
+   // just filled (see SetBasketMinMax). A NaN makes the range unknown, as no
+   // range can tell how a selection evaluates it.
+
+   TLeaf *leaf = (TLeaf*)fLeaves.UncheckedAt(0);
+   Double_t &min = fBasketMin[fWriteBasket];
+   Double_t &max = fBasketMax[fWriteBasket];
+   Int_t len = leaf->GetLen();
+   for (Int_t i = 0; i < len; ++i) {
+      Double_t value = leaf->GetValue(i);
+      if (TMath::IsNaN(value)) {
+         R__SetUnknownRange(min, max);
+         return;
+      }
+      if (value < min) min = value;
+      if (value > max) max = value;
+   }
+}
+
 //______________________________________________________________________________
 void TBranch::Refresh(TBranch* b)
 {
@@ -1885,6 +2063,18 @@ void TBranch::Refresh(TBranch* b)
       fBasketEntry[i] = b->fBasketEntry[i];
       fBasketSeek[i]  = b->fBasketSeek[i];
    }
+   delete [] fBasketMin;
+   delete [] fBasketMax;
+   fBasketMin = 0;
+   fBasketMax = 0;
+   if (b->fBasketMin) {
+      fBasketMin = new Double_t[fMaxBaskets];
+      fBasketMax = new Double_t[fMaxBaskets];
+      for (i=0;i<fMaxBaskets;i++) {
+         fBasketMin[i] = b->fBasketMin[i];
+         fBasketMax[i] = b->fBasketMax[i];
+      }
+   }
    fBaskets.Delete();
    Int_t nbaskets = b->fBaskets.GetSize();
    fBaskets.Expand(nbaskets);
@@ -1938,6 +2128,12 @@ void TBranch::Reset(Option_t*)
       }
    }
 
+   if (fBasketMin) {
+      for (Int_t i = 0; i < fMaxBaskets; ++i) {
+         R__SetEmptyRange(fBasketMin[i], fBasketMax[i]);
+      }
+   }
+
    fBaskets.Delete();
    fNBaskets = 0;
 }
@@ -1981,6 +2177,12 @@ void TBranch::ResetAfterMerge(TFileMergeInfo *)
       }
    }
 
+   if (fBasketMin) {
+      for (Int_t i = 0; i < fMaxBaskets; ++i) {
+         R__SetEmptyRange(fBasketMin[i], fBasketMax[i]);
+      }
+   }
+
    TBasket *reusebasket = (TBasket*)fBaskets[fWriteBasket];
    if (reusebasket) {
       fBaskets[fWriteBasket] = 0;
@@ -2077,6 +2279,47 @@ void TBranch::SetAutoDelete(Bool_t autodel)
    }
 }
 
+//______________________________________________________________________________
+void TBranch::SetBasketMinMax(Bool_t record)
+{
+   // Record (or stop recording) the minimum and the maximum of the values
+   // written in each basket of this branch. They are saved with the branch,
+   // so that a TTree::Draw selection can skip the baskets where no value can
+   // pass without reading them (see TTreeFormula::SkipEntries):
+   //
+   //    tree->GetBranch("pt")->SetBasketMinMax();
+   //    ... fill and write the tree ...
+   //    tree->Draw("eta", "pt>100");  // reads only the baskets with pt>100
+   //
+   // Only the branches with a single leaf of a basic type are supported. The
+   // range of the baskets filled before the call is unknown, as is the range
+   // of the baskets copied by fast cloning.
+
+   if (!record) {
+      delete [] fBasketMin;
+      delete [] fBasketMax;
+      fBasketMin = 0;
+      fBasketMax = 0;
+      return;
+   }
+   if (fBasketMin) return;
+
+   TLeaf *leaf = fNleaves == 1 ? (TLeaf*)fLeaves.UncheckedAt(0) : 0;
+   if (IsA() != TBranch::Class() || !leaf || leaf->IsA() == TLeafC::Class()) {
+      Warning("SetBasketMinMax", "Branch %s: only the branches with a single leaf of a basic type are supported", GetName());
+      return;
+   }
+   fBasketMin = new Double_t[fMaxBaskets];
+   fBasketMax = new Double_t[fMaxBaskets];
+   for (Int_t i = 0; i < fMaxBaskets; ++i) {
+      if (i < fWriteBasket || (i == fWriteBasket && fEntryNumber > fBasketEntry[i])) {
+         R__SetUnknownRange(fBasketMin[i], fBasketMax[i]);
+      } else {
+         R__SetEmptyRange(fBasketMin[i], fBasketMax[i]);
+      }
+   }
+}
+
 //______________________________________________________________________________
 void TBranch::SetBasketSize(Int_t buffsize)
 {
@@ -2131,6 +2374,65 @@ void TBranch::SetCompressionAlgorithm(Int_t algorithm)
    }
 }
 
+//______________________________________________________________________________
+void TBranch::SetCompressionDictionarySize(Int_t size)
+{
+   // Build a compression dictionary of at most size bytes from the content
+   // of the next baskets written, and use it to compress all the following
+   // baskets of this branch.
+   //
+   // A small basket compresses poorly since the compression starts without
+   // any history; the dictionary, a sample of the data of the branch, is
+   // used as such a history (a ZLIB preset dictionary).  It is stored with
+   // the branch in the file and used to decompress the baskets.  Files with
+   // such baskets can not be read by older versions of ROOT.
+   //
+   // The dictionary is only used with the ZLIB algorithm, its size is
+   // limited to 32 kB and once built it is never changed.
+   // size = 0 cancels the building of the dictionary if it is not complete.
+
+   if (size < 0) size = 0;
+   if (size > kMaxDictionarySize) size = kMaxDictionarySize;
+   fDictionarySize = size;
+   fDictionaryBaskets = 0;
+   fDictionarySample.Set(0);
+}
+
+//______________________________________________________________________________
+void TBranch::SampleCompressionDictionary(const char *data, Int_t len)
+{
+   // Add the beginning of the content of a basket (data, of len bytes) to the
+   // sample from which the compression dictionary is built.  Called by
+   // TBasket::WriteBuffer; see SetCompressionDictionarySize.
+   //
+   // Each basket contributes at most a quarter of the dictionary, so that
+   // the dictionary is representative of several baskets. The dictionary
+   // is complete when it reaches the requested size or after
+   // kMaxDictionaryBaskets baskets.
+
+   if (fDictionarySize <= 0 || fCompressionDictionary.GetSize()) return;
+   Int_t algorithm = GetCompressionAlgorithm();
+   if (GetCompressionLevel() <= 0
+       || (algorithm != ROOT::kUseGlobalSetting && algorithm != ROOT::kZLIB)) {
+      return;
+   }
+
+   Int_t cur = fDictionarySample.GetSize();
+   Int_t n = TMath::Min(len, fDictionarySize / 4);
+   n = TMath::Min(n, fDictionarySize - cur);
+   if (n > 0) {
+      fDictionarySample.Set(cur + n);
+      memcpy(fDictionarySample.GetArray() + cur, data, n);
+   }
+   ++fDictionaryBaskets;
+   if (fDictionarySample.GetSize() >= fDictionarySize || fDictionaryBaskets >= kMaxDictionaryBaskets) {
+      fCompressionDictionary = fDictionarySample;
+      fDictionarySample.Set(0);
+      fDictionaryBaskets = 0;
+      fDictionarySize = 0;
+   }
+}
+
 //______________________________________________________________________________
 void TBranch::SetCompressionLevel(Int_t level)
 {
@@ -2346,6 +2648,7 @@ void TBranch::Streamer(TBuffer& b)
             fBasketBytes[fWriteBasket] = fBasketBytes[fWriteBasket-1];
             fBasketEntry[fWriteBasket] = fEntries;
             fBasketSeek [fWriteBasket] = fBasketSeek [fWriteBasket-1];
+            if (fBasketMin) R__SetUnknownRange(fBasketMin[fWriteBasket], fBasketMax[fWriteBasket]);
 
          }
          if (!fSplitLevel && fBranches.GetEntriesFast()) fSplitLevel = 1;
@@ -2573,6 +2876,7 @@ Int_t TBranch::WriteBasket(TBasket* basket, Int_t where)
       }
       fBaskets.AddAtAndExpand(reusebasket,fWriteBasket);
       fBasketEntry[fWriteBasket] = fEntryNumber;
+      if (fBasketMin) R__SetEmptyRange(fBasketMin[fWriteBasket], fBasketMax[fWriteBasket]);
    } else {
       --fNBaskets;
       fBaskets[where] = 0;
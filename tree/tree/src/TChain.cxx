@@ -50,16 +50,100 @@
 #include "TTreeCache.h"
 #include "TUrl.h"
 #include "TVirtualIndex.h"
+#include "TVirtualMutex.h"
 #include "TEventList.h"
 #include "TEntryList.h"
 #include "TEntryListFromFile.h"
 #include "TFileStager.h"
 #include "TFilePrefetch.h"
+#include "TThread.h"
+
+#include <vector>
 
 const Long64_t theBigNumber = Long64_t(1234567890)<<28;
 
 ClassImp(TChain)
 
+//______________________________________________________________________________
+class TChainNextFile {
+   // Opens the file of the next tree of a chain in a background thread
+   // and, if branch names are given, fills a TTreeCache with the first
+   // cluster of these branches. See TChain::SetPrefetchNextFile.
+
+public:
+   TString              fFileName;    // Name of the file to open
+   TString              fTreeName;    // Name of the tree in the file
+   Int_t                fTreeNumber;  // Number of the tree in the chain
+   Int_t                fCacheSize;   // Size of the TTreeCache to fill
+   std::vector<TString> fBranches;    // Branches to put in the cache
+   TFile               *fFile;        // File opened by the thread (owned until adopted)
+   TTree               *fTree;        // Tree read by the thread
+   TThread             *fThread;      // Thread opening the file
+
+   TChainNextFile(const char *filename, const char *treename, Int_t treenumber)
+      : fFileName(filename), fTreeName(treename), fTreeNumber(treenumber),
+        fCacheSize(0), fFile(0), fTree(0), fThread(0) {}
+
+   ~TChainNextFile()
+   {
+      Wait();
+      if (fFile) {
+         TFileCacheRead *cache = fTree ? fFile->GetCacheRead(fTree) : 0;
+         if (cache) {
+            fFile->SetCacheRead(0, fTree);
+            delete cache;
+         }
+         delete fFile;
+      }
+   }
+
+   void Start()
+   {
+      fThread = new TThread(Run, this);
+      fThread->Run();
+   }
+
+   void Wait()
+   {
+      if (fThread) {
+         fThread->Join();
+         delete fThread;
+         fThread = 0;
+      }
+   }
+
+   static void *Run(void *arg)
+   {
+      TChainNextFile *next = (TChainNextFile*) arg;
+      TFile *file;
+      TTree *tree = 0;
+      {
+         // Reading a TTree goes through the global gTree (see TTree::Streamer
+         // and TBranch::Streamer), it must not be done together with another thread.
+         R__LOCKGUARD2(gROOTMutex);
+         TDirectory::TContext ctxt(0);
+         file = TFile::Open(next->fFileName);
+         if (!file || file->IsZombie()) {
+            delete file;
+            return 0;
+         }
+         tree = (TTree*) file->Get(next->fTreeName);
+      }
+      if (tree && next->fCacheSize > 0 && next->fBranches.size() && !file->IsMapped()) {
+         TTreeCache *cache = new TTreeCache(tree, next->fCacheSize);
+         file->SetCacheRead(cache, tree);
+         for (UInt_t i = 0; i < next->fBranches.size(); ++i) {
+            cache->AddBranch(tree->GetBranch(next->fBranches[i]));
+         }
+         cache->StopLearningPhase();
+         cache->FillBuffer();
+      }
+      next->fFile = file;
+      next->fTree = tree;
+      return 0;
+   }
+};
+
 //______________________________________________________________________________
 TChain::TChain()
 : TTree()
@@ -73,6 +157,8 @@ TChain::TChain()
 , fFiles(0)
 , fStatus(0)
 , fProofChain(0)
+, fPrefetchNextFile(kFALSE)
+, fNextFile(0)
 {
    // -- Default constructor.
 
@@ -109,6 +195,8 @@ TChain::TChain(const char* name, const char* title)
 , fFiles(0)
 , fStatus(0)
 , fProofChain(0)
+, fPrefetchNextFile(kFALSE)
+, fNextFile(0)
 {
    // -- Create a chain.
    //
@@ -173,6 +261,7 @@ TChain::~TChain()
    // -- Destructor.
    gROOT->GetListOfCleanups()->Remove(this);
    
+   StopNextFile();
    SafeDelete(fProofChain);
    fStatus->Delete();
    delete fStatus;
@@ -1471,7 +1560,15 @@ Long64_t TChain::LoadTree(Long64_t entry)
    //        if we did not delete it above.
    {
       TDirectory::TContext ctxt(0);
-      fFile = TFile::Open(element->GetTitle());
+      TFile *file = 0;
+      if (fNextFile && fNextFile->fTreeNumber == treenum) {
+         // The file has been opened in the background.
+         fNextFile->Wait();
+         file = fNextFile->fFile;
+         fNextFile->fFile = 0;
+      }
+      StopNextFile();
+      fFile = file ? file : TFile::Open(element->GetTitle());
       if (fFile) fFile->SetBit(kMustCleanup);
    }
 
@@ -1504,8 +1601,13 @@ Long64_t TChain::LoadTree(Long64_t entry)
    // FIXME: We may set fDirectory to zero here!
    fDirectory = fFile;
 
-   // Reuse cache from previous file (if any).
-   if (tpf) {
+   // Reuse cache from previous file (if any), unless the file has been
+   // opened in the background and its cache already filled.
+   TFileCacheRead *primed = (fFile && fTree) ? fFile->GetCacheRead(fTree) : 0;
+   if (primed) {
+      delete tpf;
+      tpf = 0;
+   } else if (tpf) {
       if (fFile) {
          tpf->ResetCache();
          fFile->SetCacheRead(tpf, fTree);
@@ -1645,6 +1747,11 @@ Long64_t TChain::LoadTree(Long64_t entry)
       fNotify->Notify();
    }
 
+   // Get the next file ready while this one is being processed.
+   if (fPrefetchNextFile) {
+      StartNextFile();
+   }
+
    // Return the new local entry number.
    return treeReadEntry;
 }
@@ -2133,6 +2240,7 @@ void TChain::Reset(Option_t*)
 {
    // Resets the state of this chain.
 
+   StopNextFile();
    delete fFile;
    fFile = 0;
    fNtrees         = 0;
@@ -2155,6 +2263,7 @@ void TChain::ResetAfterMerge(TFileMergeInfo *info)
    // Resets the state of this chain after a merge (keep the customization but
    // forget the data).
    
+   StopNextFile();
    fNtrees         = 0;
    fTreeNumber     = -1;
    fTree           = 0;
@@ -2621,6 +2730,34 @@ void TChain::SetPacketSize(Int_t size)
    }
 }
 
+//______________________________________________________________________________
+void TChain::SetPrefetchNextFile(Bool_t prefetch)
+{
+   // Enable/Disable opening the file of the next tree of the chain in the
+   // background while the current one is being processed.
+   //
+   // When LoadTree switches to a new tree, a thread is started that opens
+   // the file of the following tree and reads the tree header. If the
+   // current tree uses a TTreeCache which has finished its learning phase
+   // (and does not itself prefetch asynchronously), the thread also creates
+   // a TTreeCache of the same size for the next tree, with the same
+   // branches, and fills it with the first cluster. When LoadTree then
+   // moves to the next tree, the file, the tree and the filled cache are
+   // used directly, hiding the open latency and the first read which
+   // otherwise stall the processing at each file boundary, in particular
+   // with remote files.
+   //
+   // Only sequential processing benefits: if LoadTree goes to another tree,
+   // the file opened in the background is closed.
+
+   fPrefetchNextFile = prefetch;
+   if (!prefetch) {
+      StopNextFile();
+   } else if (fTree && !fNextFile) {
+      StartNextFile();
+   }
+}
+
 //______________________________________________________________________________
 void TChain::SetProof(Bool_t on, Bool_t refresh, Bool_t gettreeheader)
 {
@@ -2687,6 +2824,47 @@ void TChain::SetWeight(Double_t w, Option_t* option)
    }
 }
 
+//______________________________________________________________________________
+void TChain::StartNextFile()
+{
+   // Start opening in the background the file of the tree following the
+   // current one, see SetPrefetchNextFile.
+
+   StopNextFile();
+   if (fTreeNumber < 0 || fTreeNumber + 1 >= fNtrees) {
+      return;
+   }
+   TChainElement *element = (TChainElement*) fFiles->At(fTreeNumber + 1);
+   if (!element) {
+      return;
+   }
+   fNextFile = new TChainNextFile(element->GetTitle(), element->GetName(), fTreeNumber + 1);
+
+   // Fill a cache for the next tree with the branches of the current one.
+   TFileCacheRead *pf = fFile ? fFile->GetCacheRead(fTree) : 0;
+   if (pf && pf->IsA() == TTreeCache::Class() && !pf->IsEnablePrefetching()) {
+      TTreeCache *tpf = (TTreeCache*) pf;
+      if (!tpf->IsLearning()) {
+         fNextFile->fCacheSize = tpf->GetBufferSize();
+         const TObjArray *branches = tpf->GetCachedBranches();
+         for (Int_t i = 0; i < branches->GetEntriesFast(); ++i) {
+            fNextFile->fBranches.push_back(branches->UncheckedAt(i)->GetName());
+         }
+      }
+   }
+   fNextFile->Start();
+}
+
+//______________________________________________________________________________
+void TChain::StopNextFile()
+{
+   // Wait for the background opening of the next file (if any) and close
+   // the file.
+
+   delete fNextFile;
+   fNextFile = 0;
+}
+
 //______________________________________________________________________________
 void TChain::Streamer(TBuffer& b)
 {
@@ -25,7 +25,10 @@ There are two types of entry lists:
   numbers in the blocks is described in the TEntryListBlock class description, and
   this representation might be changed by calling OptimizeStorage() function
   (when the list is filled via the Enter() function, this is done automatically,
-  except for the last block).
+  except for the last block, which is optimized when the list is written).
+  The blocks stored as runs of consecutive entries are written as bits or lists,
+  so that the files can be read by older versions, unless SetWriteRuns() is called.
+  Add(), Subtract() and Intersect() work block by block, 16 entries at a time.
   Individual entry lists can be merged (functions Merge() and Add())
   to make an entry list for a TChain of corresponding TTrees.
 End_Html
@@ -59,6 +62,9 @@ Begin_Html
 <li> <b>Subtract</b>() - if the lists are for the same TTree, removes the entries of the second
                list from the first list. If the lists are for TChains, loops over all
                sub-lists
+<li> <b>Intersect</b>() - if the lists are for the same TTree, keeps only the entries of the
+                first list that are also in the second list. If the lists are for TChains,
+                loops over all sub-lists
 <li> <b>GetEntry(n)</b> - returns the n-th entry number 
 <li> <b>Next</b>()      - returns next entry number. Note, that this function is 
                 much faster than GetEntry, and it's called when GetEntry() is called
@@ -162,6 +168,8 @@ End_Html */
 
 ClassImp(TEntryList)
 
+Bool_t TEntryList::fgWriteRuns = kFALSE;
+
 //______________________________________________________________________________
 TEntryList::TEntryList() : fEntriesToProcess(0)
 {
@@ -1220,6 +1228,17 @@ void TEntryList::SetTree(const TTree *tree)
 
 }
 
+//______________________________________________________________________________
+void TEntryList::SetWriteRuns(Bool_t write)
+{
+   //If write is true, the blocks stored as runs of consecutive entries are
+   //written as runs, which takes less space for the lists selecting large
+   //ranges of entries. The versions older than 6.00 misread these blocks.
+   //By default they are written as bits or as lists of entries.
+
+   fgWriteRuns = write;
+}
+
 //______________________________________________________________________________
 void TEntryList::Subtract(const TEntryList *elist)
 {
@@ -1233,13 +1252,20 @@ void TEntryList::Subtract(const TEntryList *elist)
          //second list is also only for 1 tree
          if (!strcmp(elist->fTreeName.Data(),fTreeName.Data()) && 
              !strcmp(elist->fFileName.Data(),fFileName.Data())){
-            //same tree
-            Long64_t n2 = elist->GetN();
-            Long64_t entry;
-            for (Int_t i=0; i<n2; i++){
-               entry = (const_cast<TEntryList*>(elist))->GetEntry(i);
-               Remove(entry);
+            //same tree, subtract block by block
+            if (!elist->fBlocks) return;
+            TEntryListBlock *block1 = 0;
+            TEntryListBlock *block2 = 0;
+            Int_t nmin = TMath::Min(fNBlocks, elist->fNBlocks);
+            Long64_t nold;
+            for (Int_t i=0; i<nmin; i++){
+               block1 = (TEntryListBlock*)fBlocks->UncheckedAt(i);
+               block2 = (TEntryListBlock*)elist->fBlocks->UncheckedAt(i);
+               nold = block1->GetNPassed();
+               fN = fN - nold + block1->Subtract(block2);
             }
+            fLastIndexQueried = -1;
+            fLastIndexReturned = 0;
          } else {
             //different trees
             return;
@@ -1276,6 +1302,60 @@ void TEntryList::Subtract(const TEntryList *elist)
 
 }
 
+//______________________________________________________________________________
+void TEntryList::Intersect(const TEntryList *elist)
+{
+   //keep only the entries of this entry list, that are also contained in elist
+   //Entry lists for the same tree are intersected block by block
+
+   if (!elist) return;
+   if (!fLists){
+      if (!fBlocks) return;
+      //find the list for the same tree as this list, if any
+      const TEntryList *other = 0;
+      if (!elist->fLists){
+         if (!strcmp(elist->fTreeName.Data(),fTreeName.Data()) && 
+             !strcmp(elist->fFileName.Data(),fFileName.Data()))
+            other = elist;
+      } else {
+         TIter next1(elist->GetLists());
+         TEntryList *templist = 0;
+         while ((templist = (TEntryList*)next1())){
+            if (!strcmp(templist->fTreeName.Data(),fTreeName.Data()) && 
+                !strcmp(templist->fFileName.Data(),fFileName.Data())){
+               other = templist;
+               break;
+            }
+         }
+      }
+      //blocks that have no counterpart in the other list are emptied
+      TEntryListBlock empty;
+      TEntryListBlock *block1 = 0;
+      TEntryListBlock *block2 = 0;
+      Long64_t nold;
+      for (Int_t i=0; i<fNBlocks; i++){
+         block1 = (TEntryListBlock*)fBlocks->UncheckedAt(i);
+         block2 = &empty;
+         if (other && other->fBlocks && i<other->fNBlocks)
+            block2 = (TEntryListBlock*)other->fBlocks->UncheckedAt(i);
+         nold = block1->GetNPassed();
+         fN = fN - nold + block1->Intersect(block2);
+      }
+      fLastIndexQueried = -1;
+      fLastIndexReturned = 0;
+   } else {
+      //this list has sublists
+      TIter next2(fLists);
+      TEntryList *templist = 0;
+      Long64_t oldn=0;
+      while ((templist = (TEntryList*)next2())){
+         oldn = templist->GetN();
+         templist->Intersect(elist);
+         fN = fN - oldn + templist->GetN();
+      }
+   }
+}
+
 //______________________________________________________________________________
 TEntryList operator||(TEntryList &elist1, TEntryList &elist2)
 {
@@ -1546,6 +1626,13 @@ void TEntryList::Streamer(TBuffer &b)
          GetFileName(fFileName.Data(), fFileName);
       }
    } else {
+      //write the blocks in their most compact representation, the runs only
+      //if requested with SetWriteRuns, then restore the runs in memory
+      if (fBlocks){
+         for (Int_t i=0; i<fNBlocks; i++)
+            ((TEntryListBlock*)fBlocks->UncheckedAt(i))->OptimizeStorage(fgWriteRuns);
+      }
       b.WriteClassBuffer(TEntryList::Class(), this);
+      if (!fgWriteRuns) OptimizeStorage();
    }
 }
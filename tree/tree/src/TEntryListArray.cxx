@@ -604,6 +604,25 @@ TEntryListArray* TEntryListArray::SetEntry(Long64_t entry, TTree *tree)
    return newlist;
 }
 
+//______________________________________________________________________________
+void TEntryListArray::Intersect(const TEntryList *elist)
+{
+   //Keep only the entries of this entry list that are also contained in elist
+   //The subentries of the entries that are kept are not intersected
+
+   if (!elist) return;
+
+   TEntryList::Intersect(elist);
+   if (!fLists && fSubLists) {
+      TEntryListArray *e = 0;
+      TIter next(fSubLists);
+      while ((e = (TEntryListArray*) next())) {
+         if (!Contains(e->fEntry))
+            RemoveSubList(e);
+      }
+   }
+}
+
 //______________________________________________________________________________
 void TEntryListArray::Subtract(const TEntryList *elist)
 {
@@ -12,7 +12,7 @@
 //______________________________________________________________________________
 /* Begin_Html
 <center><h2>TEntryListBlock: Used by TEntryList to store the entry numbers</h2></center>
- There are 2 ways to represent entry numbers in a TEntryListBlock:
+ There are 3 ways to represent entry numbers in a TEntryListBlock:
 <ol>
  <li> as bits, where passing entry numbers are assigned 1, not passing - 0
  <li> as a simple array of entry numbers
@@ -20,9 +20,12 @@
 <li> storing the numbers of entries that pass
 <li> storing the numbers of entries that don't pass
 </ul>
+ <li> as runs, a sorted array of (first, last) pairs of consecutive passing entries
  </ol>
- In both cases, a UShort_t* is used. The second option is better in case
- less than 1/16 or more than 15/16 of entries pass the selection, and the representation can be
+ In all cases, a UShort_t* is used. The second option is better in case
+ less than 1/16 or more than 15/16 of entries pass the selection, the third one
+ when the passing entries come in less than kBlockSize/2 runs (and in less runs
+ than half the length of the list), and the representation can be
  changed by calling OptimizeStorage() function. 
  When the block is being filled, it's always stored as bits, and the OptimizeStorage()
  function is called by TEntryList when it starts filling the next block. If
@@ -38,7 +41,11 @@ Begin_Html
 <ul>
  <li> <b>Merge</b>() - adds all entries from one block to the other. If the first block 
              uses array representation, it's changed to bits representation only
-             if the total number of passing entries is still less than kBlockSize
+             if the total number of passing entries is still less than kBlockSize.
+             Merge(), Intersect() and Subtract() work on the bits representation
+             of both blocks, 16 entries at a time
+ <li> <b>Intersect</b>() - keeps only the entries also contained in the other block
+ <li> <b>Subtract</b>() - removes the entries contained in the other block
  <li> <b>GetEntry(n)</b> - returns n-th non-zero entry.
  <li> <b>Next</b>()      - return next non-zero entry. In case of representation 1), Next()
                  is faster than GetEntry()
@@ -46,11 +53,27 @@ Begin_Html
 End_Html */
 
 
+#include <string.h>
+
 #include "TEntryListBlock.h"
 #include "TString.h"
 
 ClassImp(TEntryListBlock)
 
+//______________________________________________________________________________
+static inline Int_t R__CountBits(UShort_t x)
+{
+   // Number of bits set in x
+
+#if defined(__GNUC__)
+   return __builtin_popcount(x);
+#else
+   Int_t n = 0;
+   for (; x; x &= x - 1) n++;
+   return n;
+#endif
+}
+
 //______________________________________________________________________________
 TEntryListBlock::TEntryListBlock()
 {
@@ -127,7 +150,7 @@ TEntryListBlock &TEntryListBlock::operator=(const TEntryListBlock &eblock)
 Bool_t TEntryListBlock::Enter(Int_t entry)
 {
    //If the block has already been optimized and the entries
-   //are stored as a list and not as bits, trying to enter a new entry
+   //are stored as a list or as runs and not as bits, trying to enter a new entry
    //will make the block switch to bits representation
 
    if (entry > kBlockSize*16) {
@@ -152,7 +175,7 @@ Bool_t TEntryListBlock::Enter(Int_t entry)
          return 0;
       }
    }
-   //list
+   //list or runs
    //change to bits
    UShort_t *bits = new UShort_t[kBlockSize];
    Transform(1, bits);
@@ -165,7 +188,7 @@ Bool_t TEntryListBlock::Remove(Int_t entry)
 {
 //Remove entry #entry
 //If the block has already been optimized and the entries
-//are stored as a list and not as bits, trying to remove a new entry
+//are stored as a list or as runs and not as bits, trying to remove a new entry
 //will make the block switch to bits representation
 
    if (entry > kBlockSize*16) {
@@ -183,7 +206,7 @@ Bool_t TEntryListBlock::Remove(Int_t entry)
          return 0;
       }
    }
-   //list
+   //list or runs
    //change to bits
    UShort_t *bits = new UShort_t[kBlockSize];
    Transform(1, bits);
@@ -208,6 +231,11 @@ Int_t TEntryListBlock::Contains(Int_t entry)
       Bool_t result = (fIndices[i] & (1<<j))!=0;
       return result;
    }
+   if (fType==2 && fIndices){
+      //runs
+      Int_t irun = FindRun(entry);
+      return irun < fN/2 && fIndices[2*irun] <= entry;
+   }
    //list
    if (entry < fCurrent) fCurrent = 0;
    if (fPassing && fIndices){
@@ -243,11 +271,16 @@ Int_t TEntryListBlock::Merge(TEntryListBlock *block)
 {
    //Merge with the other block
    //Returns the resulting number of entries in the block
+   //Two blocks storing the passing entries as lists, with less than kBlockSize
+   //entries in total, are merged as lists. In all the other cases the bits
+   //representations of the blocks are ORed (see Combine())
 
-   Int_t i, j;
+   Int_t i;
    if (block->GetNPassed() == 0) return GetNPassed();
    if (GetNPassed() == 0){
       //this block is empty
+      if (fIndices)
+         delete [] fIndices;
       fN = block->fN;
       fIndices = new UShort_t[fN];
       for (i=0; i<fN; i++)
@@ -260,105 +293,98 @@ Int_t TEntryListBlock::Merge(TEntryListBlock *block)
       fLastIndexQueried = -1;
       return fNPassed;
    }
-   if (fType==0){
-      //stored as bits
-      if (block->fType == 0){
-         for (i=0; i<kBlockSize*16; i++){
-            if (block->Contains(i))
-               Enter(i);
-         }
-      } else {
-         if (block->fPassing){
-            //the other block stores entries that pass
-            for (i=0; i<block->fNPassed; i++){
-               Enter(block->fIndices[i]);
-            }
-         } else {
-            //the other block stores entries that don't pass
-            if (block->fNPassed==0){
-               for (i=0; i<kBlockSize*16; i++){
-                  Enter(i);
-               }
-            }
-            for (j=0; j<block->fIndices[0]; j++)
-               Enter(j);
-            for (i=0; i<block->fNPassed-1; i++){
-               for (j=block->fIndices[i]+1; j<block->fIndices[i+1]; j++){
-                  Enter(j);
-               }
-            }
-            for (j=block->fIndices[block->fNPassed-1]+1; j<kBlockSize*16; j++)
-               Enter(j);
-         }
+   if (fType!=1 || !fPassing || block->fType!=1 || !block->fPassing ||
+       fNPassed + block->fNPassed > kBlockSize)
+      return Combine(block, 0);
+
+   //both blocks stored as lists of passing entries
+   //make a bigger list
+   Int_t en = block->fNPassed;
+   Int_t newsize = fNPassed + en;
+   UShort_t *newlist = new UShort_t[newsize];
+   UShort_t *elst = block->fIndices;
+   Int_t newpos, elpos;
+   newpos = elpos = 0;
+   for (i=0; i<fNPassed; i++) {
+      while (elpos < en && fIndices[i] > elst[elpos]) {
+         newlist[newpos] = elst[elpos];
+         newpos++;
+         elpos++;
       }
+      if (elpos < en && fIndices[i] == elst[elpos]) elpos++;
+      newlist[newpos] = fIndices[i];
+      newpos++;
+   }
+   while (elpos < en) {
+      newlist[newpos] = elst[elpos];
+      newpos++;
+      elpos++;
+   }
+   delete [] fIndices;
+   fIndices = newlist;
+   fNPassed = newpos;
+   fN = fNPassed;
+   fCurrent = 0;
+   fLastIndexQueried = -1;
+   fLastIndexReturned = -1;
+   return GetNPassed();
+}
+
+//______________________________________________________________________________
+Int_t TEntryListBlock::Intersect(TEntryListBlock *block)
+{
+   //Keep only the entries that are also contained in the other block
+   //Returns the resulting number of entries in the block
+
+   if (GetNPassed() == 0) return 0;
+   return Combine(block, 1);
+}
+
+//______________________________________________________________________________
+Int_t TEntryListBlock::Subtract(TEntryListBlock *block)
+{
+   //Remove all the entries that are contained in the other block
+   //Returns the resulting number of entries in the block
+
+   if (GetNPassed() == 0 || block->GetNPassed() == 0) return GetNPassed();
+   return Combine(block, 2);
+}
+
+//______________________________________________________________________________
+Int_t TEntryListBlock::Combine(TEntryListBlock *block, Int_t op)
+{
+   //Combine this block with the other one, 16 entries at a time:
+   //op=0 - union, op=1 - intersection, op=2 - difference (this and not block)
+   //The result is stored as bits, then OptimizeStorage() is called.
+   //Returns the resulting number of entries in the block
+
+   Int_t i;
+   UShort_t *bits = new UShort_t[kBlockSize];
+   UShort_t other[kBlockSize];
+   GetBits(bits);
+   block->GetBits(other);
+   if (op==0) {
+      for (i=0; i<kBlockSize; i++)
+         bits[i] |= other[i];
+   } else if (op==1) {
+      for (i=0; i<kBlockSize; i++)
+         bits[i] &= other[i];
    } else {
-      //stored as a list
-      if (GetNPassed() + block->GetNPassed() > kBlockSize){
-         //change to bits
-         UShort_t *bits = new UShort_t[kBlockSize];
-         Transform(1, bits);
-         Merge(block);
-      } else {
-         //this is only possible if fPassing=1 in both blocks
-         if (block->fType==1){
-            //second block stored as a list
-            //make a bigger list
-            Int_t en = block->fNPassed;
-            Int_t newsize = fNPassed + en;
-            UShort_t *newlist = new UShort_t[newsize];
-            UShort_t *elst = block->fIndices;
-            Int_t newpos, elpos;
-            newpos = elpos = 0;
-            for (i=0; i<fNPassed; i++) {
-               while (elpos < en && fIndices[i] > elst[elpos]) {
-                  newlist[newpos] = elst[elpos];
-                  newpos++;
-                  elpos++;
-               }
-               if (fIndices[i] == elst[elpos]) elpos++;
-               newlist[newpos] = fIndices[i];
-               newpos++;
-            }
-            while (elpos < en) {
-               newlist[newpos] = elst[elpos];
-               newpos++;
-               elpos++;
-            }
-            delete [] fIndices;
-            fIndices = newlist;
-            fNPassed = newpos;
-            fN = fNPassed;
-         } else {
-            //second block is stored as bits
-
-            Int_t en = block->fNPassed;
-            Int_t newsize = fNPassed + en;
-            UShort_t *newlist = new UShort_t[newsize];
-            Int_t newpos, current;
-            newpos = current = 0;
-            for (i=0; i<kBlockSize*16; i++){
-               if (!block->Contains(i)) continue;
-               while(current < fNPassed && fIndices[current]<i){
-                  newlist[newpos] = fIndices[current];
-                  current++;
-                  newpos++;
-               }
-               if (fIndices[current]==i) current++;
-               newlist[newpos] = i;
-               newpos++;
-            }
-            while(current<fNPassed){
-               newlist[newpos] = fIndices[current];
-               newpos++;
-               current++;
-            }
-            delete [] fIndices;
-            fIndices = newlist;
-            fNPassed = newpos;
-            fN = fNPassed;
-         }
-      }
+      for (i=0; i<kBlockSize; i++)
+         bits[i] &= (UShort_t)~other[i];
    }
+   Int_t npassed = 0;
+   for (i=0; i<kBlockSize; i++)
+      npassed += R__CountBits(bits[i]);
+
+   if (fIndices)
+      delete [] fIndices;
+   fIndices = bits;
+   fN = kBlockSize;
+   fNPassed = npassed;
+   fType = 0;
+   fPassing = 1;
+   fCurrent = 0;
    fLastIndexQueried = -1;
    fLastIndexReturned = -1;
    OptimizeStorage();
@@ -438,6 +464,19 @@ Int_t TEntryListBlock::GetEntry(Int_t entry)
             }
          }   
       }
+      if (fType==2){
+         //runs
+         Int_t left = entry;
+         for (i=0; i<fN; i+=2){
+            Int_t len = fIndices[i+1] - fIndices[i] + 1;
+            if (left < len){
+               fLastIndexQueried = entry;
+               fLastIndexReturned = fIndices[i] + left;
+               return fLastIndexReturned;
+            }
+            left -= len;
+         }
+      }
       return -1;
    }
 }
@@ -486,6 +525,16 @@ Int_t TEntryListBlock::Next()
       }
       
    }
+   if (fType==2) {
+      //runs
+      Int_t irun = FindRun(fLastIndexReturned+1);
+      if (irun >= fN/2) return -1;
+      fLastIndexReturned++;
+      if (fLastIndexReturned < fIndices[2*irun])
+         fLastIndexReturned = fIndices[2*irun];
+      fLastIndexQueried++;
+      return fLastIndexReturned;
+   }
    return -1;
 }
 
@@ -516,6 +565,11 @@ void TEntryListBlock::PrintWithShift(Int_t shift) const
          if (result)
             printf("%d\n", i+shift);
       }
+   } else if (fType==2){
+      for (i=0; i<fN; i+=2){
+         for (Int_t j=fIndices[i]; j<=fIndices[i+1]; j++)
+            printf("%d\n", j+shift);
+      }
    } else {
       if (fPassing){
          for (i=0; i<fNPassed; i++){
@@ -544,27 +598,157 @@ void TEntryListBlock::PrintWithShift(Int_t shift) const
 
 
 //______________________________________________________________________________
-void TEntryListBlock::OptimizeStorage()
+void TEntryListBlock::OptimizeStorage(Bool_t runs)
 {
    //if there are < kBlockSize or >kBlockSize*15 entries, change to an array representation
-
+   //if runs is true and the passing entries come in less runs than half the size of that
+   //array (and than kBlockSize/2), change to a runs representation
+   //if runs is false, a block stored as runs is changed to one of the two other
+   //representations, the only ones known by the versions older than 6.00
+
+   if (fType==2 && !runs){
+      UShort_t *bits = new UShort_t[kBlockSize];
+      GetBits(bits);
+      delete [] fIndices;
+      fIndices = bits;
+      fN = kBlockSize;
+      fType = 0;
+      fPassing = 1;
+      fCurrent = 0;
+      fLastIndexQueried = -1;
+      fLastIndexReturned = -1;
+   }
    if (fType!=0) return;
+   Int_t i, nruns = 0;
+   if (runs){
+      //a run starts at each bit set that follows a bit not set
+      UShort_t carry = 0;
+      for (i=0; i<kBlockSize; i++){
+         nruns += R__CountBits((UShort_t)(fIndices[i] & ~((fIndices[i]<<1) | carry)));
+         carry = fIndices[i]>>15;
+      }
+   }
+   Int_t nlist = kBlockSize;
+   if (fNPassed<kBlockSize)
+      nlist = fNPassed;
+   else if (fNPassed > kBlockSize*15)
+      nlist = kBlockSize*16-fNPassed;
+   if (runs && 2*nruns < nlist){
+      TransformToRuns(nruns);
+      return;
+   }
    if (fNPassed > kBlockSize*15)
       fPassing = 0;
    if (fNPassed<kBlockSize || !fPassing){
       //less than 4000 entries passing, makes sense to change from bits to list
-      UShort_t *indexnew = new UShort_t[fNPassed];
+      UShort_t *indexnew = new UShort_t[nlist];
       Transform(0, indexnew);
    }
 }
 
+//______________________________________________________________________________
+void TEntryListBlock::TransformToRuns(Int_t nruns)
+{
+   //Transform the existing fIndices from bits to nruns runs of passing entries
+
+   UShort_t *runs = new UShort_t[2*nruns];
+   Int_t irun = 0;
+   Bool_t inrun = kFALSE;
+   for (Int_t i=0; i<kBlockSize*16; i++){
+      UShort_t word = fIndices[i>>4];
+      if ((i & 15)==0 && word==(inrun ? 0xFFFF : 0)){
+         //whole word in the same state
+         i += 15;
+         continue;
+      }
+      Bool_t result = (word & (1<<(i & 15)))!=0;
+      if (result && !inrun){
+         runs[2*irun] = i;
+         inrun = kTRUE;
+      } else if (!result && inrun){
+         runs[2*irun+1] = i-1;
+         irun++;
+         inrun = kFALSE;
+      }
+   }
+   if (inrun){
+      runs[2*irun+1] = kBlockSize*16-1;
+      irun++;
+   }
+   delete [] fIndices;
+   fIndices = runs;
+   fN = 2*irun;
+   fType = 2;
+   fPassing = 1;
+   fCurrent = 0;
+}
+
+//______________________________________________________________________________
+Int_t TEntryListBlock::FindRun(Int_t entry) const
+{
+   //Return the index of the first run ending at or after entry, or the number
+   //of runs if there is none. Used in runs representation only
+
+   Int_t lo = 0;
+   Int_t hi = fN/2;
+   while (lo < hi){
+      Int_t mid = (lo+hi)/2;
+      if (fIndices[2*mid+1] < entry) lo = mid+1;
+      else hi = mid;
+   }
+   return lo;
+}
+
+//______________________________________________________________________________
+void TEntryListBlock::GetBits(UShort_t *bits) const
+{
+   //Fill bits (kBlockSize words) with the bits representation of this block,
+   //whatever the representation used to store it
+
+   Int_t i;
+   if (fType==0 && fIndices){
+      memcpy(bits, fIndices, kBlockSize*sizeof(UShort_t));
+      return;
+   }
+   if (fType==1 && !fPassing){
+      //the list stores the entries that don't pass
+      for (i=0; i<kBlockSize; i++)
+         bits[i] = 0xFFFF;
+      if (fIndices){
+         for (i=0; i<fNPassed; i++)
+            bits[fIndices[i]>>4] &= (UShort_t)~(1<<(fIndices[i] & 15));
+      }
+      return;
+   }
+   memset(bits, 0, kBlockSize*sizeof(UShort_t));
+   if (!fIndices) return;
+   if (fType==1){
+      for (i=0; i<fNPassed; i++)
+         bits[fIndices[i]>>4] |= 1<<(fIndices[i] & 15);
+   } else if (fType==2){
+      for (i=0; i<fN; i+=2){
+         Int_t j = fIndices[i];
+         Int_t last = fIndices[i+1];
+         while (j<=last){
+            if ((j & 15)==0 && j+15<=last){
+               bits[j>>4] = 0xFFFF;
+               j += 16;
+            } else {
+               bits[j>>4] |= 1<<(j & 15);
+               j++;
+            }
+         }
+      }
+   }
+}
+
 
 //______________________________________________________________________________
 void TEntryListBlock::Transform(Bool_t dir, UShort_t *indexnew)
 {
    //Transform the existing fIndices
    //dir=0 - transform from bits to a list
-   //dir=1 - tranform from a list to bits
+   //dir=1 - tranform from a list or runs to bits
 
    Int_t i=0;
    Int_t ilist = 0;
@@ -595,25 +779,8 @@ void TEntryListBlock::Transform(Bool_t dir, UShort_t *indexnew)
       return;
    }
 
-
-   if (fPassing){
-      for (i=0; i<kBlockSize; i++)
-         indexnew[i] = 0;
-      for (i=0; i<fNPassed; i++){
-         ibite = fIndices[i]>>4;
-         ibit = fIndices[i] & 15;
-         indexnew[ibite] |= 1<<ibit;
-      }
-   } else {
-      for (i=0; i<kBlockSize; i++)
-         indexnew[i] = 65535;
-      for (i=0; i<fNPassed; i++){
-         ibite = fIndices[i]>>4;
-         ibit = fIndices[i] & 15;
-         indexnew[ibite] ^= 1<<ibit;
-      }
-      fNPassed = kBlockSize*16-fNPassed;
-   } 
+   GetBits(indexnew);
+   fNPassed = GetNPassed();
    if (fIndices)
       delete [] fIndices;
    fIndices = indexnew;
@@ -138,6 +138,18 @@ void TLeafD::ReadBasket(TBuffer &b)
    }
 }
 
+//______________________________________________________________________________
+Bool_t TLeafD::ReadBasketBulk(TBuffer &b, void *values, Int_t n)
+{
+   // Read the values of n consecutive entries from the basket buffer into
+   // the contiguous array values (see TBranch::GetBulkEntries).
+   // Returns kFALSE, reading nothing, for a variable size leaf.
+
+   if (fLeafCount) return kFALSE;
+   b.ReadFastArray((Double_t*)values, n*fLen);
+   return kTRUE;
+}
+
 //______________________________________________________________________________
 void TLeafD::ReadBasketExport(TBuffer &b, TClonesArray *list, Int_t n)
 {
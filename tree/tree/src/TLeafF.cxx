@@ -142,6 +142,18 @@ void TLeafF::ReadBasket(TBuffer &b)
    }
 }
 
+//______________________________________________________________________________
+Bool_t TLeafF::ReadBasketBulk(TBuffer &b, void *values, Int_t n)
+{
+   // Read the values of n consecutive entries from the basket buffer into
+   // the contiguous array values (see TBranch::GetBulkEntries).
+   // Returns kFALSE, reading nothing, for a variable size leaf.
+
+   if (fLeafCount) return kFALSE;
+   b.ReadFastArray((Float_t*)values, n*fLen);
+   return kTRUE;
+}
+
 //______________________________________________________________________________
 void TLeafF::ReadBasketExport(TBuffer &b, TClonesArray *list, Int_t n)
 {
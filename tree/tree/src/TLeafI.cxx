@@ -177,6 +177,18 @@ void TLeafI::ReadBasket(TBuffer &b)
    }
 }
 
+//______________________________________________________________________________
+Bool_t TLeafI::ReadBasketBulk(TBuffer &b, void *values, Int_t n)
+{
+   // Read the values of n consecutive entries from the basket buffer into
+   // the contiguous array values (see TBranch::GetBulkEntries).
+   // Returns kFALSE, reading nothing, for a variable size leaf.
+
+   if (fLeafCount) return kFALSE;
+   b.ReadFastArray((Int_t*)values, n*fLen);
+   return kTRUE;
+}
+
 //______________________________________________________________________________
 void TLeafI::ReadBasketExport(TBuffer &b, TClonesArray *list, Int_t n)
 {
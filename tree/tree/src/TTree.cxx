@@ -365,6 +365,9 @@
 #include "TBranchSTL.h"
 #include "TSchemaRuleSet.h"
 #include "TFileMergeInfo.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "Compression.h"
 
 #include <cstddef>
 #include <fstream>
@@ -372,9 +375,12 @@
 #include <string>
 #include <stdio.h>
 #include <limits.h>
+#include <vector>
 
 Int_t    TTree::fgBranchStyle = 1;  // Use new TBranch style with TBranchElement.
 Long64_t TTree::fgMaxTreeSize = 100000000000LL;
+Int_t    TTree::fgProcessThreads = 1;  // Process the entries in the calling thread.
+Int_t    TTree::fgFlushThreads = 1;    // Compress the baskets in the calling thread.
 
 TTree* gTree;
 
@@ -3176,6 +3182,12 @@ Long64_t TTree::CopyEntries(TTree* tree, Long64_t nentries /* = -1 */, Option_t*
    //
    // See TTree::CloneTree for a detailed explanation of the semantics of these 3 options.
    //
+   // With 'fast', the baskets keep the compression of the input file, unless
+   // 'option' also contains the word 'recompress': the baskets whose input and
+   // output branches have different compression settings (or dictionaries) are
+   // then unzipped and zipped again, by TTree::GetFlushThreads() threads, still
+   // without being unstreamed (see TTreeCloner::WriteRecompressedBaskets).
+   //
    // If the tree or any of the underlying tree of the chain has an index, that index and any
    // index in the subsequent underlying TTree objects will be merged.
    //
@@ -3235,7 +3247,11 @@ Long64_t TTree::CopyEntries(TTree* tree, Long64_t nentries /* = -1 */, Option_t*
          TTreeCloner cloner(tree->GetTree(), this, option, TTreeCloner::kNoWarnings);
          if (cloner.IsValid()) {
             this->SetEntries(this->GetEntries() + tree->GetTree()->GetEntries());
-            cloner.Exec();
+            if (!cloner.Exec()) {
+               // Some baskets were already written: the output is incomplete.
+               Error("CopyEntries", "%s", cloner.GetWarning());
+               return -1;
+            }
          } else {
             if (i == 0) {
                Warning("CopyEntries","%s",cloner.GetWarning());               
@@ -4523,14 +4539,108 @@ Int_t TTree::Fit(const char* funcname, const char* varexp, const char* selection
    return -1;
 }
 
+//______________________________________________________________________________
+//
+// Helpers for the parallel compression of the baskets in TTree::FlushBaskets.
+//
+class TBasketCompressionQueue {
+public:
+   TMutex                 fMutex;    // Protects fNext
+   std::vector<TBasket*>  fBaskets;  // Baskets to be compressed
+   std::vector<TFile*>    fFiles;    // File each basket will be written to
+   UInt_t                 fNext;     // Next basket to be compressed
+
+   TBasketCompressionQueue() : fNext(0) {}
+
+   static void *Run(void *arg) {
+      // Compress the baskets of the queue until none is left.
+      TBasketCompressionQueue *queue = (TBasketCompressionQueue*)arg;
+      while (1) {
+         UInt_t i;
+         {
+            TLockGuard lock(&queue->fMutex);
+            if (queue->fNext >= queue->fBaskets.size()) break;
+            i = queue->fNext++;
+         }
+         queue->fBaskets[i]->CompressBuffer(queue->fFiles[i], kTRUE);
+      }
+      return 0;
+   }
+};
+
+//______________________________________________________________________________
+static void R__CollectBasketsToFlush(TObjArray *branches, TBasketCompressionQueue &queue)
+{
+   // Add to the queue the baskets of the branches (and their sub-branches)
+   // which FlushBaskets will write and which can be compressed concurrently.
+
+   const Int_t kWrite = 1;
+   Int_t nb = branches->GetEntriesFast();
+   for (Int_t j = 0; j < nb; j++) {
+      TBranch *branch = (TBranch*) branches->UncheckedAt(j);
+      if (!branch) continue;
+      TObjArray *baskets = branch->GetListOfBaskets();
+      if (branch->GetDirectory() && baskets->GetEntries()
+          && branch->GetCompressionLevel() > 0
+          && ROOT::IsCompressionThreadSafe(branch->GetCompressionAlgorithm())) {
+         Int_t maxbasket = TMath::Min(branch->GetWriteBasket() + 1, baskets->GetSize());
+         for (Int_t i = 0; i < maxbasket; ++i) {
+            TBasket *basket = (TBasket*) baskets->UncheckedAt(i);
+            // Same selection as in TBranch::FlushOneBasket; derived classes
+            // (e.g. TBasketSQL) may not go through TBasket::WriteBuffer.
+            if (!basket || basket->IsA() != TBasket::Class()) continue;
+            if (!basket->GetNevBuf() || branch->GetBasketSeek(i) != 0) continue;
+            if (basket->GetBufferRef()->TestBit(TBufferFile::kNotDecompressed)) continue;
+            TFile *file = branch->GetFile(kWrite);
+            if (!file || !file->IsWritable()) continue;
+            if (basket->GetBufferRef()->IsReading()) {
+               basket->SetWriteMode();
+            }
+            queue.fBaskets.push_back(basket);
+            queue.fFiles.push_back(file);
+         }
+      }
+      R__CollectBasketsToFlush(branch->GetListOfBranches(), queue);
+   }
+}
+
 //______________________________________________________________________________
 Int_t TTree::FlushBaskets() const
 {
    // Write to disk all the basket that have not yet been individually written.
    //
+   // If TTree::SetFlushThreads has been called, the baskets are first
+   // compressed concurrently and then written in the usual order, so that
+   // the content of the file is the same as in the sequential case.
+   //
    // Return the number of bytes written or -1 in case of write error.
 
    if (!fDirectory) return 0;
+
+   Int_t nthreads = fgFlushThreads;
+   if (nthreads == 0) {
+      SysInfo_t info;
+      gSystem->GetSysInfo(&info);
+      nthreads = info.fCpus;
+   }
+   if (nthreads > 1) {
+      TBasketCompressionQueue queue;
+      R__CollectBasketsToFlush(const_cast<TTree*>(this)->GetListOfBranches(), queue);
+      Int_t nextra = TMath::Min(nthreads, (Int_t)queue.fBaskets.size()) - 1;
+      std::vector<TThread*> threads;
+      for (Int_t i = 0; i < nextra; ++i) {
+         TThread *thread = new TThread(TBasketCompressionQueue::Run, &queue);
+         threads.push_back(thread);
+         thread->Run();
+      }
+      // The calling thread takes its share of the work.
+      TBasketCompressionQueue::Run(&queue);
+      for (UInt_t i = 0; i < threads.size(); ++i) {
+         threads[i]->Join();
+         delete threads[i];
+      }
+   }
+
    Int_t nbytes = 0;
    Int_t nerror = 0;
    TObjArray *lb = const_cast<TTree*>(this)->GetListOfBranches();
@@ -5316,6 +5426,25 @@ Long64_t TTree::GetMaxTreeSize()
    return fgMaxTreeSize;
 }
 
+//______________________________________________________________________________
+Int_t TTree::GetProcessThreads()
+{
+   // Static function which returns the number of threads used by TTree::Process.
+   // 1 means the entries are processed in the calling thread, 0 one thread per core.
+
+   return fgProcessThreads;
+}
+
+//______________________________________________________________________________
+Int_t TTree::GetFlushThreads()
+{
+   // Static function which returns the number of threads compressing the
+   // baskets in TTree::FlushBaskets. 1 means the baskets are compressed in
+   // the calling thread, 0 one thread per core.
+
+   return fgFlushThreads;
+}
+
 //______________________________________________________________________________
 Double_t TTree::GetMinimum(const char* columname)
 {
@@ -7415,6 +7544,11 @@ void TTree::SetCacheSize(Long64_t cacheSize)
    if (cacheSize == 0) {
       return;
    }
+   if (file->IsMapped()) {
+      // The baskets are read straight from the file memory mapping,
+      // a cache would only add a copy (see TFile::SetMemoryMapping).
+      return;
+   }
 
    if(TTreeCacheUnzip::IsParallelUnzip() && file->GetCompressionLevel() > 0)
       new TTreeCacheUnzip(this, cacheSize);
@@ -7492,6 +7626,40 @@ void TTree::SetCircular(Long64_t maxEntries)
    }
 }
 
+//______________________________________________________________________________
+void TTree::SetCompressionDictionarySize(const char* bname, Int_t size)
+{
+   // Build a compression dictionary of at most size bytes for each branch
+   // from the first baskets written from now on (see
+   // TBranch::SetCompressionDictionarySize).
+   //
+   // This reduces the size of the files and speeds up the decompression
+   // of trees with many branches whose baskets are small (a few kB).
+   //
+   // bname is the name of a branch.
+   // if bname="*", apply to all branches.
+   // if bname="xxx*", apply to all branches with name starting with xxx
+   // see TRegexp for wildcarding options
+   // size = 0 cancels the building of the dictionaries not yet complete.
+
+   Int_t nleaves = fLeaves.GetEntriesFast();
+   TRegexp re(bname, kTRUE);
+   Int_t nb = 0;
+   for (Int_t i = 0; i < nleaves; i++)  {
+      TLeaf* leaf = (TLeaf*) fLeaves.UncheckedAt(i);
+      TBranch* branch = (TBranch*) leaf->GetBranch();
+      TString s = branch->GetName();
+      if (strcmp(bname, branch->GetName()) && (s.Index(re) == kNPOS)) {
+         continue;
+      }
+      nb++;
+      branch->SetCompressionDictionarySize(size);
+   }
+   if (!nb) {
+      Error("SetCompressionDictionarySize", "unknown branch -> '%s'", bname);
+   }
+}
+
 //______________________________________________________________________________
 void TTree::SetDebug(Int_t level, Long64_t min, Long64_t max)
 {
@@ -7807,6 +7975,46 @@ void TTree::SetParallelUnzip(Bool_t opt, Float_t RelSize)
 
 }
 
+//______________________________________________________________________________
+void TTree::SetFlushThreads(Int_t nthreads)
+{
+   // Set the number of threads used by TTree::FlushBaskets (static function).
+   //
+   // With nthreads > 1 (or nthreads = 0 for one thread per core) the baskets
+   // flushed by FlushBaskets, in particular when TTree::Fill reaches
+   // fAutoFlush, are compressed concurrently. They are then written to the
+   // file in the same order as in the sequential case, so the file content
+   // does not depend on the number of threads.
+   // Branches using the very old compression algorithm, which is not
+   // reentrant, are always compressed in the calling thread.
+   //
+   // The default, nthreads = 1, compresses the baskets in the calling thread.
+
+   fgFlushThreads = nthreads < 0 ? 1 : nthreads;
+}
+
+//______________________________________________________________________________
+void TTree::SetProcessThreads(Int_t nthreads)
+{
+   // Set the number of threads used by TTree::Process(TSelector*) (static function).
+   //
+   // With nthreads > 1 (or nthreads = 0 for one thread per core) the clusters
+   // of the tree are distributed among the threads. Each thread opens its own
+   // copy of the file and tree, with its own TTreeCache, and creates its own
+   // instance of the selector class, on which SlaveBegin, Init, Process and
+   // SlaveTerminate are called. Begin and Terminate are called on the selector
+   // given to Process, after the objects in the output lists of the thread
+   // selectors have been merged into its output list via their Merge(TCollection*)
+   // method, as it is done by PROOF.
+   // The selector class must be compiled (e.g. via ACLiC) and thread safe.
+   // Trees in a TChain or in a file open for writing, trees with an event
+   // or entry list and TTree::Draw are always processed sequentially.
+   //
+   // The default, nthreads = 1, processes the entries in the calling thread.
+
+   fgProcessThreads = nthreads < 0 ? 1 : nthreads;
+}
+
 //______________________________________________________________________________
 void TTree::SetTreeIndex(TVirtualIndex* index)
 {
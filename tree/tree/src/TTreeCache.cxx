@@ -217,6 +217,25 @@
 //   buffers are read, it might be faster to run without a cache.
 //
 //
+//   ACCESS PROFILES AND ADAPTIVE CACHE SIZE
+//   =======================================
+//
+//   With TTreeCache::SetProfileDir(dir) (or the rootrc variable
+//   TTreeCache.ProfileDir) the set of branches found at the end of the
+//   learning phase is saved in dir/<treename>_<hash>.ttreecache, hash being
+//   computed from the name of the file of the tree. The next caches created
+//   for this tree load this profile instead of learning, and thus prefetch
+//   the right branches from the first entry. If the branches read with a
+//   profile differ from the ones it lists, the profile is saved again with
+//   the branches read when the cache is deleted. Delete the file or call
+//   StartLearningPhase to learn again.
+//
+//   With TTreeCache::SetAutoResize() (or TTreeCache.AutoResize) the cache
+//   grows to hold a full cluster of the cached branches whenever the
+//   clusters turn out to be larger than the size given to SetCacheSize.
+//   The largest cluster size is also kept in the profile, so that the next
+//   run starts with the right size.
+//
 //   HOW TO VERIFY That the TreeCache has been used and check its performance
 //   ========================================================================
 //
@@ -231,6 +250,7 @@
 #include "TTreeCache.h"
 #include "TChain.h"
 #include "TList.h"
+#include "THashList.h"
 #include "TBranch.h"
 #include "TEventList.h"
 #include "TObjString.h"
@@ -238,9 +258,17 @@
 #include "TLeaf.h"
 #include "TFriendElement.h"
 #include "TFile.h"
+#include "TEnv.h"
+#include "TMath.h"
+#include "TSystem.h"
 #include <limits.h>
+#include <fstream>
 
-Int_t TTreeCache::fgLearnEntries = 100;
+Int_t   TTreeCache::fgLearnEntries  = 100;
+TString TTreeCache::fgProfileDir;
+Bool_t  TTreeCache::fgProfileDirSet = kFALSE;
+Int_t   TTreeCache::fgAutoResize    = -1;
+Int_t   TTreeCache::fgMaxAutoSize   = 256000000;
 
 ClassImp(TTreeCache)
 
@@ -267,7 +295,9 @@ TTreeCache::TTreeCache() : TFileCacheRead(),
    fFirstEntry(-1),
    fReadDirectionSet(kFALSE),
    fEnabled(kTRUE),
-   fPrefillType(TTreeCache::kNoPrefill)
+   fPrefillType(TTreeCache::kNoPrefill),
+   fProfileRead(0),
+   fClusterBytes(0)
 {
    // Default Constructor.
 }
@@ -295,13 +325,21 @@ TTreeCache::TTreeCache(TTree *tree, Int_t buffersize) : TFileCacheRead(tree->Get
    fFirstEntry(-1),
    fReadDirectionSet(kFALSE),
    fEnabled(kTRUE),
-   fPrefillType(TTreeCache::kNoPrefill)
+   fPrefillType(TTreeCache::kNoPrefill),
+   fProfileRead(0),
+   fClusterBytes(0)
 {
    // Constructor.
 
    fEntryNext = fEntryMin + fgLearnEntries;
    Int_t nleaves = tree->GetListOfLeaves()->GetEntries();
    fBranches = new TObjArray(nleaves);
+
+   if (GetProfileDir()[0]) {
+      // The name is computed once: with a chain, the current file changes.
+      fProfileName = GetProfileName();
+      LoadProfile();
+   }
 }
 
 //______________________________________________________________________________
@@ -313,6 +351,19 @@ TTreeCache::~TTreeCache()
    // we are deleted explicitly by legacy user code).
    if (fFile) fFile->SetCacheRead(0, fTree);   
 
+   // Update the access profile if the branches read with it differ from the
+   // ones it lists (for example for another analysis of the same tree).
+   if (fProfileUsed && !fIsManual && fProfileRead && fProfileRead->GetSize()) {
+      Bool_t same = fProfileRead->GetSize() == fBrNames->GetSize();
+      TIter next(fProfileRead);
+      TObject *name;
+      while (same && (name = next())) {
+         if (!fBrNames->FindObject(name->GetName())) same = kFALSE;
+      }
+      if (!same) SaveProfile(fProfileRead);
+   }
+   if (fProfileRead) {fProfileRead->Delete(); delete fProfileRead; fProfileRead=0;}
+
    delete fBranches;
    if (fBrNames) {fBrNames->Delete(); delete fBrNames; fBrNames=0;}
 }
@@ -571,6 +622,7 @@ Bool_t TTreeCache::FillBuffer()
    TTree *tree = ((TBranch*)fBranches->UncheckedAt(0))->GetTree();
    Long64_t entry = tree->GetReadEntry();
    Long64_t fEntryCurrentMax = 0;
+   Bool_t wasLearning = fIsLearning;
 
    if (fEnablePrefetching) { // Prefetching mode
       if (fIsLearning) { //  Learning mode
@@ -669,6 +721,9 @@ Bool_t TTreeCache::FillBuffer()
       }
    }
 
+   // Record the size of this cluster and grow the cache if it does not fit.
+   AdaptBufferSize(fEntryCurrent, fEntryNext);
+
    //clear cache buffer
    Int_t fNtotCurrentBuf = 0;
    if (fEnablePrefetching){ //prefetching mode
@@ -853,9 +908,40 @@ Bool_t TTreeCache::FillBuffer()
       }
    }
    fIsLearning = kFALSE;
+   if (wasLearning && !fIsManual && !fProfileUsed && GetProfileDir()[0]) {
+      SaveProfile(fBrNames);
+   }
    return kTRUE;
 }
 
+//_____________________________________________________________________________
+void TTreeCache::AdaptBufferSize(Long64_t first, Long64_t next)
+{
+   // Compute the number of bytes of the baskets of the cached branches in
+   // the entry range [first,next), i.e. usually one cluster, and keep the
+   // largest value in fClusterBytes. If the automatic resizing is enabled
+   // (see SetAutoResize) the cache is grown to hold such a cluster.
+
+   if (next <= first) return;
+   Long64_t bytes = 0;
+   for (Int_t i=0;i<fNbranches;i++) {
+      TBranch *b = (TBranch*)fBranches->UncheckedAt(i);
+      if (b->GetDirectory()==0) continue;
+      if (b->GetDirectory()->GetFile() != fFile) continue;
+      Int_t nb = b->GetWriteBasket();
+      Int_t *lbaskets   = b->GetBasketBytes();
+      Long64_t *entries = b->GetBasketEntry();
+      if (!lbaskets || !entries || nb <= 0) continue;
+      Int_t j = (Int_t)TMath::BinarySearch((Long64_t)nb, entries, first);
+      if (j < 0) j = 0;
+      for (; j<nb && entries[j]<next; j++) {
+         if (lbaskets[j] > 0) bytes += lbaskets[j];
+      }
+   }
+   if (bytes > fClusterBytes) fClusterBytes = bytes;
+   if (GetAutoResize() && !fEnablePrefetching) SetBufferSizeMin(fClusterBytes + fClusterBytes/10);
+}
+
 //_____________________________________________________________________________
 Double_t TTreeCache::GetEfficiency() const
 {
@@ -893,6 +979,47 @@ Int_t TTreeCache::GetLearnEntries()
    return fgLearnEntries;
 }
 
+//_____________________________________________________________________________
+Bool_t TTreeCache::GetAutoResize()
+{
+   // Static function returning true if the caches adapt their size to the
+   // clusters (see SetAutoResize). The default is taken from the
+   // TTreeCache.AutoResize rootrc variable.
+
+   if (fgAutoResize < 0)
+      fgAutoResize = gEnv->GetValue("TTreeCache.AutoResize", 0) ? 1 : 0;
+   return fgAutoResize == 1;
+}
+
+//_____________________________________________________________________________
+const char *TTreeCache::GetProfileDir()
+{
+   // Static function returning the directory where the access profiles are
+   // kept, "" if they are not used (see SetProfileDir). The default is taken
+   // from the TTreeCache.ProfileDir rootrc variable.
+
+   if (!fgProfileDirSet) {
+      fgProfileDir = gEnv->GetValue("TTreeCache.ProfileDir", "");
+      fgProfileDirSet = kTRUE;
+   }
+   return fgProfileDir.Data();
+}
+
+//_____________________________________________________________________________
+TString TTreeCache::GetProfileName() const
+{
+   // Return the name of the file holding the access profile of our tree:
+   // the name of the tree and a hash of the name of its current file, so
+   // that trees of the same name in different files have their own profile.
+
+   if (fProfileName.Length()) return fProfileName;
+   TString name(fTree ? fTree->GetName() : "");
+   name.ReplaceAll("/","_");
+   TFile *file = fTree ? fTree->GetCurrentFile() : 0;
+   TString filename(file ? file->GetName() : "");
+   return TString::Format("%s/%s_%08x.ttreecache", GetProfileDir(), name.Data(), (UInt_t)filename.Hash());
+}
+
 //_____________________________________________________________________________
 TTree *TTreeCache::GetTree() const
 {
@@ -901,6 +1028,104 @@ TTree *TTreeCache::GetTree() const
    return ((TBranch*)(fBranches->UncheckedAt(0)))->GetTree();
 }
 
+//_____________________________________________________________________________
+Bool_t TTreeCache::LoadProfile()
+{
+   // Load the access profile of our tree, if any: the branches it lists
+   // are added to the cache and the learning phase is skipped. Return
+   // false if there is no usable profile.
+   // The profile is a text file with one line 'clusterbytes <n>' followed by
+   // one line per cached branch.
+
+   if (!fTree || !fIsLearning) return kFALSE;
+   TString filename = GetProfileName();
+   std::ifstream in(filename.Data());
+   if (!in) return kFALSE;
+
+   TTree *tree = fTree->GetTree();
+   Long64_t clusterbytes = 0;
+   TString line;
+   while (line.ReadLine(in)) {
+      if (line.IsNull() || line[0] == '#') continue;
+      if (line.BeginsWith("clusterbytes ")) {
+         clusterbytes = TString(line(13,line.Length())).Atoll();
+         continue;
+      }
+      if (fBrNames->FindObject(line)) continue;
+      if (tree) {
+         TBranch *b = tree->GetBranch(line);
+         if (!b) continue;
+         fBranches->AddAtAndExpand(b, fNbranches);
+         fNbranches++;
+      }
+      // With a chain whose first tree is not loaded yet, the branches are
+      // found by UpdateBranches.
+      fBrNames->Add(new TObjString(line));
+   }
+   if (fBrNames->GetEntries() == 0) return kFALSE;
+
+   if (gDebug > 0) {
+      Info("LoadProfile", "%d branches and cluster size %lld taken from %s",
+           fBrNames->GetEntries(), clusterbytes, filename.Data());
+   }
+   fProfileUsed = kTRUE;
+   fIsLearning = kFALSE;
+   fEntryNext = -1; // Force the filling of the cache at the first entry.
+   if (fProfileRead) fProfileRead->Delete();
+   if (clusterbytes > fClusterBytes) fClusterBytes = clusterbytes;
+   if (GetAutoResize() && !fEnablePrefetching) SetBufferSizeMin(fClusterBytes + fClusterBytes/10);
+   return kTRUE;
+}
+
+//_____________________________________________________________________________
+void TTreeCache::SaveProfile(const TList *branches) const
+{
+   // Save the names of branches (the cached branches or the branches read
+   // with the profile) and the largest cluster size seen so far in the access
+   // profile of our tree (see LoadProfile). The file is written under a
+   // temporary name and then renamed, so that jobs running concurrently never
+   // see a partial profile. fTree is not used: this is also called by the
+   // destructor, when the tree may be gone.
+
+   if (!branches || branches->GetEntries() == 0) return;
+   TString filename = GetProfileName();
+   if (filename.IsNull()) return;
+   TString tmpname = TString::Format("%s.%d", filename.Data(), gSystem->GetPid());
+   if (gSystem->AccessPathName(GetProfileDir())) gSystem->mkdir(GetProfileDir(), kTRUE);
+   {
+      std::ofstream out(tmpname.Data());
+      if (!out) {
+         Warning("SaveProfile", "cannot write the access profile %s", tmpname.Data());
+         return;
+      }
+      out << "# TTreeCache access profile" << std::endl;
+      out << "clusterbytes " << fClusterBytes << std::endl;
+      TIter next(branches);
+      TObjString *os;
+      while ((os = (TObjString*)next())) {
+         out << os->GetName() << std::endl;
+      }
+   }
+   if (gSystem->Rename(tmpname, filename)) {
+      gSystem->Unlink(tmpname);
+      return;
+   }
+   TTreeCache *self = const_cast<TTreeCache*>(this);
+   self->fProfileUsed = kTRUE;
+   self->fProfileName = filename;
+   // The branches read during the learning phase are the saved ones.
+   if (!self->fProfileRead) self->fProfileRead = new THashList;
+   if (branches != fProfileRead) {
+      self->fProfileRead->Delete();
+      TIter nextread(branches);
+      TObject *name;
+      while ((name = nextread())) self->fProfileRead->Add(new TObjString(name->GetName()));
+   }
+   if (gDebug > 0) {
+      Info("SaveProfile", "%d branches saved in %s", branches->GetEntries(), filename.Data());
+   }
+}
+
 //_____________________________________________________________________________
 void TTreeCache::Print(Option_t *option) const
 {
@@ -1052,7 +1277,10 @@ void TTreeCache::SetEntryRange(Long64_t emin, Long64_t emax)
 
    fEntryMin  = emin;
    fEntryMax  = emax;
-   fEntryNext  = fEntryMin + fgLearnEntries;
+   // With the branches of an access profile there is nothing to learn:
+   // keep filling the cache from the first entry.
+   if (fProfileUsed && !fIsLearning) fEntryNext = -1;
+   else fEntryNext  = fEntryMin + fgLearnEntries;
    if (gDebug > 0)
       Info("SetEntryRange", "fEntryMin=%lld, fEntryMax=%lld, fEntryNext=%lld",
                              fEntryMin, fEntryMax, fEntryNext);
@@ -1079,6 +1307,44 @@ void TTreeCache::SetFile(TFile *file)
    TFileCacheRead::SetFile(file);
 }
 
+//_____________________________________________________________________________
+void TTreeCache::SetAutoResize(Bool_t resize, Int_t maxsize)
+{
+   // Static function to make the caches grow, up to maxsize bytes (256 MB
+   // by default, 0 keeps the current limit), whenever a cluster of the
+   // cached branches does not fit in the size given to TTree::SetCacheSize.
+   // The caches never shrink. This is not done in the asynchronous
+   // prefetching mode.
+
+   fgAutoResize = resize ? 1 : 0;
+   if (maxsize > 0) fgMaxAutoSize = maxsize;
+}
+
+//_____________________________________________________________________________
+void TTreeCache::SetBufferSizeMin(Long64_t size)
+{
+   // Grow the cache to size bytes (bounded by fgMaxAutoSize). Called just
+   // before the cache is refilled, so that the content of the buffer does
+   // not need to be preserved.
+
+   if (size > fgMaxAutoSize) size = fgMaxAutoSize;
+   if (size <= fBufferSizeMin) return;
+   if (gDebug > 0) {
+      Info("SetBufferSizeMin", "cache size of tree %s changed from %d to %lld bytes",
+           fTree ? fTree->GetName() : "", fBufferSizeMin, size);
+   }
+   fBufferSizeMin = (Int_t)size;
+   if (fBufferSize < fBufferSizeMin) {
+      // TFileCacheRead::Sort only reallocates above fBufferSizeMin.
+      fBufferSize = fBufferSizeMin;
+      if (fBuffer) {
+         delete [] fBuffer;
+         fBuffer = new char[fBufferSize];
+      }
+      fIsTransferred = kFALSE;
+   }
+}
+
 //_____________________________________________________________________________
 void TTreeCache::SetLearnEntries(Int_t n)
 {
@@ -1101,6 +1367,20 @@ void TTreeCache::SetLearnPrefill(TTreeCache::EPrefillType type /* = kNoPrefill *
    fPrefillType = type;
 }
 
+//_____________________________________________________________________________
+void TTreeCache::SetProfileDir(const char *dir)
+{
+   // Static function to set the directory where the access profiles of the
+   // trees are kept; "" or 0 disables them. When set, the branches learned by
+   // a cache are saved in dir/<treename>_<hash>.ttreecache at the end of
+   // the learning phase (hash being computed from the name of the file of
+   // the tree) and the caches created later for this tree start with these
+   // branches instead of learning them.
+
+   fgProfileDir = dir ? dir : "";
+   fgProfileDirSet = kTRUE;
+}
+
 //_____________________________________________________________________________
 void TTreeCache::StartLearningPhase()
 {
@@ -1110,6 +1390,8 @@ void TTreeCache::StartLearningPhase()
 
    fIsLearning = kTRUE;
    fIsManual = kFALSE;
+   fProfileUsed = kFALSE;
+   if (fProfileRead) fProfileRead->Delete();
    fNbranches  = 0;
    if (fBrNames) fBrNames->Delete();
    fIsTransferred = kFALSE;
@@ -1140,6 +1422,20 @@ void TTreeCache::StopLearningPhase()
    }
 }
 
+//_____________________________________________________________________________
+void TTreeCache::UpdateProfile(TBranch *b)
+{
+   // Record that a basket of b is read while the branches of the cache come
+   // from the access profile; this function is called by TBranch::GetBasket
+   // when IsProfileUsed() is true.
+   // The destructor saves the profile again if the branches read differ
+   // from the ones it lists.
+
+   if (!fProfileUsed || fIsLearning || fIsManual || !b) return;
+   if (!fProfileRead) fProfileRead = new THashList;
+   if (!fProfileRead->FindObject(b->GetName())) fProfileRead->Add(new TObjString(b->GetName()));
+}
+
 //_____________________________________________________________________________
 void TTreeCache::UpdateBranches(TTree *tree)
 {
@@ -24,9 +24,11 @@
 // Parallel Unzipping                                                   //
 //                                                                      //
 // TTreeCache has been specialised in order to let additional threads   //
-//  free to unzip in advance its content. In this implementation we     //
-//  support up to 10 threads, but right now it makes more sense to      //
-//  limit their number to 1-2                                           //
+//  free to unzip in advance its content. Once the baskets of a cluster //
+//  have been transferred, each of them is handed over as a separate    //
+//  task to a TThreadPool, whose threads decompress them concurrently.  //
+//  By default the pool has one thread per core, this can be changed    //
+//  with TTreeCacheUnzip::SetUnzipThreads.                              //
 //                                                                      //
 // The application reading data is carefully synchronized, in order to: //
 //  - if the block it wants is not unzipped, it self-unzips it without  //
@@ -53,16 +55,48 @@
 #include "TVirtualMutex.h"
 #include "TThread.h"
 #include "TCondition.h"
+#include "TThreadPool.h"
+#include "TSystem.h"
 #include "TMath.h"
 #include "Bytes.h"
 
 #include "TEnv.h"
 
-#define THREADCNT 2
 extern "C" void R__unzip(Int_t *nin, UChar_t *bufin, Int_t *lout, char *bufout, Int_t *nout);
 extern "C" int R__unzip_header(Int_t *nin, UChar_t *bufin, Int_t *lout);
 
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TTreeCacheUnzipBlock                                                 //
+//                                                                      //
+// Argument of an unzipping task: the index of the block in the cache   //
+// and the cycle of the cache in which the block was scheduled.         //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+struct TTreeCacheUnzipBlock {
+   Int_t fIndex;
+   Int_t fCycle;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TTreeCacheUnzipTask                                                  //
+//                                                                      //
+// Task run by the threads of the pool, it unzips a single block.       //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+class TTreeCacheUnzipTask : public TThreadPoolTaskImp<TTreeCacheUnzipTask, TTreeCacheUnzipBlock> {
+public:
+   TTreeCacheUnzipTask(TTreeCacheUnzip *cache) : fCache(cache) { }
+   bool runTask(TTreeCacheUnzipBlock &block) {
+      return fCache->UnzipCache(block.fIndex, block.fCycle) == 0;
+   }
+private:
+   TTreeCacheUnzip *fCache;
+};
+
 TTreeCacheUnzip::EParUnzipMode TTreeCacheUnzip::fgParallel = TTreeCacheUnzip::kDisable;
+Int_t TTreeCacheUnzip::fgNThreads = 0;
 
 // The unzip cache does not consume memory by itself, it just allocates in advance
 // mem blocks which are then picked as they are by the baskets.
@@ -74,6 +108,10 @@ ClassImp(TTreeCacheUnzip)
 //______________________________________________________________________________
 TTreeCacheUnzip::TTreeCacheUnzip() : TTreeCache(),
 
+   fUnzipPool(0),
+   fUnzipTask(0),
+   fNUnzipThreads(0),
+   fNPending(0),
    fActiveThread(kFALSE),
    fAsyncReading(kFALSE),
    fCycle(0),
@@ -98,6 +136,10 @@ TTreeCacheUnzip::TTreeCacheUnzip() : TTreeCache(),
 
 //______________________________________________________________________________
 TTreeCacheUnzip::TTreeCacheUnzip(TTree *tree, Int_t buffersize) : TTreeCache(tree,buffersize),
+   fUnzipPool(0),
+   fUnzipTask(0),
+   fNUnzipThreads(0),
+   fNPending(0),
    fActiveThread(kFALSE),
    fAsyncReading(kFALSE),
    fCycle(0),
@@ -127,7 +169,6 @@ void TTreeCacheUnzip::Init()
    fMutexList        = new TMutex(kTRUE);
    fIOMutex          = new TMutex(kTRUE);
 
-   fUnzipStartCondition   = new TCondition(fMutexList);
    fUnzipDoneCondition   = new TCondition(fMutexList);
 
    fTotalUnzipBytes = 0;
@@ -142,17 +183,23 @@ void TTreeCacheUnzip::Init()
       SysInfo_t info;
       gSystem->GetSysInfo(&info);
 
-      fUnzipBufferSize = Long64_t(fgRelBuffSize * GetBufferSize());
-
-      if(gDebug > 0)
-         Info("TTreeCacheUnzip", "Enabling Parallel Unzipping");
+      Int_t nthreads = fgNThreads;
+      if (nthreads <= 0) nthreads = info.fCpus;
+      if (nthreads <= 0) nthreads = 1;
 
-      fParallel = kTRUE;
+      fUnzipBufferSize = Long64_t(fgRelBuffSize * GetBufferSize());
 
-      for (Int_t i = 0; i < 10; i++) fUnzipThread[i] = 0;
+      if (fgParallel == kEnable && fgNThreads <= 0 && info.fCpus == 1) {
+         // A single core: the additional thread would only compete with the reader.
+         fParallel = kFALSE;
+      } else {
+         if(gDebug > 0)
+            Info("TTreeCacheUnzip", "Enabling Parallel Unzipping with %d threads", nthreads);
 
-      StartThreadUnzip(THREADCNT);
+         fParallel = kTRUE;
 
+         StartThreadUnzip(nthreads);
+      }
    }
    else {
       Warning("TTreeCacheUnzip", "Parallel Option unknown");
@@ -169,18 +216,15 @@ void TTreeCacheUnzip::Init()
 //______________________________________________________________________________
 TTreeCacheUnzip::~TTreeCacheUnzip()
 {
-   // destructor. (in general called by the TFile destructor
    // destructor. (in general called by the TFile destructor)
 
-   ResetCache();
-
    if (IsActiveThread())
       StopThreadUnzip();
 
+   ResetCache();
 
    delete [] fUnzipLen;
 
-   delete fUnzipStartCondition;
    delete fUnzipDoneCondition;
 
 
@@ -218,7 +262,10 @@ Bool_t TTreeCacheUnzip::FillBuffer()
    if (fNbranches <= 0) return kFALSE;
    {
       // Fill the cache buffer with the branches in the cache.
+      // The I/O mutex keeps the unzipping threads away from the
+      // list of blocks while it is being rebuilt.
       R__LOCKGUARD(fMutexList);
+      R__LOCKGUARD(fIOMutex);
       fIsTransferred = kFALSE;
 
       TTree *tree = ((TBranch*)fBranches->UncheckedAt(0))->GetTree();
@@ -385,36 +432,15 @@ Bool_t TTreeCacheUnzip::IsQueueEmpty()
    return kFALSE;
 }
 
-void TTreeCacheUnzip::WaitUnzipStartSignal()
-{
-   // Here the threads sleep waiting for some blocks to unzip
-
-   fUnzipStartCondition->TimedWaitRelative(2000);
-
-}
-//_____________________________________________________________________________
-void TTreeCacheUnzip::SendUnzipStartSignal(Bool_t broadcast)
-{
-   // This will send the signal corresponfing to the queue... normally used
-   // when we want to start processing the list of buffers.
-
-   if (gDebug > 0) Info("SendSignal", " fUnzipCondition->Signal()");
-
-   if (broadcast)
-      fUnzipStartCondition->Broadcast();
-   else 
-      fUnzipStartCondition->Signal();
-}
-
 //_____________________________________________________________________________
 Int_t TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::EParUnzipMode option)
 {
    // Static function that(de)activates multithreading unzipping
    // The possible options are:
    // kEnable _Enable_ it, which causes an automatic detection and launches the
-   // additional thread if the number of cores in the machine is greater than one
-   // kDisable _Disable_ will not activate the additional thread.
-   // kForce _Force_ will start the additional thread even if there is only one core.
+   // additional threads if the number of cores in the machine is greater than one
+   // kDisable _Disable_ will not activate the additional threads.
+   // kForce _Force_ will start the additional threads even if there is only one core.
    // the default will be taken as kEnable.
    // returns 0 if there was an error, 1 otherwise.
 
@@ -426,133 +452,108 @@ Int_t TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::EParUnzipMode option)
 }
 
 
-class TTreeCacheUnzipData {
-public:
-   TTreeCacheUnzip *fInstance;
-   Int_t            fCount;
-};
-
 //_____________________________________________________________________________
-Int_t TTreeCacheUnzip::StartThreadUnzip(Int_t nthreads)
+Int_t TTreeCacheUnzip::GetUnzipThreads()
 {
-   // The Thread is only a part of the TTreeCache but it is the part that
-   // waits for info in the queue and process it... unfortunatly, a Thread is
-   // not an object an we have to deal with it in the old C-Style way
-   // Returns 0 if the thread was initialized or 1 if it was already running
-   Int_t nt = nthreads;
-   if (nt > 10) nt = 10;
+   // Static function returning the number of unzipping threads requested
+   // with SetUnzipThreads, 0 meaning one thread per core.
 
-   if (gDebug > 0)
-      Info("StartThreadUnzip", "Going to start %d threads.", nt);
+   return fgNThreads;
+}
 
-   for (Int_t i = 0; i < nt; i++) {
-      if (!fUnzipThread[i]) {
-         TString nm("UnzipLoop");
-         nm += i;
+//_____________________________________________________________________________
+void TTreeCacheUnzip::SetUnzipThreads(Int_t nthreads)
+{
+   // Static function setting the number of threads of the unzipping pool
+   // of the caches created from now on. 0 (the default) means one thread
+   // per core of the machine.
 
-         if (gDebug > 0)
-            Info("StartThreadUnzip", "Going to start thread '%s'", nm.Data());
+   fgNThreads = nthreads > 0 ? nthreads : 0;
+}
 
-         TTreeCacheUnzipData *d = new TTreeCacheUnzipData;
-         d->fInstance = this;
-         d->fCount = i;
+//_____________________________________________________________________________
+Int_t TTreeCacheUnzip::StartThreadUnzip(Int_t nthreads)
+{
+   // Create the pool of nthreads threads which will unzip the blocks
+   // of the cache. The blocks are handed over to the pool by ScheduleBlocks.
+   // Returns 0 if the pool was created or 1 if it was already running
 
-         fUnzipThread[i] = new TThread(nm.Data(), UnzipLoop, (void*)d);
-         if (!fUnzipThread[i])
-            Error("TTreeCacheUnzip::StartThreadUnzip", " Unable to create new thread.");
+   if (fUnzipPool) return 1;
 
-         fUnzipThread[i]->Run();
+   if (gDebug > 0)
+      Info("StartThreadUnzip", "Going to start %d threads.", nthreads);
 
-         // There is at least one active thread
-         fActiveThread=kTRUE;
+   fUnzipTask = new TTreeCacheUnzipTask(this);
+   fUnzipPool = new TThreadPool<TTreeCacheUnzipTask, TTreeCacheUnzipBlock>(nthreads);
+   fNUnzipThreads = nthreads;
 
-      }
-   }
+   R__LOCKGUARD(fMutexList);
+   fActiveThread = kTRUE;
 
-   return (fActiveThread == kTRUE);
+   return 0;
 }
 
 //_____________________________________________________________________________
 Int_t TTreeCacheUnzip::StopThreadUnzip()
 {
-   // To stop the thread we only need to change the value of the variable
-   // fActiveThread to false and the loop will stop (of course, we will have)
-   // to do the cleaning after that.
-   // Note: The syncronization part is important here or we will try to delete
-   //       teh object while it's still processing the queue
-   fActiveThread = kFALSE;
-
-   for (Int_t i = 0; i < 1; i++) {
-      if(fUnzipThread[i]){
-
-         SendUnzipStartSignal(kTRUE);
+   // Stop the pool of unzipping threads. The tasks still queued are dropped,
+   // the ones being executed notice that fActiveThread is false and give
+   // their block back to the main thread.
+   {
+      R__LOCKGUARD(fMutexList);
+      fActiveThread = kFALSE;
+   }
 
-         if (fUnzipThread[i]->Exists()) {
-            fUnzipThread[i]->Join();
-            delete fUnzipThread[i];
-         }
-      }
+   // This joins the threads
+   delete fUnzipPool;
+   fUnzipPool = 0;
+   delete fUnzipTask;
+   fUnzipTask = 0;
 
-   }
+   R__LOCKGUARD(fMutexList);
+   fNPending = 0;
 
    return 1;
 }
 
-
-
 //_____________________________________________________________________________
-void* TTreeCacheUnzip::UnzipLoop(void *arg)
+void TTreeCacheUnzip::ScheduleBlocks()
 {
-   // This is a static function.
-   // This is the call that will be executed in the Thread generated by
-   // StartThreadTreeCacheUnzip... what we want to do is to inflate the next
-   // series of buffers leaving them in the second cache.
-   // Returns 0 when it finishes
-   TTreeCacheUnzipData *d = (TTreeCacheUnzipData *)arg;
-   TTreeCacheUnzip *unzipMng = d->fInstance;
-
-   TThread::SetCancelOn();
-   TThread::SetCancelDeferred();
-
-   Int_t thrnum = d->fCount;
-   Int_t startindex = thrnum;
-   Int_t locbuffsz = 16384;
-   char *locbuff = new char[16384];
-   Int_t res = 0;
-   Int_t myCycle = 0;
-
-   while( unzipMng->IsActiveThread() ) {
-      res = 1;
-
-      {
-         R__LOCKGUARD(unzipMng->fMutexList);
-         if (myCycle != unzipMng->fCycle) startindex = thrnum;
-         myCycle = unzipMng->fCycle;
-         if (unzipMng->fNseek) startindex = startindex % unzipMng->fNseek;
-         else startindex = -1;
-      }
-
-
-      if (startindex >= 0)
-         res = unzipMng->UnzipCache(startindex, locbuffsz, locbuff);
-
-      {
-         R__LOCKGUARD(unzipMng->fMutexList);
-
-         if(!unzipMng->IsActiveThread()) break;
-
-         if ((res == 1) || (!unzipMng->fIsTransferred)) {
-            unzipMng->WaitUnzipStartSignal();
-            startindex = unzipMng->fLastReadPos+3+thrnum;
+   // Hand over to the thread pool the blocks of the cache which are neither
+   // unzipped nor pending, starting from the one last read by the main thread.
+   // At most two blocks per thread are kept in flight and no block is queued
+   // while the unzipped ones exceed fUnzipBufferSize, so that all the cores
+   // are kept busy without letting the memory grow.
+   // Must be called with fMutexList held.
+
+   if (!fUnzipPool || !fActiveThread || !fNseek || fIsLearning || !fIsTransferred) return;
+
+   Int_t start = fLastReadPos;
+   while (fBlocksToGo > 0 && fNPending < 2*fNUnzipThreads && fTotalUnzipBytes < fUnzipBufferSize) {
+      Int_t idxtounzip = -1;
+      for (Int_t ii = 0; ii < fNseek; ii++) {
+         Int_t reqi = (start+ii) % fNseek;
+         if (!fUnzipStatus[reqi] && (fSeekLen[reqi] > 256)) {
+            idxtounzip = reqi;
+            break;
          }
       }
+      if (idxtounzip < 0) {
+         fBlocksToGo = 0;
+         break;
+      }
 
+      fUnzipStatus[idxtounzip] = 1; // Set it as pending
+      fBlocksToGo--;
+      fNPending++;
 
-   }
+      TTreeCacheUnzipBlock block;
+      block.fIndex = idxtounzip;
+      block.fCycle = fCycle;
+      fUnzipPool->PushTask(*fUnzipTask, block);
 
-   delete d;
-   delete [] locbuff;
-   return (void *)0;
+      start = idxtounzip+1;
+   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -659,12 +660,10 @@ void TTreeCacheUnzip::ResetCache()
    fLastReadPos = 0;
    fTotalUnzipBytes = 0;
    fBlocksToGo = fNseek;
+   // The tasks of the previous cycle still queued will be dropped
+   fNPending = 0;
    }
 
-
-   SendUnzipStartSignal(kTRUE);
-
-
 }
 
 //_____________________________________________________________________________
@@ -763,15 +762,15 @@ Int_t TTreeCacheUnzip::GetUnzipBuffer(char **buf, Long64_t pos, Int_t len, Bool_
                      *buf = fUnzipChunks[seekidx];
                      fUnzipChunks[seekidx] = 0;
                      fTotalUnzipBytes -= fUnzipLen[seekidx];
-                     SendUnzipStartSignal(kFALSE);
+                     ScheduleBlocks();
                      *free = kTRUE;
                   }
                   else {
                      memcpy(*buf, fUnzipChunks[seekidx], fUnzipLen[seekidx]);
-	             delete fUnzipChunks[seekidx];
+                     delete [] fUnzipChunks[seekidx];
                      fTotalUnzipBytes -= fUnzipLen[seekidx];
                      fUnzipChunks[seekidx] = 0;
-                     SendUnzipStartSignal(kFALSE);
+                     ScheduleBlocks();
                      *free = kFALSE;
                   }
 
@@ -815,15 +814,15 @@ Int_t TTreeCacheUnzip::GetUnzipBuffer(char **buf, Long64_t pos, Int_t len, Bool_
                   *buf = fUnzipChunks[seekidx];
                   fUnzipChunks[seekidx] = 0;
                   fTotalUnzipBytes -= fUnzipLen[seekidx];
-                  SendUnzipStartSignal(kFALSE);
+                  ScheduleBlocks();
                   *free = kTRUE;
                }
                else {
                   memcpy(*buf, fUnzipChunks[seekidx], fUnzipLen[seekidx]);
-                  delete fUnzipChunks[seekidx];
+                  delete [] fUnzipChunks[seekidx];
                   fTotalUnzipBytes -= fUnzipLen[seekidx];
                   fUnzipChunks[seekidx] = 0;
-                  SendUnzipStartSignal(kFALSE);
+                  ScheduleBlocks();
                   *free = kFALSE;
                }
 
@@ -832,14 +831,14 @@ Int_t TTreeCacheUnzip::GetUnzipBuffer(char **buf, Long64_t pos, Int_t len, Bool_
 
                return fUnzipLen[seekidx];
             }
-            else {
+            else if (seekidx >= 0) {
                // This is a complete miss. We want to avoid the threads
                // to try unzipping this block in the future.
+               if (!fUnzipStatus[seekidx] && fBlocksToGo) fBlocksToGo--;
                fUnzipStatus[seekidx] = 2;
                fUnzipChunks[seekidx] = 0;
 
-               if ((fTotalUnzipBytes < fUnzipBufferSize) && fBlocksToGo)
-                  SendUnzipStartSignal(kFALSE);
+               ScheduleBlocks();
 
                //if (gDebug > 0)
                //   Info("GetUnzipBuffer", "++++++++++++++++++++ CacheMISS Block wanted: %d  len:%d fNseek:%d", seekidx, len, fNseek);
@@ -891,6 +890,13 @@ Int_t TTreeCacheUnzip::GetUnzipBuffer(char **buf, Long64_t pos, Int_t len, Bool_
 
    } // scope of the lock!
 
+   if (fParallel && !fIsLearning) {
+      // The read above may have triggered the transfer of the cluster:
+      // the pool can now start to unzip its blocks.
+      R__LOCKGUARD(fMutexList);
+      ScheduleBlocks();
+   }
+
    if (!res) {
       res = UnzipBuffer(buf, fCompBuffer);
       *free = kTRUE;
@@ -944,6 +950,12 @@ Int_t TTreeCacheUnzip::UnzipBuffer(char **dest, char *src)
    Int_t nbytes=0, objlen=0, keylen=0;
    GetRecordHeader(src, hlen, nbytes, objlen, keylen);
 
+   if (objlen > nbytes-keylen && src[keylen] == 'Z' && src[keylen+1] == 'D') {
+      // Compressed with the dictionary of its branch: TBasket::ReadBasketBuffers
+      // will unzip it.
+      return -1;
+   }
+
    if (!(*dest)) {
       /* early consistency check */
       UChar_t *bufcur = (UChar_t *) (src + keylen);
@@ -1029,226 +1041,124 @@ Int_t TTreeCacheUnzip::UnzipBuffer(char **dest, char *src)
 }
 
 //_____________________________________________________________________________
-Int_t TTreeCacheUnzip::UnzipCache(Int_t &startindex, Int_t &locbuffsz, char *&locbuff)
+Int_t TTreeCacheUnzip::UnzipCache(Int_t index, Int_t cycle)
 {
-   // This inflates all the buffers in the cache.. passing the data to a new
-   // buffer that will only wait there to be read...
-   // We can not inflate all the buffers in the cache so we will try to do
-   // it until the cache gets full... there is a member called fUnzipBufferSize which will
-   // tell us the max size we can allocate for this cache.
-   //
-   // note that we will  unzip in the order they were put into the cache not
-   // the order of the transference so it has to be read in that order or the
-   // pre-unzipping will be useless.
-   //
-   // startindex is used as start index to check for blks to be unzipped
+   // This inflates the block index of the cache, passing the data to a new
+   // buffer that will only wait there to be read by GetUnzipBuffer.
+   // It is executed by the threads of the pool, each call taking care of
+   // a single block, so that all the blocks of a cluster can be inflated
+   // concurrently. cycle is the value of fCycle when the block was scheduled:
+   // if the cache has been paged in the meantime the block is dropped.
    //
-   // returns 0 in normal conditions or -1 if error, 1 if it would like to sleep
+   // returns 0 in normal conditions or -1 if error, 1 if the block was dropped
    //
-   // This func is supposed to compete among an indefinite number of threads to get a chunk to inflate
-   // in order to accommodate multiple unzippers
    // Since everything is so async, we cannot use a fixed buffer, we are forced to keep
    // the individual chunks as separate blocks, whose summed size does not exceed the maximum
    // allowed. The pointers are kept globally in the array fUnzipChunks
-   Int_t myCycle;
    const Int_t hlen=128;
    Int_t objlen=0, keylen=0;
    Int_t nbytes=0;
    Int_t readbuf = 0;
 
-   Int_t idxtounzip = -1;
    Long64_t rdoffs = 0;
    Int_t rdlen = 0;
    {
       R__LOCKGUARD(fMutexList);
 
-      if (!IsActiveThread() || !fNseek || fIsLearning || !fIsTransferred) {
+      if (cycle != fCycle) return 1;
+
+      if (!fActiveThread || !fNseek || fIsLearning || !fIsTransferred) {
          if (gDebug > 0)
             Info("UnzipCache", "Sudden Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
-                 IsActiveThread(), fNseek, fIsLearning);
-         return 1;
-      }
-
-      // To synchronize with the 'paging'
-      myCycle = fCycle;
-
-      // Try to look for a blk to unzip
-      idxtounzip = -1;
-      rdoffs = 0;
-      rdlen = 0;
-      if (fTotalUnzipBytes < fUnzipBufferSize) {
-
-
-         if (fBlocksToGo > 0) {
-            for (Int_t ii=0; ii < fNseek; ii++) {
-               Int_t reqi = (startindex+ii) % fNseek;
-               if (!fUnzipStatus[reqi] && (fSeekLen[reqi] > 256)   ) {
-                  // We found a chunk which is not unzipped nor pending
-                  fUnzipStatus[reqi] = 1; // Set it as pending
-                  idxtounzip = reqi;
-
-                  rdoffs = fSeek[idxtounzip];
-                  rdlen = fSeekLen[idxtounzip];
-                  break;
-               }
-            }
-	    if (idxtounzip < 0) fBlocksToGo = 0;
-         }
-
+                 fActiveThread, fNseek, fIsLearning);
 
+         // Leave the block to the main thread
+         fUnzipStatus[index] = 2;
+         fNPending--;
+         fUnzipDoneCondition->Broadcast();
+         return 1;
       }
 
+      rdoffs = fSeek[index];
+      rdlen = fSeekLen[index];
    } // lock scope
 
-
-
-   if (idxtounzip < 0) {
-      if (gDebug > 0)
-         Info("UnzipCache", "Nothing to do... startindex:%d fTotalUnzipBytes:%lld fUnzipBufferSize:%lld fNseek:%d",
-              startindex, fTotalUnzipBytes, fUnzipBufferSize, fNseek );
-      return 1;
-   }
-
-
-   // And here we have a new blk to unzip
-   startindex = idxtounzip+THREADCNT;
-
-
-   if (!IsActiveThread() || !fNseek || fIsLearning ) {
-      if (gDebug > 0)
-         Info("UnzipCache", "Sudden Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
-              IsActiveThread(), fNseek, fIsLearning);
-      return 1;
-   }
+   if (gDebug > 0)
+      Info("UnzipCache", "Going to unzip block %d", index);
 
    Int_t loc = -1;
-
-   // Prepare a static tmp buf of adequate size
-   if(locbuffsz < rdlen) {
-      if (locbuff) delete [] locbuff;
-      locbuffsz = rdlen;
-      locbuff = new char[locbuffsz];
-      //memset(locbuff, 0, locbuffsz);
-   } else
-      if(locbuffsz > rdlen*3) {
-         if (locbuff) delete [] locbuff;
-         locbuffsz = rdlen*2;
-         locbuff = new char[locbuffsz];
-         //memset(locbuff, 0, locbuffsz);
-      }
-
-
-      if (gDebug > 0) 
-      Info("UnzipCache", "Going to unzip block %d", idxtounzip);
-
-      readbuf = ReadBufferExt(locbuff, rdoffs, rdlen, loc);
-
-   {
-      R__LOCKGUARD(fMutexList);
-
-      if ( (myCycle != fCycle) || !fIsTransferred )  {
-         if (gDebug > 0)
-            Info("UnzipCache", "Sudden paging Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
-                 IsActiveThread(), fNseek, fIsLearning);
-
-         fUnzipStatus[idxtounzip] = 2; // Set it as not done
-         fUnzipChunks[idxtounzip] = 0;
-         fUnzipLen[idxtounzip] = 0;
-         fUnzipDoneCondition->Signal();
-         
-         startindex = 0;
-         return 1;
-      }
-
-
-      if (readbuf <= 0) {
-         fUnzipStatus[idxtounzip] = 2; // Set it as not done
-         fUnzipChunks[idxtounzip] = 0;
-         fUnzipLen[idxtounzip] = 0;
-         if (gDebug > 0)
-            Info("UnzipCache", "Block %d not done. rdoffs=%lld rdlen=%d readbuf=%d", idxtounzip, rdoffs, rdlen, readbuf);
-         return -1;
-      }
-
-
-      GetRecordHeader(locbuff, hlen, nbytes, objlen, keylen);
-
-      Int_t len = (objlen > nbytes-keylen)? keylen+objlen : nbytes;
-
-      // If the single unzipped chunk is really too big, reset it to not processable
-      // I.e. mark it as done but set the pointer to 0
-      // This block will be unzipped synchronously in the main thread
-      if (len > 4*fUnzipBufferSize) {
-
-         //if (gDebug > 0)
-            Info("UnzipCache", "Block %d is too big, skipping.", idxtounzip);
-
-         fUnzipStatus[idxtounzip] = 2; // Set it as done
-         fUnzipChunks[idxtounzip] = 0;
-         fUnzipLen[idxtounzip] = 0;
-
-         fUnzipDoneCondition->Signal();
-         return 0;
-      }
-
-   } // Scope of the lock
+   char *locbuff = new char[rdlen];
+   readbuf = ReadBufferExt(locbuff, rdoffs, rdlen, loc);
 
    // Unzip it into a new blk
    char *ptr = 0;
    Int_t loclen = 0;
+   if (readbuf > 0) {
+      GetRecordHeader(locbuff, hlen, nbytes, objlen, keylen);
 
-   loclen = UnzipBuffer(&ptr, locbuff);
-
-   if ((loclen > 0) && (loclen == objlen+keylen)) {
-      R__LOCKGUARD(fMutexList);
+      Int_t len = (objlen > nbytes-keylen)? keylen+objlen : nbytes;
 
-      if ( (myCycle != fCycle)  || !fIsTransferred) {
+      // If the single unzipped chunk is really too big, leave it to the
+      // main thread which will unzip it synchronously.
+      if (len > 4*fUnzipBufferSize) {
          if (gDebug > 0)
-            Info("UnzipCache", "Sudden paging Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
-                 IsActiveThread(), fNseek, fIsLearning);
-         delete [] ptr;
+            Info("UnzipCache", "Block %d is too big, skipping.", index);
+      } else {
+         loclen = UnzipBuffer(&ptr, locbuff);
+      }
+   }
+   delete [] locbuff;
 
-         fUnzipStatus[idxtounzip] = 2; // Set it as not done
-         fUnzipChunks[idxtounzip] = 0;
-         fUnzipLen[idxtounzip] = 0;
+   R__LOCKGUARD(fMutexList);
 
-         startindex = 0;
-         fUnzipDoneCondition->Signal();
-         return 1;
-      }
+   if (cycle != fCycle) {
+      if (gDebug > 0)
+         Info("UnzipCache", "Sudden paging Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
+              fActiveThread, fNseek, fIsLearning);
+      delete [] ptr;
+      return 1;
+   }
 
-      fUnzipStatus[idxtounzip] = 2; // Set it as done
-      fUnzipChunks[idxtounzip] = ptr;
-      fUnzipLen[idxtounzip] = loclen;
+   Int_t res = 0;
+   fUnzipStatus[index] = 2; // Set it as done
+   fNPending--;
+   if (ptr && (loclen > 0) && (loclen == objlen+keylen)) {
+      fUnzipChunks[index] = ptr;
+      fUnzipLen[index] = loclen;
       fTotalUnzipBytes += loclen;
 
-      fActiveBlks.push(idxtounzip);
+      fActiveBlks.push(index);
 
       if (gDebug > 0)
          Info("UnzipCache", "reqi:%d, rdoffs:%lld, rdlen: %d, loclen:%d",
-              idxtounzip, rdoffs, rdlen, loclen);
+              index, rdoffs, rdlen, loclen);
 
       fNUnzip++;
-   }
-   else {
-      R__LOCKGUARD(fMutexList);
-      Info("argh", "loclen:%d objlen:%d loc:%d readbuf:%d", loclen, objlen, loc, readbuf);
-      fUnzipStatus[idxtounzip] = 2; // Set it as done
-      fUnzipChunks[idxtounzip] = 0;
-      fUnzipLen[idxtounzip] = 0;
+   } else {
+      // The main thread will take care of it
+      delete [] ptr;
+      fUnzipChunks[index] = 0;
+      fUnzipLen[index] = 0;
+      if (readbuf <= 0) {
+         if (gDebug > 0)
+            Info("UnzipCache", "Block %d not done. rdoffs=%lld rdlen=%d readbuf=%d", index, rdoffs, rdlen, readbuf);
+         res = -1;
+      }
    }
 
+   fUnzipDoneCondition->Broadcast();
 
-   fUnzipDoneCondition->Signal();
+   // Keep the pool busy
+   ScheduleBlocks();
 
-   delete [] ptr;
-   return 0;
+   return res;
 }
 
 void  TTreeCacheUnzip::Print(Option_t* option) const {
 
    printf("******TreeCacheUnzip statistics for file: %s ******\n",fFile->GetName());
    printf("Max allowed mem for pending buffers: %lld\n", fUnzipBufferSize);
+   printf("Number of unzipping threads: %d\n", fNUnzipThreads);
    printf("Number of blocks unzipped by threads: %d\n", fNUnzip);
    printf("Number of hits: %d\n", fNFound);
    printf("Number of stalls: %d\n", fNStalls);
@@ -35,8 +35,22 @@
 #include "TLeafS.h"
 #include "TLeafO.h"
 #include "TLeafC.h"
+#include "TSystem.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "Compression.h"
 
 #include <algorithm>
+#include <vector>
+#include <string.h>
+
+//______________________________________________________________________________
+static Bool_t R__IsRecompressOption(Option_t *method)
+{
+   TString opt(method);
+   opt.ToLower();
+   return opt.Contains("recompress");
+}
 
 //______________________________________________________________________________
 Bool_t TTreeCloner::CompareSeek::operator()(UInt_t i1, UInt_t i2)
@@ -68,6 +82,7 @@ TTreeCloner::TTreeCloner(TTree *from, TTree *to, Option_t *method, UInt_t option
    fFromTree(from),
    fToTree(to),
    fMethod(method),
+   fRecompress(R__IsRecompressOption(method)),
    fFromBranches( from ? from->GetListOfLeaves()->GetEntries()+1 : 0),
    fToBranches( to ? to->GetListOfLeaves()->GetEntries()+1 : 0),
    fMaxBaskets(CollectBranches()),
@@ -118,6 +133,11 @@ TTreeCloner::TTreeCloner(TTree *from, TTree *to, Option_t *method, UInt_t option
    // in which they will be needed when reading the whole tree
    // sequentially.
    //
+   // If method contains "recompress", the baskets are decompressed and
+   // compressed again with the compression settings (and dictionary) of
+   // the output branches when they differ from the input ones, see
+   // WriteRecompressedBaskets. Without it, the baskets are copied as they
+   // are and keep the compression of the input file.
 
    TString opt(method);
    opt.ToLower();
@@ -183,7 +203,11 @@ Bool_t TTreeCloner::Exec()
    CloseOutWriteBaskets();
    CollectBaskets();
    SortBaskets();
-   WriteBaskets();
+   if (fRecompress) {
+      if (!WriteRecompressedBaskets()) return kFALSE;
+   } else {
+      WriteBaskets();
+   }
    CopyMemoryBaskets();
 
    return kTRUE;
@@ -223,6 +247,21 @@ UInt_t TTreeCloner::CollectBranches(TBranch *from, TBranch *to) {
    // Since this is called from the constructor, this can not be a virtual function
 
    UInt_t numBaskets = 0;
+   const TArrayC &fromdict = from->GetCompressionDictionary();
+   const TArrayC &todict = to->GetCompressionDictionary();
+   if (!fRecompress && fromdict.GetSize() && (fromdict.GetSize() != todict.GetSize()
+                              || memcmp(fromdict.GetArray(), todict.GetArray(), fromdict.GetSize()))) {
+      // The baskets can not be decompressed without the dictionary they were
+      // compressed with, they need to be recompressed.
+      fWarningMsg.Form("The export branch and the import branch do not have the same compression dictionary. (The branch name is %s.)",
+                       from->GetName());
+      if (!(fOptions & kNoWarnings)) {
+         Warning("TTreeCloner::CollectBranches", "%s", fWarningMsg.Data());
+      }
+      fNeedConversion = kTRUE;
+      fIsValid = kFALSE;
+      return 0;
+   }
    if (from->InheritsFrom(TBranchClones::Class())) {
       TBranchClones *fromclones = (TBranchClones*) from;
       TBranchClones *toclones = (TBranchClones*) to;
@@ -654,3 +693,185 @@ void TTreeCloner::WriteBaskets()
    }
    delete basket;
 }
+
+//______________________________________________________________________________
+//
+// Helper for TTreeCloner::WriteRecompressedBaskets: the baskets of a batch
+// recompressed by the threads.
+//
+class TBasketRecompressionQueue {
+public:
+   TMutex                 fMutex;     // Protects fNext
+   std::vector<TBasket*>  fBaskets;   // Baskets to be recompressed, 0 for the baskets not read from the file
+   std::vector<TBranch*>  fFrom;      // Branch each basket was read from
+   std::vector<TBranch*>  fTo;        // Branch each basket will be written to
+   std::vector<Int_t>     fStatus;    // Result of TBasket::Recompress
+   UInt_t                 fN;         // Number of baskets in the batch
+   UInt_t                 fNext;      // Next basket to be recompressed
+
+   TBasketRecompressionQueue() : fN(0), fNext(0) {}
+
+   static void *Run(void *arg) {
+      // Recompress the baskets of the batch until none is left.
+      TBasketRecompressionQueue *queue = (TBasketRecompressionQueue*)arg;
+      while (1) {
+         UInt_t i;
+         {
+            TLockGuard lock(&queue->fMutex);
+            if (queue->fNext >= queue->fN) break;
+            i = queue->fNext++;
+         }
+         if (queue->fBaskets[i]) {
+            queue->fStatus[i] = queue->fBaskets[i]->Recompress(queue->fFrom[i], queue->fTo[i]);
+         }
+      }
+      return 0;
+   }
+};
+
+//______________________________________________________________________________
+Bool_t TTreeCloner::WriteRecompressedBaskets()
+{
+   // Transfer the basket from the input file to the output file, compressing
+   // them again if the compression settings or dictionaries of the input and
+   // output branches differ.
+   //
+   // The baskets are processed by batches: the raw baskets of a batch are
+   // read in order, recompressed concurrently by TTree::GetFlushThreads()
+   // threads (0 for one per core) and then written in order, so that the
+   // output file is the same as with a single thread. The entries are not
+   // unstreamed, the baskets keep their layout, number of entries and
+   // clustering.
+   // A basket which can not be recompressed, even by a second sequential
+   // attempt, can not be written as it was read (its compression does not
+   // match the output branch): the cloning is then stopped, the cloner made
+   // invalid and false returned.
+
+   const UInt_t   kMaxBatchBaskets = 256;
+   const Long64_t kMaxBatchBytes   = 64*1024*1024;
+
+   Int_t nthreads = TTree::GetFlushThreads();
+   if (nthreads == 0) {
+      SysInfo_t info;
+      gSystem->GetSysInfo(&info);
+      nthreads = info.fCpus;
+   }
+   for (Int_t i = 0; nthreads > 1 && i < fToBranches.GetEntries(); ++i) {
+      TBranch *from = (TBranch*)fFromBranches.UncheckedAt(i);
+      TBranch *to   = (TBranch*)fToBranches.UncheckedAt(i);
+      if (!ROOT::IsCompressionThreadSafe(from->GetCompressionAlgorithm()) ||
+          !ROOT::IsCompressionThreadSafe(to->GetCompressionAlgorithm())) {
+         nthreads = 1;
+      }
+   }
+
+   TFile *fromfile = fFromTree->GetCurrentFile();
+   // Very old files may have compressed baskets with fObjlen == fNbytes-fKeylen.
+   Bool_t oldFile = fromfile && fromfile->GetVersion() <= 30401;
+
+   TBasketRecompressionQueue queue;
+   std::vector<TBasket*> baskets;  // One per basket of the batch, reused by the next batches.
+   UInt_t first = 0;
+   while (first < fMaxBaskets) {
+      // Read the raw baskets of the batch.
+      queue.fBaskets.clear();
+      queue.fFrom.clear();
+      queue.fTo.clear();
+      queue.fStatus.clear();
+      Long64_t batchBytes = 0;
+      UInt_t last = first;
+      for (; last < fMaxBaskets && last - first < kMaxBatchBaskets && batchBytes < kMaxBatchBytes; ++last) {
+         TBranch *from = (TBranch*)fFromBranches.UncheckedAt( fBasketBranchNum[ fBasketIndex[last] ] );
+         TBranch *to   = (TBranch*)fToBranches.UncheckedAt( fBasketBranchNum[ fBasketIndex[last] ] );
+         Int_t index = fBasketNum[ fBasketIndex[last] ];
+         UInt_t n = last - first;
+         if (baskets.size() <= n) baskets.push_back(new TBasket());
+         TBasket *basket = baskets[n];
+
+         Bool_t recompress = kFALSE;
+         Int_t status = 0;
+         Long64_t pos = from->GetBasketSeek(index);
+         if (pos != 0) {
+            TFile *file = from->GetFile(0);
+            if (from->GetBasketBytes()[index] == 0) {
+               from->GetBasketBytes()[index] = basket->ReadBasketBytes(pos, file);
+            }
+            Int_t len = from->GetBasketBytes()[index];
+            batchBytes += len;
+            if (!oldFile) {
+               const TArrayC &fromdict = from->GetCompressionDictionary();
+               const TArrayC &todict = to->GetCompressionDictionary();
+               recompress = from->GetCompressionSettings() != to->GetCompressionSettings()
+                  || fromdict.GetSize() != todict.GetSize()
+                  || memcmp(fromdict.GetArray(), todict.GetArray(), fromdict.GetSize());
+            }
+            if (basket->LoadBasketBuffers(pos,len,file,fFromTree) != 0 && recompress) {
+               // Could not be read, hence not recompressed either.
+               status = 1;
+               recompress = kFALSE;
+            }
+         }
+         queue.fBaskets.push_back(recompress ? basket : 0);
+         queue.fFrom.push_back(from);
+         queue.fTo.push_back(to);
+         queue.fStatus.push_back(status);
+      }
+
+      // Recompress them.
+      queue.fN = last - first;
+      queue.fNext = 0;
+      Int_t nextra = TMath::Min(nthreads, (Int_t)queue.fN) - 1;
+      std::vector<TThread*> threads;
+      for (Int_t i = 0; i < nextra; ++i) {
+         TThread *thread = new TThread(TBasketRecompressionQueue::Run, &queue);
+         threads.push_back(thread);
+         thread->Run();
+      }
+      // The calling thread takes its share of the work.
+      TBasketRecompressionQueue::Run(&queue);
+      for (UInt_t i = 0; i < threads.size(); ++i) {
+         threads[i]->Join();
+         delete threads[i];
+      }
+
+      // Write them, as in WriteBaskets.
+      for (UInt_t j = first; j < last; ++j) {
+         TBranch *from = queue.fFrom[j - first];
+         TBranch *to   = queue.fTo[j - first];
+         Int_t index = fBasketNum[ fBasketIndex[j] ];
+         if (queue.fStatus[j - first] != 0) {
+            // Give it a second chance, alone.
+            TBasket *basket = queue.fBaskets[j - first];
+            if (!basket || basket->Recompress(from, to) != 0) {
+               fWarningMsg.Form("Cannot recompress basket %d of branch %s, the cloning of %s is stopped.",
+                                index, from->GetName(), fFromTree->GetName());
+               Error("WriteRecompressedBaskets", "%s", fWarningMsg.Data());
+               fIsValid = kFALSE;
+               for (UInt_t i = 0; i < baskets.size(); ++i) {
+                  delete baskets[i];
+               }
+               return kFALSE;
+            }
+         }
+         if (from->GetBasketSeek(index) != 0) {
+            TBasket *basket = baskets[j - first];
+            basket->IncrementPidOffset(fPidOffset);
+            basket->CopyTo(to->GetFile(0));
+            to->AddBasket(*basket,kTRUE,fToStartEntries + from->GetBasketEntry()[index]);
+         } else {
+            TBasket *frombasket = from->GetBasket( index );
+            if (frombasket && frombasket->GetNevBuf()>0) {
+               TBasket *tobasket = (TBasket*)frombasket->Clone();
+               tobasket->SetBranch(to);
+               to->AddBasket(*tobasket, kFALSE, fToStartEntries+from->GetBasketEntry()[index]);
+               to->FlushOneBasket(to->GetWriteBasket());
+            }
+         }
+      }
+      first = last;
+   }
+   for (UInt_t i = 0; i < baskets.size(); ++i) {
+      delete baskets[i];
+   }
+   return kTRUE;
+}
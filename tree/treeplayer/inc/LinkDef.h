@@ -16,9 +16,11 @@
 #pragma link C++ class TTreePlayer+;
 #pragma link C++ class TTreeFormula-;
 #pragma link C++ class TSelectorDraw;
+#pragma link C++ class TSelectorDrawBatch;
 #pragma link C++ class TSelectorEntries;
 #pragma link C++ class TFileDrawMap+;
 #pragma link C++ class TTreeIndex-;
+#pragma link C++ class TTreeHashIndex-;
 #pragma link C++ class TChainIndex+;
 #pragma link C++ class TChainIndex::TChainIndexEntry+;
 #pragma link C++ class TTreeFormulaManager;
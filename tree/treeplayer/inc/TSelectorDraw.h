@@ -62,10 +62,15 @@ protected:
    Bool_t         fCleanElist;     //  true if original Tree elist must be saved
    Bool_t         fObjEval;        //  true if fVar1 returns an object (or pointer to).
    Long64_t       fCurrentSubEntry; // Current subentry when fSelectMultiple is true. Used to fill TEntryListArray
+   Long64_t       fSkipNext;       //! First entry of the current tree that may pass the selection (see TTreeFormula::SkipEntries)
+   Long64_t       fSkipCheck;      //! Entry of the current tree from which fSkipNext must be recomputed
+   Double_t       fSelectValue;    //! Value of the selection given to ProcessFillSelected
+   Bool_t         fSelectValueSet; //! True in ProcessFillSelected: fSelectValue replaces the evaluation of fSelect
    
 protected:
    virtual void      ClearFormula();
    virtual Bool_t    CompileVariables(const char *varexp="", const char *selection="");
+   Double_t          EvalSelect();
    virtual void      InitArrays(Int_t newsize);
 
 private:
@@ -112,6 +117,7 @@ public:
    virtual void      ProcessFill(Long64_t entry);
    virtual void      ProcessFillMultiple(Long64_t entry);
    virtual void      ProcessFillObject(Long64_t entry);
+   void              ProcessFillSelected(Long64_t entry, Double_t select);
    virtual void      SetEstimate(Long64_t n);
    virtual UInt_t    SplitNames(const TString &varexp, std::vector<TString> &names);
    virtual void      TakeAction();
@@ -0,0 +1,76 @@
+// @(#)root/treeplayer:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2000, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TSelectorDrawBatch
+#define ROOT_TSelectorDrawBatch
+
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TSelectorDrawBatch                                                   //
+//                                                                      //
+// A TSelector doing many TTree::Draw in a single loop on the tree.     //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef ROOT_TSelector
+#include "TSelector.h"
+#endif
+#ifndef ROOT_TList
+#include "TList.h"
+#endif
+#ifndef ROOT_TObjArray
+#include "TObjArray.h"
+#endif
+
+#include <vector>
+
+class TSelectorDraw;
+
+class TSelectorDrawBatch : public TSelector {
+
+protected:
+   TTree               *fTree;          //! Pointer to current Tree
+   TList                fDraws;         //  TSelectorDraw of each draw
+   TList                fInputs;        //  Input list (varexp and selection) of each draw
+   TObjArray            fSelections;    //! Formula of each selection shared by several draws
+   std::vector<Int_t>   fSelectionIndex;//! Index in fSelections of the selection of each draw, -1 if not shared
+   std::vector<Double_t> fSelectValues; //! Value of each shared selection for the current entry
+   std::vector<Bool_t>  fActive;        //! False for the draws whose Begin failed
+   Long64_t             fNentries;      //! Number of entries processed
+   Bool_t               fUpdateCache;   //! True if the branches must be added to the cache of the current tree
+
+   void                 ShareSelections();
+   void                 UpdateCache();
+
+private:
+   TSelectorDrawBatch(const TSelectorDrawBatch&);             // not implemented
+   TSelectorDrawBatch& operator=(const TSelectorDrawBatch&);  // not implemented
+
+public:
+   TSelectorDrawBatch();
+   virtual ~TSelectorDrawBatch();
+
+   virtual Int_t          Add(const char *varexp, const char *selection = "", Option_t *option = "goff");
+   virtual void           Begin(TTree *tree);
+   virtual void           Clear(Option_t *option = "");
+   Int_t                  FindTarget(const char *name) const;
+   TSelectorDraw         *GetDraw(Int_t i) const { return (TSelectorDraw*)fDraws.At(i); }
+   Int_t                  GetNdraws() const { return fDraws.GetSize(); }
+   TObject               *GetDrawObject(Int_t i) const;
+   virtual Bool_t         Notify();
+   virtual Bool_t         Process(Long64_t /*entry*/) { return kFALSE; }
+   virtual void           ProcessFill(Long64_t entry);
+   virtual void           Terminate();
+
+   ClassDef(TSelectorDrawBatch,1);  //A TSelector doing many TTree::Draw in a single loop on the tree
+};
+
+#endif
@@ -65,6 +65,14 @@ class TTreeFormula : public TFormula {
 
 friend class TTreeFormulaManager;
 
+public:
+   // The compiled formulas (see JitCompile) get the functions giving them
+   // access to the tree variables, which are not public, as arguments.
+   typedef Bool_t   (*TJitVariable_t)(TTreeFormula *formula, Int_t code, Int_t instance, Bool_t willLoad, Double_t &value);
+   typedef void     (*TJitBooleanOptimization_t)(TTreeFormula *formula, Bool_t willLoad);
+   typedef Double_t (*TJitFunction_t)(TTreeFormula *formula, Int_t instance, Bool_t willLoad,
+                                      TJitVariable_t variable, TJitBooleanOptimization_t booleanOptimization);
+
 protected:
    enum {
       kIsCharacter = BIT(12),
@@ -120,6 +128,11 @@ protected:
    Bool_t                    fDidBooleanOptimization;  //! True if we executed one boolean optimization since the last time instance number 0 was evaluated
    TTreeFormulaManager      *fManager;        //! The dimension coordinator.
 
+   TJitFunction_t            fJitFunction;    //! Compiled version of the formula (see JitCompile), 0 if none
+   Long_t                    fJitNCalls;      //! Number of evaluations before compiling
+   Int_t                     fJitStatus;      //! 0: not tried yet, 1: compiled, -1: can not be compiled
+   static Long_t             fgJitThreshold;  // Number of evaluations after which a formula is compiled, 0 to never compile
+
    // Helper members and function used during the construction and parsing
    TList                    *fDimensionSetup; //! list of dimension setups, for delayed creation of the dimension information.
    std::vector<std::string>  fAliasesUsed;    //! List of aliases used during the parsing of the expression.
@@ -141,6 +154,12 @@ protected:
    virtual Double_t  GetValueFromMethod(Int_t i, TLeaf *leaf) const;
    virtual void*     GetValuePointerFromMethod(Int_t i, TLeaf *leaf) const;
    Int_t             GetRealInstance(Int_t instance, Int_t codeindex);
+   Bool_t            EvalJitVariable(Int_t code, Int_t instance, Bool_t willLoad, Double_t &value);
+   void              JitCompile();
+   Bool_t            JitTranslate(TString &body) const;
+   static Bool_t     JitVariable(TTreeFormula *formula, Int_t code, Int_t instance, Bool_t willLoad, Double_t &value);
+   static void       JitBooleanOptimization(TTreeFormula *formula, Bool_t willLoad);
+   Bool_t            IsZeroInBaskets(Long64_t entry, Long64_t &next) const;
 
    void              LoadBranches();
    Bool_t            LoadCurrentDim();
@@ -184,6 +203,7 @@ public:
    //the mutable keyword.
    //NOTE: Also modify the code in PrintValue which current goes around this limitation :(
    virtual Bool_t      IsInteger(Bool_t fast=kTRUE) const;
+           Bool_t      IsCompiled() const { return fJitStatus > 0; }
            Bool_t      IsQuickLoad() const { return fQuickLoad; }
    virtual Bool_t      IsString() const;
    virtual Bool_t      Notify() { UpdateFormulaLeaves(); return kTRUE; }
@@ -192,10 +212,14 @@ public:
    virtual void        SetAxis(TAxis *axis=0);
            void        SetQuickLoad(Bool_t quick) { fQuickLoad = quick; }
    virtual void        SetTree(TTree *tree) {fTree = tree;}
+           Long64_t    SkipEntries(Long64_t entry, Long64_t *checkedUntil = 0) const;
    virtual void        ResetLoading();
    virtual TTree*      GetTree() const {return fTree;}
    virtual void        UpdateFormulaLeaves();
 
+   static Long_t       GetJitThreshold() { return fgJitThreshold; }
+   static void         SetJitThreshold(Long_t nevals);
+
    ClassDef(TTreeFormula,9)  //The Tree formula
 };
 
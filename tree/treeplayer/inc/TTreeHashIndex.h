@@ -0,0 +1,84 @@
+// @(#)root/treeplayer:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2004, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TTreeHashIndex
+#define ROOT_TTreeHashIndex
+
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TTreeHashIndex                                                       //
+//                                                                      //
+// A Tree Index with majorname and minorname, stored in a hash table.   //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef ROOT_TVirtualIndex
+#include "TVirtualIndex.h"
+#endif
+#ifndef ROOT_TTreeFormula
+#include "TTreeFormula.h"
+#endif
+
+class TTreeHashIndex : public TVirtualIndex {
+
+protected:
+   TString        fMajorName;           // Index major name
+   TString        fMinorName;           // Index minor name
+   Long64_t       fN;                   // Number of entries
+   Long64_t       fNSlots;              // Number of slots of the hash table (a power of 2)
+   Long64_t      *fKeys;                //[fNSlots] Index value of each slot
+   Long64_t      *fEntries;             //[fNSlots] Entry number of each slot, -1 if the slot is empty
+   char          *fMapBuffer;           //! Memory mapped table (see OpenTable), 0 if not mapped
+   Long64_t       fMapSize;             //! Size of the mapped table
+   TTreeFormula  *fMajorFormula;        //! Pointer to major TreeFormula
+   TTreeFormula  *fMinorFormula;        //! Pointer to minor TreeFormula
+   TTreeFormula  *fMajorFormulaParent;  //! Pointer to major TreeFormula in Parent tree (if any)
+   TTreeFormula  *fMinorFormulaParent;  //! Pointer to minor TreeFormula in Parent tree (if any)
+
+   Bool_t         ComputeValues(Long64_t *values, Int_t nthreads);
+   Long64_t       FindSlot(Long64_t value) const;
+   void           Insert(Long64_t value, Long64_t entry);
+   void           Reserve(Long64_t n);
+   void           UnmapTable();
+
+private:
+   TTreeHashIndex(const TTreeHashIndex&);            // Not implemented.
+   TTreeHashIndex &operator=(const TTreeHashIndex&); // Not implemented.
+
+public:
+   TTreeHashIndex();
+   TTreeHashIndex(const TTree *T, const char *majorname, const char *minorname, Int_t nthreads = 1);
+   virtual               ~TTreeHashIndex();
+   virtual void           Append(const TVirtualIndex *,Bool_t delaySort = kFALSE);
+   virtual Long64_t       GetEntryNumberFriend(const TTree *parent);
+   virtual Long64_t       GetEntryNumberWithIndex(Int_t major, Int_t minor) const;
+   virtual Long64_t       GetEntryNumberWithBestIndex(Int_t major, Int_t minor) const;
+   const char            *GetMajorName()    const {return fMajorName.Data();}
+   const char            *GetMinorName()    const {return fMinorName.Data();}
+   virtual Long64_t       GetN()            const {return fN;}
+   Long64_t               GetNSlots()       const {return fNSlots;}
+   virtual TTreeFormula  *GetMajorFormula();
+   virtual TTreeFormula  *GetMinorFormula();
+   virtual TTreeFormula  *GetMajorFormulaParent(const TTree *parent);
+   virtual TTreeFormula  *GetMinorFormulaParent(const TTree *parent);
+   Bool_t                 IsMapped()        const {return fMapBuffer != 0;}
+   virtual void           Print(Option_t *option="") const;
+   virtual void           UpdateFormulaLeaves(const TTree *parent);
+   virtual void           SetTree(const TTree *T);
+   Bool_t                 WriteTable(const char *filename) const;
+
+   static TTreeHashIndex *OpenTable(const TTree *T, const char *filename);
+
+   ClassDef(TTreeHashIndex,1);  //A Tree Index with majorname and minorname, stored in a hash table.
+};
+
+#endif
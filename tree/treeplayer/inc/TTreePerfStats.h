@@ -28,6 +28,9 @@
 #include "TString.h"
 #endif
 
+#include <map>
+#include <string>
+
 
 class TBrowser;
 class TFile;
@@ -35,10 +38,30 @@ class TTree;
 class TStopwatch;
 class TPaveText;
 class TGraphErrors;
+class TVirtualMutex;
 class TGaxis;
 class TText;
 class TTreePerfStats : public TVirtualPerfStats {
 
+public:
+   struct TBranchCounters {
+      Long64_t   fBaskets;      //Number of baskets unzipped
+      Long64_t   fZipBytes;     //Number of compressed bytes unzipped
+      Long64_t   fUnzipBytes;   //Number of bytes after decompression
+      Double_t   fUnzipTime;    //Time spent uncompressing the baskets
+      Int_t      fMinBasket;    //Smallest compressed basket
+      Int_t      fMaxBasket;    //Largest compressed basket
+      TBranchCounters() : fBaskets(0), fZipBytes(0), fUnzipBytes(0), fUnzipTime(0), fMinBasket(0), fMaxBasket(0) {}
+   };
+   struct TFileCounters {
+      Long64_t   fReadCalls;    //Number of read calls
+      Long64_t   fBytesRead;    //Number of bytes read
+      Double_t   fReadTime;     //Time spent in the read calls
+      TFileCounters() : fReadCalls(0), fBytesRead(0), fReadTime(0) {}
+   };
+   typedef std::map<std::string, TBranchCounters> BranchCounters_t;
+   typedef std::map<std::string, TFileCounters>   FileCounters_t;
+
 protected:
    Int_t         fTreeCacheSize; //TTreeCache buffer size
    Int_t         fNleaves;       //Number of leaves in the tree
@@ -62,6 +85,9 @@ protected:
    TStopwatch   *fWatch;         //TStopwatch pointer
    TGaxis       *fRealTimeAxis;  //pointer to TGaxis object showing real-time
    TText        *fHostInfoText;  //Graphics Text object with the fHostInfo data
+   BranchCounters_t fBranchCounters; //!Per branch decompression counters
+   FileCounters_t   fFileCounters;   //!Per file read counters
+   mutable TVirtualMutex *fCountersMutex; //!Protects the counters, the events are also recorded by the unzipping and prefetching threads
       
 public:
    TTreePerfStats();
@@ -89,8 +115,11 @@ public:
    TStopwatch      *GetStopwatch() const {return fWatch;}
    virtual Int_t    GetTreeCacheSize() const {return fTreeCacheSize;}
    virtual Double_t GetUnzipTime() const {return fUnzipTime; }
+   const BranchCounters_t &GetBranchCounters() const {return fBranchCounters;}
+   const FileCounters_t   &GetFileCounters() const {return fFileCounters;}
    virtual void     Paint(Option_t *chopt="");
    virtual void     Print(Option_t *option="") const;
+   virtual void     PrintJSON(std::ostream &out) const;
 
    virtual void     SimpleEvent(EEventType) {}
    virtual void     PacketEvent(const char *, const char *, const char *,
@@ -99,6 +128,7 @@ public:
    virtual void     FileOpenEvent(TFile *, const char *, Double_t) {}
    virtual void     FileReadEvent(TFile *file, Int_t len, Double_t start);
    virtual void     FileUnzipEvent(TFile *file, Long64_t pos, Double_t start, Int_t complen, Int_t objlen);
+   virtual void     BasketUnzipEvent(TObject *branch, TFile *file, Long64_t pos, Double_t start, Int_t complen, Int_t objlen);
    virtual void     RateEvent(Double_t , Double_t , Long64_t , Long64_t) {}
 
    virtual void     SaveAs(const char *filename="",Option_t *option="") const;
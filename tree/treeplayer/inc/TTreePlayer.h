@@ -65,6 +65,8 @@ protected:
    void           TakeAction(Int_t nfill, Int_t &npoints, Int_t &action, TObject *obj, Option_t *option);
    void           TakeEstimate(Int_t nfill, Int_t &npoints, Int_t action, TObject *obj, Option_t *option);
    void           DeleteSelectorFromFile();
+   Bool_t         IsParallelProcessable(TSelector *selector) const;
+   Long64_t       ProcessParallel(TSelector *selector, Option_t *option, Long64_t nentries, Long64_t firstentry, Int_t nthreads);
    
 public:
    TTreePlayer();
@@ -81,6 +81,10 @@ TSelectorDraw::TSelectorDraw()
    fWeight         = 1;
    fCurrentSubEntry = -1;
    fTreeElistArray  = 0;
+   fSkipNext        = 0;
+   fSkipCheck       = 0;
+   fSelectValue     = 0;
+   fSelectValueSet  = kFALSE;
 }
 
 //______________________________________________________________________________
@@ -113,6 +117,8 @@ void TSelectorDraw::Begin(TTree *tree)
    fTree = tree;
    fDimension = 0;
    fAction = 0;
+   fSkipNext = 0;
+   fSkipCheck = 0;
 
    TObject *obj = fInput->FindObject("varexp");
    const char *varexp0   = obj ? obj->GetTitle() : "";
@@ -1010,6 +1016,15 @@ Bool_t TSelectorDraw::CompileVariables(const char *varexp, const char *selection
    return kTRUE;
 }
 
+//______________________________________________________________________________
+Double_t TSelectorDraw::EvalSelect()
+{
+   // Return the value of the selection for the first instance of the current
+   // entry, the one given to ProcessFillSelected if it is the caller.
+
+   return fSelectValueSet ? fSelectValue : fSelect->EvalInstance(0);
+}
+
 //______________________________________________________________________________
 Double_t* TSelectorDraw::GetVal(Int_t i) const
 {
@@ -1121,6 +1136,8 @@ Bool_t TSelectorDraw::Notify()
       }
    }
    if (fSelect) fSelect->UpdateFormulaLeaves();
+   fSkipNext = 0;
+   fSkipCheck = 0;
    return kTRUE;
 }
 
@@ -1129,6 +1146,13 @@ void TSelectorDraw::ProcessFill(Long64_t entry)
 {
    // Called in the entry loop for all entries accepted by Select.
 
+   // Skip, without reading them, the entries in baskets where the selection
+   // can not pass (see TBranch::SetBasketMinMax).
+   if (fSelect) {
+      if (entry >= fSkipCheck) fSkipNext = fSelect->SkipEntries(entry, &fSkipCheck);
+      if (entry < fSkipNext) return;
+   }
+
    if (fObjEval) {
       ProcessFillObject(entry);
       return;
@@ -1143,7 +1167,7 @@ void TSelectorDraw::ProcessFill(Long64_t entry)
    if (fForceRead && fManager->GetNdata() <= 0) return;
 
    if (fSelect) {
-      fW[fNfill] = fWeight * fSelect->EvalInstance(0);
+      fW[fNfill] = fWeight * EvalSelect();
       if (!fW[fNfill]) return;
    } else fW[fNfill] = fWeight;
    if (fVal) {
@@ -1181,7 +1205,7 @@ void TSelectorDraw::ProcessFillMultiple(Long64_t entry)
    // Calculate the first values
    if (fSelect) {
       // coverity[var_deref_model] fSelectMultiple==kTRUE => fSelect != 0 
-      fW[fNfill] = fWeight * fSelect->EvalInstance(0);
+      fW[fNfill] = fWeight * EvalSelect();
       if (!fW[fNfill] && !fSelectMultiple) return;
    } else fW[fNfill] = fWeight;
 
@@ -1251,7 +1275,7 @@ void TSelectorDraw::ProcessFillObject(Long64_t /*entry*/)
    for (Int_t i = 0; i < ndata; i++) {
       if (i == 0) {
          if (fSelect) {
-            fW[fNfill] = fWeight * fSelect->EvalInstance(0);
+            fW[fNfill] = fWeight * EvalSelect();
             if (!fW[fNfill] && !fSelectMultiple) return;
          } else fW[fNfill] = fWeight;
          ww = fW[nfill0];
@@ -1298,6 +1322,19 @@ void TSelectorDraw::ProcessFillObject(Long64_t /*entry*/)
 
 }
 
+//______________________________________________________________________________
+void TSelectorDraw::ProcessFillSelected(Long64_t entry, Double_t select)
+{
+   // Same as ProcessFill, with select as the value of the selection for the
+   // current entry instead of evaluating it again. Used by TSelectorDrawBatch
+   // for the selections shared by several draws, which have no variable index.
+
+   fSelectValue = select;
+   fSelectValueSet = kTRUE;
+   ProcessFill(entry);
+   fSelectValueSet = kFALSE;
+}
+
 //_______________________________________________________________________
 void TSelectorDraw::SetEstimate(Long64_t)
 {
@@ -1323,7 +1360,11 @@ void TSelectorDraw::TakeAction()
    //__________________________2-D histogram_______________________
    else if (fAction ==  2) {
       TH2 *h2 = (TH2*)fObject;
-      for (i = 0; i < fNfill; i++) h2->Fill(fVal[1][i], fVal[0][i], fW[i]);
+      if (h2->GetBuffer()) {
+         for (i = 0; i < fNfill; i++) h2->Fill(fVal[1][i], fVal[0][i], fW[i]);
+      } else {
+         h2->FillN(fNfill, fVal[1], fVal[0], fW);
+      }
    }
    //__________________________Profile histogram_______________________
    else if (fAction ==  4)((TProfile*)fObject)->FillN(fNfill, fVal[1], fVal[0], fW);
@@ -1372,7 +1413,11 @@ void TSelectorDraw::TakeAction()
          else                                                                pm->Draw(fOption.Data());
       }
       if (!h2->TestBit(kCanDelete)) {
-         for (i = 0; i < fNfill; i++) h2->Fill(fVal[1][i], fVal[0][i], fW[i]);
+         if (h2->GetBuffer()) {
+            for (i = 0; i < fNfill; i++) h2->Fill(fVal[1][i], fVal[0][i], fW[i]);
+         } else {
+            h2->FillN(fNfill, fVal[1], fVal[0], fW);
+         }
       }
    }
    //__________________________3D scatter plot_______________________
@@ -0,0 +1,319 @@
+// @(#)root/treeplayer:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2000, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// TSelectorDrawBatch                                                   //
+//                                                                      //
+// A TSelector doing many TTree::Draw in a single loop on the tree, so  //
+// that the baskets are read and decompressed once for all the draws.   //
+// Each draw is registered with Add, with the same arguments as         //
+// TTree::Draw, then the tree is processed with the batch:              //
+//                                                                      //
+//    TSelectorDrawBatch batch;                                         //
+//    batch.Add("px>>hpx(100,-4,4)", "pz>0");                           //
+//    batch.Add("py>>hpy(100,-4,4)", "pz>0");                           //
+//    batch.Add("px:py>>hpxpy", "random<0.5", "goff prof");             //
+//    tree->Process(&batch);                                            //
+//    TH1 *hpx = (TH1*)batch.GetDrawObject(0);                          //
+//                                                                      //
+// A draw without a target ("px" instead of "px>>hpx") fills a         //
+// histogram named "htemp_<i>", i being its index, since they can not  //
+// all fill "htemp". Two draws can not have the same target: Add        //
+// rejects the second one. Nothing is drawn: the histograms are in the  //
+// current directory, as with the "goff" option.                        //
+//                                                                      //
+// A selection without arrays used by several draws is evaluated once  //
+// per entry: its value is given to these draws, which are not called   //
+// for the entries that do not pass it. The branches used by all the    //
+// draws are added to the TTreeCache of the tree at the first entry of  //
+// each tree, so that the draws whose selection is rarely passed are    //
+// cached as well.                                                      //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+#include "TSelectorDrawBatch.h"
+#include "TSelectorDraw.h"
+#include "TTreeFormula.h"
+#include "TEntryList.h"
+#include "TNamed.h"
+#include "TTree.h"
+
+ClassImp(TSelectorDrawBatch)
+
+//______________________________________________________________________________
+static TString R__DrawTarget(const TString &varexp)
+{
+   // Return the name of the object filled by a draw of varexp, as decoded by
+   // TSelectorDraw::Begin: what follows the last ">>", without the leading
+   // '+' and the binning. Return an empty string if there is no ">>".
+
+   Ssiz_t pos = varexp.Length() - 1;
+   while (pos > 0 && !(varexp[pos] == '>' && varexp[pos-1] == '>')) --pos;
+   if (pos <= 0) return "";
+   TString name = varexp(pos + 1, varexp.Length() - pos - 1);
+   name = name.Strip(TString::kBoth);
+   if (name.BeginsWith("+")) name.Remove(0, 1);
+   Ssiz_t paren = name.First('(');
+   if (paren != kNPOS) name.Remove(paren);
+   return name.Strip(TString::kBoth);
+}
+
+//______________________________________________________________________________
+TSelectorDrawBatch::TSelectorDrawBatch() : fTree(0), fNentries(0), fUpdateCache(kFALSE)
+{
+   // Default constructor.
+
+   fDraws.SetOwner(kTRUE);
+   fInputs.SetOwner(kTRUE);
+   fSelections.SetOwner(kTRUE);
+}
+
+//______________________________________________________________________________
+TSelectorDrawBatch::~TSelectorDrawBatch()
+{
+   // Destructor. The histograms filled by the draws are not deleted.
+
+   fSelections.Delete();
+   fDraws.Delete();
+   fInputs.Delete();
+}
+
+//______________________________________________________________________________
+Int_t TSelectorDrawBatch::Add(const char *varexp, const char *selection, Option_t *option)
+{
+   // Register a draw of varexp for the entries passing selection, with
+   // option, done at the next processing of a tree with this selector.
+   // The arguments are the ones of TTree::Draw, see its documentation.
+   // Return the index of the draw, to be used with GetDraw and GetDrawObject,
+   // or -1 if its target is already filled by another draw of the batch:
+   // the Begin of the second draw would reset or delete the object of the
+   // first one. A draw without a target fills "htemp_<index>".
+
+   TString exp = varexp ? varexp : "";
+   TString target = R__DrawTarget(exp);
+   if (target.IsNull()) {
+      Int_t n = fDraws.GetSize();
+      do {
+         target.Form("htemp_%d", n++);
+      } while (FindTarget(target) >= 0);
+      exp += ">>" + target;
+   } else if (FindTarget(target) >= 0) {
+      Error("Add", "\"%s\" is already filled by draw %d, \"%s\" is not added",
+            target.Data(), FindTarget(target), exp.Data());
+      return -1;
+   }
+
+   TList *input = new TList;
+   input->SetOwner(kTRUE);
+   input->Add(new TNamed("varexp", exp.Data()));
+   input->Add(new TNamed("selection", selection ? selection : ""));
+   fInputs.Add(input);
+
+   TSelectorDraw *draw = new TSelectorDraw;
+   draw->SetInputList(input);
+   draw->SetOption(option ? option : "");
+   fDraws.Add(draw);
+   return fDraws.GetSize() - 1;
+}
+
+//______________________________________________________________________________
+void TSelectorDrawBatch::Begin(TTree *tree)
+{
+   // Called everytime a loop on the tree(s) starts: initialize all the draws.
+
+   SetStatus(0);
+   fTree = tree;
+   fNentries = 0;
+   fUpdateCache = kTRUE;
+
+   Int_t ndraws = fDraws.GetSize();
+   fActive.assign(ndraws, kFALSE);
+   Int_t nactive = 0;
+   for (Int_t i = 0; i < ndraws; ++i) {
+      TSelectorDraw *draw = GetDraw(i);
+      draw->Begin(tree);
+      if (draw->GetStatus() == -1) {
+         Warning("Begin", "draw %d of \"%s\" is skipped", i, ((TList*)fInputs.At(i))->At(0)->GetTitle());
+         continue;
+      }
+      fActive[i] = kTRUE;
+      ++nactive;
+   }
+   if (!nactive && ndraws) {
+      SetStatus(-1);
+      return;
+   }
+   ShareSelections();
+}
+
+//______________________________________________________________________________
+void TSelectorDrawBatch::Clear(Option_t *)
+{
+   // Remove all the draws.
+
+   fSelections.Delete();
+   fDraws.Delete();
+   fInputs.Delete();
+   fSelectionIndex.clear();
+   fSelectValues.clear();
+   fActive.clear();
+}
+
+//______________________________________________________________________________
+Int_t TSelectorDrawBatch::FindTarget(const char *name) const
+{
+   // Return the index of the draw filling the object called name, -1 if none.
+
+   for (Int_t i = 0; i < fInputs.GetSize(); ++i) {
+      TList *input = (TList*)fInputs.At(i);
+      if (R__DrawTarget(input->At(0)->GetTitle()) == name) return i;
+   }
+   return -1;
+}
+
+//______________________________________________________________________________
+TObject *TSelectorDrawBatch::GetDrawObject(Int_t i) const
+{
+   // Return the object (histogram, graph or entry list) filled by draw i.
+
+   TSelectorDraw *draw = GetDraw(i);
+   return draw ? draw->GetObject() : 0;
+}
+
+//______________________________________________________________________________
+Bool_t TSelectorDrawBatch::Notify()
+{
+   // This function is called at the first entry of a new tree in a chain.
+
+   Int_t ndraws = fActive.size();
+   for (Int_t i = 0; i < ndraws; ++i) {
+      if (!fActive[i]) continue;
+      TSelectorDraw *draw = GetDraw(i);
+      draw->Notify();
+      TObject *obj = draw->GetObject();
+      if (fTree && obj && obj->InheritsFrom(TEntryList::Class())) {
+         ((TEntryList*)obj)->SetTree(fTree->GetTree());
+      }
+   }
+   for (Int_t s = 0; s <= fSelections.GetLast(); ++s) {
+      TTreeFormula *select = (TTreeFormula*)fSelections.UncheckedAt(s);
+      if (select) select->UpdateFormulaLeaves();
+   }
+   fUpdateCache = kTRUE;
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+void TSelectorDrawBatch::ProcessFill(Long64_t entry)
+{
+   // Called in the entry loop: evaluate the shared selections then fill the
+   // draws, giving them the value of their shared selection.
+
+   if (fUpdateCache) UpdateCache();
+   ++fNentries;
+
+   for (Int_t s = 0; s <= fSelections.GetLast(); ++s) {
+      TTreeFormula *select = (TTreeFormula*)fSelections.UncheckedAt(s);
+      fSelectValues[s] = select->EvalInstance(0);
+   }
+   Int_t ndraws = fActive.size();
+   for (Int_t i = 0; i < ndraws; ++i) {
+      if (!fActive[i]) continue;
+      Int_t s = fSelectionIndex[i];
+      if (s < 0) {
+         GetDraw(i)->ProcessFill(entry);
+      } else if (fSelectValues[s]) {
+         GetDraw(i)->ProcessFillSelected(entry, fSelectValues[s]);
+      }
+   }
+}
+
+//______________________________________________________________________________
+void TSelectorDrawBatch::ShareSelections()
+{
+   // Create one formula for each selection used by several draws. Its value
+   // is given to their TSelectorDraw, which do not evaluate their own copy,
+   // and they are not called at all for the entries where it is zero. Only
+   // the selections without arrays are shared: with arrays each instance is
+   // selected separately.
+
+   fSelections.Delete();
+   Int_t ndraws = fActive.size();
+   fSelectionIndex.assign(ndraws, -1);
+
+   std::vector<Bool_t> done(ndraws, kFALSE);
+   for (Int_t i = 0; i < ndraws; ++i) {
+      if (!fActive[i] || done[i]) continue;
+      TTreeFormula *select = GetDraw(i)->GetSelect();
+      if (!select || select->GetMultiplicity()) continue;
+      TString title = select->GetTitle();
+      std::vector<Int_t> users(1, i);
+      for (Int_t j = i + 1; j < ndraws; ++j) {
+         if (!fActive[j] || done[j]) continue;
+         TTreeFormula *other = GetDraw(j)->GetSelect();
+         if (other && !other->GetMultiplicity() && title == other->GetTitle()) users.push_back(j);
+      }
+      if (users.size() < 2) continue;
+
+      TTreeFormula *shared = new TTreeFormula("Selection", title, fTree);
+      shared->SetQuickLoad(kTRUE);
+      if (!shared->GetNdim() || shared->GetMultiplicity()) {
+         delete shared;
+         continue;
+      }
+      Int_t index = fSelections.GetLast() + 1;
+      fSelections.AddAtAndExpand(shared, index);
+      for (size_t u = 0; u < users.size(); ++u) {
+         fSelectionIndex[users[u]] = index;
+         done[users[u]] = kTRUE;
+      }
+   }
+   fSelectValues.assign(fSelections.GetLast() + 1, 0);
+}
+
+//______________________________________________________________________________
+void TSelectorDrawBatch::Terminate()
+{
+   // Called at the end of a loop on a TTree: terminate all the draws.
+   // The status is the number of entries processed.
+
+   Int_t ndraws = fActive.size();
+   for (Int_t i = 0; i < ndraws; ++i) {
+      if (fActive[i]) GetDraw(i)->Terminate();
+   }
+   fSelections.Delete();
+   SetStatus(fNentries);
+}
+
+//______________________________________________________________________________
+void TSelectorDrawBatch::UpdateCache()
+{
+   // Add the branches used by all the draws to the TTreeCache of the current
+   // tree. Otherwise the branches only read for the entries passing a rare
+   // selection may be missed by the learning phase of the cache.
+
+   fUpdateCache = kFALSE;
+   if (!fTree || fTree->GetCacheSize() <= 0) return;
+
+   Int_t ndraws = fActive.size();
+   for (Int_t i = 0; i < ndraws; ++i) {
+      if (!fActive[i]) continue;
+      TSelectorDraw *draw = GetDraw(i);
+      for (Int_t v = -1; v < draw->GetDimension(); ++v) {
+         TTreeFormula *form = v < 0 ? draw->GetSelect() : draw->GetVar(v);
+         if (!form) continue;
+         for (Int_t c = 0; c < form->GetNcodes(); ++c) {
+            TLeaf *leaf = form->GetLeaf(c);
+            if (leaf && leaf->GetBranch()) fTree->AddBranchToCache(leaf->GetBranch(), kTRUE);
+         }
+      }
+   }
+}
@@ -45,6 +45,7 @@
 #include "TFormLeafInfoReference.h"
 
 #include "TEntryList.h"
+#include "TVirtualMutex.h"
 
 #include <ctype.h>
 #include <stdio.h>
@@ -52,6 +53,7 @@
 #include <stdlib.h>
 #include <typeinfo>
 #include <algorithm>
+#include <map>
 
 const Int_t kMaxLen     = 1024;
 R__EXTERN TTree *gTree;
@@ -128,7 +130,7 @@ public:
 
 //______________________________________________________________________________
 TTreeFormula::TTreeFormula(): TFormula(), fQuickLoad(kFALSE), fNeedLoading(kTRUE),
-   fDidBooleanOptimization(kFALSE), fDimensionSetup(0)
+   fDidBooleanOptimization(kFALSE), fJitFunction(0), fJitNCalls(0), fJitStatus(0), fDimensionSetup(0)
 
 {
    // Tree Formula default constructor
@@ -159,7 +161,7 @@ TTreeFormula::TTreeFormula(): TFormula(), fQuickLoad(kFALSE), fNeedLoading(kTRUE
 //______________________________________________________________________________
 TTreeFormula::TTreeFormula(const char *name,const char *expression, TTree *tree)
    :TFormula(), fTree(tree), fQuickLoad(kFALSE), fNeedLoading(kTRUE),
-    fDidBooleanOptimization(kFALSE), fDimensionSetup(0)
+    fDidBooleanOptimization(kFALSE), fJitFunction(0), fJitNCalls(0), fJitStatus(0), fDimensionSetup(0)
 {
    // Normal TTree Formula Constuctor
 
@@ -170,7 +172,7 @@ TTreeFormula::TTreeFormula(const char *name,const char *expression, TTree *tree)
 TTreeFormula::TTreeFormula(const char *name,const char *expression, TTree *tree,
                            const std::vector<std::string>& aliases)
    :TFormula(), fTree(tree), fQuickLoad(kFALSE), fNeedLoading(kTRUE),
-    fDidBooleanOptimization(kFALSE), fDimensionSetup(0), fAliasesUsed(aliases)
+    fDidBooleanOptimization(kFALSE), fJitFunction(0), fJitNCalls(0), fJitStatus(0), fDimensionSetup(0), fAliasesUsed(aliases)
 {
    // Constructor used during the expansion of an alias
    Init(name,expression);
@@ -3927,6 +3929,8 @@ Double_t TTreeFormula::EvalInstance(Int_t instance, const char *stringStackArg[]
       }
    }
 
+   if (fJitStatus == 0 && fgJitThreshold && ++fJitNCalls >= fgJitThreshold) JitCompile();
+
    Double_t tab[kMAXFOUND];
    const Int_t kMAXSTRINGFOUND = 10;
    const char *stringStackLocal[kMAXSTRINGFOUND];
@@ -3935,6 +3939,8 @@ Double_t TTreeFormula::EvalInstance(Int_t instance, const char *stringStackArg[]
    const Bool_t willLoad = (instance==0 || fNeedLoading); fNeedLoading = kFALSE;
    if (willLoad) fDidBooleanOptimization = kFALSE;
 
+   if (fJitStatus > 0) return (*fJitFunction)(this, instance, willLoad, &JitVariable, &JitBooleanOptimization);
+
    Int_t pos  = 0;
    Int_t pos2 = 0;
    for (Int_t i=0; i<fNoper ; ++i) {
@@ -4311,6 +4317,450 @@ Double_t TTreeFormula::EvalInstance(Int_t instance, const char *stringStackArg[]
    return result;
 }
 
+//______________________________________________________________________________
+Bool_t TTreeFormula::EvalJitVariable(Int_t code, Int_t instance, Bool_t willLoad, Double_t &value)
+{
+   // Set 'value' to the tree variable 'code' for 'instance', loading its
+   // branch as EvalInstance does. Return false if the instance is out of
+   // range, in which case the formula evaluates to 0.
+   // Called by the compiled version of the formula (see JitCompile), only for
+   // the lookup types accepted by JitTranslate.
+
+   switch (fLookupType[code]) {
+      case kIndexOfEntry:      value = (Double_t)fTree->GetReadEntry(); return kTRUE;
+      case kIndexOfLocalEntry: value = (Double_t)fTree->GetTree()->GetReadEntry(); return kTRUE;
+      case kEntries:           value = (Double_t)fTree->GetEntries(); return kTRUE;
+      case kLength:            value = fManager->fNdata; return kTRUE;
+      case kIteration:         value = instance; return kTRUE;
+
+      case kDirect:     { TT_EVAL_INIT_LOOP; value = leaf->GetValue(real_instance); return kTRUE; }
+      case kMethod:     { TT_EVAL_INIT_LOOP; value = GetValueFromMethod(code,leaf); return kTRUE; }
+      case kDataMember: { TT_EVAL_INIT_LOOP; value = ((TFormLeafInfo*)fDataMembers.UncheckedAt(code))->
+                                 GetValue(leaf,real_instance); return kTRUE; }
+      case kTreeMember: { TREE_EVAL_INIT_LOOP; value = ((TFormLeafInfo*)fDataMembers.UncheckedAt(code))->
+                                 GetValue((TLeaf*)0x0,real_instance); return kTRUE; }
+   }
+   value = 0;
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+Bool_t TTreeFormula::JitVariable(TTreeFormula *formula, Int_t code, Int_t instance, Bool_t willLoad, Double_t &value)
+{
+   // Passed to the compiled version of formula, see EvalJitVariable.
+
+   return formula->EvalJitVariable(code, instance, willLoad, value);
+}
+
+//______________________________________________________________________________
+void TTreeFormula::JitBooleanOptimization(TTreeFormula *formula, Bool_t willLoad)
+{
+   // Passed to the compiled version of formula, called when a && or || is
+   // decided by its first operand: the branches of the second one are not
+   // loaded for this entry, as in EvalInstance.
+
+   if (willLoad) formula->fDidBooleanOptimization = kTRUE;
+}
+
+Long_t TTreeFormula::fgJitThreshold = 0;
+
+namespace {
+   struct TJitOperation {
+      Int_t       fAction; // TFormula action code
+      Int_t       fNargs;  // Number of values popped from the stack
+      const char *fExpr;   // C++ expression of the result, $x and $y stand for the arguments
+   };
+
+   std::map<std::string, TTreeFormula::TJitFunction_t> &R__JitCache()
+   {
+      // Compiled formulas, indexed by the body of their function.
+
+      static std::map<std::string, TTreeFormula::TJitFunction_t> cache;
+      return cache;
+   }
+}
+
+//______________________________________________________________________________
+Bool_t TTreeFormula::JitTranslate(TString &body) const
+{
+   // Translate the operations of the formula into the body of a C++ function
+   // with the same semantic as EvalInstance (see JitCompile): each slot of the
+   // evaluation stack becomes a local variable, the jumps of the conditional
+   // and boolean operators become gotos and the tree variables are read with
+   // EvalJitVariable.
+   // Return false if the formula uses an operation that is not translated
+   // (strings, aliases, function calls, graphical cuts, entry lists, random
+   // numbers ...): it is then always interpreted.
+
+   // Same semantic as the corresponding cases of EvalInstance.
+   static const TJitOperation operations[] = {
+      { kAdd,         2, "$x + $y" },
+      { kSubstract,   2, "$x - $y" },
+      { kMultiply,    2, "$x * $y" },
+      { kDivide,      2, "$y == 0 ? 0 : $x / $y" },
+      { kModulo,      2, "Double_t(Long64_t($x) % Long64_t($y))" },
+      { kcos,         1, "TMath::Cos($x)" },
+      { ksin,         1, "TMath::Sin($x)" },
+      { ktan,         1, "TMath::Cos($x) == 0 ? 0 : TMath::Tan($x)" },
+      { kacos,        1, "TMath::Abs($x) > 1 ? 0 : TMath::ACos($x)" },
+      { kasin,        1, "TMath::Abs($x) > 1 ? 0 : TMath::ASin($x)" },
+      { katan,        1, "TMath::ATan($x)" },
+      { kcosh,        1, "TMath::CosH($x)" },
+      { ksinh,        1, "TMath::SinH($x)" },
+      { ktanh,        1, "TMath::CosH($x) == 0 ? 0 : TMath::TanH($x)" },
+      { kacosh,       1, "$x < 1 ? 0 : TMath::ACosH($x)" },
+      { kasinh,       1, "TMath::ASinH($x)" },
+      { katanh,       1, "TMath::Abs($x) > 1 ? 0 : TMath::ATanH($x)" },
+      { katan2,       2, "TMath::ATan2($x,$y)" },
+      { kfmod,        2, "fmod($x,$y)" },
+      { kpow,         2, "TMath::Power($x,$y)" },
+      { ksq,          1, "$x * $x" },
+      { ksqrt,        1, "TMath::Sqrt(TMath::Abs($x))" },
+      { kmin,         2, "TMath::Min($x,$y)" },
+      { kmax,         2, "TMath::Max($x,$y)" },
+      { klog,         1, "$x > 0 ? TMath::Log($x) : 0" },
+      { kexp,         1, "$x < -700 ? 0 : ($x > 700 ? TMath::Exp(700) : TMath::Exp($x))" },
+      { klog10,       1, "$x > 0 ? TMath::Log10($x) : 0" },
+      { kabs,         1, "TMath::Abs($x)" },
+      { ksign,        1, "$x < 0 ? -1 : 1" },
+      { kint,         1, "Double_t(Int_t($x))" },
+      { kSignInv,     1, "-1 * $x" },
+      { kAnd,         2, "$x != 0 && $y != 0" },
+      { kOr,          2, "$x != 0 || $y != 0" },
+      { kEqual,       2, "$x == $y" },
+      { kNotEqual,    2, "$x != $y" },
+      { kLess,        2, "$x < $y" },
+      { kGreater,     2, "$x > $y" },
+      { kLessThan,    2, "$x <= $y" },
+      { kGreaterThan, 2, "$x >= $y" },
+      { kNot,         1, "$x != 0 ? 0 : 1" },
+      { kBitAnd,      2, "Long64_t($x) & Long64_t($y)" },
+      { kBitOr,       2, "Long64_t($x) | Long64_t($y)" },
+      { kLeftShift,   2, "Long64_t($x) << Long64_t($y)" },
+      { kRightShift,  2, "Long64_t($x) >> Long64_t($y)" }
+   };
+
+   if (fAxis || fNoper < 2) return kFALSE;
+
+   std::map<Int_t,Int_t> labels; // Target of a jump -> size of the stack there
+   TString code;
+   Int_t pos = 0;
+   Int_t maxpos = 0;
+   Bool_t reachable = kTRUE;
+   for (Int_t i = 0; i <= fNoper; ++i) {
+      std::map<Int_t,Int_t>::const_iterator label = labels.find(i);
+      if (label != labels.end()) {
+         if (!reachable) pos = label->second;
+         else if (pos != label->second) return kFALSE;
+         code += TString::Format("L%d:\n", i);
+         reachable = kTRUE;
+      }
+      if (i == fNoper) break;
+      if (!reachable) continue;
+
+      const Int_t oper = GetOper()[i];
+      const Int_t action = oper >> kTFOperShift;
+      const Int_t param = oper & kTFOperMask;
+
+      switch (action) {
+         case kEnd:
+            code += "   return t0;\n";
+            reachable = kFALSE;
+            continue;
+         case kConstant:
+            if (!TMath::Finite(fConst[param])) return kFALSE;
+            code += TString::Format("   t%d = %.17g;\n", pos++, fConst[param]);
+            break;
+         case kpi:
+            code += TString::Format("   t%d = TMath::ACos(-1);\n", pos++);
+            break;
+         case kJump:
+            if (param < i) return kFALSE;
+            labels[param+1] = pos;
+            code += TString::Format("   goto L%d;\n", param+1);
+            reachable = kFALSE;
+            continue;
+         case kJumpIf:
+            if (param < i || pos < 1) return kFALSE;
+            --pos;
+            labels[param+1] = pos;
+            code += TString::Format("   if (!t%d) { boolopt(f, willLoad); goto L%d; }\n", pos, param+1);
+            continue;
+         case kBoolOptimize: {
+            if (pos < 1) return kFALSE;
+            const Int_t op = param % 10; // 1 is && , 2 is ||
+            const Int_t target = i + param / 10 + 1;
+            if (op != 1 && op != 2) continue;
+            labels[target] = pos;
+            code += TString::Format("   if (%st%d) { t%d = %d; boolopt(f, willLoad); goto L%d; }\n",
+                                    op == 1 ? "!" : "", pos-1, pos-1, op == 1 ? 0 : 1, target);
+            continue;
+         }
+         case kDefinedVariable:
+            switch (fLookupType[param]) {
+               case kDirect: case kDataMember: case kMethod: case kTreeMember:
+               case kIndexOfEntry: case kIndexOfLocalEntry: case kEntries: case kLength: case kIteration:
+                  break;
+               default:
+                  return kFALSE;
+            }
+            code += TString::Format("   if (!variable(f, %d, instance, willLoad, t%d)) return 0;\n", param, pos++);
+            break;
+         default: {
+            const TJitOperation *op = 0;
+            for (size_t j = 0; j < sizeof(operations)/sizeof(operations[0]); ++j) {
+               if (operations[j].fAction == action) op = &operations[j];
+            }
+            if (!op || pos < op->fNargs) return kFALSE;
+            pos -= op->fNargs;
+            TString expr(op->fExpr);
+            expr.ReplaceAll("$x", TString::Format("t%d", pos));
+            expr.ReplaceAll("$y", TString::Format("t%d", pos+1));
+            code += TString::Format("   t%d = %s;\n", pos++, expr.Data());
+            break;
+         }
+      }
+      if (pos > maxpos) maxpos = pos;
+   }
+   if (maxpos > kMAXFOUND) return kFALSE;
+
+   body = "   Double_t t0 = 0";
+   for (Int_t i = 1; i < maxpos; ++i) body += TString::Format(", t%d = 0", i);
+   body += ";\n";
+   body += code;
+   body += "   return t0;\n";
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+void TTreeFormula::JitCompile()
+{
+   // Translate the formula into C++ (see JitTranslate), compile it with the
+   // interpreter and evaluate it with the compiled function from now on.
+   // The functions are cached by source code, so that identical formulas,
+   // typically the ones created for each tree of a TChain or by each TTree::Draw
+   // of a loop, are compiled only once. The leaves are looked up at each
+   // evaluation (EvalJitVariable), hence a compiled formula stays valid when
+   // UpdateFormulaLeaves switches it to another tree.
+   // If the formula can not be translated or compiled, it keeps being
+   // interpreted.
+
+   R__LOCKGUARD2(gClingMutex);
+
+   if (fJitStatus) return;
+   fJitStatus = -1;
+   TString body;
+   if (!gInterpreter || !JitTranslate(body)) return;
+
+   std::map<std::string, TJitFunction_t> &cache = R__JitCache();
+   std::map<std::string, TJitFunction_t>::const_iterator iter = cache.find(body.Data());
+   if (iter != cache.end()) {
+      fJitFunction = iter->second;
+      fJitStatus = fJitFunction ? 1 : -1;
+      return;
+   }
+   cache[body.Data()] = 0;
+
+   static Bool_t included = kFALSE;
+   TInterpreter::EErrorCode err = TInterpreter::kNoError;
+   if (!included) {
+      gInterpreter->ProcessLine("#include \"TTreeFormula.h\"", &err);
+      if (err == TInterpreter::kNoError) gInterpreter->ProcessLine("#include \"TMath.h\"", &err);
+      if (err != TInterpreter::kNoError) return;
+      included = kTRUE;
+   }
+   static Int_t ncompiled = 0;
+   TString name = TString::Format("R__TTreeFormulaJit%d", ncompiled++);
+   TString code;
+   code.Form("Double_t %s(TTreeFormula *f, Int_t instance, Bool_t willLoad, TTreeFormula::TJitVariable_t variable,\n"
+             "   TTreeFormula::TJitBooleanOptimization_t boolopt)\n{\n%s}\n",
+             name.Data(), body.Data());
+   gInterpreter->ProcessLine(code, &err);
+   if (err != TInterpreter::kNoError) return;
+   Long_t addr = gInterpreter->Calc(TString::Format("(Long_t)&%s", name.Data()), &err);
+   if (err != TInterpreter::kNoError || !addr) return;
+
+   if (gDebug > 0) {
+      Info("JitCompile", "%s: compiled %d operations as %s", GetTitle(), fNoper, name.Data());
+   }
+   fJitFunction = (TJitFunction_t)addr;
+   fJitStatus = 1;
+   cache[body.Data()] = fJitFunction;
+}
+
+//______________________________________________________________________________
+void TTreeFormula::SetJitThreshold(Long_t nevals)
+{
+   // Enable the compilation of the formulas (see JitCompile). A formula is
+   // compiled when it has been evaluated nevals times, so that the cost of the
+   // compilation is only paid for the formulas evaluated for many entries, for
+   // example the variables and the selection of a TTree::Draw. 0 (the default)
+   // disables it. Formulas already compiled are not affected.
+
+   fgJitThreshold = nevals > 0 ? nevals : 0;
+}
+
+namespace {
+   struct TFormulaRange {
+      Double_t fMin; // Smallest possible value
+      Double_t fMax; // Largest possible value
+   };
+
+   TFormulaRange R__MakeRange(Double_t min, Double_t max)
+   {
+      // Range [min,max], any value if one of the bounds is NaN (e.g. inf-inf).
+
+      TFormulaRange r;
+      if (TMath::IsNaN(min) || TMath::IsNaN(max)) {
+         r.fMin = -TMath::Infinity();
+         r.fMax = TMath::Infinity();
+      } else {
+         r.fMin = min;
+         r.fMax = max;
+      }
+      return r;
+   }
+
+   TFormulaRange R__MakeBool(Bool_t canBeFalse, Bool_t canBeTrue)
+   {
+      // Range of a boolean result.
+
+      return R__MakeRange(canBeFalse ? 0 : 1, canBeTrue ? 1 : 0);
+   }
+
+   Bool_t R__CanBeTrue(const TFormulaRange &r)  { return r.fMin != 0 || r.fMax != 0; }
+   Bool_t R__CanBeFalse(const TFormulaRange &r) { return r.fMin <= 0 && r.fMax >= 0; }
+}
+
+//______________________________________________________________________________
+Bool_t TTreeFormula::IsZeroInBaskets(Long64_t entry, Long64_t &next) const
+{
+   // Return true if the formula is 0 for all the entries of the current tree
+   // from entry to next (excluded), according to the range of the values of
+   // its branches in the baskets containing entry (see TBranch::SetBasketMinMax).
+   // The formula is evaluated on ranges of values: each variable can take any
+   // value of the range of its basket, or any value at all if the range of
+   // its basket is not known. next is set to the first entry where one of
+   // the baskets changes.
+   // Only the arithmetic, comparison and logical operations are evaluated on
+   // ranges: for the other operations false is returned.
+
+   const TTree *tree = fTree->GetTree();
+   next = tree->GetEntries();
+   if (fAxis || fNoper < 1) return kFALSE;
+
+   TFormulaRange stack[kMAXFOUND];
+   Int_t pos = 0;
+   for (Int_t i = 0; i < fNoper; ++i) {
+      const Int_t oper = GetOper()[i];
+      const Int_t action = oper >> kTFOperShift;
+      const Int_t param = oper & kTFOperMask;
+
+      if (pos >= kMAXFOUND) return kFALSE;
+      if (action == kEnd) break;
+      switch (action) {
+         case kConstant:
+            stack[pos++] = R__MakeRange(fConst[param], fConst[param]);
+            continue;
+         case kBoolOptimize:
+            // The right operand of the && or || is evaluated too.
+            continue;
+         case kDefinedVariable: {
+            Double_t min = -TMath::Infinity();
+            Double_t max = TMath::Infinity();
+            if (fLookupType[param] == kDirect) {
+               TLeaf *leaf = GetLeaf(param);
+               TBranch *branch = leaf ? leaf->GetBranch() : 0;
+               Long64_t basketEnd;
+               if (branch && branch->GetTree() == tree &&
+                   branch->GetBasketMinMax(entry, min, max, basketEnd)) {
+                  if (basketEnd < next) next = basketEnd;
+               } else {
+                  min = -TMath::Infinity();
+                  max = TMath::Infinity();
+               }
+            }
+            stack[pos++] = R__MakeRange(min, max);
+            continue;
+         }
+      }
+
+      // Unary operations.
+      if (pos < 1) return kFALSE;
+      TFormulaRange &x = stack[pos-1];
+      switch (action) {
+         case kSignInv: x = R__MakeRange(-x.fMax, -x.fMin); continue;
+         case kabs:
+            if (x.fMin >= 0) continue;
+            if (x.fMax <= 0) x = R__MakeRange(-x.fMax, -x.fMin);
+            else x = R__MakeRange(0, TMath::Max(-x.fMin, x.fMax));
+            continue;
+         case kNot: x = R__MakeBool(R__CanBeTrue(x), R__CanBeFalse(x)); continue;
+      }
+
+      // Binary operations.
+      if (pos < 2) return kFALSE;
+      TFormulaRange &a = stack[pos-2];
+      const TFormulaRange &b = stack[pos-1];
+      switch (action) {
+         case kAdd:       a = R__MakeRange(a.fMin + b.fMin, a.fMax + b.fMax); break;
+         case kSubstract: a = R__MakeRange(a.fMin - b.fMax, a.fMax - b.fMin); break;
+         case kMultiply: {
+            Double_t p1 = a.fMin*b.fMin, p2 = a.fMin*b.fMax, p3 = a.fMax*b.fMin, p4 = a.fMax*b.fMax;
+            if (TMath::IsNaN(p1) || TMath::IsNaN(p2) || TMath::IsNaN(p3) || TMath::IsNaN(p4)) {
+               a = R__MakeRange(-TMath::Infinity(), TMath::Infinity());
+            } else {
+               a = R__MakeRange(TMath::Min(TMath::Min(p1, p2), TMath::Min(p3, p4)),
+                                TMath::Max(TMath::Max(p1, p2), TMath::Max(p3, p4)));
+            }
+            break;
+         }
+         case kmin: a = R__MakeRange(TMath::Min(a.fMin, b.fMin), TMath::Min(a.fMax, b.fMax)); break;
+         case kmax: a = R__MakeRange(TMath::Max(a.fMin, b.fMin), TMath::Max(a.fMax, b.fMax)); break;
+         case kLess:        a = R__MakeBool(a.fMax >= b.fMin, a.fMin < b.fMax);  break;
+         case kGreater:     a = R__MakeBool(a.fMin <= b.fMax, a.fMax > b.fMin);  break;
+         case kLessThan:    a = R__MakeBool(a.fMax > b.fMin,  a.fMin <= b.fMax); break;
+         case kGreaterThan: a = R__MakeBool(a.fMin < b.fMax,  a.fMax >= b.fMin); break;
+         case kEqual:
+            a = R__MakeBool(a.fMin != a.fMax || b.fMin != b.fMax || a.fMin != b.fMin,
+                            a.fMin <= b.fMax && b.fMin <= a.fMax);
+            break;
+         case kNotEqual:
+            a = R__MakeBool(a.fMin <= b.fMax && b.fMin <= a.fMax,
+                            a.fMin != a.fMax || b.fMin != b.fMax || a.fMin != b.fMin);
+            break;
+         case kAnd: a = R__MakeBool(R__CanBeFalse(a) || R__CanBeFalse(b), R__CanBeTrue(a) && R__CanBeTrue(b)); break;
+         case kOr:  a = R__MakeBool(R__CanBeFalse(a) && R__CanBeFalse(b), R__CanBeTrue(a) || R__CanBeTrue(b)); break;
+         default:
+            return kFALSE;
+      }
+      --pos;
+   }
+   return pos == 1 && stack[0].fMin == 0 && stack[0].fMax == 0;
+}
+
+//______________________________________________________________________________
+Long64_t TTreeFormula::SkipEntries(Long64_t entry, Long64_t *checkedUntil) const
+{
+   // Return the first entry of the current tree, starting at entry, for which
+   // the formula may not be 0 according to the range of the values recorded
+   // in the baskets of its branches (see TBranch::SetBasketMinMax). The
+   // entries skipped are in baskets where no value can make the formula non
+   // zero: a selection does not need to read them. Return the number of
+   // entries of the tree if all the remaining entries can be skipped.
+   // If checkedUntil is given, it is set to the end of the baskets containing
+   // the returned entry: the entries before it need not be checked again.
+
+   const TTree *tree = fTree ? fTree->GetTree() : 0;
+   Long64_t nentries = tree ? tree->GetEntries() : entry;
+   Long64_t next = nentries;
+   while (entry < nentries && IsZeroInBaskets(entry, next)) {
+      entry = next;
+   }
+   if (checkedUntil) *checkedUntil = entry < nentries ? next : nentries;
+   return entry;
+}
+
 //______________________________________________________________________________
 TFormLeafInfo *TTreeFormula::GetLeafInfo(Int_t code) const
 {
@@ -0,0 +1,804 @@
+// @(#)root/treeplayer:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2004, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+// A Tree Index with majorname and minorname, stored in a hash table.   //
+//                                                                      //
+// TTreeHashIndex is used like TTreeIndex, e.g. to join a friend tree   //
+// on the run and event numbers:                                        //
+//                                                                      //
+//    friendTree->SetTreeIndex(new TTreeHashIndex(friendTree,           //
+//                                                "run","event"));      //
+//    mainTree->AddFriend(friendTree);                                  //
+//                                                                      //
+// The pairs major<<31 + minor are stored in an open addressing hash    //
+// table (linear probing, load factor at most 1/2) instead of a sorted  //
+// array: building the index does not require a sort and               //
+// GetEntryNumberWithIndex takes constant time instead of a binary     //
+// search. GetEntryNumberWithBestIndex, which needs the ordering of the //
+// values, is a linear search. If a pair appears in several entries,   //
+// the index returns the first one.                                     //
+//                                                                      //
+// The values can be computed by several threads, each reading a slice //
+// of the entries from its own copy of the tree (see the constructor).  //
+//                                                                      //
+// Besides being saved with the tree, the table can be written to a     //
+// flat file with WriteTable and memory mapped back with OpenTable, so  //
+// that the index of a large tree is paged in on demand instead of      //
+// being read and streamed in full.                                     //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+#include "TTreeHashIndex.h"
+#include "TTree.h"
+#include "TChain.h"
+#include "TFile.h"
+#include "TSystem.h"
+#include "TROOT.h"
+#include "TThread.h"
+#include "TVirtualMutex.h"
+#include "TError.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifndef WIN32
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+ClassImp(TTreeHashIndex)
+
+// Layout of the files written by TTreeHashIndex::WriteTable: this header,
+// the major and minor names padded to a multiple of 8 bytes, then the
+// fNSlots keys and the fNSlots entry numbers, in the byte order of the
+// machine which wrote the file.
+struct TTreeHashIndexHeader {
+   char     fMagic[8];    // "RHSHIDX1"
+   UInt_t   fByteOrder;   // 0x01020304 as written by the writer
+   Int_t    fMajorLen;    // Length of the major name
+   Int_t    fMinorLen;    // Length of the minor name
+   Int_t    fPadding;     // Unused
+   Long64_t fN;           // Number of entries
+   Long64_t fNSlots;      // Number of slots
+};
+
+static const char   kTableMagic[8] = { 'R','H','S','H','I','D','X','1' };
+static const UInt_t kTableByteOrder = 0x01020304;
+
+//______________________________________________________________________________
+static inline ULong64_t R__HashIndexValue(Long64_t value)
+{
+   // Mix the bits of value (finalizer of MurmurHash3): major<<31 + minor
+   // leaves the low bits to the minor number only, which would cluster.
+
+   ULong64_t h = (ULong64_t)value;
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdULL;
+   h ^= h >> 33;
+   h *= 0xc4ceb9fe1a85ec53ULL;
+   h ^= h >> 33;
+   return h;
+}
+
+//______________________________________________________________________________
+static Bool_t R__ComputeIndexValues(TTree *tree, TTreeFormula *major, TTreeFormula *minor,
+                                    Long64_t first, Long64_t last, Long64_t *values)
+{
+   // Compute major<<31 + minor for the entries [first,last[ of tree into
+   // values[first-first..last-first[. Return false if an entry cannot be loaded.
+
+   Int_t current = -1;
+   for (Long64_t i = first; i < last; ++i) {
+      Long64_t centry = tree->LoadTree(i);
+      if (centry < 0) return kFALSE;
+      if (tree->GetTreeNumber() != current) {
+         current = tree->GetTreeNumber();
+         major->UpdateFormulaLeaves();
+         minor->UpdateFormulaLeaves();
+      }
+      Long64_t majorv = (Long64_t)major->EvalInstance();
+      Long64_t minorv = (Long64_t)minor->EvalInstance();
+      values[i-first] = (majorv<<31) + minorv;
+   }
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+//
+// Helper for TTreeHashIndex::ComputeValues: each thread computes the
+// values of a slice of the entries with its own copy of the tree.
+//
+class TTreeHashIndexSlice {
+public:
+   TString   fFileName;   // File containing the tree
+   TString   fTreeName;   // Path of the tree in the file
+   TString   fMajorName;  // Index major name
+   TString   fMinorName;  // Index minor name
+   Long64_t  fCacheSize;  // Size of the TTreeCache of the thread
+   Long64_t  fFirst;      // First entry of the slice
+   Long64_t  fLast;       // Last entry (excluded) of the slice
+   Long64_t *fValues;     // Values of the index, starting at entry fFirst
+   Bool_t    fDone;       // The values have been computed
+
+   static void *Run(void *arg);
+};
+
+//______________________________________________________________________________
+void *TTreeHashIndexSlice::Run(void *arg)
+{
+   // Compute the values of the entries of the slice.
+
+   TTreeHashIndexSlice *slice = (TTreeHashIndexSlice*)arg;
+
+   TDirectory::TContext ctxt(0);
+   TFile *file;
+   TTree *tree;
+   {
+      // Reading a TTree goes through the global gTree (see TTree::Streamer
+      // and TBranch::Streamer), the threads must not read theirs together.
+      R__LOCKGUARD2(gROOTMutex);
+      file = TFile::Open(slice->fFileName);
+      tree = file ? dynamic_cast<TTree*>(file->Get(slice->fTreeName)) : 0;
+   }
+   if (tree) {
+      if (slice->fCacheSize > 0) tree->SetCacheSize(slice->fCacheSize);
+      TTreeFormula *major, *minor;
+      {
+         // Parsing the formulas accesses the list of classes.
+         R__LOCKGUARD2(gROOTMutex);
+         major = new TTreeFormula("Major",slice->fMajorName.Data(),tree);
+         minor = new TTreeFormula("Minor",slice->fMinorName.Data(),tree);
+      }
+      major->SetQuickLoad(kTRUE);
+      minor->SetQuickLoad(kTRUE);
+      if (major->GetNdim() == 1 && minor->GetNdim() == 1) {
+         slice->fDone = R__ComputeIndexValues(tree, major, minor, slice->fFirst, slice->fLast, slice->fValues);
+      }
+      delete major;
+      delete minor;
+   }
+   R__LOCKGUARD2(gROOTMutex);
+   delete file;
+   return 0;
+}
+
+//______________________________________________________________________________
+TTreeHashIndex::TTreeHashIndex(): TVirtualIndex()
+{
+   // Default constructor for TTreeHashIndex
+
+   fTree               = 0;
+   fN                  = 0;
+   fNSlots             = 0;
+   fKeys               = 0;
+   fEntries            = 0;
+   fMapBuffer          = 0;
+   fMapSize            = 0;
+   fMajorFormula       = 0;
+   fMinorFormula       = 0;
+   fMajorFormulaParent = 0;
+   fMinorFormulaParent = 0;
+}
+
+//______________________________________________________________________________
+TTreeHashIndex::TTreeHashIndex(const TTree *T, const char *majorname, const char *minorname, Int_t nthreads)
+           : TVirtualIndex()
+{
+   // Normal constructor for TTreeHashIndex
+   //
+   // Build an index table using the leaves of Tree T with major & minor names,
+   // see TTreeIndex::TTreeIndex for the meaning of majorname and minorname and
+   // for the use of an index with friend trees. The index is attached to T
+   // with T->SetTreeIndex(index).
+   //
+   // The values of the index are computed by nthreads threads (0 for one per
+   // core), each of them opening its own copy of the file and of the tree and
+   // reading a contiguous slice of the entries. This is only possible for a
+   // TTree (not a TChain) in a file which is not open for writing; the values
+   // are otherwise computed in the calling thread, as for nthreads = 1.
+
+   fTree               = (TTree*)T;
+   fN                  = 0;
+   fNSlots             = 0;
+   fKeys               = 0;
+   fEntries            = 0;
+   fMapBuffer          = 0;
+   fMapSize            = 0;
+   fMajorFormula       = 0;
+   fMinorFormula       = 0;
+   fMajorFormulaParent = 0;
+   fMinorFormulaParent = 0;
+   fMajorName          = majorname;
+   fMinorName          = minorname;
+   if (!T) return;
+   fN = T->GetEntries();
+   if (fN <= 0) {
+      MakeZombie();
+      Error("TTreeHashIndex","Cannot build a TTreeHashIndex with a Tree having no entries");
+      return;
+   }
+
+   GetMajorFormula();
+   GetMinorFormula();
+   if (!fMajorFormula || !fMinorFormula ||
+       (fMajorFormula->GetNdim() != 1) || (fMinorFormula->GetNdim() != 1)) {
+      MakeZombie();
+      Error("TTreeHashIndex","Cannot build the index with major=%s, minor=%s",fMajorName.Data(), fMinorName.Data());
+      return;
+   }
+
+   Long64_t *w = new Long64_t[fN];
+   if (!ComputeValues(w, nthreads)) {
+      delete [] w;
+      MakeZombie();
+      Error("TTreeHashIndex","Cannot read the entries of the tree %s",fTree->GetName());
+      return;
+   }
+   Reserve(fN);
+   for (Long64_t i = 0; i < fN; ++i) {
+      Insert(w[i], i);
+   }
+   delete [] w;
+}
+
+//______________________________________________________________________________
+TTreeHashIndex::~TTreeHashIndex()
+{
+   // Destructor.
+
+   if (fTree && fTree->GetTreeIndex() == this) fTree->SetTreeIndex(0);
+   if (fMapBuffer) {
+      UnmapTable();
+   } else {
+      delete [] fKeys;
+      delete [] fEntries;
+   }
+   fKeys = 0;
+   fEntries = 0;
+   delete fMajorFormula;        fMajorFormula  = 0;
+   delete fMinorFormula;        fMinorFormula  = 0;
+   delete fMajorFormulaParent;  fMajorFormulaParent = 0;
+   delete fMinorFormulaParent;  fMinorFormulaParent = 0;
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::Append(const TVirtualIndex *add, Bool_t /* delaySort */)
+{
+   // Append 'add' to this index.  Entry 0 in add will become entry n+1 in this.
+   // The table is always kept up to date, there is nothing to sort.
+
+   if (!add || !add->GetN()) return;
+
+   const TTreeHashIndex *hi_add = dynamic_cast<const TTreeHashIndex*>(add);
+   if (hi_add == 0) {
+      Error("Append","Can only Append a TTreeHashIndex to a TTreeHashIndex but got a %s",
+            add->IsA()->GetName());
+      return;
+   }
+
+   if (fMapBuffer) {
+      // The mapped table is read-only, work on a copy.
+      Long64_t *keys = new Long64_t[fNSlots];
+      Long64_t *entries = new Long64_t[fNSlots];
+      memcpy(keys, fKeys, fNSlots*sizeof(Long64_t));
+      memcpy(entries, fEntries, fNSlots*sizeof(Long64_t));
+      UnmapTable();
+      fKeys = keys;
+      fEntries = entries;
+   }
+
+   Long64_t oldn = fN;
+   Reserve(fN + add->GetN());
+   for (Long64_t s = 0; s < hi_add->fNSlots; ++s) {
+      if (hi_add->fEntries[s] >= 0) Insert(hi_add->fKeys[s], hi_add->fEntries[s] + oldn);
+   }
+   fN += add->GetN();
+}
+
+//______________________________________________________________________________
+Bool_t TTreeHashIndex::ComputeValues(Long64_t *values, Int_t nthreads)
+{
+   // Compute the value major<<31 + minor of each entry of the tree, with
+   // nthreads threads if possible (see the constructor).
+
+   if (nthreads == 0) {
+      SysInfo_t info;
+      gSystem->GetSysInfo(&info);
+      nthreads = info.fCpus;
+   }
+   if (nthreads > fN) nthreads = (Int_t)fN;
+   TFile *file = fTree->GetCurrentFile();
+   if (fTree->InheritsFrom(TChain::Class()) || !file || file->IsWritable() || !fTree->GetDirectory()) {
+      nthreads = 1;
+   }
+
+   Long64_t oldEntry = fTree->GetReadEntry();
+   Bool_t status = kTRUE;
+   if (nthreads > 1) {
+      TString path(fTree->GetDirectory()->GetPath());
+      Ssiz_t colon = path.Index(":/");
+      TString treename = colon >= 0 ? path(colon+2, path.Length()) : TString();
+      if (treename.Length()) treename += "/";
+      treename += fTree->GetName();
+
+      std::vector<TTreeHashIndexSlice> slices(nthreads);
+      std::vector<TThread*> threads(nthreads);
+      for (Int_t i = 0; i < nthreads; ++i) {
+         TTreeHashIndexSlice &slice = slices[i];
+         slice.fFileName = file->GetName();
+         slice.fTreeName = treename;
+         slice.fMajorName = fMajorName;
+         slice.fMinorName = fMinorName;
+         slice.fCacheSize = fTree->GetCacheSize();
+         slice.fFirst = fN * i / nthreads;
+         slice.fLast = fN * (i+1) / nthreads;
+         slice.fValues = values + slice.fFirst;
+         slice.fDone = kFALSE;
+         threads[i] = new TThread(TTreeHashIndexSlice::Run, &slice);
+         threads[i]->Run();
+      }
+      for (Int_t i = 0; i < nthreads; ++i) {
+         threads[i]->Join();
+         delete threads[i];
+      }
+      // Redo in this thread the slices which could not be computed.
+      for (Int_t i = 0; status && i < nthreads; ++i) {
+         if (slices[i].fDone) continue;
+         status = R__ComputeIndexValues(fTree, fMajorFormula, fMinorFormula,
+                                        slices[i].fFirst, slices[i].fLast, slices[i].fValues);
+      }
+   } else {
+      status = R__ComputeIndexValues(fTree, fMajorFormula, fMinorFormula, 0, fN, values);
+   }
+   fTree->LoadTree(oldEntry);
+   return status;
+}
+
+//______________________________________________________________________________
+Long64_t TTreeHashIndex::FindSlot(Long64_t value) const
+{
+   // Return the slot holding value or, if value is not in the table, the
+   // empty slot where it would be inserted. Return -1 if the table is empty
+   // or if value is not in a table without empty slot. The tables built or
+   // written by this class always have empty slots, but a table opened by
+   // OpenTable is not scanned to check it, so the probing stops after
+   // fNSlots slots.
+
+   if (fNSlots == 0) return -1;
+   Long64_t mask = fNSlots - 1;
+   Long64_t slot = (Long64_t)(R__HashIndexValue(value) & (ULong64_t)mask);
+   for (Long64_t probe = 0; probe < fNSlots; ++probe) {
+      if (fEntries[slot] < 0 || fKeys[slot] == value) return slot;
+      slot = (slot + 1) & mask;
+   }
+   return -1;
+}
+
+//______________________________________________________________________________
+Long64_t TTreeHashIndex::GetEntryNumberFriend(const TTree *parent)
+{
+   // Returns the entry number in this (friend) Tree corresponding to entry in
+   // the master Tree 'parent'.
+   // In case this (friend) Tree and 'master' do not share an index with the same
+   // major and minor name, the entry serial number in the (friend) tree
+   // and in the master Tree are assumed to be the same
+
+   if (!parent) return -3;
+   GetMajorFormulaParent(parent);
+   GetMinorFormulaParent(parent);
+   if (!fMajorFormulaParent || !fMinorFormulaParent) return -1;
+   if (!fMajorFormulaParent->GetNdim() || !fMinorFormulaParent->GetNdim()) {
+      // The Tree Index in the friend has a pair majorname,minorname
+      // not available in the parent Tree T.
+      // if the friend Tree has less entries than the parent, this is an error
+      Long64_t pentry = parent->GetReadEntry();
+      if (pentry >= fTree->GetEntries()) return -2;
+      // otherwise we ignore the Tree Index and return the entry number
+      // in the parent Tree.
+      return pentry;
+   }
+
+   // majorname, minorname exist in the parent Tree
+   // we find the current values pair majorv,minorv in the parent Tree
+   Double_t majord = fMajorFormulaParent->EvalInstance();
+   Double_t minord = fMinorFormulaParent->EvalInstance();
+   Long64_t majorv = (Long64_t)majord;
+   Long64_t minorv = (Long64_t)minord;
+   // we check if this pair exist in the index.
+   // if yes, we return the corresponding entry number
+   // if not the function returns -1
+   return fTree->GetEntryNumberWithIndex(majorv,minorv);
+}
+
+//______________________________________________________________________________
+Long64_t TTreeHashIndex::GetEntryNumberWithBestIndex(Int_t major, Int_t minor) const
+{
+   // Return entry number corresponding to major and minor number.
+   // If an entry corresponding to major and minor is not found, the function
+   // returns the entry of the major,minor pair immediatly lower than the
+   // requested value, ie it will return -1 if the pair is lower than
+   // all the entries in the index.
+   // The table is not sorted: unless the pair is found, all the slots are
+   // scanned. Use a TTreeIndex if this function is called often.
+   //
+   // See also GetEntryNumberWithIndex
+
+   Long64_t value = Long64_t(major)<<31;
+   value += minor;
+   Long64_t slot = FindSlot(value);
+   if (slot >= 0 && fEntries[slot] >= 0) return fEntries[slot];
+
+   Long64_t best = -1;
+   for (Long64_t s = 0; s < fNSlots; ++s) {
+      if (fEntries[s] < 0 || fKeys[s] > value) continue;
+      if (best < 0 || fKeys[s] > fKeys[best]) best = s;
+   }
+   return best < 0 ? -1 : fEntries[best];
+}
+
+//______________________________________________________________________________
+Long64_t TTreeHashIndex::GetEntryNumberWithIndex(Int_t major, Int_t minor) const
+{
+   // Return entry number corresponding to major and minor number, -1 if
+   // the pair is not in the index.
+   // Note that this function returns only the entry number, not the data
+   // To read the data corresponding to an entry number, use TTree::GetEntryWithIndex
+   //
+   // See also GetEntryNumberWithBestIndex
+
+   Long64_t value = Long64_t(major)<<31;
+   value += minor;
+   Long64_t slot = FindSlot(value);
+   if (slot < 0) return -1;
+   return fEntries[slot];
+}
+
+//______________________________________________________________________________
+TTreeFormula *TTreeHashIndex::GetMajorFormula()
+{
+   // Return a pointer to the TreeFormula corresponding to the majorname.
+
+   if (!fMajorFormula) {
+      fMajorFormula = new TTreeFormula("Major",fMajorName.Data(),fTree);
+      fMajorFormula->SetQuickLoad(kTRUE);
+   }
+   return fMajorFormula;
+}
+
+//______________________________________________________________________________
+TTreeFormula *TTreeHashIndex::GetMinorFormula()
+{
+   // Return a pointer to the TreeFormula corresponding to the minorname.
+
+   if (!fMinorFormula) {
+      fMinorFormula = new TTreeFormula("Minor",fMinorName.Data(),fTree);
+      fMinorFormula->SetQuickLoad(kTRUE);
+   }
+   return fMinorFormula;
+}
+
+//______________________________________________________________________________
+TTreeFormula *TTreeHashIndex::GetMajorFormulaParent(const TTree *parent)
+{
+   // Return a pointer to the TreeFormula corresponding to the majorname in parent tree.
+
+   if (!fMajorFormulaParent) {
+      // Prevent TTreeFormula from finding any of the branches in our TTree even if it
+      // is a friend of the parent TTree.
+      TTree::TFriendLock friendlock(fTree, TTree::kFindLeaf | TTree::kFindBranch | TTree::kGetBranch | TTree::kGetLeaf);
+      fMajorFormulaParent = new TTreeFormula("MajorP",fMajorName.Data(),const_cast<TTree*>(parent));
+      fMajorFormulaParent->SetQuickLoad(kTRUE);
+   }
+   if (fMajorFormulaParent->GetTree() != parent) {
+      fMajorFormulaParent->SetTree(const_cast<TTree*>(parent));
+      fMajorFormulaParent->UpdateFormulaLeaves();
+   }
+   return fMajorFormulaParent;
+}
+
+//______________________________________________________________________________
+TTreeFormula *TTreeHashIndex::GetMinorFormulaParent(const TTree *parent)
+{
+   // Return a pointer to the TreeFormula corresponding to the minorname in parent tree.
+
+   if (!fMinorFormulaParent) {
+      // Prevent TTreeFormula from finding any of the branches in our TTree even if it
+      // is a friend of the parent TTree.
+      TTree::TFriendLock friendlock(fTree, TTree::kFindLeaf | TTree::kFindBranch | TTree::kGetBranch | TTree::kGetLeaf);
+      fMinorFormulaParent = new TTreeFormula("MinorP",fMinorName.Data(),const_cast<TTree*>(parent));
+      fMinorFormulaParent->SetQuickLoad(kTRUE);
+   }
+   if (fMinorFormulaParent->GetTree() != parent) {
+      fMinorFormulaParent->SetTree(const_cast<TTree*>(parent));
+      fMinorFormulaParent->UpdateFormulaLeaves();
+   }
+   return fMinorFormulaParent;
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::Insert(Long64_t value, Long64_t entry)
+{
+   // Add the pair value,entry to the table, which must have a free slot.
+   // If value is already present, the smallest entry number is kept.
+
+   Long64_t slot = FindSlot(value);
+   if (slot < 0) {
+      Error("Insert", "the table has no free slot for the entry %lld", entry);
+      return;
+   }
+   if (fEntries[slot] < 0 || entry < fEntries[slot]) {
+      fKeys[slot] = value;
+      fEntries[slot] = entry;
+   }
+}
+
+//______________________________________________________________________________
+TTreeHashIndex *TTreeHashIndex::OpenTable(const TTree *T, const char *filename)
+{
+   // Return a new index for the tree T with the table written in filename
+   // by WriteTable, 0 in case of error. The file is memory mapped (except on
+   // Windows where it is read): the pages of the table are only read when
+   // they are accessed by a lookup. Attach the index to the tree with
+   // T->SetTreeIndex(index).
+
+   FILE *fp = fopen(filename, "rb");
+   if (!fp) {
+      ::Error("TTreeHashIndex::OpenTable", "cannot open %s", filename);
+      return 0;
+   }
+   TTreeHashIndexHeader header;
+   Bool_t ok = fread(&header, sizeof(header), 1, fp) == 1;
+   if (ok && memcmp(header.fMagic, kTableMagic, sizeof(kTableMagic))) ok = kFALSE;
+   if (!ok) {
+      fclose(fp);
+      ::Error("TTreeHashIndex::OpenTable", "%s is not a TTreeHashIndex table", filename);
+      return 0;
+   }
+   if (header.fByteOrder != kTableByteOrder) {
+      fclose(fp);
+      ::Error("TTreeHashIndex::OpenTable", "%s was written on a machine with a different byte order", filename);
+      return 0;
+   }
+   // The lookups rely on a number of slots which is a power of two and on
+   // free slots (the load factor is at most 1/2).
+   const Int_t kMaxNameLen = 1 << 16;
+   if (header.fMajorLen < 0 || header.fMajorLen > kMaxNameLen ||
+       header.fMinorLen < 0 || header.fMinorLen > kMaxNameLen ||
+       header.fN < 0 || header.fNSlots < 0 ||
+       (header.fNSlots & (header.fNSlots - 1)) != 0 || 2 * header.fN > header.fNSlots) {
+      fclose(fp);
+      ::Error("TTreeHashIndex::OpenTable", "%s has an invalid header", filename);
+      return 0;
+   }
+   Long64_t names = (header.fMajorLen + header.fMinorLen + 7) / 8 * 8;
+   Long64_t offset = sizeof(header) + names;
+#ifndef WIN32
+   // A mapping beyond the end of the file would only fail (SIGBUS) when
+   // the missing pages are accessed.
+   struct stat st;
+   if (fstat(fileno(fp), &st) != 0 || (Long64_t)st.st_size < offset ||
+       header.fNSlots > ((Long64_t)st.st_size - offset) / (2 * (Long64_t)sizeof(Long64_t))) {
+      fclose(fp);
+      ::Error("TTreeHashIndex::OpenTable", "%s is too short for a table of %lld slots", filename, header.fNSlots);
+      return 0;
+   }
+#endif
+   Long64_t size = offset + 2 * header.fNSlots * (Long64_t)sizeof(Long64_t);
+
+   TTreeHashIndex *index = new TTreeHashIndex();
+   std::vector<char> namebuf(names + 1);
+   if (fread(&namebuf[0], 1, names, fp) != (size_t)names) ok = kFALSE;
+   index->fMajorName = TString(&namebuf[0], header.fMajorLen);
+   index->fMinorName = TString(&namebuf[header.fMajorLen], header.fMinorLen);
+   index->fTree = (TTree*)T;
+   index->fN = header.fN;
+   index->fNSlots = header.fNSlots;
+
+#ifndef WIN32
+   if (ok) {
+      char *buffer = (char*)mmap(0, size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+      if (buffer == (char*)MAP_FAILED) {
+         ok = kFALSE;
+      } else {
+         index->fMapBuffer = buffer;
+         index->fMapSize = size;
+         index->fKeys = (Long64_t*)(buffer + offset);
+         index->fEntries = index->fKeys + header.fNSlots;
+      }
+   }
+#else
+   if (ok) {
+      index->fKeys = new Long64_t[header.fNSlots];
+      index->fEntries = new Long64_t[header.fNSlots];
+      ok = fread(index->fKeys, sizeof(Long64_t), header.fNSlots, fp) == (size_t)header.fNSlots &&
+           fread(index->fEntries, sizeof(Long64_t), header.fNSlots, fp) == (size_t)header.fNSlots;
+   }
+#endif
+   fclose(fp);
+   if (!ok) {
+      ::Error("TTreeHashIndex::OpenTable", "cannot read the table in %s", filename);
+      delete index;
+      return 0;
+   }
+   if (T && T->GetEntries() != index->fN) {
+      ::Warning("TTreeHashIndex::OpenTable", "the table in %s has %lld entries but the tree %s has %lld",
+                filename, index->fN, T->GetName(), T->GetEntries());
+   }
+   return index;
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::Print(Option_t * option) const
+{
+   // Print the table with : slot, majorname, minorname, entry number.
+   // if option = "10" print only the first 10 entries
+   // if option = "100" print only the first 100 entries
+   // if option = "1000" print only the first 1000 entries
+
+   TString opt = option;
+   Long64_t n = fN;
+   if (opt.Contains("10"))   n = 10;
+   if (opt.Contains("100"))  n = 100;
+   if (opt.Contains("1000")) n = 1000;
+
+   Printf("\n*****************************************************************");
+   Printf("*    Hash index of Tree: %s/%s",fTree ? fTree->GetName() : "",fTree ? fTree->GetTitle() : "");
+   Printf("*    %lld entries, %lld slots%s",fN,fNSlots,fMapBuffer ? " (memory mapped)" : "");
+   Printf("*****************************************************************");
+   Printf("%8s : %16s : %16s : %16s","slot",fMajorName.Data(),fMinorName.Data(),"entry number");
+   Printf("*****************************************************************");
+   for (Long64_t s = 0; s < fNSlots && n > 0; ++s) {
+      if (fEntries[s] < 0) continue;
+      Long64_t minor = fKeys[s] & 0x7fffffff;
+      Long64_t major = fKeys[s]>>31;
+      Printf("%8lld :         %8lld :         %8lld :         %8lld",s,major,minor,fEntries[s]);
+      --n;
+   }
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::Reserve(Long64_t n)
+{
+   // Make sure the table can hold n values with a load factor of at most 1/2.
+
+   if (2*n <= fNSlots) return;
+   Long64_t nslots = 16;
+   while (nslots < 2*n) nslots *= 2;
+
+   Long64_t *oldKeys = fKeys;
+   Long64_t *oldEntries = fEntries;
+   Long64_t oldSlots = fNSlots;
+   fKeys = new Long64_t[nslots];
+   fEntries = new Long64_t[nslots];
+   fNSlots = nslots;
+   for (Long64_t s = 0; s < nslots; ++s) fEntries[s] = -1;
+   for (Long64_t s = 0; s < oldSlots; ++s) {
+      if (oldEntries[s] >= 0) Insert(oldKeys[s], oldEntries[s]);
+   }
+   delete [] oldKeys;
+   delete [] oldEntries;
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::Streamer(TBuffer &R__b)
+{
+   // Stream an object of class TTreeHashIndex.
+
+   UInt_t R__s, R__c;
+   if (R__b.IsReading()) {
+      Version_t R__v = R__b.ReadVersion(&R__s, &R__c); if (R__v) { }
+      if (fMapBuffer) {
+         UnmapTable();
+      } else {
+         delete [] fKeys;
+         delete [] fEntries;
+      }
+      TVirtualIndex::Streamer(R__b);
+      fMajorName.Streamer(R__b);
+      fMinorName.Streamer(R__b);
+      R__b >> fN;
+      R__b >> fNSlots;
+      fKeys = new Long64_t[fNSlots];
+      R__b.ReadFastArray(fKeys,fNSlots);
+      fEntries = new Long64_t[fNSlots];
+      R__b.ReadFastArray(fEntries,fNSlots);
+      R__b.CheckByteCount(R__s, R__c, TTreeHashIndex::IsA());
+   } else {
+      R__c = R__b.WriteVersion(TTreeHashIndex::IsA(), kTRUE);
+      TVirtualIndex::Streamer(R__b);
+      fMajorName.Streamer(R__b);
+      fMinorName.Streamer(R__b);
+      R__b << fN;
+      R__b << fNSlots;
+      R__b.WriteFastArray(fKeys, fNSlots);
+      R__b.WriteFastArray(fEntries, fNSlots);
+      R__b.SetByteCount(R__c, kTRUE);
+   }
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::UnmapTable()
+{
+   // Release the memory mapped table.
+
+#ifndef WIN32
+   if (fMapBuffer) munmap(fMapBuffer, fMapSize);
+#endif
+   fMapBuffer = 0;
+   fMapSize = 0;
+   fKeys = 0;
+   fEntries = 0;
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::UpdateFormulaLeaves(const TTree *parent)
+{
+   // Called by TChain::LoadTree when the parent chain changes it's tree.
+
+   if (fMajorFormula)       { fMajorFormula->UpdateFormulaLeaves();}
+   if (fMinorFormula)       { fMinorFormula->UpdateFormulaLeaves();}
+   if (fMajorFormulaParent) {
+      if (parent) fMajorFormulaParent->SetTree(const_cast<TTree*>(parent));
+      fMajorFormulaParent->UpdateFormulaLeaves();
+   }
+   if (fMinorFormulaParent) {
+      if (parent) fMinorFormulaParent->SetTree(const_cast<TTree*>(parent));
+      fMinorFormulaParent->UpdateFormulaLeaves();
+   }
+}
+
+//______________________________________________________________________________
+void TTreeHashIndex::SetTree(const TTree *T)
+{
+   // this function is called by TChain::LoadTree and TTreePlayer::UpdateFormulaLeaves
+   // when a new Tree is loaded.
+
+   fTree = (TTree*)T;
+}
+
+//______________________________________________________________________________
+Bool_t TTreeHashIndex::WriteTable(const char *filename) const
+{
+   // Write the hash table to filename, in a flat form which can be memory
+   // mapped by OpenTable. Return false in case of error.
+   // The file is written in the byte order of this machine.
+
+   FILE *fp = fopen(filename, "wb");
+   if (!fp) {
+      Error("WriteTable", "cannot create %s", filename);
+      return kFALSE;
+   }
+   TTreeHashIndexHeader header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.fMagic, kTableMagic, sizeof(kTableMagic));
+   header.fByteOrder = kTableByteOrder;
+   header.fMajorLen = fMajorName.Length();
+   header.fMinorLen = fMinorName.Length();
+   header.fN = fN;
+   header.fNSlots = fNSlots;
+   Int_t names = (header.fMajorLen + header.fMinorLen + 7) / 8 * 8;
+   std::vector<char> namebuf(names + 1, 0);
+   memcpy(&namebuf[0], fMajorName.Data(), header.fMajorLen);
+   memcpy(&namebuf[header.fMajorLen], fMinorName.Data(), header.fMinorLen);
+
+   Bool_t ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+               fwrite(&namebuf[0], 1, names, fp) == (size_t)names &&
+               fwrite(fKeys, sizeof(Long64_t), fNSlots, fp) == (size_t)fNSlots &&
+               fwrite(fEntries, sizeof(Long64_t), fNSlots, fp) == (size_t)fNSlots;
+   if (fclose(fp) != 0) ok = kFALSE;
+   if (!ok) {
+      Error("WriteTable", "cannot write the table to %s", filename);
+      gSystem->Unlink(filename);
+   }
+   return ok;
+}
@@ -76,6 +76,14 @@
 //           number of bytes returned to the application per second.
 //           The Physical disk speed is DiskIO + DiskIO*ReadExtra/100.
 //
+// In addition, per file (read calls, bytes read and read time) and per
+// branch (baskets, compressed and uncompressed bytes, decompression time and
+// basket sizes) counters are collected. They can be sampled at any time
+// during the job, together with the TTreeCache hit/miss counts and the time
+// spent waiting for the TFilePrefetch thread, in JSON format with
+//    ps->Print("json");          // to stdout
+//    ps->SaveAs("cmsperf.json"); // to a file
+//
 //////////////////////////////////////////////////////////////////////////
 
 
@@ -95,6 +103,10 @@
 #include "TTimeStamp.h"
 #include "TDatime.h"
 #include "TMath.h"
+#include "TTreeCache.h"
+#include "TFilePrefetch.h"
+#include "TVirtualMutex.h"
+#include <fstream>
 
 ClassImp(TTreePerfStats)
 
@@ -125,6 +137,7 @@ TTreePerfStats::TTreePerfStats() : TVirtualPerfStats()
    fCompress      = 0;
    fRealTimeAxis  = 0;
    fHostInfoText  = 0;
+   fCountersMutex = 0;
 }
 
 //______________________________________________________________________________
@@ -168,6 +181,7 @@ TTreePerfStats::TTreePerfStats(const char *name, TTree *T) : TVirtualPerfStats()
    TDatime dt;
    fHostInfo += Form(" %s",dt.AsString());
    fHostInfoText   = 0;
+   fCountersMutex  = 0;
 
    gPerfStats = this;
 }
@@ -185,6 +199,7 @@ TTreePerfStats::~TTreePerfStats()
    delete fWatch;
    delete fRealTimeAxis;
    delete fHostInfoText;
+   delete fCountersMutex;
 
    if (gPerfStats == this) {
       gPerfStats = 0;
@@ -274,7 +289,10 @@ void TTreePerfStats::FileReadEvent(TFile *file, Int_t len, Double_t start)
    // Record TTree file read event.
    // start is the TimeStamp before reading
    // len is the number of bytes read
+   // The reads may be done by other threads (TFilePrefetch, TChain
+   // prefetching of the next file), so the counters are updated under a lock.
 
+   R__LOCKGUARD2(fCountersMutex);
    if (file == this->fFile){
       Long64_t offset = file->GetRelOffset();
       Int_t np = fGraphIO->GetN();
@@ -287,6 +305,12 @@ void TTreePerfStats::FileReadEvent(TFile *file, Int_t len, Double_t start)
       fGraphTime->SetPoint(np,entry,tnow);
       fGraphTime->SetPointError(np,0.001,dtime);
    }
+   if (file) {
+      TFileCounters &counters = fFileCounters[file->GetName()];
+      counters.fReadCalls++;
+      counters.fBytesRead += len;
+      counters.fReadTime  += Double_t(TTimeStamp())-start;
+   }
 }
 
 
@@ -301,9 +325,30 @@ void TTreePerfStats::FileUnzipEvent(TFile * /* file */, Long64_t /* pos */, Doub
    
    Double_t tnow = TTimeStamp();
    Double_t dtime = tnow-start;
+   R__LOCKGUARD2(fCountersMutex);
    fUnzipTime += dtime;
 }
 
+//______________________________________________________________________________
+void TTreePerfStats::BasketUnzipEvent(TObject *branch, TFile * /* file */, Long64_t /* pos */, Double_t start, Int_t complen, Int_t objlen)
+{
+   // Record TTree file unzip event of a basket of branch, see FileUnzipEvent.
+   // The counters of the branch are updated as well.
+
+   Double_t tnow = TTimeStamp();
+   Double_t dtime = tnow-start;
+   R__LOCKGUARD2(fCountersMutex);
+   fUnzipTime += dtime;
+   if (!branch) return;
+   TBranchCounters &counters = fBranchCounters[branch->GetName()];
+   if (!counters.fBaskets || complen < counters.fMinBasket) counters.fMinBasket = complen;
+   if (complen > counters.fMaxBasket) counters.fMaxBasket = complen;
+   counters.fBaskets++;
+   counters.fZipBytes   += complen;
+   counters.fUnzipBytes += objlen;
+   counters.fUnzipTime  += dtime;
+}
+
 //______________________________________________________________________________
 void TTreePerfStats::Finish()
 {
@@ -423,6 +468,10 @@ void TTreePerfStats::Print(Option_t * option) const
 
    TString opts(option);
    opts.ToLower();
+   if (opts.Contains("json")) {
+      PrintJSON(std::cout);
+      return;
+   }
    Bool_t unzip = opts.Contains("unzip");
    TTreePerfStats *ps = (TTreePerfStats*)this;
    ps->Finish();
@@ -454,11 +503,111 @@ void TTreePerfStats::Print(Option_t * option) const
    }      
 }
 
+//______________________________________________________________________________
+static TString R__JSONString(const char *str)
+{
+   // Return str quoted and escaped as a JSON string.
+
+   TString res = "\"";
+   for (const char *c = str; c && *c; ++c) {
+      if (*c == '"' || *c == '\\') res += '\\';
+      if ((unsigned char)*c < 0x20) res += Form("\\u%04x", (unsigned char)*c);
+      else res += *c;
+   }
+   res += "\"";
+   return res;
+}
+
+//______________________________________________________________________________
+void TTreePerfStats::PrintJSON(std::ostream &out) const
+{
+   // Print the I/O counters in JSON format to out. Unlike Print, this does
+   // not call Finish: it can be used to sample the counters while the job
+   // is running. Times are in seconds, sizes in bytes.
+
+   Double_t realTime = fRealTime;
+   Double_t cpuTime  = fCpuTime;
+   if (fWatch && !fReadCalls) {
+      realTime = fWatch->RealTime();
+      cpuTime  = fWatch->CpuTime();
+      fWatch->Continue();
+   }
+   TFile *file = fTree ? fTree->GetCurrentFile() : fFile;
+
+   R__LOCKGUARD2(fCountersMutex);
+   out << "{" << std::endl;
+   out << "  \"name\": " << R__JSONString(GetName()) << "," << std::endl;
+   out << "  \"host\": " << R__JSONString(GetHostInfo()) << "," << std::endl;
+   if (fTree) out << "  \"tree\": " << R__JSONString(fTree->GetName()) << "," << std::endl;
+   out << "  \"realtime\": " << realTime << "," << std::endl;
+   out << "  \"cputime\": " << cpuTime << "," << std::endl;
+   out << "  \"disktime\": " << fDiskTime << "," << std::endl;
+   out << "  \"unziptime\": " << fUnzipTime << "," << std::endl;
+   out << "  \"filebytesread\": " << TFile::GetFileBytesRead() << "," << std::endl;
+   out << "  \"filereadcalls\": " << TFile::GetFileReadCalls() << "," << std::endl;
+
+   TFileCacheRead *cache = file ? file->GetCacheRead(fTree) : 0;
+   if (cache) {
+      out << "  \"cache\": {" << std::endl;
+      out << "    \"size\": " << cache->GetBufferSize() << "," << std::endl;
+      TTreeCache *tcache = dynamic_cast<TTreeCache*>(cache);
+      if (tcache) {
+         out << "    \"hits\": " << tcache->GetNReadOk() << "," << std::endl;
+         out << "    \"misses\": " << tcache->GetNReadMiss() << "," << std::endl;
+         out << "    \"prefetched\": " << tcache->GetNReadPref() << "," << std::endl;
+         out << "    \"efficiency\": " << tcache->GetEfficiency() << "," << std::endl;
+      }
+      TFilePrefetch *prefetch = cache->IsEnablePrefetching() ? cache->GetPrefetchObj() : 0;
+      out << "    \"prefetchwaittime\": " << (prefetch ? 1e-6*prefetch->GetWaitTime() : 0.) << "," << std::endl;
+      out << "    \"bytesread\": " << cache->GetBytesRead() << "," << std::endl;
+      out << "    \"nocachebytesread\": " << cache->GetNoCacheBytesRead() << "," << std::endl;
+      out << "    \"readcalls\": " << cache->GetReadCalls() << std::endl;
+      out << "  }," << std::endl;
+   }
+
+   out << "  \"files\": [";
+   for (FileCounters_t::const_iterator it = fFileCounters.begin(); it != fFileCounters.end(); ++it) {
+      out << (it == fFileCounters.begin() ? "" : ",") << std::endl;
+      out << "    {\"name\": " << R__JSONString(it->first.c_str())
+          << ", \"readcalls\": " << it->second.fReadCalls
+          << ", \"bytesread\": " << it->second.fBytesRead
+          << ", \"readtime\": " << it->second.fReadTime << "}";
+   }
+   out << std::endl << "  ]," << std::endl;
+
+   out << "  \"branches\": [";
+   for (BranchCounters_t::const_iterator it = fBranchCounters.begin(); it != fBranchCounters.end(); ++it) {
+      out << (it == fBranchCounters.begin() ? "" : ",") << std::endl;
+      out << "    {\"name\": " << R__JSONString(it->first.c_str())
+          << ", \"baskets\": " << it->second.fBaskets
+          << ", \"zipbytes\": " << it->second.fZipBytes
+          << ", \"unzipbytes\": " << it->second.fUnzipBytes
+          << ", \"unziptime\": " << it->second.fUnzipTime
+          << ", \"minbasket\": " << it->second.fMinBasket
+          << ", \"maxbasket\": " << it->second.fMaxBasket << "}";
+   }
+   out << std::endl << "  ]" << std::endl;
+   out << "}" << std::endl;
+}
+
 //______________________________________________________________________________
 void TTreePerfStats::SaveAs(const char *filename, Option_t * /*option*/) const
 {
-   // Save this object to filename
-   
+   // Save this object to filename.
+   // If filename ends with ".json" the counters are written in JSON format,
+   // see PrintJSON.
+
+   TString fname = filename;
+   if (fname.EndsWith(".json")) {
+      std::ofstream out(fname.Data());
+      if (!out.good()) {
+         Error("SaveAs", "cannot open file: %s", fname.Data());
+         return;
+      }
+      PrintJSON(out);
+      Info("SaveAs", "JSON file: %s has been generated", fname.Data());
+      return;
+   }
    TTreePerfStats *ps = (TTreePerfStats*)this;
    ps->Finish();
    ps->TObject::SaveAs(filename);
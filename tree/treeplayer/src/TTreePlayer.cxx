@@ -77,6 +77,9 @@
 #include "TVirtualMonitoring.h"
 #include "TTreeCache.h"
 #include "TStyle.h"
+#include "TThread.h"
+#include "TMutex.h"
+#include "TMethodCall.h"
 
 #include "HFitInterface.h"
 #include "Foption.h"
@@ -219,6 +222,7 @@ TTree *TTreePlayer::CopyTree(const char *selection, Option_t *, Long64_t nentrie
 
    //loop on the specified entries
    Int_t tnumber = -1;
+   Long64_t skipNext = 0, skipCheck = 0;
    for (entry=firstentry;entry<firstentry+nentries;entry++) {
       entryNumber = fTree->GetEntryNumber(entry);
       if (entryNumber < 0) break;
@@ -227,8 +231,12 @@ TTree *TTreePlayer::CopyTree(const char *selection, Option_t *, Long64_t nentrie
       if (tnumber != fTree->GetTreeNumber()) {
          tnumber = fTree->GetTreeNumber();
          if (select) select->UpdateFormulaLeaves();
+         skipNext = skipCheck = 0;
       }
       if (select) {
+         // Skip the baskets where the selection can not pass (see TBranch::SetBasketMinMax).
+         if (localEntry >= skipCheck) skipNext = select->SkipEntries(localEntry, &skipCheck);
+         if (localEntry < skipNext) continue;
          Int_t ndata = select->GetNdata();
          Bool_t keep = kFALSE;
          for(Int_t current = 0; current<ndata && !keep; current++) {
@@ -2124,9 +2132,22 @@ Long64_t TTreePlayer::Process(TSelector *selector,Option_t *option, Long64_t nen
    //  If the Tree (Chain) has an associated EventList, the loop is on the nentries
    //  of the EventList, starting at firstentry, otherwise the loop is on the
    //  specified Tree entries.
+   //
+   //  If TTree::SetProcessThreads has been called, the clusters of the tree
+   //  are processed concurrently by several threads, see ProcessParallel.
 
    nentries = GetEntriesToProcess(firstentry, nentries);
 
+   Int_t nthreads = TTree::GetProcessThreads();
+   if (nthreads == 0) {
+      SysInfo_t info;
+      gSystem->GetSysInfo(&info);
+      nthreads = info.fCpus;
+   }
+   if (nthreads > 1 && nentries > 0 && IsParallelProcessable(selector)) {
+      return ProcessParallel(selector, option, nentries, firstentry, nthreads);
+   }
+
    TDirectory::TContext ctxt(0);
 
    fTree->SetNotify(selector);
@@ -2229,6 +2250,249 @@ Long64_t TTreePlayer::Process(TSelector *selector,Option_t *option, Long64_t nen
    return selector->GetStatus();
 }
 
+//______________________________________________________________________________
+Bool_t TTreePlayer::IsParallelProcessable(TSelector *selector) const
+{
+   // Return true if the entries of the tree can be processed with selector
+   // by several threads: each thread must be able to open its own copy of the
+   // tree and to create its own instance of the (compiled) selector class.
+
+   if (!selector || selector->Version() < 2) return kFALSE;
+   TClass *cl = selector->IsA();
+   if (!cl || !cl->IsLoaded() || !cl->GetNew()) return kFALSE;
+   // The selectors of TTree::Draw and GetEntries keep their result in data members
+   if (cl->InheritsFrom(TSelectorDraw::Class()) || cl->InheritsFrom(TSelectorEntries::Class())) return kFALSE;
+
+   if (fTree->InheritsFrom(TChain::Class())) return kFALSE;
+   if (fTree->GetEventList() || fTree->GetEntryList()) return kFALSE;
+   if (fTree->GetListOfFriends() && fTree->GetListOfFriends()->GetSize()) return kFALSE;
+   TFile *file = fTree->GetCurrentFile();
+   if (!file || file->IsWritable() || !fTree->GetDirectory()) return kFALSE;
+
+   return kTRUE;
+}
+
+//______________________________________________________________________________
+//
+// Helpers for TTreePlayer::ProcessParallel: the state shared by the threads
+// and the function executed by each of them.
+//
+class TProcessClusterQueue {
+public:
+   TMutex                 fMutex;        // Protects fNext and fAbort
+   std::vector<Long64_t>  fBoundaries;   // First entry of each cluster, plus the end of the range
+   UInt_t                 fNext;         // Next cluster to be processed
+   Bool_t                 fAbort;        // A selector requested to abort the processing
+   TString                fFileName;     // File containing the tree
+   TString                fTreeName;     // Path of the tree in the file
+   TString                fOption;       // Option passed to the selectors
+   TClass                *fSelectorClass;// Class of the selectors
+   TList                 *fInput;        // Input list shared by the selectors
+   Long64_t               fCacheSize;    // Size of the TTreeCache of each thread
+
+   TProcessClusterQueue() : fNext(0), fAbort(kFALSE), fSelectorClass(0), fInput(0), fCacheSize(0) {}
+
+   Bool_t NextCluster(Long64_t &first, Long64_t &last) {
+      // Get the next cluster [first,last[ to be processed, return false if none is left.
+      TLockGuard lock(&fMutex);
+      if (fAbort || fNext+1 >= fBoundaries.size()) return kFALSE;
+      first = fBoundaries[fNext];
+      last = fBoundaries[fNext+1];
+      ++fNext;
+      return kTRUE;
+   }
+   void Abort() {
+      TLockGuard lock(&fMutex);
+      fAbort = kTRUE;
+   }
+};
+
+class TProcessClusterWorker {
+public:
+   TProcessClusterQueue *fQueue;     // Clusters to be processed
+   TSelector            *fSelector;  // Selector created by this worker, 0 if the tree could not be opened
+   Bool_t                fFailed;    // The tree could not be opened or an entry could not be loaded
+
+   static void *Run(void *arg);
+};
+
+//______________________________________________________________________________
+void *TProcessClusterWorker::Run(void *arg)
+{
+   // Process the clusters of the queue with a new selector until none is left.
+
+   TProcessClusterWorker *worker = (TProcessClusterWorker*)arg;
+   TProcessClusterQueue *queue = worker->fQueue;
+
+   TFile *file;
+   TTree *tree;
+   {
+      // Reading a TTree goes through the global gTree (see TTree::Streamer
+      // and TBranch::Streamer), the threads must not read theirs together.
+      R__LOCKGUARD2(gROOTMutex);
+      TDirectory::TContext ctxt(0);
+      file = TFile::Open(queue->fFileName);
+      tree = file ? dynamic_cast<TTree*>(file->Get(queue->fTreeName)) : 0;
+   }
+   if (!tree) {
+      // Stop the other threads, the processing is reported as failed.
+      worker->fFailed = kTRUE;
+      queue->Abort();
+      R__LOCKGUARD2(gROOTMutex);
+      delete file;
+      return 0;
+   }
+   {
+      // The objects created by the selector must not be attached to the file.
+      TDirectory::TContext ctxt(0);
+
+      if (queue->fCacheSize > 0) tree->SetCacheSize(queue->fCacheSize);
+
+      TSelector *selector = (TSelector*)queue->fSelectorClass->New();
+      worker->fSelector = selector;
+      selector->SetOption(queue->fOption);
+      selector->SetInputList(queue->fInput);
+      tree->SetNotify(selector);
+      selector->SlaveBegin(tree);
+      selector->Init(tree);
+      selector->Notify();
+
+      Long64_t first, last;
+      while (selector->GetAbort() != TSelector::kAbortProcess && queue->NextCluster(first, last)) {
+         for (Long64_t entry = first; entry < last; ++entry) {
+            if (tree->LoadTree(entry) < 0) {
+               worker->fFailed = kTRUE;
+               break;
+            }
+            selector->Process(entry);
+            if (selector->GetAbort() != TSelector::kContinue) break;
+         }
+         if (worker->fFailed) break;
+      }
+      if (worker->fFailed || selector->GetAbort() != TSelector::kContinue) queue->Abort();
+
+      selector->SlaveTerminate();
+      tree->SetNotify(0);
+   }
+   R__LOCKGUARD2(gROOTMutex);
+   delete file;
+
+   return 0;
+}
+
+//______________________________________________________________________________
+Long64_t TTreePlayer::ProcessParallel(TSelector *selector, Option_t *option, Long64_t nentries, Long64_t firstentry, Int_t nthreads)
+{
+   // Process the entries [firstentry, firstentry+nentries[ of the tree with
+   // nthreads threads, each of them handling whole clusters.
+   //
+   // Begin and Terminate are called on selector in the calling thread.
+   // Each thread opens its own copy of the tree, with its own TTreeCache,
+   // and creates its own instance of the selector class, on which SlaveBegin,
+   // Init, Process and SlaveTerminate are called. Once all the clusters have
+   // been processed, the objects of the output lists of the thread selectors
+   // are merged into the output list of selector via their Merge(TCollection*)
+   // method, or just added to it if they cannot be merged, as done by PROOF.
+   // TSelector::kAbortFile is treated as kAbortProcess.
+   // If a thread cannot open the tree or load one of its entries, all the
+   // threads stop; the outputs processed so far are merged and terminated,
+   // and -1 is returned.
+
+   TProcessClusterQueue queue;
+   queue.fFileName = fTree->GetCurrentFile()->GetName();
+   TString path(fTree->GetDirectory()->GetPath());
+   Ssiz_t colon = path.Index(":/");
+   queue.fTreeName = colon >= 0 ? path(colon+2, path.Length()) : TString();
+   if (queue.fTreeName.Length()) queue.fTreeName += "/";
+   queue.fTreeName += fTree->GetName();
+   queue.fOption = option;
+   queue.fSelectorClass = selector->IsA();
+   queue.fInput = selector->GetInputList();
+   queue.fCacheSize = fTree->GetCacheSize();
+
+   Long64_t lastentry = firstentry + nentries;
+   TTree::TClusterIterator clusterIter = fTree->GetClusterIterator(firstentry);
+   Long64_t start;
+   while ((start = clusterIter()) < lastentry) {
+      queue.fBoundaries.push_back(start < firstentry ? firstentry : start);
+   }
+   queue.fBoundaries.push_back(lastentry);
+
+   TDirectory::TContext ctxt(0);
+
+   selector->SetOption(option);
+   selector->Begin(fTree);       //<===call user initialization function
+
+   if (gMonitoringWriter)
+      gMonitoringWriter->SendProcessingStatus("STARTED",kTRUE);
+
+   Bool_t failed = kFALSE;
+   if (selector->GetAbort() != TSelector::kAbortProcess) {
+      Int_t nclusters = Int_t(queue.fBoundaries.size()) - 1;
+      if (nthreads > nclusters) nthreads = nclusters;
+
+      std::vector<TProcessClusterWorker> workers(nthreads);
+      std::vector<TThread*> threads(nthreads);
+      for (Int_t i = 0; i < nthreads; ++i) {
+         workers[i].fQueue = &queue;
+         workers[i].fSelector = 0;
+         workers[i].fFailed = kFALSE;
+         threads[i] = new TThread(TProcessClusterWorker::Run, &workers[i]);
+         threads[i]->Run();
+      }
+      for (Int_t i = 0; i < nthreads; ++i) {
+         threads[i]->Join();
+         delete threads[i];
+      }
+
+      // Merge the outputs of the threads
+      TList *output = selector->GetOutputList();
+      Int_t nok = 0;
+      for (Int_t i = 0; i < nthreads; ++i) {
+         if (workers[i].fFailed) failed = kTRUE;
+         TSelector *wsel = workers[i].fSelector;
+         if (!wsel) continue;
+         ++nok;
+         TList *woutput = wsel->GetOutputList();
+         TObject *obj;
+         while ((obj = woutput->First())) {
+            woutput->Remove(obj);
+            TObject *target = output->FindObject(obj->GetName());
+            TMethodCall callEnv;
+            if (target && target->IsA())
+               callEnv.InitWithPrototype(target->IsA(), "Merge", "TCollection*");
+            if (callEnv.IsValid()) {
+               TList list;
+               list.Add(obj);
+               callEnv.SetParam((Long_t) &list);
+               callEnv.Execute(target);
+               delete obj;
+            } else {
+               output->Add(obj);
+            }
+         }
+         delete wsel;
+      }
+      if (!nok) {
+         Error("ProcessParallel", "Could not open tree %s in file %s",
+               queue.fTreeName.Data(), queue.fFileName.Data());
+         return -1;
+      }
+      if (failed) {
+         Error("ProcessParallel", "Could not read tree %s in file %s, the processing was stopped",
+               queue.fTreeName.Data(), queue.fFileName.Data());
+      }
+   }
+
+   if (selector->Version() != 0 || selector->GetStatus() != -1) {
+      selector->Terminate();        //<==call user termination function
+   }
+   if (gMonitoringWriter)
+      gMonitoringWriter->SendProcessingStatus("DONE");
+
+   return failed ? -1 : selector->GetStatus();
+}
+
 //______________________________________________________________________________
 void TTreePlayer::RecursiveRemove(TObject *obj)
 {